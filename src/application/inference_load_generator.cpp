@@ -0,0 +1,67 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file inference_load_generator.cpp
+ * \brief Local load generator - drives the inference server with concurrent clients sending random samples, reports the latency and throughput.
+ * \author tkornuta
+ * \date Oct 16, 2026
+ */
+
+#include <logger/Log.hpp>
+#include <logger/ConsoleOutput.hpp>
+using namespace mic::logger;
+
+#include <iostream>
+#include <cstdlib>
+
+#include <mlnn/InferenceClient.hpp>
+
+/**
+ * \brief Main function of the load generator.
+ * Usage: inference_load_generator <socket_path> <input_size> <output_size> [clients=16] [requests_per_client=1000]
+ */
+int main(int argc, char* argv[]) {
+	// Set console output.
+	LOGGER->addOutput(new ConsoleOutput());
+
+	if (argc < 4) {
+		std::cout << "Usage: " << argv[0] << " <socket_path> <input_size> <output_size> [clients=16] [requests_per_client=1000]" << std::endl;
+		return -1;
+	}//: if
+
+	size_t input_size = atoi(argv[2]);
+	size_t output_size = atoi(argv[3]);
+	size_t clients = (argc > 4) ? atoi(argv[4]) : 16;
+	size_t requests = (argc > 5) ? atoi(argv[5]) : 1000;
+
+	// Generate random samples.
+	std::vector<std::vector<float> > samples;
+	for (size_t i = 0; i < 100; i++) {
+		mic::types::MatrixPtr<float> x = MAKE_MATRIX_PTR(float, input_size, 1);
+		x->rand(0.0, 1.0);
+		samples.push_back(std::vector<float>(x->data(), x->data() + input_size));
+	}//: for
+
+	mic::mlnn::LoadGenerator<float> generator(argv[1], output_size);
+	mic::mlnn::InferenceStatistics stats = generator.run(samples, clients, requests);
+	std::cout << clients << " clients: " << stats << std::endl;
+	if (generator.failedRequests() > 0) {
+		std::cout << generator.failedRequests() << " requests failed!" << std::endl;
+		return -1;
+	}//: if
+
+	return 0;
+}
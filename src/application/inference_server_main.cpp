@@ -0,0 +1,81 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file inference_server_main.cpp
+ * \brief Inference server - loads a network and answers requests received over a Unix domain socket, dynamically batching concurrent requests.
+ * \author tkornuta
+ * \date Oct 16, 2026
+ */
+
+#include <logger/Log.hpp>
+#include <logger/ConsoleOutput.hpp>
+using namespace mic::logger;
+
+#include <iostream>
+#include <cstdlib>
+#include <csignal>
+
+#include <mlnn/InferenceServer.hpp>
+
+/// Flag set by the signal handler.
+volatile sig_atomic_t stop_requested = 0;
+
+/*!
+ * Handles SIGINT/SIGTERM - requests the server to stop.
+ */
+void handleSignal(int) {
+	stop_requested = 1;
+}
+
+
+/**
+ * \brief Main function of the inference server.
+ * Usage: inference_server <network_file> <socket_path> [max_batch_size=32] [max_latency_us=1000] [replicas=number of cores]
+ * Runs until SIGINT/SIGTERM, periodically reporting the latency and throughput.
+ */
+int main(int argc, char* argv[]) {
+	// Set console output.
+	LOGGER->addOutput(new ConsoleOutput());
+
+	if (argc < 3) {
+		std::cout << "Usage: " << argv[0] << " <network_file> <socket_path> [max_batch_size=32] [max_latency_us=1000] [replicas=number of cores]" << std::endl;
+		return -1;
+	}//: if
+
+	size_t max_batch_size = (argc > 3) ? atoi(argv[3]) : 32;
+	size_t max_latency_us = (argc > 4) ? atoi(argv[4]) : 1000;
+	size_t replicas = (argc > 5) ? atoi(argv[5]) : boost::thread::hardware_concurrency();
+
+	mic::mlnn::InferenceServer<float> server(argv[1], argv[2], max_batch_size, max_latency_us, replicas);
+	if (!server.start())
+		return -1;
+
+	signal(SIGINT, handleSignal);
+	signal(SIGTERM, handleSignal);
+
+	// Report statistics every 10 seconds.
+	size_t ticks = 0;
+	while (!stop_requested) {
+		usleep(100000);
+		if (++ticks % 100 == 0)
+			LOG(LINFO) << server.getStatistics();
+	}//: while
+
+	server.stop();
+	LOG(LINFO) << "Server stopped: " << server.getStatistics();
+
+	return 0;
+}
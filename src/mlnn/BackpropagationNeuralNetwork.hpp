@@ -44,7 +44,10 @@ public:
 	 * Constructor. Sets the neural network name.
 	 * @param name_ Name of the network.
 	 */
-	BackpropagationNeuralNetwork(std::string name_ = "bp_net") : MultiLayerNeuralNetwork<eT> (name_)
+	BackpropagationNeuralNetwork(std::string name_ = "bp_net") : MultiLayerNeuralNetwork<eT> (name_),
+		fused_softmax_cross_entropy(false),
+		replicas_generation(0),
+		async_workers_generation(0)
 	{
 		// Set default cross entropy loss function.
 		setLoss <mic::neural_nets::loss::CrossEntropyLoss<eT> >();
@@ -68,22 +71,53 @@ public:
 	}
 
 
+	/*!
+	 * Enables/disables the fused softmax-cross-entropy output mode. When enabled (and the last layer is Softmax and the loss is CrossEntropyLoss),
+	 * train() computes the softmax, the loss and the gradient y - t in a single pass (directly into the gradient of the softmax input),
+	 * instead of running the softmax forward, the loss gradient and the softmax backward separately.
+	 * @param fused_ Flag denoting whether the fused mode should be used (DEFAULT=true).
+	 */
+	void setFusedSoftmaxCrossEntropy(bool fused_ = true) {
+		fused_softmax_cross_entropy = fused_;
+	}
+
+	/*!
+	 * Returns the Softmax output layer if the fused softmax-cross-entropy mode is enabled and applicable, nullptr otherwise.
+	 */
+	std::shared_ptr<mic::mlnn::cost_function::Softmax<eT> > fusedSoftmaxLayer() {
+		if ((!fused_softmax_cross_entropy) || (layers.size() == 0) || (layers.back()->layer_type != LayerTypes::Softmax))
+			return nullptr;
+		if (!std::dynamic_pointer_cast< mic::neural_nets::loss::CrossEntropyLoss<eT> >(loss))
+			return nullptr;
+		return std::dynamic_pointer_cast< mic::mlnn::cost_function::Softmax<eT> >(layers.back());
+	}
+
 	/*!
 	 * Passes the data in a feed-forward manner through all consecutive layers, from the input to the output layer.
 	 * @param input_data Input data - a matrix containing [sample_size x batch_size].
 	 * @param skip_dropout Flag for skipping dropouts - which should be set to true during testing.
 	 */
 	void forward(mic::types::MatrixPtr<eT> input_data, bool skip_dropout = false)  {
+		forward(input_data, skip_dropout, layers.size());
+	}
+
+	/*!
+	 * Passes the data in a feed-forward manner through the given number of consecutive layers, starting from the input layer.
+	 * @param input_data Input data - a matrix containing [sample_size x batch_size].
+	 * @param skip_dropout Flag for skipping dropouts - which should be set to true during testing.
+	 * @param num_layers_ Number of layers to be computed.
+	 */
+	void forward(mic::types::MatrixPtr<eT> input_data, bool skip_dropout, size_t num_layers_)  {
 		// Make sure that there are some layers in the nn!
 		assert(layers.size() != 0);
 
 		// Boost::Matrix is col major!
 		LOG(LDEBUG) << "Inputs size: " << input_data->rows() << "x" << input_data->cols();
-		LOG(LDEBUG) << "First layer input matrix size: " <<  layers[0]->s['x']->rows() << "x" << layers[0]->s['x']->cols();
+		LOG(LDEBUG) << "First layer input matrix size: " <<  layers[0]->s[layers[0]->hx]->rows() << "x" << layers[0]->s[layers[0]->hx]->cols();
 
 		// Make sure that the dimensions are ok.
 		// Check only rows, as cols determine the batch size - and we allow them to be dynamically changing!.
-		assert((layers[0]->s['x'])->rows() == input_data->rows());
+		assert((layers[0]->s[layers[0]->hx])->rows() == input_data->rows());
 		//LOG(LDEBUG) <<" input_data: " << input_data.transpose();
 
 		// Connect layers by setting the input matrices pointers to point the output matrices.
@@ -95,27 +129,45 @@ public:
 			if (layers.size() > 1)
 				for (size_t i = 0; i < layers.size()-1; i++) {
 					// Connect pointers.
-					layers[i+1]->s['x'] = layers[i]->s['y'];
-					layers[i]->g['y'] = layers[i+1]->g['x'];
+					layers[i+1]->s[layers[i+1]->hx] = layers[i]->s[layers[i]->hy];
+					layers[i]->g[layers[i]->hy] = layers[i+1]->g[layers[i+1]->hx];
 				}//: for
 			connected = true;
+			// Find blocks of layers that can be executed as single operations, then plan the memory according to them.
+			fuseLayers();
+			planMemory();
 		}
 
-		//assert((layers[0]->s['x'])->cols() == input_data->cols());
+		//assert((layers[0]->s[layers[0]->hx])->cols() == input_data->cols());
 		// Change the size of batch - if required.
 		resizeBatch(input_data->cols());
 
-		// Copy inputs to the lowest point in the network.
-		(*(layers[0]->s['x'])) = (*input_data);
+		// Pass inputs to the lowest point in the network (copy or bind).
+		MLNN_PROFILE(profiler, ProfiledPhase::Feeding, "input", input_data->size() * sizeof(eT),
+				setInput(input_data));
+
+		// Frozen network works only in the test mode.
+		if (frozen)
+			skip_dropout = true;
 
 		// Compute the forward activations.
-		for (size_t i = 0; i < layers.size(); i++) {
+		for (size_t i = 0; i < num_layers_; i++) {
+			// Blocks of fused layers are executed as single operations.
+			const FusedBlock* block = fusedBlockStartingAt(i, num_layers_);
+			if (block) {
+				MLNN_PROFILE(profiler, ProfiledPhase::Forward, block->name, bytesTouched(*block, ProfiledPhase::Forward),
+						forwardFusedBlock(*block, skip_dropout));
+				i += block->count - 1;
+				continue;
+			}//: if
+
 			LOG(LDEBUG) << "Layer [" << i << "] " << layers[i]->name() << ": (" <<
 					layers[i]->inputSize() << "x" << layers[i]->batchSize() << ") -> (" <<
 					layers[i]->outputSize() << "x" << layers[i]->batchSize() << ")";
 
 			// Perform the forward computation: y = f(x).
-			layers[i]->forward(skip_dropout);
+			MLNN_PROFILE(profiler, ProfiledPhase::Forward, layers[i]->name(), bytesTouched(layers[i], ProfiledPhase::Forward),
+					layers[i]->forward(skip_dropout));
 
 		}
 		//LOG(LDEBUG) <<" predictions: " << getPredictions()->transpose();
@@ -132,14 +184,14 @@ public:
 			for (size_t i = 0; i < layers.size()-1; i++) {
 				bool layer_ok = true;
 				// Check inputs.
-				if (layers[i]->s['y']->rows() != layers[i+1]->s['x']->rows()) {
+				if (layers[i]->s[layers[i]->hy]->rows() != layers[i+1]->s[layers[i+1]->hx]->rows()) {
 					LOG(LERROR) << "Layer["<<i<<"].y differs from " << "Layer["<<i+1<<"].x";
 					ok = false;
 					layer_ok = false;
 				}
 
 				// Check gradients.
-				if (layers[i]->g['y']->rows() != layers[i+1]->g['x']->rows()) {
+				if (layers[i]->g[layers[i]->hy]->rows() != layers[i+1]->g[layers[i+1]->hx]->rows()) {
 					LOG(LERROR) << "Layer["<<i<<"].dy differs from " << "Layer["<<i+1<<"].dx";
 					ok = false;
 					layer_ok = false;
@@ -162,21 +214,39 @@ public:
 		// Make sure that there are some layers in the nn!
 		assert(layers.size() != 0);
 
-		LOG(LDEBUG) << "Last layer output gradient matrix size: " << layers.back()->g['y']->cols() << "x" << layers.back()->g['y']->rows();
+		LOG(LDEBUG) << "Last layer output gradient matrix size: " << layers.back()->g[layers.back()->hy]->cols() << "x" << layers.back()->g[layers.back()->hy]->rows();
 		LOG(LDEBUG) << "Passed target matrix size: " <<  gradients_->cols() << "x" << gradients_->rows();
 
 		// Make sure that the dimensions are ok.
-		assert((layers.back()->g['y'])->cols() == gradients_->cols());
-		assert((layers.back()->g['y'])->rows() == gradients_->rows());
+		assert((layers.back()->g[layers.back()->hy])->cols() == gradients_->cols());
+		assert((layers.back()->g[layers.back()->hy])->rows() == gradients_->rows());
 
-		// Set gradient of the last layer - COPY data.
-		(*(layers.back()->g['y'])) = (*gradients_);
+		// Set gradient of the last layer (copy or bind).
+		setOutputGradient(gradients_);
 
 		// Back-propagate the gradients.
-		for (int i = layers.size() - 1; i >= 0; i--) {
-			layers[i]->backward();
-		}//: for
+		backward(layers.size());
+	}
 
+	/*!
+	 * Back-propagates the gradients through the given number of layers, starting from the one with index num_layers_-1 down to the first one.
+	 * Assumes that the gradient at the output of layer num_layers_-1 was already set.
+	 * @param num_layers_ Number of layers.
+	 */
+	void backward(size_t num_layers_) {
+		for (int i = (int)num_layers_ - 1; i >= 0; i--) {
+			// Blocks of fused layers are executed as single operations.
+			const FusedBlock* block = fusedBlockEndingAt(i, num_layers_);
+			if (block) {
+				MLNN_PROFILE(profiler, ProfiledPhase::Backward, block->name, bytesTouched(*block, ProfiledPhase::Backward),
+						backwardFusedBlock(*block));
+				i -= block->count - 1;
+				continue;
+			}//: if
+
+			MLNN_PROFILE(profiler, ProfiledPhase::Backward, layers[i]->name(), bytesTouched(layers[i], ProfiledPhase::Backward),
+					layers[i]->backward());
+		}//: for
 	}
 
 
@@ -189,6 +259,49 @@ public:
 	 * @return Loss computed according to the selected loss function. If function not set - returns INF.
 	 */
 	eT train(mic::types::MatrixPtr<eT> encoded_batch_, mic::types::MatrixPtr<eT> encoded_targets_, eT learning_rate_, eT decay_ = 0.0f) {
+		if (frozen) {
+			LOG(LERROR) << "Network " << name << " is frozen - it cannot be trained!";
+			return 0;
+		}//: if
+
+		// Shard the batch between replicas.
+		if (replicas.size() > 0)
+			return trainDataParallel(encoded_batch_, encoded_targets_, learning_rate_, decay_);
+
+		// Calculate the gradients.
+		eT loss_value = calculateGradients(encoded_batch_, encoded_targets_);
+
+		// Apply the changes - according to the optimization function.
+		update(learning_rate_, decay_);
+
+		// Return loss.
+		return loss_value;
+	}
+
+	/*!
+	 * Calculates the gradients of all parameters for a given batch, i.e. performs the forward and backward passes, without updating the parameters.
+	 * @param encoded_batch_ Batch encoded in the form of matrix of size [sample_size x batch_size].
+	 * @param encoded_targets_ Targets (labels) encoded in the form of matrix of size [label_size x batch_size].
+	 * @return Loss computed according to the selected loss function (divided by the batch size).
+	 */
+	eT calculateGradients(mic::types::MatrixPtr<eT> encoded_batch_, mic::types::MatrixPtr<eT> encoded_targets_) {
+		// Use fused softmax-cross-entropy, if possible.
+		std::shared_ptr<mic::mlnn::cost_function::Softmax<eT> > softmax = fusedSoftmaxLayer();
+		if (softmax) {
+			// Forward propagate the activations from first layer to the one preceding softmax.
+			forward(encoded_batch_, false, layers.size() - 1);
+
+			// Calculate softmax, loss and gradient of its input at once.
+			eT loss_value;
+			MLNN_PROFILE(profiler, ProfiledPhase::Loss, softmax->name(), 4 * encoded_targets_->size() * sizeof(eT),
+					loss_value = softmax->forwardCrossEntropy(encoded_targets_));
+
+			// Backpropagate the gradients from the layer preceding softmax to the first.
+			backward(layers.size() - 1);
+
+			// Return mean value of the loss function (i.e. loss divided by the batch size).
+			return loss_value / encoded_targets_->cols();
+		}//: if
 
 		// Forward propagate the activations from first layer to the last.
 		forward(encoded_batch_);
@@ -197,21 +310,110 @@ public:
 		mic::types::MatrixPtr<eT> encoded_predictions = getPredictions();
 
 		// Calculate gradient according to the loss function.
-		mic::types::MatrixPtr<eT> dy = loss->calculateGradient(encoded_targets_, encoded_predictions);
+		mic::types::MatrixPtr<eT> dy;
+		MLNN_PROFILE(profiler, ProfiledPhase::Loss, "loss gradient", 3 * encoded_targets_->size() * sizeof(eT),
+				dy = loss->calculateGradient(encoded_targets_, encoded_predictions));
 
 		// Backpropagate the gradients from last layer to the first.
 		backward(dy);
 
-		// Apply the changes - according to the optimization function.
-		update(learning_rate_, decay_);
-
 		// Calculate mean value of the loss function (i.e. loss divided by the batch size).
-		eT loss_value = loss->calculateMeanLoss(encoded_targets_, encoded_predictions);
-
-		// Return loss.
+		eT loss_value;
+		MLNN_PROFILE(profiler, ProfiledPhase::Loss, "loss", 2 * encoded_targets_->size() * sizeof(eT),
+				loss_value = loss->calculateMeanLoss(encoded_targets_, encoded_predictions));
 		return loss_value;
 	}
 
+	/*!
+	 * Enables data-parallel training: every batch passed to train() is split into (nearly) equal shards, processed in parallel by replicas of the network
+	 * that share parameters with it but have their own activations and gradients. Gradients of the replicas are then summed (always in the same order,
+	 * so the results are deterministic for a given number of replicas) and the network performs a single update.
+	 * Must be called when the network is complete (replicas are recreated when layers are replaced, e.g. pushed or loaded).
+	 * @param num_replicas_ Number of replicas (0 or 1 disables data-parallel training).
+	 * @return True if replicas were created.
+	 */
+	bool setDataParallel(size_t num_replicas_) {
+		replicas.clear();
+		if (num_replicas_ <= 1)
+			return false;
+
+		for (size_t r = 0; r < num_replicas_; r++) {
+			std::shared_ptr<BackpropagationNeuralNetwork<eT> > replica = createReplica(r, false);
+			if (!replica) {
+				replicas.clear();
+				return false;
+			}//: if
+			replicas.push_back(replica);
+		}//: for
+		replicas_generation = layers_generation;
+
+		shard_inputs.resize(num_replicas_);
+		shard_targets.resize(num_replicas_);
+		shard_losses.resize(num_replicas_);
+		for (size_t r = 0; r < num_replicas_; r++) {
+			shard_inputs[r] = MAKE_MATRIX_PTR(eT, 1, 1);
+			shard_targets[r] = MAKE_MATRIX_PTR(eT, 1, 1);
+		}//: for
+		return true;
+	}
+
+	/*!
+	 * Trains the network asynchronously (in the Hogwild! fashion): batches are distributed between workers running in parallel,
+	 * each of them performing forward and backward passes on its own and applying the update directly to the parameters shared with the network, without any locks.
+	 * Workers are replicas of the network with their own activations, gradients and optimization functions (copies of the ones of the network).
+	 * As the updates of different workers interleave, results are not deterministic.
+	 * @param encoded_batches_ Vector of batches, each encoded in the form of matrix of size [sample_size x batch_size].
+	 * @param encoded_targets_ Vector of targets (labels), each encoded in the form of matrix of size [label_size x batch_size].
+	 * @param learning_rate_ The learning rate.
+	 * @param decay_ Weight decay rate (determining that the "unused/unupdated" weights will decay to 0) (DEFAULT=0.0 - no decay).
+	 * @param num_workers_ Number of workers (0 - train sequentially).
+	 * @return Mean loss of all batches (each computed before the update performed with the given batch).
+	 */
+	eT trainAsynchronous(const std::vector<mic::types::MatrixPtr<eT> > & encoded_batches_, const std::vector<mic::types::MatrixPtr<eT> > & encoded_targets_, eT learning_rate_, eT decay_, size_t num_workers_) {
+		assert(encoded_batches_.size() == encoded_targets_.size());
+		if (encoded_batches_.size() == 0)
+			return 0;
+
+		// (Re)create the workers - also when the layers were replaced, as the workers would update the old parameters with the old optimization functions.
+		if ((async_workers.size() != num_workers_) || (async_workers_generation != layers_generation)) {
+			async_workers.clear();
+			for (size_t w = 0; w < num_workers_; w++) {
+				std::shared_ptr<BackpropagationNeuralNetwork<eT> > worker = createReplica(w, true);
+				if (!worker) {
+					async_workers.clear();
+					break;
+				}//: if
+				async_workers.push_back(worker);
+			}//: for
+			async_workers_generation = layers_generation;
+		}//: if
+
+		eT loss_value = 0;
+		if (async_workers.empty()) {
+			// Fall back to sequential training.
+			if (num_workers_ > 0)
+				LOG(LWARNING) << "Network " << name << " cannot be trained asynchronously - training sequentially";
+			for (size_t b = 0; b < encoded_batches_.size(); b++)
+				loss_value += train(encoded_batches_[b], encoded_targets_[b], learning_rate_, decay_);
+			return loss_value / encoded_batches_.size();
+		}//: if
+
+		// Every worker processes every num_workers_-th batch.
+		std::vector<eT> worker_losses(num_workers_, 0);
+#pragma omp parallel for schedule(static, 1) num_threads(num_workers_)
+		for (size_t w = 0; w < num_workers_; w++)
+			for (size_t b = w; b < encoded_batches_.size(); b += num_workers_)
+				worker_losses[w] += async_workers[w]->train(encoded_batches_[b], encoded_targets_[b], learning_rate_, decay_);
+
+		// Parameters have changed.
+		for (size_t i = 0; i < layers.size(); i++)
+			layers[i]->invalidateParameterCaches();
+
+		for (size_t w = 0; w < num_workers_; w++)
+			loss_value += worker_losses[w];
+		return loss_value / encoded_batches_.size();
+	}
+
 
 	/*!
 	 * Tests the neural network with a given batch.
@@ -254,12 +456,168 @@ protected:
 	// Unhide the overloaded protected methods & fields inherited from the template class MultiLayerNeuralNetwork fields via "using" statement.
 	using MultiLayerNeuralNetwork<eT>::layers;
 	using MultiLayerNeuralNetwork<eT>::connected;
+	using MultiLayerNeuralNetwork<eT>::name;
+	using MultiLayerNeuralNetwork<eT>::replicateLayer;
+	using MultiLayerNeuralNetwork<eT>::collectParameterSegments;
+	using MultiLayerNeuralNetwork<eT>::updateParameters;
+	using MultiLayerNeuralNetwork<eT>::parameter_segments;
+	using MultiLayerNeuralNetwork<eT>::update_chunks;
+	using MultiLayerNeuralNetwork<eT>::multi_tensor_update;
+	using MultiLayerNeuralNetwork<eT>::layers_generation;
+	using MultiLayerNeuralNetwork<eT>::max_gradient_norm;
+	using MultiLayerNeuralNetwork<eT>::bind_inputs;
+	using MultiLayerNeuralNetwork<eT>::frozen;
+	using MultiLayerNeuralNetwork<eT>::setInput;
+	using MultiLayerNeuralNetwork<eT>::setOutputGradient;
+	using MultiLayerNeuralNetwork<eT>::profiler;
+	using MultiLayerNeuralNetwork<eT>::bytesTouched;
+	using MultiLayerNeuralNetwork<eT>::layer_fusion;
+	using MultiLayerNeuralNetwork<eT>::fuseLayers;
+	using MultiLayerNeuralNetwork<eT>::memory_planning;
+	using MultiLayerNeuralNetwork<eT>::planMemory;
+	using MultiLayerNeuralNetwork<eT>::fusedBlockStartingAt;
+	using MultiLayerNeuralNetwork<eT>::fusedBlockEndingAt;
+	using MultiLayerNeuralNetwork<eT>::forwardFusedBlock;
+	using MultiLayerNeuralNetwork<eT>::backwardFusedBlock;
+	typedef typename MultiLayerNeuralNetwork<eT>::FusedBlock FusedBlock;
+	typedef typename MultiLayerNeuralNetwork<eT>::UpdateChunk UpdateChunk;
 
 	/*!
 	 * Pointer to loss function.
 	 */
 	std::shared_ptr<mic::neural_nets::loss::Loss<eT> > loss;
 
+	/*!
+	 * Flag denoting whether the fused softmax-cross-entropy output mode is enabled.
+	 */
+	bool fused_softmax_cross_entropy;
+
+	/// Replicas of the network used in data-parallel training.
+	std::vector<std::shared_ptr<BackpropagationNeuralNetwork<eT> > > replicas;
+
+	/// Shards of the batch processed by the replicas.
+	std::vector<mic::types::MatrixPtr<eT> > shard_inputs;
+
+	/// Shards of the targets processed by the replicas.
+	std::vector<mic::types::MatrixPtr<eT> > shard_targets;
+
+	/// Losses of the replicas (summed over their shards).
+	std::vector<eT> shard_losses;
+
+	/// Generation of the layers the replicas were created from.
+	size_t replicas_generation;
+
+	/// Workers used in asynchronous training.
+	std::vector<std::shared_ptr<BackpropagationNeuralNetwork<eT> > > async_workers;
+
+	/// Generation of the layers the workers were created from.
+	size_t async_workers_generation;
+
+	/*!
+	 * Creates a replica of the network, i.e. a network consisting of replicas of its layers (sharing parameters with them).
+	 * @param index_ Index of the replica (used for deriving the seeds of dropout layers).
+	 * @param own_optimization_ Flag denoting whether layers of the replica should have their own copies of the optimization functions (i.e. update the parameters on their own).
+	 * @return Replica or nullptr if any of the layers cannot be replicated.
+	 */
+	std::shared_ptr<BackpropagationNeuralNetwork<eT> > createReplica(size_t index_, bool own_optimization_) {
+		std::shared_ptr<BackpropagationNeuralNetwork<eT> > replica = std::make_shared<BackpropagationNeuralNetwork<eT> >(name + "_replica" + std::to_string(index_));
+		replica->loss = loss;
+		replica->fused_softmax_cross_entropy = fused_softmax_cross_entropy;
+		replica->multi_tensor_update = multi_tensor_update;
+		replica->max_gradient_norm = max_gradient_norm;
+		replica->layer_fusion = layer_fusion;
+		replica->memory_planning = memory_planning;
+		// Replicas process batches that are not modified during training - bind them.
+		replica->bind_inputs = true;
+		for (size_t i = 0; i < layers.size(); i++) {
+			std::shared_ptr<Layer<eT> > layer = replicateLayer(layers[i]);
+			if (!layer)
+				return nullptr;
+			// Draw different dropout masks in every replica.
+			if (layer->layer_type == LayerTypes::Dropout) {
+				std::shared_ptr<Dropout<eT> > dropout = std::dynamic_pointer_cast<Dropout<eT> >(layer);
+				dropout->setSeed(dropout->getSeed() ^ (0x9e3779b97f4a7c15ULL * (index_ + 1)));
+			}//: if
+			if (own_optimization_) {
+				for (size_t j = 0; j < layer->opt.size(); j++) {
+					layer->opt[j] = layer->opt[j]->clone();
+					if (!layer->opt[j]) {
+						LOG(LERROR) << "Optimization function of layer " << layer->name() << " cannot be copied!";
+						return nullptr;
+					}//: if
+				}//: for
+			}//: if
+			replica->layers.push_back(layer);
+		}//: for
+		return replica;
+	}
+
+	/*!
+	 * Performs a data-parallel training step.
+	 * @param encoded_batch_ Batch encoded in the form of matrix of size [sample_size x batch_size].
+	 * @param encoded_targets_ Targets (labels) encoded in the form of matrix of size [label_size x batch_size].
+	 * @param learning_rate_ The learning rate.
+	 * @param decay_ Weight decay rate.
+	 * @return Loss computed according to the selected loss function (divided by the batch size).
+	 */
+	eT trainDataParallel(mic::types::MatrixPtr<eT> encoded_batch_, mic::types::MatrixPtr<eT> encoded_targets_, eT learning_rate_, eT decay_) {
+		// Recreate replicas if the layers were replaced - otherwise the replicas would share the old parameters.
+		if ((replicas_generation != layers_generation) && !setDataParallel(replicas.size()))
+			return train(encoded_batch_, encoded_targets_, learning_rate_, decay_);
+
+		size_t batch_size = encoded_batch_->cols();
+		// Use at most one replica per sample.
+		size_t num_shards = (batch_size < replicas.size()) ? batch_size : replicas.size();
+
+		// Split the batch - the first (batch_size % num_shards) shards get one sample more.
+		size_t begin = 0;
+		for (size_t r = 0; r < num_shards; r++) {
+			size_t cols = batch_size / num_shards + ((r < batch_size % num_shards) ? 1 : 0);
+			(*shard_inputs[r]) = encoded_batch_->block(0, begin, encoded_batch_->rows(), cols);
+			(*shard_targets[r]) = encoded_targets_->block(0, begin, encoded_targets_->rows(), cols);
+			begin += cols;
+		}//: for
+
+		// Calculate gradients in parallel.
+#pragma omp parallel for schedule(static)
+		for (size_t r = 0; r < num_shards; r++)
+			shard_losses[r] = replicas[r]->calculateGradients(shard_inputs[r], shard_targets[r]) * shard_inputs[r]->cols();
+
+		// Sum the gradients of the replicas - in a fixed order.
+		collectParameterSegments();
+		std::vector<std::vector<ParameterSegment<eT> > > replica_segments(num_shards);
+		for (size_t r = 0; r < num_shards; r++)
+			for (size_t i = 0; i < layers.size(); i++)
+				replicas[r]->layers[i]->getParameterSegments(replica_segments[r]);
+
+#pragma omp parallel for schedule(static)
+		for (size_t c = 0; c < update_chunks.size(); c++) {
+			const UpdateChunk & chunk = update_chunks[c];
+			eT* dp = parameter_segments[chunk.segment].dp->data();
+			for (size_t i = chunk.begin; i < chunk.end; i++)
+				dp[i] = 0;
+			for (size_t r = 0; r < num_shards; r++) {
+				const eT* replica_dp = replica_segments[r][chunk.segment].dp->data();
+				for (size_t i = chunk.begin; i < chunk.end; i++)
+					dp[i] += replica_dp[i];
+			}//: for
+		}//: for
+
+		// Apply the changes - gradients are cumulated for the whole batch.
+		updateParameters(learning_rate_ / batch_size, decay_);
+
+		// Parameters have changed.
+		for (size_t r = 0; r < replicas.size(); r++)
+			for (size_t i = 0; i < layers.size(); i++)
+				replicas[r]->layers[i]->invalidateParameterCaches();
+
+		// Return mean value of the loss.
+		eT loss_value = 0;
+		for (size_t r = 0; r < num_shards; r++)
+			loss_value += shard_losses[r];
+		return loss_value / batch_size;
+	}
+
 };
 
 } /* namespace mlnn */
@@ -0,0 +1,379 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file BatchPipeline.hpp
+ * \brief Pipeline preparing batches on background threads.
+ * \author tkornuta
+ * \date Oct 16, 2026
+ */
+
+#ifndef SRC_MLNN_BATCHPIPELINE_HPP_
+#define SRC_MLNN_BATCHPIPELINE_HPP_
+
+#include <types/MatrixTypes.hpp>
+#include <mlnn/Profiler.hpp>
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cassert>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/bind.hpp>
+
+namespace mic {
+namespace encoders {
+// Forward declarations of encoders (from MIToolchain) encoded in place by the pipeline.
+class MatrixXfMatrixXfEncoder;
+class UIntMatrixXfEncoder;
+} /* namespace encoders */
+
+namespace mlnn {
+
+/*!
+ * \brief Pipeline preparing (e.g. sampling and encoding) the next batches on background threads, so the preparation overlaps with training/testing.
+ * Batches are stored in a ring of preallocated slots and handed to the consumer in the order of their indices, without copying.
+ * A slot returned by next() remains valid until the following call of next() (or stop()), so the pipeline must be consumed by a single thread.
+ * \author tkornuta
+ * \tparam eT Template type (single/double precision)
+ */
+template <typename eT=float>
+class BatchPipeline {
+public:
+	/*!
+	 * Function preparing a batch: receives the index of the batch and fills the (preallocated) inputs and targets matrices.
+	 * Might be called concurrently by several threads (for different batches).
+	 */
+	typedef std::function<void(size_t, mic::types::MatrixPtr<eT>, mic::types::MatrixPtr<eT>)> FillFunction;
+
+	/*!
+	 * Constructor. Allocates the ring of slots.
+	 * @param input_size_ Size of the inputs (number of rows of the inputs matrix).
+	 * @param target_size_ Size of the targets (number of rows of the targets matrix).
+	 * @param batch_size_ Size of the batch (number of columns of both matrices).
+	 * @param depth_ Number of slots, i.e. the maximal number of batches prepared in advance.
+	 * @param num_threads_ Number of background threads.
+	 * @param fill_ Function preparing the batches.
+	 */
+	BatchPipeline(size_t input_size_, size_t target_size_, size_t batch_size_, size_t depth_, size_t num_threads_, FillFunction fill_)
+		: depth(depth_ > 0 ? depth_ : 1), num_threads(num_threads_ > 0 ? num_threads_ : 1), fill(fill_),
+		  num_batches(0), produced(0), consumed(0), released(0), running(false)
+	{
+		for (size_t i = 0; i < depth; i++) {
+			Slot slot;
+			slot.inputs = MAKE_MATRIX_PTR(eT, input_size_, batch_size_);
+			slot.targets = MAKE_MATRIX_PTR(eT, target_size_, batch_size_);
+			slot.ready = false;
+			slot.index = 0;
+			slots.push_back(slot);
+		}//: for
+	}
+
+	/*!
+	 * Destructor. Stops the background threads.
+	 */
+	virtual ~BatchPipeline() {
+		stop();
+	}
+
+	/*!
+	 * Starts (or restarts) the background threads.
+	 * @param num_batches_ Number of batches to be prepared (DEFAULT=0 - unlimited).
+	 */
+	void start(size_t num_batches_ = 0) {
+		stop();
+
+		num_batches = num_batches_;
+		produced = 0;
+		consumed = 0;
+		released = 0;
+		for (size_t i = 0; i < depth; i++)
+			slots[i].ready = false;
+		running = true;
+
+		for (size_t t = 0; t < num_threads; t++)
+			threads.create_thread(boost::bind(&BatchPipeline<eT>::produce, this));
+	}
+
+	/*!
+	 * Stops the background threads (waits till batches being currently prepared are ready).
+	 */
+	void stop() {
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			running = false;
+		}
+		slot_filled.notify_all();
+		slot_released.notify_all();
+		threads.join_all();
+	}
+
+	/*!
+	 * Releases the previously returned batch and returns the next one - waits until it is ready.
+	 * @param inputs_ Set to the matrix with inputs of the batch.
+	 * @param targets_ Set to the matrix with targets of the batch.
+	 * @return False if the pipeline was stopped or all batches were already consumed.
+	 */
+	bool next(mic::types::MatrixPtr<eT> & inputs_, mic::types::MatrixPtr<eT> & targets_) {
+		bool ready;
+		MLNN_PROFILE(profiler, ProfiledPhase::Feeding, "batch pipeline", (slots[0].inputs->size() + slots[0].targets->size()) * sizeof(eT),
+				ready = nextBatch(inputs_, targets_));
+		return ready;
+	}
+
+	/*!
+	 * Sets the profiler recording the time the consumer waits for the batches in next().
+	 * @param profiler_ Profiler (nullptr disables profiling).
+	 */
+	void setProfiler(std::shared_ptr<Profiler> profiler_) {
+		profiler = profiler_;
+	}
+
+
+	/*!
+	 * Creates a function preparing batches by sampling random batches from an importer and encoding them.
+	 * Batches are sampled from the importer in the order of their indices (so a seeded importer produces the same sequence of batches regardless of the number of threads) and encoded concurrently.
+	 * Inputs and targets are encoded directly into the matrices of the slot - see encodeBatch() - every call using its own copies of the encoders (which must be copyable).
+	 * @param importer_ Importer (e.g. MNISTMatrixImporter).
+	 * @param input_encoder_ Encoder of the data (e.g. MatrixXfMatrixXfEncoder).
+	 * @param target_encoder_ Encoder of the labels (e.g. UIntMatrixXfEncoder).
+	 */
+	template <typename ImporterT, typename InputEncoderT, typename TargetEncoderT>
+	static FillFunction randomBatches(ImporterT & importer_, InputEncoderT & input_encoder_, TargetEncoderT & target_encoder_) {
+		return encodingFunction(input_encoder_, target_encoder_, [&importer_]() { return importer_.getRandomBatch(); });
+	}
+
+	/*!
+	 * Creates a function preparing batches by taking the consecutive batches from an importer and encoding them.
+	 * Batches are taken from the importer in the order of their indices (i.e. the batch of index i contains the i-th consecutive batch) and encoded concurrently.
+	 * Inputs and targets are encoded directly into the matrices of the slot - see encodeBatch() - every call using its own copies of the encoders (which must be copyable).
+	 * @param importer_ Importer (e.g. MNISTMatrixImporter) - next batches are taken starting from its current sample index.
+	 * @param input_encoder_ Encoder of the data (e.g. MatrixXfMatrixXfEncoder).
+	 * @param target_encoder_ Encoder of the labels (e.g. UIntMatrixXfEncoder).
+	 */
+	template <typename ImporterT, typename InputEncoderT, typename TargetEncoderT>
+	static FillFunction nextBatches(ImporterT & importer_, InputEncoderT & input_encoder_, TargetEncoderT & target_encoder_) {
+		return encodingFunction(input_encoder_, target_encoder_, [&importer_]() { return importer_.getNextBatch(); });
+	}
+
+	/*!
+	 * Encodes a batch of samples with the given encoder and copies the result into the batch matrix.
+	 * Fallback for encoders that cannot encode in place.
+	 * @param encoder_ Encoder.
+	 * @param samples_ Samples.
+	 * @param batch_ Matrix the encoded samples are stored in (one sample per column).
+	 */
+	template <typename EncoderT, typename SamplesT>
+	static void encodeBatch(EncoderT & encoder_, SamplesT & samples_, mic::types::MatrixPtr<eT> batch_) {
+		(*batch_) = (*encoder_.encodeBatch(samples_));
+	}
+
+	/*!
+	 * Encodes a batch of matrices in place, storing every (flattened) matrix in a column of the batch matrix - as MatrixXfMatrixXfEncoder does.
+	 * @param samples_ Samples.
+	 * @param batch_ Matrix the encoded samples are stored in (one sample per column).
+	 */
+	static void encodeBatch(mic::encoders::MatrixXfMatrixXfEncoder &, std::vector<mic::types::MatrixXfPtr> & samples_, mic::types::MatrixPtr<eT> batch_) {
+		assert(samples_.size() == (size_t)batch_->cols());
+		for (size_t i = 0; i < samples_.size(); i++) {
+			assert((size_t)samples_[i]->size() == (size_t)batch_->rows());
+			batch_->col(i) = Eigen::Map<const Eigen::VectorXf>(samples_[i]->data(), samples_[i]->size()).template cast<eT>();
+		}//: for
+	}
+
+	/*!
+	 * Encodes a batch of labels in place, storing the one-hot encoding of every label in a column of the batch matrix - as UIntMatrixXfEncoder does.
+	 * @param samples_ Labels.
+	 * @param batch_ Matrix the encoded labels are stored in (one label per column).
+	 */
+	static void encodeBatch(mic::encoders::UIntMatrixXfEncoder &, std::vector<std::shared_ptr<unsigned int> > & samples_, mic::types::MatrixPtr<eT> batch_) {
+		assert(samples_.size() == (size_t)batch_->cols());
+		batch_->setZero();
+		for (size_t i = 0; i < samples_.size(); i++) {
+			assert((size_t)*samples_[i] < (size_t)batch_->rows());
+			(*batch_)(*samples_[i], i) = 1;
+		}//: for
+	}
+
+private:
+	/*!
+	 * \brief Slot of the ring.
+	 */
+	struct Slot {
+		/// Inputs of the batch.
+		mic::types::MatrixPtr<eT> inputs;
+
+		/// Targets of the batch.
+		mic::types::MatrixPtr<eT> targets;
+
+		/// Flag denoting whether the batch is ready.
+		bool ready;
+
+		/// Index of the batch stored in the slot.
+		size_t index;
+	};
+
+	/*!
+	 * \brief Order in which the batches are sampled from the importer - shared by all calls of a function created by encodingFunction().
+	 */
+	struct SamplingOrder {
+		/// Mutex guarding the importer.
+		boost::mutex mutex;
+
+		/// Condition variable signalled when a batch is sampled.
+		boost::condition_variable sampled;
+
+		/// Index of the batch to be sampled next.
+		size_t next;
+	};
+
+	/*!
+	 * Creates a function sampling batches (in the order of their indices) and encoding them (concurrently) directly into the slots.
+	 * @param input_encoder_ Encoder of the data.
+	 * @param target_encoder_ Encoder of the labels.
+	 * @param sample_ Function returning the next batch sampled from the importer.
+	 */
+	template <typename InputEncoderT, typename TargetEncoderT, typename SampleT>
+	static FillFunction encodingFunction(InputEncoderT & input_encoder_, TargetEncoderT & target_encoder_, SampleT sample_) {
+		std::shared_ptr<SamplingOrder> order = std::make_shared<SamplingOrder>();
+		order->next = 0;
+		return [&input_encoder_, &target_encoder_, sample_, order](size_t index_, mic::types::MatrixPtr<eT> inputs_, mic::types::MatrixPtr<eT> targets_) {
+			boost::mutex::scoped_lock lock(order->mutex);
+			// The pipeline (re)starts from the batch of index 0.
+			if (index_ == 0)
+				order->next = 0;
+			while (order->next != index_)
+				order->sampled.wait(lock);
+			auto batch = sample_();
+			order->next++;
+			lock.unlock();
+			order->sampled.notify_all();
+
+			// Encode with own copies of the encoders - concurrently with other threads.
+			InputEncoderT input_encoder(input_encoder_);
+			TargetEncoderT target_encoder(target_encoder_);
+			encodeBatch(input_encoder, batch.data(), inputs_);
+			encodeBatch(target_encoder, batch.labels(), targets_);
+		};
+	}
+
+	/*!
+	 * Releases the previously returned batch and returns the next one - waits until it is ready.
+	 */
+	bool nextBatch(mic::types::MatrixPtr<eT> & inputs_, mic::types::MatrixPtr<eT> & targets_) {
+		boost::mutex::scoped_lock lock(mutex);
+
+		// Release the slot with the previous batch.
+		if (released < consumed) {
+			slots[released % depth].ready = false;
+			released++;
+			slot_released.notify_all();
+		}//: if
+
+		if ((num_batches > 0) && (consumed >= num_batches))
+			return false;
+
+		Slot & slot = slots[consumed % depth];
+		while (running && !(slot.ready && (slot.index == consumed)))
+			slot_filled.wait(lock);
+		if (!running)
+			return false;
+
+		inputs_ = slot.inputs;
+		targets_ = slot.targets;
+		consumed++;
+		return true;
+	}
+
+	/*!
+	 * Loop of the background thread: waits till the slot of the next batch is released, claims the index of the batch and prepares it.
+	 * Indices are claimed only when their slots are free, so every claimed batch is prepared (which the functions created by encodingFunction() rely on).
+	 */
+	void produce() {
+		while (true) {
+			size_t index;
+			{
+				boost::mutex::scoped_lock lock(mutex);
+				// Wait till the consumer releases the batch previously stored in the slot.
+				while (running && ((num_batches == 0) || (produced < num_batches)) && (produced >= released + depth))
+					slot_released.wait(lock);
+				if (!running || ((num_batches > 0) && (produced >= num_batches)))
+					return;
+				index = produced++;
+			}
+
+			// Prepare the batch - outside of the critical section.
+			Slot & slot = slots[index % depth];
+			fill(index, slot.inputs, slot.targets);
+
+			{
+				boost::mutex::scoped_lock lock(mutex);
+				slot.index = index;
+				slot.ready = true;
+			}
+			slot_filled.notify_all();
+		}//: while
+	}
+
+	/// Ring of slots.
+	std::vector<Slot> slots;
+
+	/// Number of slots.
+	size_t depth;
+
+	/// Number of background threads.
+	size_t num_threads;
+
+	/// Function preparing the batches.
+	FillFunction fill;
+
+	/// Number of batches to be prepared (0 - unlimited).
+	size_t num_batches;
+
+	/// Number of batches claimed by the background threads.
+	size_t produced;
+
+	/// Number of batches returned to the consumer.
+	size_t consumed;
+
+	/// Number of batches released by the consumer.
+	size_t released;
+
+	/// Flag denoting whether the pipeline is running.
+	bool running;
+
+	/// Mutex guarding the state of the pipeline.
+	boost::mutex mutex;
+
+	/// Condition variable signalled when a batch is ready.
+	boost::condition_variable slot_filled;
+
+	/// Condition variable signalled when a slot is released.
+	boost::condition_variable slot_released;
+
+	/// Background threads.
+	boost::thread_group threads;
+
+	/// Profiler (nullptr if profiling is disabled).
+	std::shared_ptr<Profiler> profiler;
+};
+
+} /* namespace mlnn */
+} /* namespace mic */
+
+#endif /* SRC_MLNN_BATCHPIPELINE_HPP_ */
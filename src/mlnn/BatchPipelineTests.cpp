@@ -0,0 +1,258 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * @file: BatchPipelineTests.cpp
+ * @Author: Tomasz Kornuta <tkornut@us.ibm.com>
+ * @Date:   Oct 16, 2026
+ *
+ * Copyright (c) 2017, Tomasz Kornuta, IBM Corporation. All rights reserved.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <mlnn/BatchPipeline.hpp>
+
+#include <encoders/MatrixXfMatrixXfEncoder.hpp>
+#include <encoders/UIntMatrixXfEncoder.hpp>
+
+#include <atomic>
+#include <unistd.h>
+
+/*!
+ * Fills a batch with values depending on its index.
+ */
+void fillBatch(size_t index_, mic::types::MatrixPtr<float> inputs_, mic::types::MatrixPtr<float> targets_) {
+	inputs_->setConstant((float)index_);
+	targets_->setConstant(-(float)index_);
+}
+
+/*!
+ * Tests whether batches prepared by several threads are returned in the order of their indices.
+ */
+TEST(BatchPipeline, Order) {
+	mic::mlnn::BatchPipeline<float> pipeline(6, 2, 4, 3, 4, fillBatch);
+	pipeline.start();
+
+	mic::types::MatrixPtr<float> inputs, targets;
+	for (size_t i=0; i< 100; i++) {
+		ASSERT_TRUE(pipeline.next(inputs, targets));
+		ASSERT_EQ(inputs->rows(), 6);
+		ASSERT_EQ(inputs->cols(), 4);
+		ASSERT_EQ(targets->rows(), 2);
+		for (size_t j=0; j< (size_t)inputs->size(); j++)
+			ASSERT_EQ((*inputs)[j], (float)i) << "Difference at position j=" << j << " in batch " << i;
+		for (size_t j=0; j< (size_t)targets->size(); j++)
+			ASSERT_EQ((*targets)[j], -(float)i) << "Difference at position j=" << j << " in batch " << i;
+	}//: for
+	pipeline.stop();
+	ASSERT_FALSE(pipeline.next(inputs, targets));
+}
+
+/*!
+ * Tests whether the pipeline prepares the requested number of batches and can be restarted.
+ */
+TEST(BatchPipeline, NumberOfBatches) {
+	mic::mlnn::BatchPipeline<float> pipeline(3, 1, 2, 2, 2, fillBatch);
+	mic::types::MatrixPtr<float> inputs, targets;
+
+	for (size_t run=0; run< 3; run++) {
+		pipeline.start(5);
+		size_t batches = 0;
+		while (pipeline.next(inputs, targets)) {
+			ASSERT_EQ((*inputs)[0], (float)batches);
+			batches++;
+		}//: while
+		ASSERT_EQ(batches, 5) << "Invalid number of batches in run " << run;
+	}//: for
+}
+
+/*!
+ * Tests whether batches are returned without copying, i.e. in the preallocated slots of the ring.
+ */
+TEST(BatchPipeline, ZeroCopy) {
+	mic::mlnn::BatchPipeline<float> pipeline(3, 1, 2, 2, 1, fillBatch);
+	pipeline.start(6);
+
+	std::vector<float*> slots;
+	mic::types::MatrixPtr<float> inputs, targets;
+	while (pipeline.next(inputs, targets))
+		slots.push_back(inputs->data());
+
+	ASSERT_EQ(slots.size(), 6);
+	for (size_t i=2; i< slots.size(); i++)
+		ASSERT_EQ(slots[i], slots[i-2]) << "Different slot of batch " << i;
+	ASSERT_NE(slots[0], slots[1]);
+}
+
+/*!
+ * \brief Importer returning batches of indices of consecutive samples (mock of importers from MIToolchain).
+ */
+struct CountingImporter {
+	/// Batch with samples and labels.
+	struct Batch {
+		std::vector<size_t> samples;
+		std::vector<size_t> & data() { return samples; }
+		std::vector<size_t> & labels() { return samples; }
+	};
+
+	CountingImporter() : next(0) { }
+
+	Batch getNextBatch() {
+		Batch batch;
+		for (size_t i=0; i< 2; i++)
+			batch.samples.push_back(next++);
+		return batch;
+	}
+
+	Batch getRandomBatch() {
+		return getNextBatch();
+	}
+
+	size_t next;
+};
+
+/*!
+ * \brief Slow encoder recording the maximal number of concurrent encodings (shared by its copies).
+ */
+struct SlowEncoder {
+	SlowEncoder() : active(std::make_shared<std::atomic<int> >(0)), max_active(std::make_shared<std::atomic<int> >(0)) { }
+
+	mic::types::MatrixPtr<float> encodeBatch(std::vector<size_t> & samples_) {
+		int now = ++(*active);
+		int max = *max_active;
+		while ((now > max) && !max_active->compare_exchange_weak(max, now)) { }
+		usleep(20000);
+		mic::types::MatrixPtr<float> encoded = MAKE_MATRIX_PTR(float, 1, samples_.size());
+		for (size_t i=0; i< samples_.size(); i++)
+			(*encoded)[i] = (float)samples_[i];
+		--(*active);
+		return encoded;
+	}
+
+	std::shared_ptr<std::atomic<int> > active;
+	std::shared_ptr<std::atomic<int> > max_active;
+};
+
+/*!
+ * Tests whether batches taken from the importer are encoded by several threads at once - and contain all samples.
+ */
+TEST(BatchPipeline, ConcurrentEncoding) {
+	CountingImporter importer;
+	SlowEncoder input_encoder, target_encoder;
+	mic::mlnn::BatchPipeline<float> pipeline(1, 1, 2, 4, 4, mic::mlnn::BatchPipeline<float>::nextBatches(importer, input_encoder, target_encoder));
+	pipeline.start(8);
+
+	mic::types::MatrixPtr<float> inputs, targets;
+	std::vector<bool> seen(16, false);
+	while (pipeline.next(inputs, targets))
+		for (size_t j=0; j< (size_t)inputs->size(); j++)
+			seen[(size_t)(*inputs)[j]] = true;
+	for (size_t i=0; i< 16; i++)
+		ASSERT_TRUE(seen[i]) << "Sample " << i << " missing";
+	ASSERT_GT((int)*input_encoder.max_active, 1);
+}
+
+/*!
+ * \brief Encoder storing the indices of samples (mock of encoders from MIToolchain).
+ */
+struct IndexEncoder {
+	mic::types::MatrixPtr<float> encodeBatch(std::vector<size_t> & samples_) {
+		mic::types::MatrixPtr<float> encoded = MAKE_MATRIX_PTR(float, 1, samples_.size());
+		for (size_t i=0; i< samples_.size(); i++)
+			(*encoded)[i] = (float)samples_[i];
+		return encoded;
+	}
+};
+
+/*!
+ * Tests whether consecutive batches taken from the importer by several threads are returned in the order of their indices.
+ */
+TEST(BatchPipeline, NextBatchesOrder) {
+	CountingImporter importer;
+	IndexEncoder input_encoder, target_encoder;
+	mic::mlnn::BatchPipeline<float> pipeline(1, 1, 2, 8, 8, mic::mlnn::BatchPipeline<float>::nextBatches(importer, input_encoder, target_encoder));
+
+	mic::types::MatrixPtr<float> inputs, targets;
+	for (size_t run=0; run< 2; run++) {
+		importer.next = 0;
+		pipeline.start(2000);
+		size_t batches = 0;
+		while (pipeline.next(inputs, targets)) {
+			ASSERT_EQ((*inputs)[0], (float)(2*batches)) << "Invalid batch " << batches << " in run " << run;
+			ASSERT_EQ((*inputs)[1], (float)(2*batches+1)) << "Invalid batch " << batches << " in run " << run;
+			batches++;
+		}//: while
+		ASSERT_EQ(batches, 2000);
+	}//: for
+}
+
+/*!
+ * \brief Importer returning batches of 2x3 matrices filled with the label (mock of MNISTMatrixImporter).
+ */
+struct MatrixImporter {
+	/// Batch with samples and labels.
+	struct Batch {
+		std::vector<mic::types::MatrixXfPtr> samples;
+		std::vector<std::shared_ptr<unsigned int> > sample_labels;
+		std::vector<mic::types::MatrixXfPtr> & data() { return samples; }
+		std::vector<std::shared_ptr<unsigned int> > & labels() { return sample_labels; }
+	};
+
+	MatrixImporter() : next(0) { }
+
+	Batch getNextBatch() {
+		Batch batch;
+		for (size_t i=0; i< 4; i++, next++) {
+			mic::types::MatrixXfPtr sample = MAKE_MATRIX_PTR(float, 2, 3);
+			for (size_t j=0; j< 6; j++)
+				(*sample)[j] = (float)(10*(next % 5) + j);
+			batch.samples.push_back(sample);
+			batch.sample_labels.push_back(std::make_shared<unsigned int>(next % 5));
+		}//: for
+		return batch;
+	}
+
+	size_t next;
+};
+
+/*!
+ * Tests encoding of matrices and labels directly into the slots.
+ */
+TEST(BatchPipeline, InPlaceEncoding) {
+	MatrixImporter importer;
+	mic::encoders::MatrixXfMatrixXfEncoder input_encoder(2, 3);
+	mic::encoders::UIntMatrixXfEncoder target_encoder(5);
+	mic::mlnn::BatchPipeline<float> pipeline(6, 5, 4, 2, 2, mic::mlnn::BatchPipeline<float>::nextBatches(importer, input_encoder, target_encoder));
+	pipeline.start(10);
+
+	mic::types::MatrixPtr<float> inputs, targets;
+	size_t sample = 0;
+	while (pipeline.next(inputs, targets))
+		for (size_t i=0; i< 4; i++, sample++) {
+			for (size_t j=0; j< 6; j++)
+				ASSERT_EQ((*inputs)(j, i), (float)(10*(sample % 5) + j)) << "Difference at position j=" << j << " of sample " << sample;
+			for (size_t j=0; j< 5; j++)
+				ASSERT_EQ((*targets)(j, i), (j == sample % 5) ? 1.0f : 0.0f) << "Difference at position j=" << j << " of sample " << sample;
+		}//: for
+	ASSERT_EQ(sample, 40);
+}
+
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
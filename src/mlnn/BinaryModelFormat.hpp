@@ -0,0 +1,213 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file BinaryModelFormat.hpp
+ * \brief Structures of the binary model format and reading of model files.
+ * \author tkornuta
+ * \date Oct 16, 2026
+ */
+
+#ifndef SRC_MLNN_BINARYMODELFORMAT_HPP_
+#define SRC_MLNN_BINARYMODELFORMAT_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+
+
+namespace mic {
+namespace mlnn {
+namespace binary_format {
+
+/*!
+ * Layout of the file (all fields in native byte order):
+ * - header,
+ * - table of layers (BinaryLayerEntry for every layer),
+ * - table of tensors (BinaryTensorEntry for every matrix of every layer, grouped by layers and arrays, in the order of their handles),
+ * - pool of strings (names of the network, layers and matrices, configurations of layers - parameters specific to their types, stored in text archives),
+ * - blobs with data of the parameters, each aligned to blob_alignment bytes.
+ * Only parameters are stored, the remaining matrices (states, gradients, memory) are recreated from their sizes and zeroed.
+ */
+
+/// Magic number identifying the binary model files.
+const char magic[8] = {'M', 'L', 'N', 'N', 'B', 'I', 'N', '\0'};
+
+/// Current version of the format (version 1 lacked configurations of layers, version 2 lacked stride of pooling layers, version 3 lacked configurations of ELU and Sigmoid).
+const uint32_t version = 4;
+
+/// Alignment of blobs with data.
+const uint64_t blob_alignment = 64;
+
+/// Arrays of matrices of a layer.
+enum class MatrixArrays : uint32_t { State = 0, Gradients, Parameters, Memory };
+
+/*!
+ * \brief Header of the file.
+ */
+struct BinaryHeader {
+	/// Magic number.
+	char magic[8];
+
+	/// Version of the format.
+	uint32_t version;
+
+	/// Size of the scalar type (4 - float, 8 - double).
+	uint32_t scalar_size;
+
+	/// Number of layers.
+	uint64_t num_layers;
+
+	/// Number of tensors (matrices).
+	uint64_t num_tensors;
+
+	/// Offset of the table of layers.
+	uint64_t layer_table_offset;
+
+	/// Offset of the table of tensors.
+	uint64_t tensor_table_offset;
+
+	/// Offset of the name of the network (in the pool of strings).
+	uint64_t name_offset;
+
+	/// Length of the name of the network.
+	uint64_t name_length;
+};
+
+/*!
+ * \brief Entry of the table of layers.
+ */
+struct BinaryLayerEntry {
+	/// Type of the layer (LayerTypes).
+	uint32_t layer_type;
+
+	/// Padding.
+	uint32_t reserved;
+
+	/// Dimensions of the input.
+	uint64_t input_height, input_width, input_depth;
+
+	/// Dimensions of the output.
+	uint64_t output_height, output_width, output_depth;
+
+	/// Size of the batch.
+	uint64_t batch_size;
+
+	/// Offset and length of the name of the layer.
+	uint64_t name_offset, name_length;
+
+	/// Index of the first tensor of the layer and number of its tensors.
+	uint64_t first_tensor, num_tensors;
+
+	/// Offset and length of the configuration of the layer (since version 2).
+	uint64_t config_offset, config_length;
+};
+
+/*!
+ * \brief Entry of the table of tensors.
+ */
+struct BinaryTensorEntry {
+	/// Array the matrix belongs to (MatrixArrays).
+	uint32_t array;
+
+	/// Padding.
+	uint32_t reserved;
+
+	/// Size of the matrix.
+	uint64_t rows, cols;
+
+	/// Offset and length of the name of the matrix.
+	uint64_t name_offset, name_length;
+
+	/// Offset of the blob with data (0 - data not stored).
+	uint64_t data_offset;
+};
+
+/*!
+ * Returns the offset aligned to the given alignment.
+ */
+inline uint64_t align(uint64_t offset_, uint64_t alignment_ = blob_alignment) {
+	return (offset_ + alignment_ - 1) / alignment_ * alignment_;
+}
+
+
+/*!
+ * \brief Contents of a model file, read into memory at once.
+ * \author tkornuta
+ */
+class ModelFile {
+public:
+	/*!
+	 * Constructor. Reads the file (or its beginning).
+	 * @param filename_ Name of the file.
+	 * @param max_size_ Maximal number of bytes read (DEFAULT - the whole file).
+	 */
+	ModelFile(std::string filename_, uint64_t max_size_ = UINT64_MAX) {
+		std::ifstream ifs(filename_, std::ios::binary | std::ios::ate);
+		if (!ifs)
+			return;
+		uint64_t size = (uint64_t)ifs.tellg();
+		if (size > max_size_)
+			size = max_size_;
+		data.resize(size);
+		ifs.seekg(0);
+		if (!ifs.read(data.data(), size))
+			data.clear();
+	}
+
+	/*!
+	 * Returns true if the given range lies within the file.
+	 */
+	bool contains(uint64_t offset_, uint64_t length_) const {
+		return (offset_ <= data.size()) && (length_ <= data.size() - offset_);
+	}
+
+	/*!
+	 * Returns pointer to the given offset.
+	 */
+	const char* at(uint64_t offset_) const {
+		return data.data() + offset_;
+	}
+
+	/*!
+	 * Returns string stored at the given offset.
+	 */
+	std::string string(uint64_t offset_, uint64_t length_) const {
+		return std::string(data.data() + offset_, length_);
+	}
+
+	/*!
+	 * Returns true if the file starts with the magic number of binary models.
+	 */
+	bool isBinaryModel() const {
+		return contains(0, sizeof(magic)) && (memcmp(data.data(), magic, sizeof(magic)) == 0);
+	}
+
+private:
+	/// Contents of the file.
+	std::vector<char> data;
+
+	// Disable copying.
+	ModelFile(const ModelFile&) = delete;
+	ModelFile& operator=(const ModelFile&) = delete;
+};
+
+} /* namespace binary_format */
+} /* namespace mlnn */
+} /* namespace mic */
+
+#endif /* SRC_MLNN_BINARYMODELFORMAT_HPP_ */
@@ -0,0 +1,325 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file CheckpointWriter.hpp
+ * \brief Asynchronous checkpointing of the network during training.
+ * \author tkornuta
+ * \date Oct 16, 2026
+ */
+
+#ifndef SRC_MLNN_CHECKPOINTWRITER_HPP_
+#define SRC_MLNN_CHECKPOINTWRITER_HPP_
+
+#include <mlnn/MultiLayerNeuralNetwork.hpp>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <fstream>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boost/archive/text_oarchive.hpp>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/bind.hpp>
+
+namespace mic {
+namespace mlnn {
+
+/*!
+ * \brief Writer periodically saving checkpoints of the network on a background thread.
+ * The training thread only copies parameters and states of the optimization functions into one of two snapshots (double buffer),
+ * while the other one is being written to disk - so the training never waits for I/O.
+ * Checkpoints are written to temporary files, flushed to disk and atomically renamed to prefix-iteration, only the given number of the last ones is kept.
+ * When the writer falls behind, the pending snapshot is replaced with the newer one (and the older checkpoint is skipped).
+ * \author tkornuta
+ * \tparam eT Template type (single/double precision)
+ */
+template <typename eT=float>
+class CheckpointWriter {
+public:
+	/*!
+	 * Constructor. Starts the writing thread.
+	 * @param prefix_ Prefix of names of the checkpoint files.
+	 * @param interval_ Interval between checkpoints [iterations].
+	 * @param keep_last_ Number of kept checkpoints (0 - keep all).
+	 */
+	CheckpointWriter(std::string prefix_, size_t interval_ = 1000, size_t keep_last_ = 3)
+		: prefix(prefix_), interval(interval_ > 0 ? interval_ : 1), keep_last(keep_last_),
+		  iteration(0), written_checkpoints(0), skipped_checkpoints(0), stopping(false)
+	{
+		for (size_t i = 0; i < 2; i++) {
+			snapshots[i].network = std::make_shared<MultiLayerNeuralNetwork<eT> >(prefix_);
+			snapshots[i].iteration = 0;
+			snapshots[i].state = SnapshotState::Free;
+		}//: for
+		writer = boost::thread(boost::bind(&CheckpointWriter<eT>::writerLoop, this));
+	}
+
+	/*!
+	 * Destructor. Writes the pending checkpoints and stops the writing thread.
+	 */
+	virtual ~CheckpointWriter() {
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			stopping = true;
+		}
+		condition.notify_all();
+		writer.join();
+	}
+
+	/*!
+	 * Counts the training iteration and takes a snapshot of the network every interval iterations.
+	 * Should be called after every update of the network.
+	 * @param nn_ Trained network.
+	 * @return True if the snapshot was taken.
+	 */
+	bool step(MultiLayerNeuralNetwork<eT> & nn_) {
+		if (++iteration % interval != 0)
+			return false;
+		return snapshot(nn_);
+	}
+
+	/*!
+	 * Takes a snapshot of the network at the current iteration and passes it to the writing thread.
+	 * The first snapshot copies the whole network, the next ones only copy the values (unless the structure of the network changes).
+	 * @param nn_ Trained network.
+	 * @return False if the network could not be copied.
+	 */
+	bool snapshot(MultiLayerNeuralNetwork<eT> & nn_) {
+		// Take the free snapshot or replace the older pending one - at most one snapshot is being written.
+		Snapshot* free = NULL;
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			for (size_t i = 0; i < 2; i++)
+				if (snapshots[i].state == SnapshotState::Free)
+					free = &snapshots[i];
+			if (free == NULL)
+				for (size_t i = 0; i < 2; i++)
+					if ((snapshots[i].state == SnapshotState::Pending) && ((free == NULL) || (snapshots[i].iteration < free->iteration)))
+						free = &snapshots[i];
+			if (free->state == SnapshotState::Pending)
+				skipped_checkpoints++;
+			free->state = SnapshotState::Filling;
+		}
+
+		bool copied = nn_.snapshotTo(*free->network);
+
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			free->iteration = iteration;
+			free->state = copied ? SnapshotState::Pending : SnapshotState::Free;
+		}
+		condition.notify_all();
+		return copied;
+	}
+
+	/*!
+	 * Waits until all pending checkpoints are written.
+	 */
+	void flush() {
+		boost::mutex::scoped_lock lock(mutex);
+		while ((snapshots[0].state == SnapshotState::Pending) || (snapshots[0].state == SnapshotState::Writing) ||
+				(snapshots[1].state == SnapshotState::Pending) || (snapshots[1].state == SnapshotState::Writing))
+			condition.wait(lock);
+	}
+
+	/*!
+	 * Returns the name of the last written checkpoint (empty if none was written yet).
+	 */
+	std::string latestCheckpoint() {
+		boost::mutex::scoped_lock lock(mutex);
+		return (checkpoints.size() > 0) ? checkpoints.back() : "";
+	}
+
+	/*!
+	 * Returns the number of written checkpoints.
+	 */
+	size_t writtenCheckpoints() {
+		boost::mutex::scoped_lock lock(mutex);
+		return written_checkpoints;
+	}
+
+	/*!
+	 * Returns the number of checkpoints skipped because the writer fell behind.
+	 */
+	size_t skippedCheckpoints() {
+		boost::mutex::scoped_lock lock(mutex);
+		return skipped_checkpoints;
+	}
+
+	/*!
+	 * Returns the number of counted iterations.
+	 */
+	size_t getIteration() {
+		return iteration;
+	}
+
+private:
+	/// States of the snapshot.
+	enum class SnapshotState { Free, Filling, Pending, Writing };
+
+	/*!
+	 * \brief Snapshot of the network.
+	 */
+	struct Snapshot {
+		/// Copy of the network.
+		std::shared_ptr<MultiLayerNeuralNetwork<eT> > network;
+
+		/// Iteration at which the snapshot was taken.
+		size_t iteration;
+
+		/// State of the snapshot.
+		SnapshotState state;
+	};
+
+	/*!
+	 * Loop of the writing thread - writes the pending snapshots (the older first), until stopped and there are no pending snapshots.
+	 */
+	void writerLoop() {
+		while (true) {
+			Snapshot* pending = NULL;
+			{
+				boost::mutex::scoped_lock lock(mutex);
+				while (true) {
+					for (size_t i = 0; i < 2; i++)
+						if ((snapshots[i].state == SnapshotState::Pending) && ((pending == NULL) || (snapshots[i].iteration < pending->iteration)))
+							pending = &snapshots[i];
+					if ((pending != NULL) || stopping)
+						break;
+					condition.wait(lock);
+				}//: while
+				if (pending == NULL)
+					return;
+				pending->state = SnapshotState::Writing;
+			}
+
+			std::string filename = prefix + "-" + std::to_string(pending->iteration);
+			bool saved = writeCheckpoint(*pending->network, filename);
+
+			boost::mutex::scoped_lock lock(mutex);
+			if (saved) {
+				written_checkpoints++;
+				checkpoints.push_back(filename);
+				// Remove the oldest checkpoints.
+				while ((keep_last > 0) && (checkpoints.size() > keep_last)) {
+					std::remove(checkpoints.front().c_str());
+					checkpoints.pop_front();
+				}//: while
+			}//: if
+			pending->state = SnapshotState::Free;
+			condition.notify_all();
+		}//: while
+	}
+
+	/*!
+	 * Writes the network to a temporary file, flushes it to disk and atomically renames it - the file with the checkpoint is either complete or does not exist.
+	 * @param network_ Snapshot of the network.
+	 * @param filename_ Name of the checkpoint file.
+	 * @return True if the checkpoint was written.
+	 */
+	bool writeCheckpoint(MultiLayerNeuralNetwork<eT> & network_, std::string filename_) {
+		std::string temporary = filename_ + ".tmp";
+		bool saved = true;
+		try {
+			std::ofstream ofs(temporary);
+			{
+				boost::archive::text_oarchive ar(ofs);
+				ar & network_;
+			}
+			// Errors of the final flush (e.g. full disk) are reported only by the explicit close.
+			ofs.close();
+			saved = !ofs.fail();
+		} catch(...) {
+			saved = false;
+		}
+		// Data must reach the disk before the rename, the rename itself (stored in the directory) - before the checkpoint is counted.
+		saved = saved && syncPath(temporary, O_RDONLY) && (std::rename(temporary.c_str(), filename_.c_str()) == 0);
+		if (!saved) {
+			LOG(LERROR) << "Could not write checkpoint " << filename_ << "!";
+			std::remove(temporary.c_str());
+			return false;
+		}//: if
+		size_t slash = filename_.find_last_of('/');
+		std::string directory = (slash == std::string::npos) ? "." : ((slash == 0) ? "/" : filename_.substr(0, slash));
+		if (!syncPath(directory, O_RDONLY | O_DIRECTORY)) {
+			LOG(LERROR) << "Could not flush directory " << directory << " of checkpoint " << filename_ << "!";
+			std::remove(filename_.c_str());
+			return false;
+		}//: if
+		return true;
+	}
+
+	/*!
+	 * Flushes the file or directory to disk.
+	 * @param path_ Path to the file or directory.
+	 * @param flags_ Flags used for opening it.
+	 * @return True if succeeded.
+	 */
+	static bool syncPath(std::string path_, int flags_) {
+		int fd = ::open(path_.c_str(), flags_);
+		if (fd < 0)
+			return false;
+		bool synced = (::fsync(fd) == 0);
+		return (::close(fd) == 0) && synced;
+	}
+
+	/// Prefix of names of the checkpoint files.
+	std::string prefix;
+
+	/// Interval between checkpoints [iterations].
+	size_t interval;
+
+	/// Number of kept checkpoints.
+	size_t keep_last;
+
+	/// Number of counted iterations.
+	size_t iteration;
+
+	/// Snapshots (double buffer).
+	Snapshot snapshots[2];
+
+	/// Names of the kept checkpoints (the oldest first).
+	std::deque<std::string> checkpoints;
+
+	/// Number of written checkpoints.
+	size_t written_checkpoints;
+
+	/// Number of skipped checkpoints.
+	size_t skipped_checkpoints;
+
+	/// Flag denoting that the writer should stop.
+	bool stopping;
+
+	/// Mutex guarding the snapshots and statistics.
+	boost::mutex mutex;
+
+	/// Condition signalling changes of states of the snapshots.
+	boost::condition_variable condition;
+
+	/// Writing thread.
+	boost::thread writer;
+};
+
+} /* namespace mlnn */
+} /* namespace mic */
+
+#endif /* SRC_MLNN_CHECKPOINTWRITER_HPP_ */
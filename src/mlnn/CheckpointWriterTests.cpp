@@ -0,0 +1,174 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * @file: CheckpointWriterTests.cpp
+ * @Author: Tomasz Kornuta <tkornut@us.ibm.com>
+ * @Date:   Oct 16, 2026
+ *
+ * Copyright (c) 2017, Tomasz Kornuta, IBM Corporation. All rights reserved.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <mlnn/BackpropagationNeuralNetwork.hpp>
+#include <mlnn/CheckpointWriter.hpp>
+
+#include <fstream>
+#include <unistd.h>
+
+/*!
+ * Creates a small network trained with Adam, together with a batch and its targets.
+ */
+void createNet(mic::mlnn::BackpropagationNeuralNetwork<double> & nn_, mic::types::MatrixPtr<double> & x_, mic::types::MatrixPtr<double> & t_) {
+	nn_.pushLayer(new mic::mlnn::fully_connected::Linear<double>(6, 5));
+	nn_.pushLayer(new mic::mlnn::activation_function::ReLU<double>(5));
+	nn_.pushLayer(new mic::mlnn::regularisation::Dropout<double>(5, 0.8));
+	nn_.pushLayer(new mic::mlnn::fully_connected::Linear<double>(5, 3));
+	nn_.pushLayer(new mic::mlnn::cost_function::Softmax<double>(3));
+	nn_.setLoss< mic::neural_nets::loss::CrossEntropyLoss<double> >();
+	nn_.setOptimization< mic::neural_nets::optimization::Adam<double> >();
+
+	x_ = MAKE_MATRIX_PTR(double, 6, 4);
+	x_->rand(-1.0, 1.0);
+	t_ = MAKE_MATRIX_PTR(double, 3, 4);
+	t_->setZero();
+	for (size_t i=0; i< 4; i++)
+		(*t_)(i % 3, i) = 1;
+}
+
+/*!
+ * Checks whether the file exists.
+ */
+bool exists(std::string filename_) {
+	return std::ifstream(filename_).good();
+}
+
+/*!
+ * Checks whether the parameters of both networks are equal.
+ */
+void expectSameParameters(mic::mlnn::BackpropagationNeuralNetwork<double> & nn1_, mic::mlnn::BackpropagationNeuralNetwork<double> & nn2_) {
+	// Linear layers.
+	for (size_t l : {0, 3})
+		for (std::string key : {"W", "b"}) {
+			mic::types::MatrixPtr<double> p1 = nn1_.getLayer(l)->getParam(key);
+			mic::types::MatrixPtr<double> p2 = nn2_.getLayer(l)->getParam(key);
+			for (size_t i=0; i< (size_t)p1->size(); i++)
+				ASSERT_EQ((*p1)[i], (*p2)[i]) << "Difference in layer " << l << " parameter " << key << " at position " << i;
+		}//: for
+}
+
+/*!
+ * Tests whether checkpoints are written at the given interval and only the last ones are kept.
+ */
+TEST(CheckpointWriter, Rotation) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> nn("nn");
+	mic::types::MatrixPtr<double> x, t;
+	createNet(nn, x, t);
+
+	{
+		mic::mlnn::CheckpointWriter<double> writer("checkpoint_test", 2, 2);
+		for (size_t i=1; i<= 10; i++) {
+			nn.train(x, t, 0.01, 0.001);
+			ASSERT_EQ(writer.step(nn), (i % 2 == 0));
+			writer.flush();
+		}//: for
+		ASSERT_EQ(writer.getIteration(), 10);
+		ASSERT_EQ(writer.writtenCheckpoints(), 5);
+		ASSERT_EQ(writer.skippedCheckpoints(), 0);
+		ASSERT_EQ(writer.latestCheckpoint(), "checkpoint_test-10");
+	}
+
+	for (size_t i=2; i<= 6; i+=2)
+		ASSERT_FALSE(exists("checkpoint_test-" + std::to_string(i)));
+	ASSERT_TRUE(exists("checkpoint_test-8"));
+	ASSERT_TRUE(exists("checkpoint_test-10"));
+	ASSERT_FALSE(exists("checkpoint_test-10.tmp"));
+
+	mic::mlnn::BackpropagationNeuralNetwork<double> restored("restored");
+	ASSERT_TRUE(restored.load("checkpoint_test-10"));
+	expectSameParameters(restored, nn);
+	std::remove("checkpoint_test-8");
+	std::remove("checkpoint_test-10");
+}
+
+/*!
+ * Tests whether the checkpoint contains the state of the network at the moment of the snapshot - even if the training continues before it is written -
+ * and whether the training resumed from the checkpoint continues exactly as the training of the network.
+ */
+TEST(CheckpointWriter, ResumeTraining) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> nn("nn");
+	mic::types::MatrixPtr<double> x, t;
+	createNet(nn, x, t);
+
+	mic::mlnn::CheckpointWriter<double> writer("checkpoint_test", 5, 0);
+	for (size_t i=0; i< 5; i++) {
+		nn.train(x, t, 0.01, 0.001);
+		writer.step(nn);
+	}//: for
+	ASSERT_TRUE(nn.save("checkpoint_test_reference.txt"));
+
+	// Continue training - the snapshot is already taken.
+	for (size_t i=0; i< 3; i++)
+		nn.train(x, t, 0.01, 0.001);
+	writer.flush();
+	ASSERT_EQ(writer.latestCheckpoint(), "checkpoint_test-5");
+
+	mic::mlnn::BackpropagationNeuralNetwork<double> reference("reference");
+	ASSERT_TRUE(reference.load("checkpoint_test_reference.txt"));
+	mic::mlnn::BackpropagationNeuralNetwork<double> restored("restored");
+	ASSERT_TRUE(restored.load("checkpoint_test-5"));
+	std::remove("checkpoint_test_reference.txt");
+	std::remove("checkpoint_test-5");
+	expectSameParameters(restored, reference);
+
+	// Both have the same state of optimization functions and dropout masks.
+	for (size_t i=0; i< 3; i++) {
+		reference.train(x, t, 0.01, 0.001);
+		restored.train(x, t, 0.01, 0.001);
+	}//: for
+	expectSameParameters(restored, reference);
+}
+
+/*!
+ * Tests whether the checkpoint that could not be flushed (here to a full device) is neither renamed into place nor counted.
+ */
+TEST(CheckpointWriter, FailedFlush) {
+	if (!exists("/dev/full"))
+		return;
+	// The network is small enough to fit in the buffer of the stream - written out only when the stream is closed.
+	mic::mlnn::BackpropagationNeuralNetwork<double> nn("nn");
+	nn.pushLayer(new mic::mlnn::fully_connected::Linear<double>(2, 1));
+
+	// The temporary file points to the device that reports no space left when its data is written out.
+	ASSERT_EQ(symlink("/dev/full", "checkpoint_full-1.tmp"), 0);
+	{
+		mic::mlnn::CheckpointWriter<double> writer("checkpoint_full", 1, 0);
+		ASSERT_TRUE(writer.step(nn));
+		writer.flush();
+		ASSERT_EQ(writer.writtenCheckpoints(), 0);
+		ASSERT_EQ(writer.latestCheckpoint(), "");
+	}
+	ASSERT_FALSE(exists("checkpoint_full-1"));
+	std::remove("checkpoint_full-1");
+	std::remove("checkpoint_full-1.tmp");
+}
+
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
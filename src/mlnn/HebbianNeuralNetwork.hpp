@@ -68,11 +68,11 @@ public:
 
 		// Boost::Matrix is col major!
 		LOG(LDEBUG) << "Inputs size: " << input_data->rows() << "x" << input_data->cols();
-		LOG(LDEBUG) << "First layer input matrix size: " <<  layers[0]->s['x']->rows() << "x" << layers[0]->s['x']->cols();
+		LOG(LDEBUG) << "First layer input matrix size: " <<  layers[0]->s[layers[0]->hx]->rows() << "x" << layers[0]->s[layers[0]->hx]->cols();
 
 		// Make sure that the dimensions are ok.
 		// Check only rows, as cols determine the batch size - and we allow them to be dynamically changing!.
-		assert((layers[0]->s['x'])->rows() == input_data->rows());
+		assert((layers[0]->s[layers[0]->hx])->rows() == input_data->rows());
 		//LOG(LDEBUG) <<" input_data: " << input_data.transpose();
 
 		// Connect layers by setting the input matrices pointers to point the output matrices.
@@ -82,19 +82,19 @@ public:
 			if (layers.size() > 1)
 				for (size_t i = 0; i < layers.size()-1; i++) {
 					// Assert sizes.
-					assert(layers[i+1]->s['x']->rows() == layers[i]->s['y']->rows());
+					assert(layers[i+1]->s[layers[i+1]->hx]->rows() == layers[i]->s[layers[i]->hy]->rows());
 					// Connect pointers.
-					layers[i+1]->s['x'] = layers[i]->s['y'];
+					layers[i+1]->s[layers[i+1]->hx] = layers[i]->s[layers[i]->hy];
 				}//: for
 			connected = true;
 		}
 
-		//assert((layers[0]->s['x'])->cols() == input_data->cols());
+		//assert((layers[0]->s[layers[0]->hx])->cols() == input_data->cols());
 		// Change the size of batch - if required.
 		resizeBatch(input_data->cols());
 
-		// Copy inputs to the lowest point in the network.
-		(*(layers[0]->s['x'])) = (*input_data);
+		// Pass inputs to the lowest point in the network (copy or bind).
+		setInput(input_data);
 
 		// Compute the forward activations.
 		for (size_t i = 0; i < layers.size(); i++) {
@@ -156,6 +156,7 @@ protected:
 	// Unhide the overloaded protected methods & fields inherited from the template class MultiLayerNeuralNetwork fields via "using" statement.
 	using MultiLayerNeuralNetwork<eT>::layers;
 	using MultiLayerNeuralNetwork<eT>::connected;
+	using MultiLayerNeuralNetwork<eT>::setInput;
 
 };
 
@@ -0,0 +1,197 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file InferenceClient.hpp
+ * \brief Client of the inference server and a local load generator driving it.
+ * \author tkornuta
+ * \date Oct 16, 2026
+ */
+
+#ifndef SRC_MLNN_INFERENCECLIENT_HPP_
+#define SRC_MLNN_INFERENCECLIENT_HPP_
+
+#include <mlnn/InferenceServer.hpp>
+
+namespace mic {
+namespace mlnn {
+
+/*!
+ * \brief Client sending samples to the inference server over a Unix domain socket and receiving their predictions.
+ * \author tkornuta
+ * \tparam eT Template type (single/double precision)
+ */
+template <typename eT=float>
+class InferenceClient {
+public:
+	/*!
+	 * Constructor.
+	 * @param output_size_ Size of the predictions returned by the server.
+	 */
+	InferenceClient(size_t output_size_) : output_size(output_size_), fd(-1) { }
+
+	/*!
+	 * Destructor. Closes the connection.
+	 */
+	virtual ~InferenceClient() {
+		disconnect();
+	}
+
+	/*!
+	 * Connects to the server.
+	 * @param socket_path_ Path of the Unix domain socket.
+	 * @return False if the connection could not be established.
+	 */
+	bool connect(std::string socket_path_) {
+		disconnect();
+		sockaddr_un address;
+		if (!InferenceServer<eT>::socketAddress(socket_path_, address))
+			return false;
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if ((fd < 0) || (::connect(fd, (sockaddr*)&address, sizeof(address)) != 0)) {
+			LOG(LERROR) << "Could not connect to " << socket_path_ << ": " << strerror(errno);
+			InferenceServer<eT>::closeSocket(fd);
+			return false;
+		}//: if
+		return true;
+	}
+
+	/*!
+	 * Closes the connection.
+	 */
+	void disconnect() {
+		InferenceServer<eT>::closeSocket(fd);
+	}
+
+	/*!
+	 * Sends the sample and waits for its predictions.
+	 * @param input_ Sample.
+	 * @param output_ Predictions.
+	 * @return False if the connection was broken.
+	 */
+	bool predict(const std::vector<eT> & input_, std::vector<eT> & output_) {
+		return InferenceServer<eT>::sendValues(fd, input_) && InferenceServer<eT>::receiveValues(fd, output_, output_size);
+	}
+
+private:
+	/// Size of the predictions.
+	size_t output_size;
+
+	/// Socket.
+	int fd;
+};
+
+
+/*!
+ * \brief Local load generator - drives the inference server with a number of concurrent clients, each sending requests one after another.
+ * \author tkornuta
+ * \tparam eT Template type (single/double precision)
+ */
+template <typename eT=float>
+class LoadGenerator {
+public:
+	/*!
+	 * Constructor.
+	 * @param socket_path_ Path of the Unix domain socket.
+	 * @param output_size_ Size of the predictions returned by the server.
+	 */
+	LoadGenerator(std::string socket_path_, size_t output_size_) : socket_path(socket_path_), output_size(output_size_), failed_requests(0) { }
+
+	/*!
+	 * Sends the samples to the server - every client sends the given number of requests, taking samples cyclically (starting from a different offset).
+	 * @param samples_ Samples.
+	 * @param num_clients_ Number of concurrent clients.
+	 * @param requests_per_client_ Number of requests sent by each client.
+	 * @return Statistics (client-side latencies, batches are not known - set to 0).
+	 */
+	InferenceStatistics run(const std::vector<std::vector<eT> > & samples_, size_t num_clients_, size_t requests_per_client_) {
+		latencies.clear();
+		failed_requests = 0;
+		predictions.assign(num_clients_, std::vector<std::vector<eT> >(requests_per_client_));
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		boost::thread_group clients;
+		for (size_t c = 0; c < num_clients_; c++)
+			clients.create_thread(boost::bind(&LoadGenerator<eT>::runClient, this, boost::cref(samples_), c, requests_per_client_));
+		clients.join_all();
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		return InferenceStatistics::compute(latencies, latencies.size(), 0, seconds);
+	}
+
+	/*!
+	 * Returns the number of requests that failed during the last run.
+	 */
+	size_t failedRequests() {
+		return failed_requests;
+	}
+
+	/*!
+	 * Returns the predictions received by the client for its request during the last run.
+	 * @param client_ Index of the client.
+	 * @param request_ Index of the request - the client sent the sample (client_ + request_) % number of samples.
+	 */
+	const std::vector<eT> & getPredictions(size_t client_, size_t request_) {
+		return predictions[client_][request_];
+	}
+
+private:
+	/*!
+	 * Loop of a single client.
+	 */
+	void runClient(const std::vector<std::vector<eT> > & samples_, size_t client_, size_t requests_) {
+		InferenceClient<eT> client(output_size);
+		std::vector<double> client_latencies;
+		size_t failed = 0;
+		if (!client.connect(socket_path))
+			failed = requests_;
+		else
+			for (size_t r = 0; r < requests_; r++) {
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				if (!client.predict(samples_[(client_ + r) % samples_.size()], predictions[client_][r])) {
+					failed += requests_ - r;
+					break;
+				}//: if
+				client_latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+			}//: for
+
+		boost::mutex::scoped_lock lock(mutex);
+		latencies.insert(latencies.end(), client_latencies.begin(), client_latencies.end());
+		failed_requests += failed;
+	}
+
+	/// Path of the socket.
+	std::string socket_path;
+
+	/// Size of the predictions.
+	size_t output_size;
+
+	/// Latencies of the requests [ms].
+	std::vector<double> latencies;
+
+	/// Predictions received by the clients.
+	std::vector<std::vector<std::vector<eT> > > predictions;
+
+	/// Number of failed requests.
+	size_t failed_requests;
+
+	/// Mutex guarding the results.
+	boost::mutex mutex;
+};
+
+} /* namespace mlnn */
+} /* namespace mic */
+
+#endif /* SRC_MLNN_INFERENCECLIENT_HPP_ */
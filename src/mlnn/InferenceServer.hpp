@@ -0,0 +1,536 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file InferenceServer.hpp
+ * \brief Server answering inference requests received over a Unix domain socket, dynamically batching concurrent requests.
+ * \author tkornuta
+ * \date Oct 16, 2026
+ */
+
+#ifndef SRC_MLNN_INFERENCESERVER_HPP_
+#define SRC_MLNN_INFERENCESERVER_HPP_
+
+#include <mlnn/BackpropagationNeuralNetwork.hpp>
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/bind.hpp>
+
+namespace mic {
+namespace mlnn {
+
+/*!
+ * \brief Latency and throughput statistics of the processed requests.
+ * \author tkornuta
+ */
+struct InferenceStatistics {
+	/// Number of processed requests.
+	size_t requests;
+
+	/// Number of processed batches.
+	size_t batches;
+
+	/// Median of latencies [ms].
+	double p50;
+
+	/// 99th percentile of latencies [ms].
+	double p99;
+
+	/// Throughput [requests/s].
+	double throughput;
+
+	/*!
+	 * Computes the statistics.
+	 * @param latencies_ Latencies of requests [ms] - of all requests or of a sample of them.
+	 * @param requests_ Number of requests.
+	 * @param batches_ Number of batches.
+	 * @param seconds_ Time of processing [s].
+	 */
+	static InferenceStatistics compute(std::vector<double> latencies_, size_t requests_, size_t batches_, double seconds_) {
+		InferenceStatistics stats;
+		stats.requests = requests_;
+		stats.batches = batches_;
+		stats.p50 = percentile(latencies_, 0.5);
+		stats.p99 = percentile(latencies_, 0.99);
+		stats.throughput = (seconds_ > 0) ? (double)requests_ / seconds_ : 0;
+		return stats;
+	}
+
+	/*!
+	 * Returns the given percentile (nearest rank) of the values.
+	 */
+	static double percentile(std::vector<double> & values_, double fraction_) {
+		if (values_.size() == 0)
+			return 0;
+		size_t rank = (size_t)std::ceil(fraction_ * values_.size());
+		if (rank > 0)
+			rank--;
+		std::nth_element(values_.begin(), values_.begin() + rank, values_.end());
+		return values_[rank];
+	}
+
+	/*!
+	 * Stream operator enabling to print the statistics.
+	 */
+	friend std::ostream& operator<<(std::ostream& os_, const InferenceStatistics& stats_) {
+		os_ << stats_.requests << " requests in " << stats_.batches << " batches, latency p50 = " << stats_.p50 << " ms, p99 = " << stats_.p99
+			<< " ms, throughput = " << stats_.throughput << " requests/s";
+		return os_;
+	}
+};
+
+
+/*!
+ * \brief Server loading a network and answering inference requests received over a Unix domain socket.
+ * Requests coming concurrently from the clients are dynamically batched - a batch is processed when it reaches the maximal size
+ * or when its oldest request waited for the maximal latency - by a pool of workers, each using its own replica of the network.
+ *
+ * Protocol (native byte order): a client sends requests consisting of the number of values (uint32) followed by the values of a single sample (eT),
+ * the server replies in the same format with the predictions (outputs of the last layer). Sample of invalid size closes the connection.
+ * \author tkornuta
+ * \tparam eT Template type (single/double precision)
+ */
+template <typename eT=float>
+class InferenceServer {
+public:
+	/*!
+	 * Constructor. Loads and freezes replicas of the network.
+	 * @param filename_ Name of the file with the network (saved with MultiLayerNeuralNetwork::save).
+	 * @param socket_path_ Path of the Unix domain socket.
+	 * @param max_batch_size_ Maximal size of the batch.
+	 * @param max_latency_us_ Maximal time [us] a request waits for other requests to be batched with.
+	 * @param num_replicas_ Number of replicas of the network (and worker threads).
+	 */
+	InferenceServer(std::string filename_, std::string socket_path_, size_t max_batch_size_ = 32, size_t max_latency_us_ = 1000, size_t num_replicas_ = 1)
+		: socket_path(socket_path_), max_batch_size(max_batch_size_ > 0 ? max_batch_size_ : 1), max_latency(max_latency_us_),
+		  listen_fd(-1), running(false), processed_requests(0), processed_batches(0)
+	{
+		for (size_t i = 0; i < (num_replicas_ > 0 ? num_replicas_ : 1); i++) {
+			std::shared_ptr<BackpropagationNeuralNetwork<eT> > replica = std::make_shared<BackpropagationNeuralNetwork<eT> >("replica");
+			if (!replica->load(filename_))
+				break;
+			replica->freeze();
+			replica->setInputBinding();
+			replicas.push_back(replica);
+		}//: for
+	}
+
+	/*!
+	 * Destructor. Stops the server.
+	 */
+	virtual ~InferenceServer() {
+		stop();
+	}
+
+	/*!
+	 * Returns the size of the samples (inputs of the network).
+	 */
+	size_t inputSize() {
+		return (replicas.size() > 0) ? replicas[0]->getLayer(0)->inputSize() : 0;
+	}
+
+	/*!
+	 * Returns the size of the predictions (outputs of the network).
+	 */
+	size_t outputSize() {
+		return (replicas.size() > 0) ? replicas[0]->getPredictions()->rows() : 0;
+	}
+
+	/*!
+	 * Creates the socket and starts the threads accepting connections and processing batches.
+	 * @return False if the network was not loaded or the socket could not be created.
+	 */
+	bool start() {
+		if (running)
+			return true;
+		if (replicas.size() == 0) {
+			LOG(LERROR) << "Network not loaded - cannot start the inference server!";
+			return false;
+		}//: if
+
+		sockaddr_un address;
+		if (!socketAddress(socket_path, address))
+			return false;
+		listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		unlink(socket_path.c_str());
+		if ((listen_fd < 0) || (bind(listen_fd, (sockaddr*)&address, sizeof(address)) != 0) || (listen(listen_fd, SOMAXCONN) != 0)) {
+			LOG(LERROR) << "Could not create the socket " << socket_path << ": " << strerror(errno);
+			closeSocket(listen_fd);
+			return false;
+		}//: if
+
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			latencies.clear();
+			processed_requests = 0;
+			processed_batches = 0;
+			start_time = std::chrono::steady_clock::now();
+			running = true;
+		}
+
+		for (size_t i = 0; i < replicas.size(); i++)
+			threads.create_thread(boost::bind(&InferenceServer<eT>::processBatches, this, i));
+		threads.create_thread(boost::bind(&InferenceServer<eT>::acceptConnections, this));
+
+		LOG(LINFO) << "Inference server listening on " << socket_path << " (" << replicas.size() << " replicas, batches of up to " << max_batch_size << " requests)";
+		return true;
+	}
+
+	/*!
+	 * Stops the server: closes the socket and all connections, waits for the threads.
+	 */
+	void stop() {
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			if (!running)
+				return;
+			running = false;
+			// Unblock threads waiting for connections/requests.
+			shutdown(listen_fd, SHUT_RDWR);
+			for (auto & connection : connection_threads)
+				shutdown(connection.first, SHUT_RDWR);
+		}
+		request_arrived.notify_all();
+		request_done.notify_all();
+		threads.join_all();
+
+		// No new connections are accepted - wait for the threads of the remaining ones.
+		std::vector<std::shared_ptr<boost::thread> > remaining;
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			for (auto & connection : connection_threads)
+				remaining.push_back(connection.second);
+			remaining.insert(remaining.end(), finished_threads.begin(), finished_threads.end());
+		}
+		for (std::shared_ptr<boost::thread> thread : remaining)
+			thread->join();
+		connection_threads.clear();
+		finished_threads.clear();
+
+		closeSocket(listen_fd);
+		unlink(socket_path.c_str());
+		queue.clear();
+	}
+
+	/*!
+	 * Returns the number of threads serving connections that were not joined yet (of open connections and of closed ones waiting to be reaped).
+	 */
+	size_t connectionThreads() {
+		boost::mutex::scoped_lock lock(mutex);
+		return connection_threads.size() + finished_threads.size();
+	}
+
+	/*!
+	 * Returns the statistics of the requests processed since the server was started (percentiles of latencies of the last latency_window requests).
+	 */
+	InferenceStatistics getStatistics() {
+		std::vector<double> window;
+		size_t requests, batches;
+		double seconds;
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			window = latencies;
+			requests = processed_requests;
+			batches = processed_batches;
+			seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+		}
+		// Percentiles are computed outside of the critical section.
+		return InferenceStatistics::compute(window, requests, batches, seconds);
+	}
+
+	/// Number of the last requests whose latencies are kept for the statistics.
+	static const size_t latency_window = 10000;
+
+	/*!
+	 * Fills the address of a Unix domain socket.
+	 * @return False if the path is too long.
+	 */
+	static bool socketAddress(std::string path_, sockaddr_un & address_) {
+		memset(&address_, 0, sizeof(address_));
+		address_.sun_family = AF_UNIX;
+		if (path_.size() >= sizeof(address_.sun_path)) {
+			LOG(LERROR) << "Socket path " << path_ << " is too long!";
+			return false;
+		}//: if
+		strncpy(address_.sun_path, path_.c_str(), sizeof(address_.sun_path) - 1);
+		return true;
+	}
+
+	/*!
+	 * Receives the given number of bytes.
+	 * @return False if the connection was closed or broken.
+	 */
+	static bool receive(int fd_, void* data_, size_t bytes_) {
+		char* data = (char*)data_;
+		while (bytes_ > 0) {
+			ssize_t received = recv(fd_, data, bytes_, 0);
+			if (received < 0 && errno == EINTR)
+				continue;
+			if (received <= 0)
+				return false;
+			data += received;
+			bytes_ -= received;
+		}//: while
+		return true;
+	}
+
+	/*!
+	 * Sends the given number of bytes.
+	 * @return False if the connection was closed or broken.
+	 */
+	static bool send(int fd_, const void* data_, size_t bytes_) {
+		const char* data = (const char*)data_;
+		while (bytes_ > 0) {
+			ssize_t sent = ::send(fd_, data, bytes_, MSG_NOSIGNAL);
+			if (sent < 0 && errno == EINTR)
+				continue;
+			if (sent <= 0)
+				return false;
+			data += sent;
+			bytes_ -= sent;
+		}//: while
+		return true;
+	}
+
+	/*!
+	 * Sends a message consisting of the number of values followed by the values.
+	 */
+	static bool sendValues(int fd_, const std::vector<eT> & values_) {
+		uint32_t size = values_.size();
+		return send(fd_, &size, sizeof(size)) && send(fd_, values_.data(), size * sizeof(eT));
+	}
+
+	/*!
+	 * Receives a message consisting of the number of values followed by the values.
+	 * @param expected_size_ Expected number of values (message of other size is treated as an error).
+	 */
+	static bool receiveValues(int fd_, std::vector<eT> & values_, size_t expected_size_) {
+		uint32_t size;
+		if (!receive(fd_, &size, sizeof(size)) || (size != expected_size_))
+			return false;
+		values_.resize(size);
+		return receive(fd_, values_.data(), size * sizeof(eT));
+	}
+
+	/*!
+	 * Closes the socket (if open).
+	 */
+	static void closeSocket(int & fd_) {
+		if (fd_ >= 0)
+			close(fd_);
+		fd_ = -1;
+	}
+
+private:
+	/*!
+	 * \brief Single request - sample waiting for its predictions.
+	 */
+	struct Request {
+		/// Sample.
+		std::vector<eT> input;
+
+		/// Predictions.
+		std::vector<eT> output;
+
+		/// Flag denoting whether predictions are ready.
+		bool done;
+
+		/// Time the request was enqueued.
+		std::chrono::steady_clock::time_point enqueued;
+	};
+
+	/*!
+	 * Loop of the thread accepting connections - starts a thread serving every new connection and joins the threads of the closed ones.
+	 */
+	void acceptConnections() {
+		while (true) {
+			int fd = accept(listen_fd, NULL, NULL);
+			std::vector<std::shared_ptr<boost::thread> > finished;
+			{
+				boost::mutex::scoped_lock lock(mutex);
+				if (!running) {
+					closeSocket(fd);
+					return;
+				}//: if
+				finished.swap(finished_threads);
+				if (fd >= 0)
+					connection_threads[fd] = std::make_shared<boost::thread>(boost::bind(&InferenceServer<eT>::serveConnection, this, fd));
+			}
+			// Threads of the closed connections have already left the critical section.
+			for (std::shared_ptr<boost::thread> thread : finished)
+				thread->join();
+		}//: while
+	}
+
+	/*!
+	 * Loop of the thread serving a single connection: receives requests, enqueues them and sends back the predictions.
+	 */
+	void serveConnection(int fd_) {
+		size_t input_size = inputSize();
+		std::shared_ptr<Request> request = std::make_shared<Request>();
+		while (receiveValues(fd_, request->input, input_size)) {
+			{
+				boost::mutex::scoped_lock lock(mutex);
+				request->done = false;
+				request->enqueued = std::chrono::steady_clock::now();
+				queue.push_back(request);
+				request_arrived.notify_all();
+				while (running && !request->done)
+					request_done.wait(lock);
+				if (!running)
+					break;
+			}
+			if (!sendValues(fd_, request->output))
+				break;
+		}//: while
+
+		boost::mutex::scoped_lock lock(mutex);
+		// Hand the thread over to be joined by the accepting thread (or by stop()).
+		finished_threads.push_back(connection_threads[fd_]);
+		connection_threads.erase(fd_);
+		close(fd_);
+	}
+
+	/*!
+	 * Loop of the worker: collects the batch of requests and computes their predictions using the given replica.
+	 * @param replica_ Index of the replica.
+	 */
+	void processBatches(size_t replica_) {
+		BackpropagationNeuralNetwork<eT> & nn = *replicas[replica_];
+		size_t input_size = inputSize();
+		std::vector<std::shared_ptr<Request> > batch;
+		std::vector<mic::types::MatrixPtr<eT> > inputs(max_batch_size + 1);
+
+		while (true) {
+			batch.clear();
+			{
+				boost::mutex::scoped_lock lock(mutex);
+				while (running && queue.empty())
+					request_arrived.wait(lock);
+				// Wait till the batch is full or the oldest request waited long enough.
+				std::chrono::steady_clock::time_point deadline = queue.empty() ? std::chrono::steady_clock::now() : queue.front()->enqueued + max_latency;
+				while (running && (queue.size() < max_batch_size) && (std::chrono::steady_clock::now() < deadline))
+					request_arrived.timed_wait(lock, boost::posix_time::microseconds(
+							std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now()).count() + 1));
+				if (!running)
+					return;
+				while (!queue.empty() && (batch.size() < max_batch_size)) {
+					batch.push_back(queue.front());
+					queue.pop_front();
+				}//: while
+			}
+			if (batch.empty())
+				continue;
+
+			// Gather the samples - keep matrices for every batch size, so bound inputs are not reallocated.
+			mic::types::MatrixPtr<eT> & x = inputs[batch.size()];
+			if (!x)
+				x = MAKE_MATRIX_PTR(eT, input_size, batch.size());
+			for (size_t i = 0; i < batch.size(); i++)
+				x->col(i) = Eigen::Map<const Eigen::Matrix<eT, Eigen::Dynamic, 1> >(batch[i]->input.data(), input_size);
+
+			nn.forward(x, true);
+			mic::types::MatrixPtr<eT> y = nn.getPredictions();
+
+			boost::mutex::scoped_lock lock(mutex);
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < batch.size(); i++) {
+				batch[i]->output.assign(y->col(i).data(), y->col(i).data() + y->rows());
+				batch[i]->done = true;
+				double latency = std::chrono::duration<double, std::milli>(now - batch[i]->enqueued).count();
+				// Keep only the latest latencies - overwrite the oldest one when the window is full.
+				if (latencies.size() < latency_window)
+					latencies.push_back(latency);
+				else
+					latencies[processed_requests % latency_window] = latency;
+				processed_requests++;
+			}//: for
+			processed_batches++;
+			request_done.notify_all();
+		}//: while
+	}
+
+	/// Replicas of the network.
+	std::vector<std::shared_ptr<BackpropagationNeuralNetwork<eT> > > replicas;
+
+	/// Path of the socket.
+	std::string socket_path;
+
+	/// Maximal size of the batch.
+	size_t max_batch_size;
+
+	/// Maximal time a request waits for other requests.
+	std::chrono::microseconds max_latency;
+
+	/// Listening socket.
+	int listen_fd;
+
+	/// Threads serving open connections (indexed by their sockets).
+	std::map<int, std::shared_ptr<boost::thread> > connection_threads;
+
+	/// Threads of closed connections, waiting to be joined.
+	std::vector<std::shared_ptr<boost::thread> > finished_threads;
+
+	/// Queue of requests waiting for processing.
+	std::deque<std::shared_ptr<Request> > queue;
+
+	/// Flag denoting whether the server is running.
+	bool running;
+
+	/// Latencies of the last latency_window processed requests [ms] (ring buffer).
+	std::vector<double> latencies;
+
+	/// Number of processed requests.
+	size_t processed_requests;
+
+	/// Number of processed batches.
+	size_t processed_batches;
+
+	/// Time the server was started.
+	std::chrono::steady_clock::time_point start_time;
+
+	/// Mutex guarding the state of the server.
+	boost::mutex mutex;
+
+	/// Condition variable signalled when a request is enqueued.
+	boost::condition_variable request_arrived;
+
+	/// Condition variable signalled when a batch of requests is processed.
+	boost::condition_variable request_done;
+
+	/// Threads processing batches and accepting connections.
+	boost::thread_group threads;
+};
+
+} /* namespace mlnn */
+} /* namespace mic */
+
+#endif /* SRC_MLNN_INFERENCESERVER_HPP_ */
@@ -0,0 +1,160 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * @file: InferenceServerTests.cpp
+ * @Author: Tomasz Kornuta <tkornut@us.ibm.com>
+ * @Date:   Oct 16, 2026
+ *
+ * Copyright (c) 2017, Tomasz Kornuta, IBM Corporation. All rights reserved.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <mlnn/InferenceClient.hpp>
+
+/*!
+ * Tests whether predictions returned by the server to concurrent clients are equal to the predictions of the network.
+ */
+TEST(InferenceServer, SameAsForward) {
+	mic::mlnn::BackpropagationNeuralNetwork<float> nn("nn");
+	nn.pushLayer(new mic::mlnn::fully_connected::Linear<float>(6, 5));
+	nn.pushLayer(new mic::mlnn::activation_function::ReLU<float>(5));
+	nn.pushLayer(new mic::mlnn::fully_connected::Linear<float>(5, 3));
+	nn.pushLayer(new mic::mlnn::cost_function::Softmax<float>(3));
+	ASSERT_TRUE(nn.save("inference_server_test.txt"));
+
+	// Samples and their predictions.
+	std::vector<std::vector<float> > samples;
+	std::vector<mic::types::MatrixPtr<float> > predictions;
+	for (size_t i=0; i< 10; i++) {
+		mic::types::MatrixPtr<float> x = MAKE_MATRIX_PTR(float, 6, 1);
+		x->rand(-1.0, 1.0);
+		samples.push_back(std::vector<float>(x->data(), x->data() + 6));
+		nn.forward(x, true);
+		predictions.push_back(MAKE_MATRIX_PTR(float, (*nn.getPredictions())));
+	}//: for
+
+	// Batches are full as soon as all clients send their requests.
+	mic::mlnn::InferenceServer<float> server("inference_server_test.txt", "inference_server_test.sock", 8, 20000, 2);
+	ASSERT_EQ(server.inputSize(), 6);
+	ASSERT_EQ(server.outputSize(), 3);
+	ASSERT_TRUE(server.start());
+
+	mic::mlnn::LoadGenerator<float> generator("inference_server_test.sock", 3);
+	mic::mlnn::InferenceStatistics client_stats = generator.run(samples, 8, 20);
+	ASSERT_EQ(generator.failedRequests(), 0);
+	ASSERT_EQ(client_stats.requests, 160);
+	ASSERT_GT(client_stats.throughput, 0);
+	ASSERT_LE(client_stats.p50, client_stats.p99);
+
+	for (size_t c=0; c< 8; c++)
+		for (size_t r=0; r< 20; r++) {
+			const std::vector<float> & y = generator.getPredictions(c, r);
+			ASSERT_EQ(y.size(), 3);
+			for (size_t i=0; i< 3; i++)
+				EXPECT_NEAR(y[i], (*predictions[(c + r) % 10])[i], 1e-5) << "Difference at position i=" << i << " for client " << c << " in request " << r;
+		}//: for
+
+	mic::mlnn::InferenceStatistics server_stats = server.getStatistics();
+	ASSERT_EQ(server_stats.requests, 160);
+	// Requests were batched.
+	ASSERT_LT(server_stats.batches, 160);
+	server.stop();
+
+	// Server does not accept connections anymore.
+	mic::mlnn::InferenceClient<float> client(3);
+	ASSERT_FALSE(client.connect("inference_server_test.sock"));
+}
+
+/*!
+ * Tests whether the server rejects samples of invalid size and keeps serving other clients.
+ */
+TEST(InferenceServer, InvalidSample) {
+	mic::mlnn::BackpropagationNeuralNetwork<float> nn("nn");
+	nn.pushLayer(new mic::mlnn::fully_connected::Linear<float>(4, 2));
+	ASSERT_TRUE(nn.save("inference_server_test.txt"));
+
+	mic::mlnn::InferenceServer<float> server("inference_server_test.txt", "inference_server_test.sock", 4, 100, 1);
+	ASSERT_TRUE(server.start());
+
+	std::vector<float> y;
+	mic::mlnn::InferenceClient<float> invalid(2);
+	ASSERT_TRUE(invalid.connect("inference_server_test.sock"));
+	ASSERT_FALSE(invalid.predict(std::vector<float>(3, 1.0), y));
+
+	mic::mlnn::InferenceClient<float> valid(2);
+	ASSERT_TRUE(valid.connect("inference_server_test.sock"));
+	ASSERT_TRUE(valid.predict(std::vector<float>(4, 1.0), y));
+	ASSERT_EQ(y.size(), 2);
+}
+
+/*!
+ * Tests whether the statistics count all requests when their number exceeds the window of kept latencies.
+ */
+TEST(InferenceServer, StatisticsWindow) {
+	mic::mlnn::BackpropagationNeuralNetwork<float> nn("nn");
+	nn.pushLayer(new mic::mlnn::fully_connected::Linear<float>(4, 2));
+	ASSERT_TRUE(nn.save("inference_server_test.txt"));
+
+	mic::mlnn::InferenceServer<float> server("inference_server_test.txt", "inference_server_test.sock", 4, 100, 1);
+	ASSERT_TRUE(server.start());
+
+	std::vector<std::vector<float> > samples(1, std::vector<float>(4, 1.0));
+	size_t requests_per_client = mic::mlnn::InferenceServer<float>::latency_window / 4 + 50;
+	mic::mlnn::LoadGenerator<float> generator("inference_server_test.sock", 2);
+	generator.run(samples, 4, requests_per_client);
+	ASSERT_EQ(generator.failedRequests(), 0);
+
+	mic::mlnn::InferenceStatistics stats = server.getStatistics();
+	ASSERT_EQ(stats.requests, 4 * requests_per_client);
+	ASSERT_GT(stats.p50, 0);
+	ASSERT_LE(stats.p50, stats.p99);
+}
+
+/*!
+ * Tests whether threads serving closed connections are joined while the server keeps running.
+ */
+TEST(InferenceServer, ReapConnectionThreads) {
+	mic::mlnn::BackpropagationNeuralNetwork<float> nn("nn");
+	nn.pushLayer(new mic::mlnn::fully_connected::Linear<float>(4, 2));
+	ASSERT_TRUE(nn.save("inference_server_test.txt"));
+
+	mic::mlnn::InferenceServer<float> server("inference_server_test.txt", "inference_server_test.sock", 4, 100, 1);
+	ASSERT_TRUE(server.start());
+
+	std::vector<float> y;
+	for (size_t i=0; i< 50; i++) {
+		mic::mlnn::InferenceClient<float> client(2);
+		ASSERT_TRUE(client.connect("inference_server_test.sock"));
+		ASSERT_TRUE(client.predict(std::vector<float>(4, 1.0), y));
+		client.disconnect();
+	}//: for
+
+	// Only the threads of the open connection and of the one closed just before it might not be joined yet.
+	mic::mlnn::InferenceClient<float> client(2);
+	ASSERT_TRUE(client.connect("inference_server_test.sock"));
+	ASSERT_TRUE(client.predict(std::vector<float>(4, 1.0), y));
+	ASSERT_LE(server.connectionThreads(), 2);
+	server.stop();
+	ASSERT_EQ(server.connectionThreads(), 0);
+}
+
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
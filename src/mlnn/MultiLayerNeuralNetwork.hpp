@@ -26,8 +26,18 @@
 #include <types/MatrixTypes.hpp>
 #include <mlnn/layer/LayerTypes.hpp>
 #include <loss/LossTypes.hpp>
+#include <mlnn/BinaryModelFormat.hpp>
+#include <mlnn/Profiler.hpp>
 
 #include <fstream>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <sstream>
+#include <cstddef>
+#include <atomic>
 // Include headers that implement a archive in simple text format
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/archive/text_oarchive.hpp>
@@ -64,7 +74,17 @@ public:
 	 */
 	MultiLayerNeuralNetwork(std::string name_ = "mlnn") :
 		name(name_),
-		connected(false) // Initially the network is not connected.
+		connected(false), // Initially the network is not connected.
+		multi_tensor_update(false),
+		max_gradient_norm(0),
+		bind_inputs(false),
+		frozen(false),
+		layer_fusion(false),
+		memory_planning(false),
+		layers_generation(nextGeneration()),
+		snapshot_target(nullptr),
+		snapshot_generation(0),
+		snapshot_target_generation(0)
 	{
 
 	}
@@ -81,8 +101,10 @@ public:
 	 */
 	template <typename LayerType>
 	void pushLayer( LayerType* layer_ptr_){
+		unbindInputs();
 		layers.push_back(std::shared_ptr <LayerType> (layer_ptr_));
 		connected = false;
+		layers_generation = nextGeneration();
 	}
 
 	/*!
@@ -114,10 +136,12 @@ public:
 	 */
 	void popLayer(size_t number_of_layers_ = 1){
 		assert(number_of_layers_ <= layers.size());
+		unbindInputs();
 		//layers.erase(layers.back() - number_of_layers_, layers.back());
 		for (size_t i=0; i <number_of_layers_; i++)
 			layers.pop_back();
 		connected = false;
+		layers_generation = nextGeneration();
 	}
 
 
@@ -170,6 +194,7 @@ public:
 		// Iterate through layers and set optimization function for each one.
 		for (size_t i = 0; i < layers.size(); i++)
 			layers[i]->template setOptimization<omT> ();
+		layers_generation = nextGeneration();
 	}
 
 
@@ -180,11 +205,120 @@ public:
 	 */
 	void update(eT alpha_, eT decay_ = 0.0f) {
 		// The updates are cumulated for a batch, reduce the alpha rate.
-		eT alpha_batch = alpha_/layers[0]->batch_size;
+		updateParameters(alpha_/layers[0]->batch_size, decay_);
+	}
 
-		for (size_t i = 0; i < layers.size(); i++) {
-			layers[i]->update(alpha_batch, decay_);
+	/*!
+	 * Updates parameters of all layers with a given (already reduced) learning rate.
+	 * @param alpha_batch Learning rate divided by the size of the batch the gradients were cumulated for.
+	 * @param decay_ Weight decay rate.
+	 */
+	void updateParameters(eT alpha_batch, eT decay_) {
+		if (frozen) {
+			LOG(LERROR) << "Network " << name << " is frozen - it cannot be updated!";
+			return;
+		}//: if
+
+		if (!multi_tensor_update) {
+			for (size_t i = 0; i < layers.size(); i++) {
+				MLNN_PROFILE(profiler, ProfiledPhase::Update, layers[i]->name(), bytesTouched(layers[i], ProfiledPhase::Update),
+						layers[i]->update(alpha_batch, decay_));
+			}//: for
+			return;
+		}//: if
+
+		// Collect parameters of all layers - and update layers that do not expose them.
+		collectParameterSegments();
+		for (size_t i = 0; i < unsegmented_layers.size(); i++) {
+			std::shared_ptr<Layer<eT> > layer = layers[unsegmented_layers[i]];
+			MLNN_PROFILE(profiler, ProfiledPhase::Update, layer->name(), bytesTouched(layer, ProfiledPhase::Update),
+					layer->update(alpha_batch, decay_));
 		}//: for
+
+#ifndef MLNN_DISABLE_PROFILING
+		// The multi-tensor pass is recorded as a single operation.
+		Profiler::time_point update_start;
+		if (profiler)
+			update_start = Profiler::now();
+#endif
+
+		// Rescale the gradients if their norm is too big.
+		eT scale = 1.0;
+		if (max_gradient_norm > 0) {
+			eT norm = sweepGradientNorm();
+			if (norm > max_gradient_norm)
+				scale = max_gradient_norm / norm;
+		}//: if
+
+		// Update all parameters in a single parallel pass.
+#pragma omp parallel for schedule(static)
+		for (size_t c = 0; c < update_chunks.size(); c++) {
+			const UpdateChunk & chunk = update_chunks[c];
+			ParameterSegment<eT> & segment = parameter_segments[chunk.segment];
+			eT* dp = segment.dp->data();
+			if (scale != 1.0)
+				for (size_t i = chunk.begin; i < chunk.end; i++)
+					dp[i] *= scale;
+			segment.opt->applyUpdate(segment.p->data(), dp, chunk.begin, chunk.end, alpha_batch, (segment.decay ? decay_ : (eT)0.0));
+		}//: for
+
+		// Finalize the step.
+		for (size_t i = 0; i < parameter_segments.size(); i++)
+			parameter_segments[i].opt->nextStep();
+		for (size_t i = 0; i < layers.size(); i++)
+			layers[i]->invalidateParameterCaches();
+
+#ifndef MLNN_DISABLE_PROFILING
+		if (profiler) {
+			size_t bytes = 0;
+			for (size_t i = 0; i < parameter_segments.size(); i++)
+				bytes += (2 * parameter_segments[i].p->size() + optimizationStateSize(parameter_segments[i].opt)) * sizeof(eT);
+			profiler->record("multi-tensor", ProfiledPhase::Update, update_start, bytes);
+		}//: if
+#endif
+	}
+
+	/*!
+	 * Sets the profiler recording the time and bytes touched by forward, backward and update of every layer, the loss computation and feeding of the inputs.
+	 * Replicas used in data-parallel and asynchronous training are not profiled.
+	 * @param profiler_ Profiler (nullptr disables profiling).
+	 */
+	void setProfiler(std::shared_ptr<Profiler> profiler_) {
+		profiler = profiler_;
+	}
+
+	/*!
+	 * Returns the profiler (nullptr if profiling is disabled).
+	 */
+	std::shared_ptr<Profiler> getProfiler() {
+		return profiler;
+	}
+
+	/*!
+	 * Enables/disables the multi-tensor update, i.e. update() stepping the parameters of all layers in a single parallel pass (split into chunks of update_chunk_size elements),
+	 * instead of calling update() of every layer and the optimization function of every parameter one by one.
+	 * Layers that do not expose their parameters (e.g. hebbian ones) are still updated by their own update().
+	 * @param multi_tensor_ Flag denoting whether the multi-tensor update should be used (DEFAULT=true).
+	 */
+	void setMultiTensorUpdate(bool multi_tensor_ = true) {
+		multi_tensor_update = multi_tensor_;
+	}
+
+	/*!
+	 * Sets the maximal L2 norm of the gradients of all parameters - if exceeded, the gradients are scaled down before the update.
+	 * Works only with the multi-tensor update.
+	 * @param max_norm_ Maximal norm (0 disables clipping).
+	 */
+	void setGradientClipping(eT max_norm_) {
+		max_gradient_norm = max_norm_;
+	}
+
+	/*!
+	 * Returns the L2 norm of the gradients of all parameters updated by gradient-based optimization functions (computed in a single sweep).
+	 */
+	eT gradientNorm() {
+		collectParameterSegments();
+		return sweepGradientNorm();
 	}
 
 
@@ -201,21 +335,178 @@ public:
 	 * @param New size of the batch.
 	 */
 	void resizeBatch(size_t batch_size_) {
-		// If current batch size is ok.
-		if ((size_t)(layers[0]->s['x'])->cols() == batch_size_)
+		// If current batch size is ok (the bound input might already have the new size, so check the own one).
+		mic::types::MatrixPtr<eT> input = owned_input ? owned_input : layers[0]->s[layers[0]->hx];
+		if ((size_t)input->cols() == batch_size_)
 			return;
 
-		// Else - resize.
+		// Else - resize (own matrices of the layers, not the bound ones).
+		unbindInputs();
 		for (size_t i = 0; i < layers.size(); i++) {
 			layers[i]->resizeBatch(batch_size_);
 		}//: for
 	}
 
+	/*!
+	 * Switches the network to the inference-only mode (e.g. for serving predictions of a loaded model), minimizing its memory footprint:
+	 * releases gradients, optimization functions and temporary matrices used only in training, then plans the memory of activations -
+	 * outputs of layers with elementwise forward pass overwrite their inputs, and activations that are never alive at the same time share matrices
+	 * (if they have the same size). Afterwards the network can perform only forward passes (in the test mode).
+	 * Must be called when the network is complete.
+	 */
+	void freeze() {
+		if (frozen || (layers.size() == 0))
+			return;
+		unbindInputs();
+
+		for (size_t i = 0; i < layers.size(); i++)
+			layers[i]->freeze();
+
+		// Activations: 0 - input of the network, i+1 - output of i-th layer.
+		// Group activations stored in the same matrix (as computed in place) and determine lifetimes of the groups,
+		// i.e. the step (layer) they are produced in (-1 for the input) and the last step they are consumed in.
+		size_t num_layers = layers.size();
+		std::vector<size_t> group(num_layers + 1);
+		std::vector<int> group_begin, group_end;
+		std::vector<size_t> group_rows;
+		group[0] = 0;
+		group_begin.push_back(-1);
+		group_end.push_back(0);
+		group_rows.push_back(layers[0]->inputSize());
+		for (size_t i = 0; i < num_layers; i++) {
+			// The first layer cannot overwrite its input, as it might be bound to an external matrix.
+			if ((i > 0) && layers[i]->elementwiseForward() && (layers[i]->inputSize() == layers[i]->outputSize()))
+				group[i+1] = group[i];
+			else {
+				group[i+1] = group_begin.size();
+				group_begin.push_back(i);
+				group_rows.push_back(layers[i]->outputSize());
+				group_end.push_back(i);
+			}//: else
+			// Consumed by the next layer (or kept, in the case of predictions).
+			group_end[group[i+1]] = i + 1;
+		}//: for
+
+		// Assign groups to matrices - reuse matrices of the same size that are not needed anymore.
+		std::vector<mic::types::MatrixPtr<eT> > group_matrix(group_begin.size());
+		std::vector<mic::types::MatrixPtr<eT> > matrices;
+		std::vector<int> matrix_end;
+		for (size_t gi = 0; gi < group_begin.size(); gi++) {
+			for (size_t mi = 0; mi < matrices.size(); mi++) {
+				if ((matrix_end[mi] < group_begin[gi]) && ((size_t)matrices[mi]->rows() == group_rows[gi])) {
+					group_matrix[gi] = matrices[mi];
+					matrix_end[mi] = group_end[gi];
+					break;
+				}//: if
+			}//: for
+			if (!group_matrix[gi]) {
+				group_matrix[gi] = (gi == 0) ? layers[0]->s[layers[0]->hx] : layers[group_begin[gi]]->s[layers[group_begin[gi]]->hy];
+				matrices.push_back(group_matrix[gi]);
+				matrix_end.push_back(group_end[gi]);
+			}//: if
+		}//: for
+
+		// Connect the layers through the assigned matrices.
+		layers[0]->s[layers[0]->hx] = group_matrix[group[0]];
+		for (size_t i = 0; i < num_layers; i++) {
+			layers[i]->s[layers[i]->hy] = group_matrix[group[i+1]];
+			if (i + 1 < num_layers)
+				layers[i+1]->s[layers[i+1]->hx] = group_matrix[group[i+1]];
+		}//: for
+		connected = true;
+		frozen = true;
+		fuseLayers();
+
+		LOG(LINFO) << "Network " << name << " frozen: " << num_layers + 1 << " activations stored in " << matrices.size() << " matrices, footprint " << memoryFootprint() << " bytes";
+	}
+
+	/*!
+	 * Returns true if the network is in the inference-only mode.
+	 */
+	bool isFrozen() {
+		return frozen;
+	}
+
+	/*!
+	 * Returns the number of bytes occupied by the matrices of all layers (states, gradients, parameters and temporary matrices) and the scratch arena,
+	 * counting shared matrices once. The internal state of optimization functions is not included.
+	 */
+	size_t memoryFootprint() {
+		std::set<mic::types::Matrix<eT>*> counted;
+		size_t bytes = 0;
+		for (size_t i = 0; i < layers.size(); i++) {
+			mic::types::MatrixArray<eT>* arrays[] = {&layers[i]->s, &layers[i]->g, &layers[i]->p, &layers[i]->m};
+			for (mic::types::MatrixArray<eT>* array : arrays)
+				for (auto key : array->keys()) {
+					mic::types::MatrixPtr<eT> matrix = (*array)[key.second];
+					if (counted.insert(matrix.get()).second)
+						bytes += matrix->size() * sizeof(eT);
+				}//: for
+		}//: for
+		if (scratch_arena)
+			bytes += scratch_arena->bytes();
+		return bytes;
+	}
+
+	/*!
+	 * Enables/disables binding of the inputs: forward() makes the first layer use the passed input matrix directly (instead of copying it)
+	 * and backward() does the same with the gradient passed to the last layer.
+	 * The bound matrices must remain unchanged (and alive) until the processing of a given batch (i.e. forward, backward and update) is finished.
+	 * @param bind_ Flag denoting whether the inputs should be bound (DEFAULT=true).
+	 */
+	void setInputBinding(bool bind_ = true) {
+		unbindInputs();
+		bind_inputs = bind_;
+	}
+
+	/*!
+	 * Enables/disables the layer fusion pass, performed whenever the layers get connected (i.e. in the first forward pass after a change of the structure or when the network is frozen).
+	 * The pass finds blocks of neighbouring layers and executes each of them as a single operation:
+	 *  - Linear -> ReLU/ELU/Sigmoid: the product is written directly to the output of the activation, then the bias and the activation are applied in a single sweep,
+	 *  - Linear -> ReLU/ELU/Sigmoid -> Dropout: additionally the gradients of dropout and of the activation are calculated in a single sweep,
+	 *  - Convolution -> ReLU/ELU/Sigmoid -> MaxPooling: outputs of the convolution are pooled first and only the pooled ones are activated (as the activations are monotonic).
+	 * The layers remain in the network (and are saved as usual), but the intermediate states and gradients inside the blocks (e.g. outputs of the fused Linear layers) are not updated.
+	 * @param fusion_ Flag denoting whether the layers should be fused (DEFAULT=true).
+	 */
+	void setLayerFusion(bool fusion_ = true) {
+		layer_fusion = fusion_;
+		fuseLayers();
+		// Lifetimes of buffers depend on the blocks.
+		if (connected)
+			planMemory();
+	}
+
+	/*!
+	 * Enables/disables planning of the memory used in training, performed whenever the layers get connected (i.e. in the first forward pass after a change of the structure).
+	 * The planner determines lifetimes of activations and gradients passed between the layers over the forward and backward pass - taking into account
+	 * which of them are read in the backward pass and the blocks of fused layers - and stores the ones that are never alive at the same time in shared matrices.
+	 * Outputs of elementwise layers overwrite their inputs if neither the layer nor the preceding one needs them in the backward pass.
+	 * Temporary matrices of the layers are served from a single scratch arena, sized for the most demanding layer.
+	 * Afterwards only the input, the predictions and the gradients of the input and of the predictions remain valid after the processing of a batch
+	 * (intermediate activations and gradients are overwritten).
+	 * @param planning_ Flag denoting whether the memory should be planned (DEFAULT=true).
+	 */
+	void setMemoryPlanning(bool planning_ = true) {
+		memory_planning = planning_;
+		if (connected || !planning_)
+			planMemory();
+	}
+
+	/*!
+	 * Returns the descriptions of blocks of layers executed as single operations.
+	 */
+	std::vector<std::string> getFusions() {
+		std::vector<std::string> fusions;
+		for (size_t i = 0; i < fused_blocks.size(); i++)
+			fusions.push_back(fused_blocks[i].name);
+		return fusions;
+	}
+
 	/*!
 	 * Returns the predictions (output of the forward processing) of the last layer in the form of a matrix of size [output_size x batch_size].
 	 */
 	mic::types::MatrixPtr<eT> getPredictions() {
-		return layers.back()->s['y'];
+		return layers.back()->s[layers.back()->hy];
 	}
 
 	/*!
@@ -224,7 +515,7 @@ public:
 	 */
 	mic::types::MatrixPtr<eT> getPredictions(size_t layer_nr_) {
 		assert(layer_nr_ < layers.size());
-		return layers[layer_nr_]->s['y'];
+		return layers[layer_nr_]->s[layers[layer_nr_]->hy];
 	}
 
 	/*!
@@ -271,6 +562,47 @@ public:
 		return os_;
 	}
 
+	/*!
+	 * Copies the network to the snapshot: parameters, states of the optimization functions and configurations of layers.
+	 * When the structure of the snapshot differs (e.g. at the first call) the whole network is copied through an in-memory archive.
+	 * Otherwise only the values are copied - through the list of pairs of matrices and scalars collected when the layers of either network were replaced,
+	 * so refreshing the snapshot with the same layers does not allocate any memory and can be done periodically at a low cost.
+	 * @param snapshot_ Snapshot of the network.
+	 * @return False if the network could not be copied.
+	 */
+	bool snapshotTo(MultiLayerNeuralNetwork<eT> & snapshot_) {
+		if ((snapshot_target != &snapshot_) || (snapshot_generation != layers_generation) || (snapshot_target_generation != snapshot_.layers_generation)) {
+			snapshot_target = nullptr;
+			if (!sameStructure(snapshot_)) {
+				try {
+					std::stringstream archive;
+					{
+						boost::archive::text_oarchive oar(archive);
+						oar & (*this);
+					}
+					boost::archive::text_iarchive iar(archive);
+					iar & snapshot_;
+				} catch(...) {
+					LOG(LERROR) << "Could not copy neural network " << name << " to the snapshot!";
+					snapshot_.layers.clear();
+					return false;
+				}
+			}//: if
+			collectSnapshotState(snapshot_);
+		}//: if
+
+		snapshot_.name = name;
+		for (size_t i = 0; i < snapshot_matrices.size(); i++)
+			(*snapshot_matrices[i].second) = (*snapshot_matrices[i].first);
+		for (size_t i = 0; i < snapshot_scalars.size(); i++)
+			(*snapshot_scalars[i].second) = (*snapshot_scalars[i].first);
+		for (size_t l = 0; l < layers.size(); l++) {
+			snapshot_.layers[l]->invalidateParameterCaches();
+			copyConfiguration(layers[l], snapshot_.layers[l]);
+		}//: for
+		return true;
+	}
+
 
 	/*!
 	 * Saves network to file using serialization.
@@ -300,11 +632,14 @@ public:
 	}
 
 	/*!
-	 * Loads network from the file using serialization.
+	 * Loads network from the file using serialization. Files in the binary format are detected and loaded with loadBinary().
 	 * @param filename_ Name of the file.
 	 */
 	bool load(std::string filename_)
 	{
+		// Only the magic number is read.
+		if (binary_format::ModelFile(filename_, sizeof(binary_format::magic)).isBinaryModel())
+			return loadBinary(filename_);
 		try {
 			// Create and input archive
 			std::ifstream ifs(filename_);
@@ -322,6 +657,246 @@ public:
 		return true;
 	}
 
+	/*!
+	 * Saves network to the file in the binary format: header, table of layers, table of tensors and aligned raw blobs with parameters.
+	 * Only parameters are stored, the remaining matrices are recreated (zeroed) during loading.
+	 * @param filename_ Name of the file.
+	 */
+	bool saveBinary(std::string filename_)
+	{
+		using namespace binary_format;
+		std::vector<BinaryLayerEntry> layer_table(layers.size());
+		std::vector<BinaryTensorEntry> tensor_table;
+		std::vector<mic::types::MatrixPtr<eT> > blobs;
+		std::string strings;
+
+		// Fill the tables - offsets are relative to the pool of strings/first blob, corrected below.
+		for (size_t i = 0; i < layers.size(); i++) {
+			BinaryLayerEntry & entry = layer_table[i];
+			std::shared_ptr<Layer<eT> > layer = layers[i];
+			memset(&entry, 0, sizeof(entry));
+			entry.layer_type = (uint32_t)layer->layer_type;
+			entry.input_height = layer->input_height;
+			entry.input_width = layer->input_width;
+			entry.input_depth = layer->input_depth;
+			entry.output_height = layer->output_height;
+			entry.output_width = layer->output_width;
+			entry.output_depth = layer->output_depth;
+			entry.batch_size = layer->batch_size;
+			entry.name_offset = strings.size();
+			entry.name_length = layer->layer_name.size();
+			strings += layer->layer_name;
+			entry.first_tensor = tensor_table.size();
+
+			// Store the parameters specific to the layer type.
+			std::ostringstream configuration;
+			{
+				boost::archive::text_oarchive ar(configuration, boost::archive::no_header);
+				serializeConfiguration(ar, layer, layer->layer_type, configuration_version);
+			}
+			entry.config_offset = strings.size();
+			entry.config_length = configuration.str().size();
+			strings += configuration.str();
+
+			mic::types::MatrixArray<eT>* arrays[] = {&layer->s, &layer->g, &layer->p, &layer->m};
+			for (uint32_t a = 0; a < 4; a++) {
+				// Store matrices in the order of their handles.
+				std::map<std::string, size_t> keys = arrays[a]->keys();
+				std::vector<std::string> names(keys.size());
+				for (auto key : keys)
+					names[key.second] = key.first;
+				for (size_t h = 0; h < names.size(); h++) {
+					mic::types::MatrixPtr<eT> matrix = (*arrays[a])[h];
+					BinaryTensorEntry tensor;
+					memset(&tensor, 0, sizeof(tensor));
+					tensor.array = a;
+					tensor.rows = matrix->rows();
+					tensor.cols = matrix->cols();
+					tensor.name_offset = strings.size();
+					tensor.name_length = names[h].size();
+					strings += names[h];
+					if (a == (uint32_t)MatrixArrays::Parameters) {
+						// Mark the blob - its offset is set below.
+						tensor.data_offset = blobs.size() + 1;
+						blobs.push_back(matrix);
+					}//: if
+					tensor_table.push_back(tensor);
+				}//: for
+			}//: for
+			entry.num_tensors = tensor_table.size() - entry.first_tensor;
+		}//: for
+
+		// Compute the layout.
+		BinaryHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, magic, sizeof(magic));
+		header.version = version;
+		header.scalar_size = sizeof(eT);
+		header.num_layers = layer_table.size();
+		header.num_tensors = tensor_table.size();
+		header.layer_table_offset = sizeof(BinaryHeader);
+		header.tensor_table_offset = header.layer_table_offset + layer_table.size() * sizeof(BinaryLayerEntry);
+		uint64_t strings_offset = header.tensor_table_offset + tensor_table.size() * sizeof(BinaryTensorEntry);
+		header.name_offset = strings_offset + strings.size();
+		header.name_length = name.size();
+		strings += name;
+
+		std::vector<uint64_t> blob_offsets(blobs.size());
+		uint64_t offset = strings_offset + strings.size();
+		for (size_t b = 0; b < blobs.size(); b++) {
+			blob_offsets[b] = align(offset);
+			offset = blob_offsets[b] + blobs[b]->size() * sizeof(eT);
+		}//: for
+		for (size_t i = 0; i < layer_table.size(); i++) {
+			layer_table[i].name_offset += strings_offset;
+			layer_table[i].config_offset += strings_offset;
+		}//: for
+		for (size_t t = 0; t < tensor_table.size(); t++) {
+			tensor_table[t].name_offset += strings_offset;
+			if (tensor_table[t].data_offset > 0)
+				tensor_table[t].data_offset = blob_offsets[tensor_table[t].data_offset - 1];
+		}//: for
+
+		// Write the file.
+		std::ofstream ofs(filename_, std::ios::binary);
+		ofs.write((const char*)&header, sizeof(header));
+		ofs.write((const char*)layer_table.data(), layer_table.size() * sizeof(BinaryLayerEntry));
+		ofs.write((const char*)tensor_table.data(), tensor_table.size() * sizeof(BinaryTensorEntry));
+		ofs.write(strings.data(), strings.size());
+		offset = strings_offset + strings.size();
+		const char padding[blob_alignment] = {0};
+		for (size_t b = 0; b < blobs.size(); b++) {
+			ofs.write(padding, blob_offsets[b] - offset);
+			ofs.write((const char*)blobs[b]->data(), blobs[b]->size() * sizeof(eT));
+			offset = blob_offsets[b] + blobs[b]->size() * sizeof(eT);
+		}//: for
+		ofs.close();
+
+		if (!ofs) {
+			LOG(LERROR) << "Could not write neural network " << name << " to file " << filename_ << "!";
+			return false;
+		}//: if
+		LOG(LINFO) << "Network " << name << " properly saved to binary file " << filename_;
+		return true;
+	}
+
+	/*!
+	 * Loads network from the file in the binary format. The file is read at once and parameters are copied from it into the matrices of the layers
+	 * without any parsing.
+	 * The file does not contain the state of optimization functions - the layers get the default gradient descent, to be replaced by setOptimization() if required.
+	 * @param filename_ Name of the file.
+	 */
+	bool loadBinary(std::string filename_)
+	{
+		using namespace binary_format;
+		ModelFile file(filename_);
+		if (!file.isBinaryModel()) {
+			LOG(LERROR) << "File " << filename_ << " does not contain a neural network in the binary format!";
+			return false;
+		}//: if
+
+		BinaryHeader header;
+		if (!file.contains(0, sizeof(header))) {
+			LOG(LERROR) << "Binary file " << filename_ << " is truncated!";
+			return false;
+		}//: if
+		memcpy(&header, file.at(0), sizeof(header));
+		if ((header.version < 1) || (header.version > version) || (header.scalar_size != sizeof(eT))) {
+			LOG(LERROR) << "Binary file " << filename_ << " has version " << header.version << " and scalars of size " << header.scalar_size
+					<< " (expected version " << version << " and size " << sizeof(eT) << ")!";
+			return false;
+		}//: if
+		// Entries of layers in version 1 lack the configuration.
+		size_t layer_entry_size = (header.version == 1) ? offsetof(BinaryLayerEntry, config_offset) : sizeof(BinaryLayerEntry);
+		if (!file.contains(header.layer_table_offset, header.num_layers * layer_entry_size) ||
+				!file.contains(header.tensor_table_offset, header.num_tensors * sizeof(BinaryTensorEntry)) ||
+				!file.contains(header.name_offset, header.name_length)) {
+			LOG(LERROR) << "Binary file " << filename_ << " is truncated!";
+			return false;
+		}//: if
+
+		layers.clear();
+		connected = false;
+		owned_input.reset();
+		owned_output_gradient.reset();
+		frozen = false;
+		layers_generation = nextGeneration();
+		name = file.string(header.name_offset, header.name_length);
+
+		const BinaryTensorEntry* tensor_table = (const BinaryTensorEntry*)file.at(header.tensor_table_offset);
+		for (size_t i = 0; i < header.num_layers; i++) {
+			BinaryLayerEntry entry;
+			memset(&entry, 0, sizeof(entry));
+			memcpy(&entry, file.at(header.layer_table_offset + i * layer_entry_size), layer_entry_size);
+			std::shared_ptr<Layer<eT> > layer = createLayer((LayerTypes)entry.layer_type);
+			if (!layer || !file.contains(entry.name_offset, entry.name_length) || !file.contains(entry.config_offset, entry.config_length) ||
+					(entry.first_tensor + entry.num_tensors > header.num_tensors)) {
+				LOG(LERROR) << "Could not load layer " << i << " from binary file " << filename_ << "!";
+				layers.clear();
+				return false;
+			}//: if
+			layer->layer_type = (LayerTypes)entry.layer_type;
+			layer->input_height = entry.input_height;
+			layer->input_width = entry.input_width;
+			layer->input_depth = entry.input_depth;
+			layer->output_height = entry.output_height;
+			layer->output_width = entry.output_width;
+			layer->output_depth = entry.output_depth;
+			layer->batch_size = entry.batch_size;
+			layer->layer_name = file.string(entry.name_offset, entry.name_length);
+
+			layer->s = mic::types::MatrixArray<eT>("state");
+			layer->g = mic::types::MatrixArray<eT>("gradients");
+			layer->p = mic::types::MatrixArray<eT>("parameters");
+			layer->m = mic::types::MatrixArray<eT>("memory");
+			mic::types::MatrixArray<eT>* arrays[] = {&layer->s, &layer->g, &layer->p, &layer->m};
+			for (size_t t = entry.first_tensor; t < entry.first_tensor + entry.num_tensors; t++) {
+				const BinaryTensorEntry & tensor = tensor_table[t];
+				uint64_t bytes = tensor.rows * tensor.cols * sizeof(eT);
+				if ((tensor.array > 3) || !file.contains(tensor.name_offset, tensor.name_length) ||
+						((tensor.data_offset > 0) && !file.contains(tensor.data_offset, bytes))) {
+					LOG(LERROR) << "Could not load matrix " << t << " from binary file " << filename_ << "!";
+					layers.clear();
+					return false;
+				}//: if
+				std::string matrix_name = file.string(tensor.name_offset, tensor.name_length);
+				arrays[tensor.array]->add(matrix_name, tensor.rows, tensor.cols);
+				mic::types::MatrixPtr<eT> matrix = (*arrays[tensor.array])[matrix_name];
+				if (tensor.data_offset > 0)
+					memcpy(matrix->data(), file.at(tensor.data_offset), bytes);
+				else
+					matrix->setZero();
+			}//: for
+
+			try {
+				if (header.version >= 2) {
+					// Restore the parameters specific to the layer type.
+					std::istringstream configuration(file.string(entry.config_offset, entry.config_length));
+					boost::archive::text_iarchive ar(configuration, boost::archive::no_header);
+					// Version N of the format stores configurations of version N+1 of the network class.
+					serializeConfiguration(ar, layer, layer->layer_type, header.version + 1);
+				}//: if
+
+				// Matrices were (re)created - resolve their handles.
+				layer->resolveHandles();
+			} catch(...) {
+				LOG(LERROR) << "Could not load layer " << i << " from binary file " << filename_ << "!";
+				layers.clear();
+				return false;
+			}
+			// Restore filter size and stride of convolutional layers saved in version 1.
+			if ((header.version == 1) && (layer->layer_type == LayerTypes::Convolution))
+				std::dynamic_pointer_cast<Convolution<eT> >(layer)->repackLegacyFilters();
+			// Optimization functions are not stored - create the default ones.
+			layer->template setOptimization<mic::neural_nets::optimization::GradientDescent<eT> > ();
+
+			layers.push_back(layer);
+		}//: for
+
+		LOG(LINFO) << "Network " << name << " properly loaded from binary file " << filename_;
+		return true;
+	}
+
 
 
 protected:
@@ -338,6 +913,853 @@ protected:
     /// Flag denoting whether the layers are interconnected, thus no copying between inputs and outputs of the neighboring layers will be required.
     bool connected;
 
+	/// Flag denoting whether the multi-tensor update is used.
+	bool multi_tensor_update;
+
+	/// Maximal norm of the gradients (0 means no clipping).
+	eT max_gradient_norm;
+
+	/// Flag denoting whether the inputs (and gradients of outputs) are bound instead of copied.
+	bool bind_inputs;
+
+	/// Flag denoting whether the network is in the inference-only mode.
+	bool frozen;
+
+	/// Flag denoting whether blocks of layers are fused.
+	bool layer_fusion;
+
+	/// Flag denoting whether the memory used in training is planned.
+	bool memory_planning;
+
+	/// Scratch arena serving temporary matrices of all layers (nullptr if the memory is not planned).
+	std::shared_ptr<ScratchArena<eT> > scratch_arena;
+
+	/// Profiler (nullptr if profiling is disabled).
+	std::shared_ptr<Profiler> profiler;
+
+	/// Input matrix owned by the first layer - stored when the input is bound.
+	mic::types::MatrixPtr<eT> owned_input;
+
+	/// Gradient of the output owned by the last layer - stored when the gradient is bound.
+	mic::types::MatrixPtr<eT> owned_output_gradient;
+
+	/// Generation of the layers - changed whenever layers, their parameters or optimization functions are replaced (e.g. pushed or loaded).
+	size_t layers_generation;
+
+	/// Snapshot the pairs of matrices and scalars were collected for (nullptr if none).
+	MultiLayerNeuralNetwork<eT>* snapshot_target;
+
+	/// Generation of the layers the pairs were collected for.
+	size_t snapshot_generation;
+
+	/// Generation of the layers of the snapshot the pairs were collected for.
+	size_t snapshot_target_generation;
+
+	/// Pairs of matrices (parameters and states of optimization functions) of the network and the snapshot, copied by snapshotTo().
+	std::vector<std::pair<mic::types::MatrixPtr<eT>, mic::types::MatrixPtr<eT> > > snapshot_matrices;
+
+	/// Pairs of scalars of optimization functions of the network and the snapshot, copied by snapshotTo().
+	std::vector<std::pair<eT*, eT*> > snapshot_scalars;
+
+	/*!
+	 * Creates an empty layer of a given type - to be filled during deserialization.
+	 * @param lt Type of the layer.
+	 * @return Pointer to the layer (empty if the type is undefined).
+	 */
+	static std::shared_ptr<Layer<eT> > createLayer(LayerTypes lt) {
+		std::shared_ptr<Layer<eT> > layer_ptr;
+		switch(lt) {
+		// activation_function
+		case(LayerTypes::ELU):
+			layer_ptr = std::make_shared<ELU<eT> >(ELU<eT>());
+			LOG(LDEBUG) <<  "ELU";
+			break;
+		case(LayerTypes::ReLU):
+			layer_ptr = std::make_shared<ReLU<eT> >(ReLU<eT>());
+			LOG(LDEBUG) <<  "ReLU";
+			break;
+		case(LayerTypes::Sigmoid):
+			layer_ptr = std::make_shared<Sigmoid<eT> >(Sigmoid<eT>());
+			LOG(LDEBUG) <<  "Sigmoid";
+			break;
+
+		// convolution
+		case(LayerTypes::Convolution):
+			layer_ptr = std::make_shared<Convolution<eT> >(Convolution<eT>());
+			LOG(LDEBUG) <<  "Convolution";
+			break;
+		case(LayerTypes::Cropping):
+			layer_ptr = std::make_shared<Cropping<eT> >(Cropping<eT>());
+			LOG(LDEBUG) <<  "Cropping";
+			break;
+		case(LayerTypes::MaxPooling):
+			layer_ptr = std::make_shared<MaxPooling<eT> >(MaxPooling<eT>());
+			LOG(LDEBUG) <<  "MaxPooling";
+			break;
+		case(LayerTypes::Padding):
+			layer_ptr = std::make_shared<Padding<eT> >(Padding<eT>());
+			LOG(LDEBUG) <<  "Padding";
+			break;
+
+		// cost_function
+		case(LayerTypes::Softmax):
+			layer_ptr = std::make_shared<Softmax<eT> >(Softmax<eT>());
+			LOG(LDEBUG) <<  "Softmax";
+			break;
+
+		// fully_connected
+		case(LayerTypes::Linear):
+			//ar.template register_type<mic::mlnn::Linear>();
+			layer_ptr = std::make_shared<Linear<eT> >(Linear<eT>());
+			LOG(LDEBUG) <<  "Linear";
+			break;
+		case(LayerTypes::SparseLinear):
+			layer_ptr = std::make_shared<SparseLinear<eT> >(SparseLinear<eT>());
+			LOG(LDEBUG) <<  "SparseLinear";
+			break;
+		case(LayerTypes::FusedLinear):
+			layer_ptr = std::make_shared<FusedLinear<eT> >(FusedLinear<eT>());
+			LOG(LDEBUG) <<  "FusedLinear";
+			break;
+		case(LayerTypes::HebbianLinear):
+			layer_ptr = std::make_shared<HebbianLinear<eT> >(HebbianLinear<eT>());
+			LOG(LDEBUG) <<  "HebbianLinear";
+			break;
+
+		case(LayerTypes::BinaryCorrelator):
+			layer_ptr = std::make_shared<BinaryCorrelator<eT> >(BinaryCorrelator<eT>());
+			LOG(LDEBUG) <<  "BinaryCorrelator";
+			break;
+
+		// regularisation
+		case(LayerTypes::Dropout):
+			layer_ptr = std::make_shared<Dropout<eT> >(Dropout<eT>());
+			LOG(LDEBUG) <<  "Dropout";
+			break;
+
+		default:
+			LOG(LERROR) <<  "Undefined Layer type detected during deserialization!";
+		}//: switch
+		return layer_ptr;
+	}
+
+	/*!
+	 * Serializes the parameters specific to the type of the layer (e.g. filter size or keep ratio), which are not stored by Layer::serialize.
+	 * @param ar Used archive.
+	 * @param layer_ Serialized layer.
+	 * @param lt Type of the layer.
+	 * @param version_ Version of the configuration (equal to the version of the network class it was stored with).
+	 */
+	template<class Archive>
+	static void serializeConfiguration(Archive & ar, std::shared_ptr<Layer<eT> > layer_, LayerTypes lt, const unsigned int version_) {
+		switch(lt) {
+		case(LayerTypes::Convolution):
+			std::dynamic_pointer_cast<Convolution<eT> >(layer_)->serializeConfiguration(ar);
+			break;
+		case(LayerTypes::Cropping):
+			std::dynamic_pointer_cast<Cropping<eT> >(layer_)->serializeConfiguration(ar);
+			break;
+		case(LayerTypes::MaxPooling):
+			std::dynamic_pointer_cast<MaxPooling<eT> >(layer_)->serializeConfiguration(ar, version_);
+			break;
+		case(LayerTypes::Padding):
+			std::dynamic_pointer_cast<Padding<eT> >(layer_)->serializeConfiguration(ar);
+			break;
+		case(LayerTypes::Dropout):
+			std::dynamic_pointer_cast<Dropout<eT> >(layer_)->serializeConfiguration(ar);
+			break;
+		case(LayerTypes::FusedLinear):
+			std::dynamic_pointer_cast<FusedLinear<eT> >(layer_)->serializeConfiguration(ar);
+			break;
+		case(LayerTypes::ELU):
+			std::dynamic_pointer_cast<ELU<eT> >(layer_)->serializeConfiguration(ar, version_);
+			break;
+		case(LayerTypes::Sigmoid):
+			std::dynamic_pointer_cast<Sigmoid<eT> >(layer_)->serializeConfiguration(ar, version_);
+			break;
+		default:
+			break;
+		}//: switch
+	}
+
+	/*!
+	 * Sets the input of the first layer - binds or copies the passed matrix.
+	 * @param input_ Input matrix.
+	 */
+	void setInput(mic::types::MatrixPtr<eT> input_) {
+		std::shared_ptr<Layer<eT> > first = layers[0];
+		if (!bind_inputs) {
+			(*(first->s[first->hx])) = (*input_);
+			return;
+		}//: if
+		if (!owned_input)
+			owned_input = first->s[first->hx];
+		first->s[first->hx] = input_;
+	}
+
+	/*!
+	 * Sets the gradient of the output of the last layer - binds or copies the passed matrix.
+	 * @param gradient_ Gradient matrix.
+	 */
+	void setOutputGradient(mic::types::MatrixPtr<eT> gradient_) {
+		std::shared_ptr<Layer<eT> > last = layers.back();
+		if (!bind_inputs) {
+			(*(last->g[last->hy])) = (*gradient_);
+			return;
+		}//: if
+		if (!owned_output_gradient)
+			owned_output_gradient = last->g[last->hy];
+		last->g[last->hy] = gradient_;
+	}
+
+	/*!
+	 * Restores the matrices owned by the first and last layers (if bound).
+	 */
+	void unbindInputs() {
+		if (owned_input) {
+			layers[0]->s[layers[0]->hx] = owned_input;
+			owned_input.reset();
+		}//: if
+		if (owned_output_gradient) {
+			layers.back()->g[layers.back()->hy] = owned_output_gradient;
+			owned_output_gradient.reset();
+		}//: if
+	}
+
+	/// Number of parameter elements updated as a single unit of work by the multi-tensor update.
+	static const size_t update_chunk_size = 16384;
+
+	/// Current version of the configurations of layers (must be equal to the version of the class set with BOOST_CLASS_VERSION).
+	static const unsigned int configuration_version = 5;
+
+	/*!
+	 * \brief Range of elements of a parameter segment - the unit of work of the multi-tensor update.
+	 */
+	struct UpdateChunk {
+		/// Index of the segment.
+		size_t segment;
+
+		/// Index of the first element.
+		size_t begin;
+
+		/// Index following the last element.
+		size_t end;
+	};
+
+	/// Parameters of all layers updated by gradient-based optimization functions.
+	std::vector<ParameterSegment<eT> > parameter_segments;
+
+	/// Parameter segments split into chunks.
+	std::vector<UpdateChunk> update_chunks;
+
+	/// Indices of layers that do not expose their parameters, thus must be updated by their own update().
+	std::vector<size_t> unsegmented_layers;
+
+	/*!
+	 * \brief Types of blocks of layers executed as single operations.
+	 */
+	enum class FusionTypes : short {
+		LinearActivation = 0, ///< Linear -> activation
+		LinearActivationDropout, ///< Linear -> activation -> Dropout
+		ConvolutionActivationPooling ///< Convolution -> activation -> MaxPooling
+	};
+
+	/*!
+	 * \brief Block of neighbouring layers executed as a single operation.
+	 */
+	struct FusedBlock {
+		/// Type of the block.
+		FusionTypes type;
+
+		/// Index of the first layer.
+		size_t first;
+
+		/// Number of layers.
+		size_t count;
+
+		/// Activation function (of the second layer).
+		mic::mlnn::activation_function::kernels::Activation activation;
+
+		/// Description of the block (types and names of the layers).
+		std::string name;
+	};
+
+	/// Blocks of fused layers.
+	std::vector<FusedBlock> fused_blocks;
+
+	/// Index of the block containing the given layer (-1 if the layer is not fused).
+	std::vector<int> fused_block_of;
+
+	/*!
+	 * Creates a replica of a layer, i.e. its copy that shares parameters with the original, but has its own states, gradients and temporary matrices.
+	 * Only layers trained by back-propagation can be replicated.
+	 * @param layer_ Layer to be replicated.
+	 * @return Replica or nullptr if the layer cannot be replicated.
+	 */
+	std::shared_ptr<Layer<eT> > replicateLayer(std::shared_ptr<Layer<eT> > layer_) {
+		std::shared_ptr<Layer<eT> > replica;
+		switch(layer_->layer_type) {
+		// activation_function
+		case(LayerTypes::ELU):
+			replica = std::make_shared<ELU<eT> >(*std::dynamic_pointer_cast<ELU<eT> >(layer_));
+			break;
+		case(LayerTypes::ReLU):
+			replica = std::make_shared<ReLU<eT> >(*std::dynamic_pointer_cast<ReLU<eT> >(layer_));
+			break;
+		case(LayerTypes::Sigmoid):
+			replica = std::make_shared<Sigmoid<eT> >(*std::dynamic_pointer_cast<Sigmoid<eT> >(layer_));
+			break;
+
+		// convolution
+		case(LayerTypes::Convolution):
+			replica = std::make_shared<Convolution<eT> >(*std::dynamic_pointer_cast<Convolution<eT> >(layer_));
+			break;
+		case(LayerTypes::Cropping):
+			replica = std::make_shared<Cropping<eT> >(*std::dynamic_pointer_cast<Cropping<eT> >(layer_));
+			break;
+		case(LayerTypes::MaxPooling):
+			replica = std::make_shared<MaxPooling<eT> >(*std::dynamic_pointer_cast<MaxPooling<eT> >(layer_));
+			break;
+		case(LayerTypes::Padding):
+			replica = std::make_shared<Padding<eT> >(*std::dynamic_pointer_cast<Padding<eT> >(layer_));
+			break;
+
+		// cost_function
+		case(LayerTypes::Softmax):
+			replica = std::make_shared<Softmax<eT> >(*std::dynamic_pointer_cast<Softmax<eT> >(layer_));
+			break;
+
+		// fully_connected
+		case(LayerTypes::Linear):
+			replica = std::make_shared<Linear<eT> >(*std::dynamic_pointer_cast<Linear<eT> >(layer_));
+			break;
+		case(LayerTypes::SparseLinear):
+			replica = std::make_shared<SparseLinear<eT> >(*std::dynamic_pointer_cast<SparseLinear<eT> >(layer_));
+			break;
+		case(LayerTypes::FusedLinear):
+			replica = std::make_shared<FusedLinear<eT> >(*std::dynamic_pointer_cast<FusedLinear<eT> >(layer_));
+			break;
+
+		// regularisation
+		case(LayerTypes::Dropout):
+			replica = std::make_shared<Dropout<eT> >(*std::dynamic_pointer_cast<Dropout<eT> >(layer_));
+			break;
+
+		default:
+			LOG(LERROR) <<  "Layer " << layer_->name() << " cannot be replicated!";
+			return nullptr;
+		}//: switch
+
+		// Give the replica its own states, gradients and temporary matrices.
+		for (auto key : replica->s.keys())
+			replica->s[key.second] = MAKE_MATRIX_PTR(eT, *layer_->s[key.second]);
+		for (auto key : replica->g.keys())
+			replica->g[key.second] = MAKE_MATRIX_PTR(eT, *layer_->g[key.second]);
+		for (auto key : replica->m.keys())
+			replica->m[key.second] = MAKE_MATRIX_PTR(eT, *layer_->m[key.second]);
+
+		// Share parameters.
+		for (auto key : replica->p.keys())
+			replica->p[key.second] = layer_->p[key.second];
+
+		// Replicas are processed concurrently - the arena must not be shared.
+		replica->setScratchArena(nullptr);
+
+		return replica;
+	}
+
+	/*!
+	 * Returns the number of bytes touched by the given phase of the layer - the sizes of the matrices it reads or writes (each counted once):
+	 * input, output and parameters in forward; input, gradients of the output and input, parameters and their gradients in backward;
+	 * parameters, their gradients and states of the optimization functions in update.
+	 * @param layer_ Layer.
+	 * @param phase_ Phase.
+	 */
+	size_t bytesTouched(std::shared_ptr<Layer<eT> > layer_, ProfiledPhase phase_) {
+		size_t x = layer_->s[layer_->hx]->size();
+		size_t y = layer_->s[layer_->hy]->size();
+		size_t p = 0;
+		size_t state = 0;
+		for (size_t i = 0; i < layer_->p.keys().size(); i++)
+			p += layer_->p[i]->size();
+		switch (phase_) {
+		case(ProfiledPhase::Forward):
+			return (x + y + p) * sizeof(eT);
+		case(ProfiledPhase::Backward):
+			return (2 * x + y + 2 * p) * sizeof(eT);
+		case(ProfiledPhase::Update):
+			for (size_t i = 0; i < layer_->opt.size(); i++)
+				state += optimizationStateSize(layer_->opt[i]);
+			return (2 * p + state) * sizeof(eT);
+		default:
+			return 0;
+		}//: switch
+	}
+
+	/*!
+	 * Returns the number of elements of the state matrices of the optimization function.
+	 */
+	static size_t optimizationStateSize(std::shared_ptr<mic::neural_nets::optimization::OptimizationFunction<eT> > opt_) {
+		size_t size = 0;
+		std::vector<mic::types::MatrixPtr<eT> > matrices = opt_->stateMatrices();
+		for (size_t i = 0; i < matrices.size(); i++)
+			size += matrices[i]->size();
+		return size;
+	}
+
+	/*!
+	 * Checks whether the other network consists of layers of the same types, with parameters and optimization functions of the same sizes and types.
+	 * @param other_ Other network.
+	 */
+	bool sameStructure(MultiLayerNeuralNetwork<eT> & other_) {
+		if (layers.size() != other_.layers.size())
+			return false;
+		for (size_t l = 0; l < layers.size(); l++) {
+			std::shared_ptr<Layer<eT> > layer = layers[l];
+			std::shared_ptr<Layer<eT> > other = other_.layers[l];
+			if ((layer->layer_type != other->layer_type) || (layer->batch_size != other->batch_size) ||
+					(layer->inputSize() != other->inputSize()) || (layer->outputSize() != other->outputSize()) ||
+					(layer->p.keys() != other->p.keys()) || (layer->opt.size() != other->opt.size()))
+				return false;
+			size_t num_params = layer->p.keys().size();
+			for (size_t i = 0; i < num_params; i++)
+				if ((layer->p[i]->rows() != other->p[i]->rows()) || (layer->p[i]->cols() != other->p[i]->cols()))
+					return false;
+			for (size_t i = 0; i < layer->opt.size(); i++)
+				if (layer->opt[i]->type() != other->opt[i]->type())
+					return false;
+		}//: for
+		return true;
+	}
+
+	/*!
+	 * Collects the pairs of parameters and states of the optimization functions of the network and the snapshot (of the same structure), copied by snapshotTo().
+	 * @param snapshot_ Snapshot of the network.
+	 */
+	void collectSnapshotState(MultiLayerNeuralNetwork<eT> & snapshot_) {
+		snapshot_matrices.clear();
+		snapshot_scalars.clear();
+		for (size_t l = 0; l < layers.size(); l++) {
+			std::shared_ptr<Layer<eT> > from = layers[l];
+			std::shared_ptr<Layer<eT> > to = snapshot_.layers[l];
+			size_t num_params = from->p.keys().size();
+			for (size_t i = 0; i < num_params; i++)
+				snapshot_matrices.push_back(std::make_pair(from->p[i], to->p[i]));
+			for (size_t i = 0; i < from->opt.size(); i++) {
+				std::vector<mic::types::MatrixPtr<eT> > from_matrices = from->opt[i]->stateMatrices();
+				std::vector<mic::types::MatrixPtr<eT> > to_matrices = to->opt[i]->stateMatrices();
+				for (size_t j = 0; j < from_matrices.size(); j++)
+					snapshot_matrices.push_back(std::make_pair(from_matrices[j], to_matrices[j]));
+				std::vector<eT*> from_scalars = from->opt[i]->stateScalars();
+				std::vector<eT*> to_scalars = to->opt[i]->stateScalars();
+				for (size_t j = 0; j < from_scalars.size(); j++)
+					snapshot_scalars.push_back(std::make_pair(from_scalars[j], to_scalars[j]));
+			}//: for
+		}//: for
+		snapshot_target = &snapshot_;
+		snapshot_generation = layers_generation;
+		snapshot_target_generation = snapshot_.layers_generation;
+	}
+
+	/*!
+	 * Copies the configuration that might change without replacing the layer (e.g. position in the stream of dropout masks) between layers of the same type.
+	 * The remaining configuration determines the sizes of matrices of the layer, hence is equal in layers of the same structure.
+	 * @param from_ Source layer.
+	 * @param to_ Destination layer.
+	 */
+	static void copyConfiguration(std::shared_ptr<Layer<eT> > from_, std::shared_ptr<Layer<eT> > to_) {
+		switch(from_->layer_type) {
+		case(LayerTypes::Convolution):
+			std::static_pointer_cast<Convolution<eT> >(to_)->engine = std::static_pointer_cast<Convolution<eT> >(from_)->engine;
+			break;
+		case(LayerTypes::Dropout): {
+			std::shared_ptr<Dropout<eT> > from = std::static_pointer_cast<Dropout<eT> >(from_);
+			std::shared_ptr<Dropout<eT> > to = std::static_pointer_cast<Dropout<eT> >(to_);
+			to->keep_ratio = from->keep_ratio;
+			to->seed = from->seed;
+			to->counter = from->counter;
+			break;
+		}
+		case(LayerTypes::FusedLinear): {
+			std::shared_ptr<FusedLinear<eT> > from = std::static_pointer_cast<FusedLinear<eT> >(from_);
+			std::shared_ptr<FusedLinear<eT> > to = std::static_pointer_cast<FusedLinear<eT> >(to_);
+			to->activation = from->activation;
+			to->fast_exp = from->fast_exp;
+			break;
+		}
+		case(LayerTypes::ELU):
+			std::static_pointer_cast<ELU<eT> >(to_)->fast_exp = std::static_pointer_cast<ELU<eT> >(from_)->fast_exp;
+			break;
+		case(LayerTypes::Sigmoid):
+			std::static_pointer_cast<Sigmoid<eT> >(to_)->fast_exp = std::static_pointer_cast<Sigmoid<eT> >(from_)->fast_exp;
+			break;
+		default:
+			break;
+		}//: switch
+	}
+
+	/*!
+	 * Returns a new generation of layers - unique among all networks.
+	 */
+	static size_t nextGeneration() {
+		static std::atomic<size_t> generation(0);
+		return ++generation;
+	}
+
+	/*!
+	 * Collects the parameter segments of all layers and splits them into chunks.
+	 * Collected anew on every call, as layers, their parameters and optimization functions might have been replaced in the meantime (vectors retain their capacity, so there are no reallocations).
+	 */
+	void collectParameterSegments() {
+		parameter_segments.clear();
+		update_chunks.clear();
+		unsegmented_layers.clear();
+
+		for (size_t i = 0; i < layers.size(); i++)
+			if (!layers[i]->getParameterSegments(parameter_segments))
+				unsegmented_layers.push_back(i);
+
+		for (size_t i = 0; i < parameter_segments.size(); i++) {
+			assert(parameter_segments[i].p->size() == parameter_segments[i].dp->size());
+			size_t size = parameter_segments[i].p->size();
+			// Parameters of the optimization functions that cannot update ranges form single chunks.
+			size_t chunk_size = parameter_segments[i].opt->supportsRanges() ? update_chunk_size : size;
+			for (size_t begin = 0; begin < size; begin += chunk_size) {
+				size_t end = begin + chunk_size;
+				update_chunks.push_back({i, begin, (end < size) ? end : size});
+			}//: for
+		}//: for
+	}
+
+	/*!
+	 * Calculates the L2 norm of the gradients of the collected parameter segments.
+	 */
+	eT sweepGradientNorm() {
+		double sum = 0.0;
+#pragma omp parallel for schedule(static) reduction(+:sum)
+		for (size_t c = 0; c < update_chunks.size(); c++) {
+			const UpdateChunk & chunk = update_chunks[c];
+			const eT* dp = parameter_segments[chunk.segment].dp->data();
+			double chunk_sum = 0.0;
+			for (size_t i = chunk.begin; i < chunk.end; i++)
+				chunk_sum += (double)dp[i] * dp[i];
+			sum += chunk_sum;
+		}//: for
+		return (eT)std::sqrt(sum);
+	}
+
+	/*!
+	 * Finds the blocks of neighbouring layers that can be executed as single operations (if the layer fusion is enabled).
+	 * Must be called whenever the layers get connected, as the blocks rely on neighbouring layers sharing their inputs/outputs.
+	 */
+	void fuseLayers() {
+		fused_blocks.clear();
+		fused_block_of.assign(layers.size(), -1);
+		if (!layer_fusion)
+			return;
+
+		for (size_t i = 0; i + 2 <= layers.size(); i++) {
+			FusedBlock block;
+			block.first = i;
+			if (!fusableActivation(layers[i+1], block.activation))
+				continue;
+			bool dropout = (i + 2 < layers.size()) && (layers[i+2]->layer_type == LayerTypes::Dropout);
+			bool pooling = (i + 2 < layers.size()) && (layers[i+2]->layer_type == LayerTypes::MaxPooling);
+			// Exact types - layers derived from Linear (e.g. SparseLinear) compute their gradients differently.
+			if (layers[i]->layer_type == LayerTypes::Linear) {
+				block.type = dropout ? FusionTypes::LinearActivationDropout : FusionTypes::LinearActivation;
+				block.count = dropout ? 3 : 2;
+			} else if ((layers[i]->layer_type == LayerTypes::Convolution) && pooling) {
+				block.type = FusionTypes::ConvolutionActivationPooling;
+				block.count = 3;
+			} else
+				continue;
+
+			for (size_t j = i; j < i + block.count; j++) {
+				block.name += ((j > i) ? " + " : "") + layers[j]->type() + " '" + layers[j]->name() + "'";
+				fused_block_of[j] = fused_blocks.size();
+			}//: for
+			LOG(LINFO) << "Network " << name << ": fused " << block.name;
+			fused_blocks.push_back(block);
+			i += block.count - 1;
+		}//: for
+	}
+
+	/*!
+	 * Checks whether the layer is an activation function that can be fused with the preceding layer.
+	 * @param layer_ Layer.
+	 * @param activation_ Returned activation function.
+	 */
+	bool fusableActivation(std::shared_ptr<Layer<eT> > layer_, mic::mlnn::activation_function::kernels::Activation & activation_) {
+		switch (layer_->layer_type) {
+		case(LayerTypes::ReLU):
+			activation_ = mic::mlnn::activation_function::kernels::Activation::ReLU;
+			return true;
+		case(LayerTypes::ELU):
+			activation_ = mic::mlnn::activation_function::kernels::Activation::ELU;
+			return true;
+		case(LayerTypes::Sigmoid):
+			activation_ = mic::mlnn::activation_function::kernels::Activation::Sigmoid;
+			return true;
+		default:
+			return false;
+		}//: switch
+	}
+
+	/*!
+	 * Returns the fused block starting with the given layer, or nullptr if there is no such block or it does not fit in the processed layers.
+	 * @param layer_ Index of the layer.
+	 * @param num_layers_ Number of processed layers.
+	 */
+	const FusedBlock* fusedBlockStartingAt(size_t layer_, size_t num_layers_) {
+		if ((layer_ >= fused_block_of.size()) || (fused_block_of[layer_] < 0))
+			return nullptr;
+		const FusedBlock & block = fused_blocks[fused_block_of[layer_]];
+		return ((block.first == layer_) && (block.first + block.count <= num_layers_)) ? &block : nullptr;
+	}
+
+	/*!
+	 * Returns the fused block ending with the given layer, or nullptr if there is no such block or it does not fit in the processed layers.
+	 * @param layer_ Index of the layer.
+	 * @param num_layers_ Number of processed layers.
+	 */
+	const FusedBlock* fusedBlockEndingAt(size_t layer_, size_t num_layers_) {
+		if ((layer_ >= fused_block_of.size()) || (fused_block_of[layer_] < 0))
+			return nullptr;
+		const FusedBlock & block = fused_blocks[fused_block_of[layer_]];
+		return ((block.first + block.count == layer_ + 1) && (block.first + block.count <= num_layers_)) ? &block : nullptr;
+	}
+
+	/*!
+	 * Returns true if exp used by the activation layer is approximated.
+	 */
+	bool activationFastExp(std::shared_ptr<Layer<eT> > layer_) {
+		if (layer_->layer_type == LayerTypes::ELU)
+			return std::dynamic_pointer_cast<ELU<eT> >(layer_)->getFastExp();
+		if (layer_->layer_type == LayerTypes::Sigmoid)
+			return std::dynamic_pointer_cast<Sigmoid<eT> >(layer_)->getFastExp();
+		return false;
+	}
+
+	/*!
+	 * Performs the forward pass of the fused block.
+	 * @param block_ Block of layers.
+	 * @param test_ It is set to true in test mode (network verification).
+	 */
+	void forwardFusedBlock(const FusedBlock & block_, bool test_) {
+		std::shared_ptr<Layer<eT> > first = layers[block_.first];
+		std::shared_ptr<Layer<eT> > activation = layers[block_.first + 1];
+		bool fast_exp = activationFastExp(activation);
+
+		switch (block_.type) {
+		case(FusionTypes::LinearActivation):
+		case(FusionTypes::LinearActivationDropout): {
+			std::shared_ptr<Linear<eT> > linear = std::dynamic_pointer_cast<Linear<eT> >(first);
+			std::shared_ptr<Layer<eT> > dropout = (block_.type == FusionTypes::LinearActivationDropout) ? layers[block_.first + 2] : nullptr;
+			// Product written directly to the output of the activation.
+			mic::types::MatrixPtr<eT> z = activation->s[activation->hy];
+			(*z).noalias() = (*linear->p[linear->hW]) * (*linear->s[linear->hx]);
+			// In test mode dropout passes its input, so the activation is written directly to its output.
+			mic::types::MatrixPtr<eT> y = (dropout && test_) ? dropout->s[dropout->hy] : z;
+			mic::mlnn::activation_function::kernels::activate(block_.activation, fast_exp, z->data(), linear->p[linear->hb]->data(), y->data(), (size_t)z->rows(), (size_t)z->cols());
+			if (dropout && !test_)
+				dropout->forward(false);
+			break;
+		}
+		case(FusionTypes::ConvolutionActivationPooling): {
+			std::shared_ptr<MaxPooling<eT> > pooling = std::dynamic_pointer_cast<MaxPooling<eT> >(layers[block_.first + 2]);
+			first->forward(test_);
+			// Activations are monotonic - pool the outputs of the convolution, then activate only the pooled ones.
+			mic::types::MatrixPtr<eT> y = pooling->s[pooling->hy];
+			pooling->pool(first->s[first->hy]->data(), y->data());
+			mic::mlnn::activation_function::kernels::activate<eT>(block_.activation, fast_exp, y->data(), nullptr, y->data(), (size_t)y->size(), 1);
+			break;
+		}
+		}//: switch
+	}
+
+	/*!
+	 * Performs the backward pass of the fused block.
+	 * @param block_ Block of layers.
+	 */
+	void backwardFusedBlock(const FusedBlock & block_) {
+		std::shared_ptr<Layer<eT> > first = layers[block_.first];
+		std::shared_ptr<Layer<eT> > activation = layers[block_.first + 1];
+		// Gradient of the output of the first layer (the input of the activation).
+		mic::types::MatrixPtr<eT> dz = first->g[first->hy];
+
+		switch (block_.type) {
+		case(FusionTypes::LinearActivation):
+			mic::mlnn::activation_function::kernels::activationGradient(block_.activation, activation->s[activation->hy]->data(),
+					activation->g[activation->hy]->data(), dz->data(), (size_t)dz->size());
+			break;
+		case(FusionTypes::LinearActivationDropout): {
+			std::shared_ptr<Dropout<eT> > dropout = std::dynamic_pointer_cast<Dropout<eT> >(layers[block_.first + 2]);
+			mic::mlnn::activation_function::kernels::activationGradient(block_.activation, activation->s[activation->hy]->data(),
+					dropout->g[dropout->hy]->data(), dropout->m[dropout->hmask]->data(), dz->data(), (size_t)dz->size());
+			break;
+		}
+		case(FusionTypes::ConvolutionActivationPooling): {
+			std::shared_ptr<MaxPooling<eT> > pooling = std::dynamic_pointer_cast<MaxPooling<eT> >(layers[block_.first + 2]);
+			const eT* y = pooling->s[pooling->hy]->data();
+			const eT* dy = pooling->g[pooling->hy]->data();
+			// Derivative of the activation (calculated from the pooled output) applied while scattering the gradients.
+			switch (block_.activation) {
+			case(mic::mlnn::activation_function::kernels::Activation::ReLU):
+				pooling->template unpool<mic::mlnn::activation_function::kernels::ReLUBackward<eT> >(y, dy, dz->data());
+				break;
+			case(mic::mlnn::activation_function::kernels::Activation::ELU):
+				pooling->template unpool<mic::mlnn::activation_function::kernels::ELUBackward<eT> >(y, dy, dz->data());
+				break;
+			case(mic::mlnn::activation_function::kernels::Activation::Sigmoid):
+				pooling->template unpool<mic::mlnn::activation_function::kernels::SigmoidBackward<eT> >(y, dy, dz->data());
+				break;
+			default:
+				pooling->template unpool<mic::mlnn::activation_function::kernels::IdentityBackward<eT> >(y, dy, dz->data());
+			}//: switch
+			break;
+		}
+		}//: switch
+
+		first->backward();
+	}
+
+	/*!
+	 * Returns the number of bytes touched by the given phase of the fused block - the input of the first layer, the output of the last one
+	 * and the parameters (plus the respective gradients in backward).
+	 * @param block_ Block of layers.
+	 * @param phase_ Phase.
+	 */
+	size_t bytesTouched(const FusedBlock & block_, ProfiledPhase phase_) {
+		std::shared_ptr<Layer<eT> > first = layers[block_.first];
+		std::shared_ptr<Layer<eT> > last = layers[block_.first + block_.count - 1];
+		size_t x = first->s[first->hx]->size();
+		size_t y = last->s[last->hy]->size();
+		size_t p = 0;
+		for (size_t i = 0; i < first->p.keys().size(); i++)
+			p += first->p[i]->size();
+		return ((phase_ == ProfiledPhase::Backward) ? (2 * x + y + 2 * p) : (x + y + p)) * sizeof(eT);
+	}
+
+	/*!
+	 * Plans the memory used in training (if the memory planning is enabled) - must be called whenever the layers get connected.
+	 * Activations: 0 - input of the network, i+1 - output of i-th layer; gradients: 0 - gradient of the input, i+1 - gradient of the output of i-th layer.
+	 * The input, the predictions and their gradients are left intact, the remaining activations and gradients are stored in matrices assigned according to their lifetimes.
+	 * Disabling the planning gives every layer its own matrices back (the layers must be connected again).
+	 */
+	void planMemory() {
+		if (frozen || (layers.size() == 0))
+			return;
+		if (!memory_planning) {
+			if (!scratch_arena)
+				return;
+			for (size_t i = 0; i < layers.size(); i++) {
+				std::shared_ptr<Layer<eT> > layer = layers[i];
+				layer->setScratchArena(nullptr);
+				layer->s[layer->hx] = MAKE_MATRIX_PTR(eT, *layer->s[layer->hx]);
+				layer->s[layer->hy] = MAKE_MATRIX_PTR(eT, *layer->s[layer->hy]);
+				layer->g[layer->hx] = MAKE_MATRIX_PTR(eT, *layer->g[layer->hx]);
+				layer->g[layer->hy] = MAKE_MATRIX_PTR(eT, *layer->g[layer->hy]);
+			}//: for
+			scratch_arena.reset();
+			connected = false;
+			return;
+		}//: if
+
+		// Layers of a fused block are processed in a single step.
+		size_t num_layers = layers.size();
+		auto fused = [&](size_t i_) { return (i_ < fused_block_of.size()) && (fused_block_of[i_] >= 0); };
+		std::vector<int> step(num_layers);
+		int steps = 0;
+		for (size_t i = 0; i < num_layers; i++) {
+			if ((i > 0) && fused(i) && (fused_block_of[i] == fused_block_of[i-1]))
+				step[i] = step[i-1];
+			else
+				step[i] = steps++;
+		}//: for
+		// Forward pass of a given step is performed at time step, then the loss is calculated (at time steps) and the backward pass follows.
+		std::vector<int> backward_time(num_layers);
+		for (size_t i = 0; i < num_layers; i++)
+			backward_time[i] = 2 * steps - step[i];
+
+		// Determine lifetimes of activations and gradients (the time they are produced in and the last time they are used in).
+		// Activations and gradients with the same number of rows can be stored in the same matrix if their lifetimes do not overlap.
+		std::vector<int> begin, end;
+		std::vector<size_t> rows;
+		// Group of activations (stored in the same matrix, as computed in place) and gradients.
+		std::vector<int> activation_group(num_layers + 1, -1), gradient_group(num_layers + 1, -1);
+		for (size_t j = 1; j < num_layers; j++) {
+			// Fused blocks might read all their activations in the backward pass.
+			int first_use = step[j-1];
+			int last_use = step[j];
+			if (layers[j]->backwardUsesInput() || fused(j))
+				last_use = std::max(last_use, backward_time[j]);
+			if (layers[j-1]->backwardUsesOutput() || fused(j-1))
+				last_use = std::max(last_use, backward_time[j-1]);
+
+			// Layer j-1 overwrites its input if neither it nor the preceding layer needs the input in the backward pass (the output of the last layer is left intact).
+			if ((j > 1) && layers[j-1]->elementwiseForward() && (layers[j-1]->inputSize() == layers[j-1]->outputSize()) && !fused(j-1) && !fused(j-2) &&
+					!layers[j-1]->backwardUsesInput() && !layers[j-2]->backwardUsesOutput()) {
+				activation_group[j] = activation_group[j-1];
+				end[activation_group[j]] = std::max(end[activation_group[j]], last_use);
+			} else {
+				activation_group[j] = begin.size();
+				begin.push_back(first_use);
+				end.push_back(last_use);
+				rows.push_back(layers[j-1]->outputSize());
+			}//: else
+
+			// Gradient of the output of layer j-1 is produced in the backward pass of layer j (or in the loss calculation, in the case of the last layer) and used by layer j-1.
+			gradient_group[j] = begin.size();
+			begin.push_back((j == num_layers - 1) ? steps : backward_time[j]);
+			end.push_back(backward_time[j-1]);
+			rows.push_back(layers[j-1]->outputSize());
+		}//: for
+
+		// Assign groups to matrices in the order they are produced - reuse matrices of the same size that are not needed anymore.
+		std::vector<size_t> order(begin.size());
+		for (size_t gi = 0; gi < order.size(); gi++)
+			order[gi] = gi;
+		std::stable_sort(order.begin(), order.end(), [&](size_t a_, size_t b_) { return begin[a_] < begin[b_]; });
+		size_t batch_size = layers[0]->batchSize();
+		std::vector<mic::types::MatrixPtr<eT> > group_matrix(begin.size());
+		std::vector<mic::types::MatrixPtr<eT> > matrices;
+		std::vector<int> matrix_end;
+		for (size_t gi : order) {
+			for (size_t mi = 0; mi < matrices.size(); mi++) {
+				if ((matrix_end[mi] < begin[gi]) && ((size_t)matrices[mi]->rows() == rows[gi])) {
+					group_matrix[gi] = matrices[mi];
+					matrix_end[mi] = end[gi];
+					break;
+				}//: if
+			}//: for
+			if (!group_matrix[gi]) {
+				group_matrix[gi] = MAKE_MATRIX_PTR(eT, rows[gi], batch_size);
+				group_matrix[gi]->setZero();
+				matrices.push_back(group_matrix[gi]);
+				matrix_end.push_back(end[gi]);
+			}//: if
+		}//: for
+
+		// Connect the layers through the assigned matrices.
+		for (size_t j = 1; j < num_layers; j++) {
+			layers[j-1]->s[layers[j-1]->hy] = group_matrix[activation_group[j]];
+			layers[j]->s[layers[j]->hx] = group_matrix[activation_group[j]];
+			layers[j-1]->g[layers[j-1]->hy] = group_matrix[gradient_group[j]];
+			layers[j]->g[layers[j]->hx] = group_matrix[gradient_group[j]];
+		}//: for
+
+		// Serve temporary matrices of all layers from a single arena.
+		scratch_arena = std::make_shared<ScratchArena<eT> >();
+		for (size_t i = 0; i < num_layers; i++) {
+			scratch_arena->reserve(layers[i]->scratchSize());
+			layers[i]->setScratchArena(scratch_arena);
+		}//: for
+
+		LOG(LINFO) << "Network " << name << " memory planned: " << 2 * (num_layers - 1) << " activations and gradients stored in " << matrices.size()
+				<< " matrices, scratch arena of " << scratch_arena->bytes() << " bytes, footprint " << memoryFootprint() << " bytes";
+	}
+
 
 private:
 	// Friend class - required for using boost serialization.
@@ -364,6 +1786,9 @@ private:
 
 			// Serialize the layer.
 			ar & (*layers[i]);
+
+			// Serialize the parameters specific to its type.
+			serializeConfiguration(ar, layers[i], layers[i]->layer_type, version);
 		}//: for
 
     }
@@ -371,13 +1796,17 @@ private:
     /*!
      * Serialization load - loads the neural net object to archive.
      * @param ar Used archive.
-     * @param version Version of the neural net class (not used currently).
+     * @param version Version of the neural net class.
      */
     template<class Archive>
     void load(Archive & ar, const unsigned int version) {
     	// Clear the layers vector - just in case.
     	layers.clear();
     	connected = false;
+    	owned_input.reset();
+    	owned_output_gradient.reset();
+    	frozen = false;
+    	layers_generation = nextGeneration();
 
     	// Deserialize name.
 		ar & name;
@@ -392,77 +1821,27 @@ private:
 			// Get layer type
 			ar & lt;
 
-			std::shared_ptr<Layer<eT> > layer_ptr;
-			switch(lt) {
-			// activation_function
-			case(LayerTypes::ELU):
-				layer_ptr = std::make_shared<ELU<eT> >(ELU<eT>());
-				LOG(LDEBUG) <<  "ELU";
-				break;
-			case(LayerTypes::ReLU):
-				layer_ptr = std::make_shared<ReLU<eT> >(ReLU<eT>());
-				LOG(LDEBUG) <<  "ReLU";
-				break;
-			case(LayerTypes::Sigmoid):
-				layer_ptr = std::make_shared<Sigmoid<eT> >(Sigmoid<eT>());
-				LOG(LDEBUG) <<  "Sigmoid";
-				break;
+			std::shared_ptr<Layer<eT> > layer_ptr = createLayer(lt);
+			if (!layer_ptr)
+				throw std::runtime_error("Undefined layer type");
 
-			// convolution
-			case(LayerTypes::Convolution):
-				layer_ptr = std::make_shared<Convolution<eT> >(Convolution<eT>());
-				LOG(LERROR) <<  "Convolution Layer serialization not implemented (some params are not serialized)!";
-				break;
-			case(LayerTypes::Cropping):
-				layer_ptr = std::make_shared<Cropping<eT> >(Cropping<eT>());
-				LOG(LERROR) <<  "Cropping Layer serialization not implemented (some params are not serialized)!";
-				break;
-			case(LayerTypes::MaxPooling):
-				layer_ptr = std::make_shared<MaxPooling<eT> >(MaxPooling<eT>());
-				LOG(LERROR) <<  "MaxPooling Layer serialization not implemented (some params are not serialized)!";
-				break;
-			case(LayerTypes::Padding):
-				layer_ptr = std::make_shared<Padding<eT> >(Padding<eT>());
-				LOG(LERROR) <<  "Padding Layer serialization not implemented (some params are not serialized)!";
-				break;
-
-			// cost_function
-			case(LayerTypes::Softmax):
-				layer_ptr = std::make_shared<Softmax<eT> >(Softmax<eT>());
-				LOG(LDEBUG) <<  "Softmax";
-				break;
-
-			// fully_connected
-			case(LayerTypes::Linear):
-				//ar.template register_type<mic::mlnn::Linear>();
-				layer_ptr = std::make_shared<Linear<eT> >(Linear<eT>());
-				LOG(LDEBUG) <<  "Linear";
-				break;
-			case(LayerTypes::SparseLinear):
-				layer_ptr = std::make_shared<SparseLinear<eT> >(SparseLinear<eT>());
-				LOG(LDEBUG) <<  "SparseLinear";
-				break;
-			case(LayerTypes::HebbianLinear):
-				layer_ptr = std::make_shared<HebbianLinear<eT> >(HebbianLinear<eT>());
-				LOG(LDEBUG) <<  "HebbianLinear";
-				break;
-
-			case(LayerTypes::BinaryCorrelator):
-				layer_ptr = std::make_shared<BinaryCorrelator<eT> >(BinaryCorrelator<eT>());
-				LOG(LDEBUG) <<  "BinaryCorrelator";
-				break;
-
-			// regularisation
-			case(LayerTypes::Dropout):
-				layer_ptr = std::make_shared<Dropout<eT> >(Dropout<eT>());
-				LOG(LERROR) <<  "Dropout Layer serialization not implemented (some params are not serialized)!";
-				break;
+			ar & (*layer_ptr);
 
-			default:
-				LOG(LERROR) <<  "Undefined Layer type detected during deserialization!";
-			}//: switch
+			if (version >= 3) {
+				// Deserialize the parameters specific to the layer type - and resolve handles depending on them.
+				serializeConfiguration(ar, layer_ptr, lt, version);
+				layer_ptr->resolveHandles();
+			} else if (lt == LayerTypes::Convolution) {
+				// Restore filter size and stride (and repack filters) of convolutional layers saved in the old format.
+				std::dynamic_pointer_cast<Convolution<eT> >(layer_ptr)->repackLegacyFilters();
+			}//: else
+
+			// States and gradients might have been shared between layers (by the memory planner) - give the layer its own ones.
+			for (auto key : layer_ptr->s.keys())
+				layer_ptr->s[key.second] = MAKE_MATRIX_PTR(eT, *layer_ptr->s[key.second]);
+			for (auto key : layer_ptr->g.keys())
+				layer_ptr->g[key.second] = MAKE_MATRIX_PTR(eT, *layer_ptr->g[key.second]);
 
-			ar & (*layer_ptr);
 			layers.push_back(layer_ptr);
 		}//: for
 
@@ -478,8 +1857,8 @@ private:
 } /* namespace mic */
 
 // Just in the case that something important will change in the MLNN class - set version.
-BOOST_CLASS_VERSION(mic::mlnn::MultiLayerNeuralNetwork<float>, 2)
-BOOST_CLASS_VERSION(mic::mlnn::MultiLayerNeuralNetwork<double>, 2)
+BOOST_CLASS_VERSION(mic::mlnn::MultiLayerNeuralNetwork<float>, 5)
+BOOST_CLASS_VERSION(mic::mlnn::MultiLayerNeuralNetwork<double>, 5)
 
 
 #endif /* SRC_MLNN_MULTILAYERNEURALNETWORK_HPP_ */
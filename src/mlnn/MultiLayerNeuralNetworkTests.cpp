@@ -197,6 +197,977 @@ TEST_F(Tutorial2LayerNN, TrainSingleStep) {
 
 }
 
+
+/*!
+ * Tests whether a training step with fused softmax-cross-entropy results in the same loss and gradients as the separate computations (softmax forward, cross-entropy and dx = y - t).
+ */
+TEST(FusedSoftmaxCrossEntropy, TrainSingleStep) {
+	double eps = 1e-10;
+	mic::mlnn::BackpropagationNeuralNetwork<double> nn("fused_softmax_network");
+	nn.pushLayer(new mic::mlnn::fully_connected::Linear<double>(5, 3, "Linear"));
+	nn.pushLayer(new mic::mlnn::cost_function::Softmax<double>(3, "Softmax"));
+	nn.setLoss< mic::neural_nets::loss::CrossEntropyLoss<double> >();
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 5, 4);
+	x->rand(-1.0, 1.0);
+	mic::types::MatrixPtr<double> t = MAKE_MATRIX_PTR(double, 3, 4);
+	(*t) << 1, 0, 0,  0, 1, 0,  0, 0, 1,  0, 1, 0;
+
+	// Reference: separate softmax forward, loss and gradient passed directly to the linear layer.
+	nn.forward(x);
+	double ref_loss = nn.loss->calculateMeanLoss(t, nn.getPredictions());
+	(*nn.layers[0]->g["y"]) = (*nn.getPredictions()) - (*t);
+	nn.layers[0]->backward();
+	mic::types::Matrix<double> ref_dW = (*nn.layers[0]->g["W"]);
+	mic::types::Matrix<double> ref_y = (*nn.getPredictions());
+
+	// Fused step (zero learning rate, so parameters remain unchanged).
+	nn.setFusedSoftmaxCrossEntropy();
+	ASSERT_NE(nn.fusedSoftmaxLayer(), nullptr);
+	double loss = nn.train(x, t, 0.0);
+
+	ASSERT_LE( fabs( loss - ref_loss), 1e-8);
+	for (size_t i=0; i< (size_t)ref_y.size(); i++)
+		ASSERT_LE( fabs( (*nn.getPredictions())[i] - ref_y[i]), eps) << "Difference in y at position i=" << i;
+	for (size_t i=0; i< (size_t)ref_dW.size(); i++)
+		ASSERT_LE( fabs( (*nn.layers[0]->g["W"])[i] - ref_dW[i]), eps) << "Difference in dW at position i=" << i;
+
+	// Fused mode is not applicable to other losses.
+	nn.setLoss< mic::neural_nets::loss::SquaredErrorLoss<double> >();
+	ASSERT_EQ(nn.fusedSoftmaxLayer(), nullptr);
+}
+
+
+/*!
+ * Creates a small convolutional network used in tests of the multi-tensor update.
+ */
+void createConvNet(mic::mlnn::BackpropagationNeuralNetwork<double> & nn_) {
+	nn_.pushLayer(new mic::mlnn::convolution::Convolution<double>(5, 5, 1, 2, 3, 1, "Conv"));
+	nn_.pushLayer(new mic::mlnn::activation_function::ReLU<double>(18, "ReLU"));
+	nn_.pushLayer(new mic::mlnn::fully_connected::Linear<double>(18, 3, "Linear"));
+	nn_.pushLayer(new mic::mlnn::cost_function::Softmax<double>(3, "Softmax"));
+	nn_.getLayer<mic::mlnn::convolution::Convolution<double> >(0)->setEngine(mic::mlnn::convolution::ConvolutionEngine::Winograd);
+	nn_.setLoss< mic::neural_nets::loss::CrossEntropyLoss<double> >();
+	nn_.setOptimization< mic::neural_nets::optimization::Adam<double> >();
+}
+
+/*!
+ * Copies parameters between two networks of the same structure.
+ */
+void copyParameters(mic::mlnn::BackpropagationNeuralNetwork<double> & from_, mic::mlnn::BackpropagationNeuralNetwork<double> & to_) {
+	for (size_t l=0; l< from_.layers.size(); l++)
+		for (size_t i=0; i< from_.layers[l]->p.keys().size(); i++) {
+			(*to_.layers[l]->p[i]) = (*from_.layers[l]->p[i]);
+			to_.layers[l]->invalidateParameterCaches();
+		}//: for
+}
+
+/*!
+ * Checks whether parameters of two networks of the same structure are equal (up to the given tolerance).
+ * @param context_ Description of the compared state (e.g. step of training), appended to the failure message.
+ */
+void expectSameParameters(mic::mlnn::BackpropagationNeuralNetwork<double> & reference_, mic::mlnn::BackpropagationNeuralNetwork<double> & nn_, double eps_, std::string context_ = "") {
+	for (size_t l=0; l< reference_.layers.size(); l++)
+		for (size_t i=0; i< reference_.layers[l]->p.keys().size(); i++)
+			for (size_t j=0; j< (size_t)reference_.layers[l]->p[i]->size(); j++)
+				ASSERT_NEAR((*reference_.layers[l]->p[i])[j], (*nn_.layers[l]->p[i])[j], eps_) << "Difference in layer " << l << " parameter " << i << " at position " << j << " " << context_;
+}
+
+
+/*!
+ * Tests whether the multi-tensor update gives the same parameters as the update of layers one by one.
+ */
+TEST(MultiTensorUpdate, SameAsLayerUpdate) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> reference("reference");
+	createConvNet(reference);
+	mic::mlnn::BackpropagationNeuralNetwork<double> multi("multi");
+	createConvNet(multi);
+	multi.setMultiTensorUpdate();
+	copyParameters(reference, multi);
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 25, 4);
+	mic::types::MatrixPtr<double> t = MAKE_MATRIX_PTR(double, 3, 4);
+	(*t) << 1, 0, 0,  0, 1, 0,  0, 0, 1,  0, 1, 0;
+
+	for (size_t step=0; step< 3; step++) {
+		x->rand(-1.0, 1.0);
+		double ref_loss = reference.train(x, t, 0.01, 0.001);
+		double loss = multi.train(x, t, 0.01, 0.001);
+		ASSERT_EQ(ref_loss, loss) << "Difference in loss in step " << step;
+
+		expectSameParameters(reference, multi, 0, "in step " + std::to_string(step));
+	}//: for
+}
+
+
+/*!
+ * \brief Gradient descent relying on the default applyUpdate(), i.e. updating only whole parameters.
+ */
+class WholeParameterGradientDescent : public mic::neural_nets::optimization::OptimizationFunction<double> {
+public:
+	WholeParameterGradientDescent(size_t rows_, size_t cols_) : delta(MAKE_MATRIX_PTR(double, rows_ * cols_, 1)) { }
+
+	mic::types::MatrixPtr<double> calculateUpdate(mic::types::MatrixPtr<double> x_, mic::types::MatrixPtr<double> dx_, double learning_rate_) {
+		(*delta) = learning_rate_ * (*dx_);
+		return delta;
+	}
+
+	mic::types::MatrixPtr<double> delta;
+};
+
+/*!
+ * Tests whether the multi-tensor update of parameters split into several chunks gives the same parameters as the update of layers one by one
+ * - for every optimization function (also the ones updating whole parameters only).
+ */
+template <typename OptimizationFunction>
+void compareLargeLayerUpdate() {
+	mic::mlnn::BackpropagationNeuralNetwork<double> reference("reference");
+	reference.pushLayer(new mic::mlnn::fully_connected::Linear<double>(200, 100, "Linear"));
+	reference.setOptimization<OptimizationFunction>();
+	mic::mlnn::BackpropagationNeuralNetwork<double> multi("multi");
+	multi.pushLayer(new mic::mlnn::fully_connected::Linear<double>(200, 100, "Linear"));
+	multi.setOptimization<OptimizationFunction>();
+	multi.setMultiTensorUpdate();
+	copyParameters(reference, multi);
+
+	for (size_t step=0; step< 2; step++) {
+		for (std::string key : {"W", "b"}) {
+			reference.layers[0]->g[key]->rand(-1.0, 1.0);
+			(*multi.layers[0]->g[key]) = (*reference.layers[0]->g[key]);
+		}//: for
+		reference.update(0.01, 0.001);
+		multi.update(0.01, 0.001);
+		expectSameParameters(reference, multi, 1e-12, "in step " + std::to_string(step));
+	}//: for
+}
+
+TEST(MultiTensorUpdate, LargeParameters) {
+	compareLargeLayerUpdate< mic::neural_nets::optimization::Adam<double> >();
+	compareLargeLayerUpdate< mic::neural_nets::optimization::AdaGradPID<double> >();
+	compareLargeLayerUpdate<WholeParameterGradientDescent>();
+}
+
+/*!
+ * Tests the whole-model gradient norm and gradient clipping.
+ */
+TEST(MultiTensorUpdate, GradientClipping) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> nn("clipped");
+	createConvNet(nn);
+	nn.setOptimization< mic::neural_nets::optimization::GradientDescent<double> >();
+	nn.setMultiTensorUpdate();
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 25, 2);
+	x->rand(-1.0, 1.0);
+	mic::types::MatrixPtr<double> t = MAKE_MATRIX_PTR(double, 3, 2);
+	(*t) << 1, 0, 0,  0, 1, 0;
+
+	// Calculate gradients.
+	nn.forward(x);
+	nn.backward(nn.loss->calculateGradient(t, nn.getPredictions()));
+
+	// Compare norm with the one calculated layer by layer.
+	double sum = 0;
+	for (size_t l=0; l< nn.layers.size(); l++)
+		for (auto key : nn.layers[l]->p.keys())
+			sum += nn.layers[l]->g[key.first]->squaredNorm();
+	double norm = nn.gradientNorm();
+	ASSERT_LE(fabs(norm - std::sqrt(sum)), 1e-10);
+
+	// Expected parameters of the linear layer after the clipped gradient descent step.
+	double alpha = 0.1;
+	mic::types::Matrix<double> W = (*nn.layers[2]->p["W"]) - alpha / 2 * 0.5 * (*nn.layers[2]->g["W"]);
+
+	// Clip to half of the norm.
+	nn.setGradientClipping(norm / 2);
+	nn.update(alpha);
+	for (size_t i=0; i< (size_t)W.size(); i++)
+		ASSERT_LE(fabs((*nn.layers[2]->p["W"])[i] - W[i]), 1e-12) << "Difference at position i=" << i;
+}
+
+/*!
+ * Tests whether data-parallel training (batch split between 3 replicas, unevenly) leads to the same parameters as training on the whole batch.
+ */
+TEST(DataParallel, SameAsSingleReplica) {
+	double eps = 1e-10;
+	mic::mlnn::BackpropagationNeuralNetwork<double> reference("reference");
+	createConvNet(reference);
+	mic::mlnn::BackpropagationNeuralNetwork<double> parallel("parallel");
+	createConvNet(parallel);
+	copyParameters(reference, parallel);
+	ASSERT_EQ(parallel.setDataParallel(3), true);
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 25, 7);
+	mic::types::MatrixPtr<double> t = MAKE_MATRIX_PTR(double, 3, 7);
+	(*t) << 1, 0, 0,  0, 1, 0,  0, 0, 1,  0, 1, 0,  1, 0, 0,  0, 0, 1,  0, 1, 0;
+
+	for (size_t step=0; step< 3; step++) {
+		x->rand(-1.0, 1.0);
+		double ref_loss = reference.train(x, t, 0.01, 0.001);
+		double loss = parallel.train(x, t, 0.01, 0.001);
+		ASSERT_NEAR(ref_loss, loss, eps) << "Difference in loss in step " << step;
+
+		expectSameParameters(reference, parallel, eps, "in step " + std::to_string(step));
+	}//: for
+}
+
+/*!
+ * Tests whether data-parallel training is deterministic.
+ */
+TEST(DataParallel, Deterministic) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> first("first");
+	createConvNet(first);
+	mic::mlnn::BackpropagationNeuralNetwork<double> second("second");
+	createConvNet(second);
+	copyParameters(first, second);
+	first.setDataParallel(4);
+	second.setDataParallel(4);
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 25, 8);
+	mic::types::MatrixPtr<double> t = MAKE_MATRIX_PTR(double, 3, 8);
+	t->setZero();
+	for (size_t i=0; i< 8; i++)
+		(*t)(i % 3, i) = 1;
+
+	for (size_t step=0; step< 3; step++) {
+		x->rand(-1.0, 1.0);
+		ASSERT_EQ(first.train(x, t, 0.01), second.train(x, t, 0.01)) << "Difference in loss in step " << step;
+
+		expectSameParameters(first, second, 0, "in step " + std::to_string(step));
+	}//: for
+}
+
+/*!
+ * Tests whether replicas are recreated when the network is loaded - so they do not compute gradients of the old parameters.
+ */
+TEST(DataParallel, SameAsSingleReplicaAfterLoad) {
+	double eps = 1e-10;
+	mic::mlnn::BackpropagationNeuralNetwork<double> reference("reference");
+	createConvNet(reference);
+	mic::mlnn::BackpropagationNeuralNetwork<double> parallel("parallel");
+	createConvNet(parallel);
+	ASSERT_EQ(parallel.setDataParallel(3), true);
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 25, 7);
+	mic::types::MatrixPtr<double> t = MAKE_MATRIX_PTR(double, 3, 7);
+	(*t) << 1, 0, 0,  0, 1, 0,  0, 0, 1,  0, 1, 0,  1, 0, 0,  0, 0, 1,  0, 1, 0;
+	x->rand(-1.0, 1.0);
+	parallel.train(x, t, 0.01, 0.001);
+
+	// Load the parameters of the reference.
+	ASSERT_TRUE(reference.save("saved.txt"));
+	ASSERT_TRUE(parallel.load("saved.txt"));
+	std::remove("saved.txt");
+
+	for (size_t step=0; step< 3; step++) {
+		x->rand(-1.0, 1.0);
+		double ref_loss = reference.train(x, t, 0.01, 0.001);
+		double loss = parallel.train(x, t, 0.01, 0.001);
+		ASSERT_NEAR(ref_loss, loss, eps) << "Difference in loss in step " << step;
+
+		expectSameParameters(reference, parallel, eps, "in step " + std::to_string(step));
+	}//: for
+}
+
+/*!
+ * Tests whether asynchronous training with a single worker is equivalent to sequential training.
+ */
+TEST(Asynchronous, SingleWorkerSameAsTrain) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> reference("reference");
+	createConvNet(reference);
+	mic::mlnn::BackpropagationNeuralNetwork<double> async("async");
+	createConvNet(async);
+	copyParameters(reference, async);
+
+	std::vector<mic::types::MatrixPtr<double> > batches, targets;
+	for (size_t b=0; b< 5; b++) {
+		batches.push_back(MAKE_MATRIX_PTR(double, 25, 4));
+		batches[b]->rand(-1.0, 1.0);
+		targets.push_back(MAKE_MATRIX_PTR(double, 3, 4));
+		(*targets[b]) << 1, 0, 0,  0, 1, 0,  0, 0, 1,  0, 1, 0;
+	}//: for
+
+	double ref_loss = 0;
+	for (size_t b=0; b< 5; b++)
+		ref_loss += reference.train(batches[b], targets[b], 0.01, 0.001);
+	double loss = async.trainAsynchronous(batches, targets, 0.01, 0.001, 1);
+	ASSERT_NEAR(ref_loss / 5, loss, 1e-12);
+
+	expectSameParameters(reference, async, 0);
+}
+
+/*!
+ * Tests whether asynchronous training without workers is equivalent to sequential training.
+ */
+TEST(Asynchronous, NoWorkersSameAsTrain) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> reference("reference");
+	createConvNet(reference);
+	mic::mlnn::BackpropagationNeuralNetwork<double> async("async");
+	createConvNet(async);
+	copyParameters(reference, async);
+
+	std::vector<mic::types::MatrixPtr<double> > batches, targets;
+	for (size_t b=0; b< 3; b++) {
+		batches.push_back(MAKE_MATRIX_PTR(double, 25, 4));
+		batches[b]->rand(-1.0, 1.0);
+		targets.push_back(MAKE_MATRIX_PTR(double, 3, 4));
+		(*targets[b]) << 1, 0, 0,  0, 1, 0,  0, 0, 1,  0, 1, 0;
+	}//: for
+
+	double ref_loss = 0;
+	for (size_t b=0; b< 3; b++)
+		ref_loss += reference.train(batches[b], targets[b], 0.01, 0.001);
+	double loss = async.trainAsynchronous(batches, targets, 0.01, 0.001, 0);
+	ASSERT_NEAR(ref_loss / 3, loss, 1e-12);
+
+	expectSameParameters(reference, async, 0);
+}
+
+/*!
+ * Tests whether workers are recreated when the network is loaded and when its optimization functions are replaced.
+ */
+TEST(Asynchronous, SingleWorkerSameAsTrainAfterLoad) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> reference("reference");
+	createConvNet(reference);
+	mic::mlnn::BackpropagationNeuralNetwork<double> async("async");
+	createConvNet(async);
+
+	std::vector<mic::types::MatrixPtr<double> > batches, targets;
+	for (size_t b=0; b< 3; b++) {
+		batches.push_back(MAKE_MATRIX_PTR(double, 25, 4));
+		batches[b]->rand(-1.0, 1.0);
+		targets.push_back(MAKE_MATRIX_PTR(double, 3, 4));
+		(*targets[b]) << 1, 0, 0,  0, 1, 0,  0, 0, 1,  0, 1, 0;
+	}//: for
+	async.trainAsynchronous(batches, targets, 0.01, 0.001, 1);
+
+	// Load the parameters of the reference.
+	ASSERT_TRUE(reference.save("saved.txt"));
+	ASSERT_TRUE(async.load("saved.txt"));
+	std::remove("saved.txt");
+	for (size_t b=0; b< 3; b++)
+		reference.train(batches[b], targets[b], 0.01, 0.001);
+	async.trainAsynchronous(batches, targets, 0.01, 0.001, 1);
+	expectSameParameters(reference, async, 0, "after load");
+
+	// Replace the optimization functions.
+	reference.setOptimization< mic::neural_nets::optimization::GradientDescent<double> >();
+	async.setOptimization< mic::neural_nets::optimization::GradientDescent<double> >();
+	for (size_t b=0; b< 3; b++)
+		reference.train(batches[b], targets[b], 0.01, 0.001);
+	async.trainAsynchronous(batches, targets, 0.01, 0.001, 1);
+	expectSameParameters(reference, async, 0, "after replacing the optimization functions");
+}
+
+/*!
+ * Tests whether asynchronous training with several workers decreases the loss.
+ */
+TEST(Asynchronous, Convergence) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> nn("async");
+	createConvNet(nn);
+
+	std::vector<mic::types::MatrixPtr<double> > batches, targets;
+	for (size_t b=0; b< 8; b++) {
+		batches.push_back(MAKE_MATRIX_PTR(double, 25, 3));
+		batches[b]->rand(-1.0, 1.0);
+		targets.push_back(MAKE_MATRIX_PTR(double, 3, 3));
+		(*targets[b]) << 1, 0, 0,  0, 1, 0,  0, 0, 1;
+	}//: for
+
+	double first_loss = nn.trainAsynchronous(batches, targets, 0.01, 0.0, 4);
+	double loss = first_loss;
+	for (size_t epoch=0; epoch< 50; epoch++)
+		loss = nn.trainAsynchronous(batches, targets, 0.01, 0.0, 4);
+	ASSERT_LT(loss, first_loss);
+}
+
+/*!
+ * Tests whether training with bound inputs (also with changing batch size) is equivalent to training with copied inputs.
+ */
+TEST(InputBinding, SameAsCopy) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> reference("reference");
+	createConvNet(reference);
+	mic::mlnn::BackpropagationNeuralNetwork<double> bound("bound");
+	createConvNet(bound);
+	bound.setInputBinding();
+	copyParameters(reference, bound);
+
+	size_t batch_sizes[] = {4, 2, 2, 4};
+	std::vector<mic::types::MatrixPtr<double> > batches;
+	for (size_t step=0; step< 4; step++) {
+		mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 25, batch_sizes[step]);
+		x->rand(-1.0, 1.0);
+		mic::types::MatrixPtr<double> t = MAKE_MATRIX_PTR(double, 3, batch_sizes[step]);
+		t->setZero();
+		for (size_t i=0; i< batch_sizes[step]; i++)
+			(*t)(i % 3, i) = 1;
+		batches.push_back(x);
+
+		double ref_loss = reference.train(x, t, 0.01, 0.001);
+		double loss = bound.train(x, t, 0.01, 0.001);
+		ASSERT_EQ(ref_loss, loss) << "Difference in loss in step " << step;
+
+		// The first layer reads directly from the batch.
+		ASSERT_EQ(bound.layers[0]->s["x"], x);
+
+		expectSameParameters(reference, bound, 0, "in step " + std::to_string(step));
+	}//: for
+
+	// Bound batches were not resized.
+	for (size_t step=0; step< 4; step++)
+		ASSERT_EQ((size_t)batches[step]->cols(), batch_sizes[step]);
+
+	// Own matrices are restored when binding is disabled.
+	bound.setInputBinding(false);
+	ASSERT_NE(bound.layers[0]->s["x"], batches[3]);
+	ASSERT_EQ((size_t)bound.layers[0]->s["x"]->cols(), 4);
+}
+
+/*!
+ * Creates a deep network with elementwise layers and activations of equal sizes, so the frozen network can reuse matrices.
+ */
+void createDeepNet(mic::mlnn::BackpropagationNeuralNetwork<double> & nn_) {
+	nn_.pushLayer(new mic::mlnn::fully_connected::Linear<double>(10, 8, "Linear1"));
+	nn_.pushLayer(new mic::mlnn::activation_function::ReLU<double>(8, "ReLU1"));
+	nn_.pushLayer(new mic::mlnn::regularisation::Dropout<double>(8, 0.5, "Dropout"));
+	nn_.pushLayer(new mic::mlnn::fully_connected::Linear<double>(8, 8, "Linear2"));
+	nn_.pushLayer(new mic::mlnn::activation_function::ELU<double>(8, "ELU"));
+	nn_.pushLayer(new mic::mlnn::fully_connected::Linear<double>(8, 8, "Linear3"));
+	nn_.pushLayer(new mic::mlnn::activation_function::Sigmoid<double>(8, "Sigmoid"));
+	nn_.pushLayer(new mic::mlnn::fully_connected::Linear<double>(8, 3, "Linear4"));
+	nn_.pushLayer(new mic::mlnn::cost_function::Softmax<double>(3, "Softmax"));
+	nn_.setLoss< mic::neural_nets::loss::CrossEntropyLoss<double> >();
+}
+
+/*!
+ * Tests whether the frozen network gives the same predictions as the original network in the test mode (also with changing batch size).
+ */
+TEST(Freeze, SameAsTestMode) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> reference("reference");
+	createDeepNet(reference);
+	mic::mlnn::BackpropagationNeuralNetwork<double> frozen("frozen");
+	createDeepNet(frozen);
+	copyParameters(reference, frozen);
+
+	// Run a single forward pass, so all matrices are allocated.
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 10, 4);
+	x->rand(-1.0, 1.0);
+	frozen.forward(x, true);
+	size_t footprint = frozen.memoryFootprint();
+
+	frozen.freeze();
+	ASSERT_TRUE(frozen.isFrozen());
+	ASSERT_LT(frozen.memoryFootprint(), footprint);
+
+	// Gradients are released.
+	for (size_t l=0; l< frozen.layers.size(); l++)
+		for (size_t i=0; i< frozen.layers[l]->g.keys().size(); i++)
+			ASSERT_EQ(frozen.layers[l]->g[i]->size(), 0);
+
+	// Elementwise layers compute in place, non-adjacent activations share matrices.
+	ASSERT_EQ(frozen.layers[1]->s["x"], frozen.layers[1]->s["y"]);
+	ASSERT_EQ(frozen.layers[0]->s["y"], frozen.layers[5]->s["y"]);
+
+	size_t batch_sizes[] = {4, 2, 7};
+	for (size_t step=0; step< 3; step++) {
+		x = MAKE_MATRIX_PTR(double, 10, batch_sizes[step]);
+		x->rand(-1.0, 1.0);
+		reference.forward(x, true);
+		// Dropout is skipped in the frozen network regardless of the flag.
+		frozen.forward(x, false);
+
+		mic::types::MatrixPtr<double> ref_y = reference.getPredictions();
+		mic::types::MatrixPtr<double> y = frozen.getPredictions();
+		ASSERT_EQ(ref_y->rows(), y->rows());
+		ASSERT_EQ(ref_y->cols(), y->cols());
+		for (size_t i=0; i< (size_t)ref_y->size(); i++)
+			ASSERT_EQ((*ref_y)[i], (*y)[i]) << "Difference at position " << i << " in step " << step;
+	}//: for
+}
+
+/*!
+ * Creates a small convolutional network with a block of convolution, activation and pooling.
+ */
+void createConvPoolNet(mic::mlnn::BackpropagationNeuralNetwork<double> & nn_) {
+	nn_.pushLayer(new mic::mlnn::convolution::Convolution<double>(6, 6, 1, 2, 3, 1, "Conv"));
+	nn_.pushLayer(new mic::mlnn::activation_function::ELU<double>(32, "ELU"));
+	nn_.pushLayer(new mic::mlnn::convolution::MaxPooling<double>(4, 4, 2, 2, "MaxPooling"));
+	nn_.pushLayer(new mic::mlnn::fully_connected::Linear<double>(8, 3, "Linear"));
+	nn_.pushLayer(new mic::mlnn::activation_function::ReLU<double>(3, "ReLU"));
+	nn_.setLoss< mic::neural_nets::loss::SquaredErrorLoss<double> >();
+}
+
+/*!
+ * Trains two networks with the same batches, checks whether their losses, predictions and parameters are the same.
+ */
+void compareTraining(mic::mlnn::BackpropagationNeuralNetwork<double> & reference_, mic::mlnn::BackpropagationNeuralNetwork<double> & nn_, size_t inputs_, size_t outputs_) {
+	size_t batch_sizes[] = {4, 4, 2, 5};
+	for (size_t step=0; step< 4; step++) {
+		mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, inputs_, batch_sizes[step]);
+		x->rand(-1.0, 1.0);
+		mic::types::MatrixPtr<double> t = MAKE_MATRIX_PTR(double, outputs_, batch_sizes[step]);
+		t->setZero();
+		for (size_t i=0; i< batch_sizes[step]; i++)
+			(*t)(i % outputs_, i) = 1;
+
+		double ref_loss = reference_.train(x, t, 0.05, 0.001);
+		double loss = nn_.train(x, t, 0.05, 0.001);
+		ASSERT_NEAR(ref_loss, loss, 1e-12) << "Difference in loss in step " << step;
+
+		for (size_t i=0; i< (size_t)reference_.getPredictions()->size(); i++)
+			ASSERT_NEAR((*reference_.getPredictions())[i], (*nn_.getPredictions())[i], 1e-12) << "Difference in predictions at position " << i << " in step " << step;
+		expectSameParameters(reference_, nn_, 1e-12, "in step " + std::to_string(step));
+	}//: for
+}
+
+/*!
+ * Tests whether training of the network with fused blocks of Linear, activation and dropout layers is equivalent to training of the original network.
+ */
+TEST(LayerFusion, LinearSameAsUnfused) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> reference("reference");
+	createDeepNet(reference);
+	mic::mlnn::BackpropagationNeuralNetwork<double> fused("fused");
+	createDeepNet(fused);
+	fused.setLayerFusion();
+	copyParameters(reference, fused);
+
+	compareTraining(reference, fused, 10, 3);
+
+	// Linear1 + ReLU1 + Dropout, Linear2 + ELU, Linear3 + Sigmoid.
+	std::vector<std::string> fusions = fused.getFusions();
+	ASSERT_EQ(fusions.size(), 3);
+	ASSERT_EQ(fusions[0], "Linear 'Linear1' + ReLU 'ReLU1' + Dropout 'Dropout'");
+
+	// Test mode (dropout skipped).
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 10, 3);
+	x->rand(-1.0, 1.0);
+	reference.forward(x, true);
+	fused.forward(x, true);
+	for (size_t i=0; i< (size_t)reference.getPredictions()->size(); i++)
+		ASSERT_NEAR((*reference.getPredictions())[i], (*fused.getPredictions())[i], 1e-12) << "Difference in test mode at position " << i;
+
+	// Fusion can be disabled at any time.
+	fused.setLayerFusion(false);
+	ASSERT_EQ(fused.getFusions().size(), 0);
+	compareTraining(reference, fused, 10, 3);
+}
+
+/*!
+ * Tests whether training of the network with a fused block of convolution, activation and pooling is equivalent to training of the original network.
+ */
+TEST(LayerFusion, ConvolutionSameAsUnfused) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> reference("reference");
+	createConvPoolNet(reference);
+	mic::mlnn::BackpropagationNeuralNetwork<double> fused("fused");
+	createConvPoolNet(fused);
+	fused.setLayerFusion();
+	copyParameters(reference, fused);
+
+	compareTraining(reference, fused, 36, 3);
+
+	// Conv + ELU + MaxPooling, Linear + ReLU.
+	ASSERT_EQ(fused.getFusions().size(), 2);
+}
+
+/*!
+ * Tests whether the frozen network with fused layers gives the same predictions as the original network in the test mode.
+ */
+TEST(LayerFusion, FrozenSameAsTestMode) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> reference("reference");
+	createDeepNet(reference);
+	mic::mlnn::BackpropagationNeuralNetwork<double> frozen("frozen");
+	createDeepNet(frozen);
+	frozen.setLayerFusion();
+	copyParameters(reference, frozen);
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 10, 4);
+	x->rand(-1.0, 1.0);
+	frozen.forward(x, true);
+	frozen.freeze();
+	ASSERT_EQ(frozen.getFusions().size(), 3);
+
+	size_t batch_sizes[] = {4, 2, 7};
+	for (size_t step=0; step< 3; step++) {
+		x = MAKE_MATRIX_PTR(double, 10, batch_sizes[step]);
+		x->rand(-1.0, 1.0);
+		reference.forward(x, true);
+		frozen.forward(x, false);
+		for (size_t i=0; i< (size_t)reference.getPredictions()->size(); i++)
+			ASSERT_NEAR((*reference.getPredictions())[i], (*frozen.getPredictions())[i], 1e-12) << "Difference at position " << i << " in step " << step;
+	}//: for
+}
+
+/*!
+ * Counts distinct matrices storing activations and gradients of the network.
+ */
+size_t countStateMatrices(mic::mlnn::BackpropagationNeuralNetwork<double> & nn_) {
+	std::set<mic::types::Matrix<double>*> matrices;
+	for (size_t l=0; l< nn_.layers.size(); l++) {
+		matrices.insert(nn_.layers[l]->s["x"].get());
+		matrices.insert(nn_.layers[l]->s["y"].get());
+		matrices.insert(nn_.layers[l]->g["x"].get());
+		matrices.insert(nn_.layers[l]->g["y"].get());
+	}//: for
+	return matrices.size();
+}
+
+/*!
+ * Tests whether training of the network with planned memory (also with fused layers) is equivalent to training of the original network and requires less memory.
+ */
+TEST(MemoryPlanning, SameAsUnplanned) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> reference("reference");
+	createDeepNet(reference);
+	mic::mlnn::BackpropagationNeuralNetwork<double> planned("planned");
+	createDeepNet(planned);
+	planned.setMemoryPlanning();
+	copyParameters(reference, planned);
+	mic::mlnn::BackpropagationNeuralNetwork<double> fused("fused");
+	createDeepNet(fused);
+	fused.setLayerFusion();
+	fused.setMemoryPlanning();
+	copyParameters(reference, fused);
+
+	compareTraining(reference, planned, 10, 3);
+	ASSERT_LT(planned.memoryFootprint(), reference.memoryFootprint());
+
+	// Activations and gradients of equal sizes that are never alive at the same time share matrices.
+	ASSERT_LT(countStateMatrices(planned), countStateMatrices(reference));
+	// ReLU overwrites the output of the linear layer.
+	ASSERT_EQ(planned.layers[1]->s["x"], planned.layers[1]->s["y"]);
+	// Sigmoid cannot overwrite the input of the dropout (read by ReLU in the backward pass).
+	ASSERT_NE(planned.layers[2]->s["x"], planned.layers[2]->s["y"]);
+
+	mic::mlnn::BackpropagationNeuralNetwork<double> reference2("reference2");
+	createDeepNet(reference2);
+	copyParameters(reference, reference2);
+	copyParameters(reference, fused);
+	compareTraining(reference2, fused, 10, 3);
+
+	// Own matrices are restored when the planning is disabled.
+	planned.setMemoryPlanning(false);
+	compareTraining(reference, planned, 10, 3);
+	ASSERT_EQ(countStateMatrices(planned), countStateMatrices(reference));
+}
+
+/*!
+ * Creates a network with two convolutional layers (sharing the scratch arena when the memory is planned).
+ */
+void createTwoConvNet(mic::mlnn::BackpropagationNeuralNetwork<double> & nn_, mic::mlnn::convolution::ConvolutionEngine engine_) {
+	nn_.pushLayer(new mic::mlnn::convolution::Convolution<double>(6, 6, 1, 2, 3, 1, "Conv1"));
+	nn_.pushLayer(new mic::mlnn::activation_function::ReLU<double>(32, "ReLU"));
+	nn_.pushLayer(new mic::mlnn::convolution::Convolution<double>(4, 4, 2, 2, 3, 1, "Conv2"));
+	nn_.pushLayer(new mic::mlnn::activation_function::ELU<double>(8, "ELU"));
+	nn_.pushLayer(new mic::mlnn::fully_connected::Linear<double>(8, 3, "Linear"));
+	nn_.getLayer<mic::mlnn::convolution::Convolution<double> >(0)->setEngine(engine_);
+	nn_.getLayer<mic::mlnn::convolution::Convolution<double> >(2)->setEngine(engine_);
+	nn_.setLoss< mic::neural_nets::loss::SquaredErrorLoss<double> >();
+}
+
+/*!
+ * Tests whether temporary matrices of convolutional layers (using all engines) served from the scratch arena give the same results as their own ones.
+ */
+TEST(MemoryPlanning, ConvolutionScratchArena) {
+	mic::mlnn::convolution::ConvolutionEngine engines[] = {mic::mlnn::convolution::ConvolutionEngine::Direct,
+			mic::mlnn::convolution::ConvolutionEngine::Im2Col, mic::mlnn::convolution::ConvolutionEngine::Winograd};
+	for (mic::mlnn::convolution::ConvolutionEngine engine : engines) {
+		mic::mlnn::BackpropagationNeuralNetwork<double> reference("reference");
+		createTwoConvNet(reference, engine);
+		mic::mlnn::BackpropagationNeuralNetwork<double> planned("planned");
+		createTwoConvNet(planned, engine);
+		planned.setMemoryPlanning();
+		copyParameters(reference, planned);
+
+		compareTraining(reference, planned, 36, 3);
+		// Lowered outputs are stored in the arena, sized for the first layer.
+		ASSERT_EQ(planned.layers[0]->m["ycol"]->size(), 0) << "Engine " << (int)engine;
+		ASSERT_EQ(planned.layers[2]->m["ycol"]->size(), 0) << "Engine " << (int)engine;
+		if (engine != mic::mlnn::convolution::ConvolutionEngine::Direct) {
+			ASSERT_EQ(planned.scratch_arena->size(), planned.layers[0]->scratchSize()) << "Engine " << (int)engine;
+		}//: if
+		ASSERT_LT(planned.memoryFootprint(), reference.memoryFootprint()) << "Engine " << (int)engine;
+	}//: for
+
+	// Block of convolution, activation and pooling.
+	mic::mlnn::BackpropagationNeuralNetwork<double> reference("reference");
+	createConvPoolNet(reference);
+	mic::mlnn::BackpropagationNeuralNetwork<double> planned("planned");
+	createConvPoolNet(planned);
+	planned.setLayerFusion();
+	planned.setMemoryPlanning();
+	copyParameters(reference, planned);
+	compareTraining(reference, planned, 36, 3);
+}
+
+/*!
+ * Tests whether the network saved in the binary format is restored with the same parameters and gives the same predictions.
+ */
+TEST(BinaryFormat, SaveLoad) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> conv("conv");
+	createConvNet(conv);
+	mic::mlnn::BackpropagationNeuralNetwork<double> deep("deep");
+	createDeepNet(deep);
+	mic::mlnn::BackpropagationNeuralNetwork<double>* nets[] = {&conv, &deep};
+
+	for (mic::mlnn::BackpropagationNeuralNetwork<double>* nn : nets) {
+		size_t input_size = nn->layers[0]->inputSize();
+		mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, input_size, 4);
+		x->rand(-1.0, 1.0);
+		mic::types::MatrixPtr<double> t = MAKE_MATRIX_PTR(double, 3, 4);
+		t->setZero();
+		for (size_t i=0; i< 4; i++)
+			(*t)(i % 3, i) = 1;
+		nn->train(x, t, 0.01, 0.001);
+		ASSERT_TRUE(nn->saveBinary("saved.bin"));
+
+		// Load detects the binary format.
+		mic::mlnn::BackpropagationNeuralNetwork<double> restored("restored");
+		ASSERT_TRUE(restored.load("saved.bin"));
+		ASSERT_EQ(restored.name, nn->name);
+		ASSERT_EQ(restored.layers.size(), nn->layers.size());
+		for (size_t l=0; l< nn->layers.size(); l++) {
+			ASSERT_EQ(restored.layers[l]->layer_type, nn->layers[l]->layer_type);
+			ASSERT_EQ(restored.layers[l]->name(), nn->layers[l]->name());
+			ASSERT_EQ(restored.layers[l]->p.keys(), nn->layers[l]->p.keys());
+			ASSERT_EQ(restored.layers[l]->m.keys(), nn->layers[l]->m.keys());
+		}//: for
+		expectSameParameters(*nn, restored, 0, "of " + nn->name);
+
+		nn->forward(x, true);
+		restored.forward(x, true);
+		for (size_t i=0; i< (size_t)nn->getPredictions()->size(); i++)
+			ASSERT_EQ((*restored.getPredictions())[i], (*nn->getPredictions())[i]) << "Difference at position " << i;
+	}//: for
+
+	// Files of other precision and truncated files are rejected.
+	mic::mlnn::BackpropagationNeuralNetwork<float> single("single");
+	ASSERT_FALSE(single.loadBinary("saved.bin"));
+	{
+		std::ifstream ifs("saved.bin", std::ios::binary);
+		std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+		std::ofstream ofs("saved.bin", std::ios::binary);
+		ofs.write(data.data(), data.size() / 2);
+	}
+	mic::mlnn::BackpropagationNeuralNetwork<double> truncated("truncated");
+	ASSERT_FALSE(truncated.load("saved.bin"));
+	ASSERT_EQ(truncated.layers.size(), 0);
+	std::remove("saved.bin");
+}
+
+/*!
+ * Tests whether the network loaded from the binary format gets the default optimization functions and can be trained further.
+ */
+TEST(BinaryFormat, TrainAfterLoad) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> nn("nn");
+	nn.pushLayer(new mic::mlnn::fully_connected::Linear<double>(10, 8, "Linear1"));
+	nn.pushLayer(new mic::mlnn::activation_function::ReLU<double>(8, "ReLU"));
+	nn.pushLayer(new mic::mlnn::fully_connected::Linear<double>(8, 3, "Linear2"));
+	nn.pushLayer(new mic::mlnn::cost_function::Softmax<double>(3, "Softmax"));
+	nn.setLoss< mic::neural_nets::loss::CrossEntropyLoss<double> >();
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 10, 4);
+	x->rand(-1.0, 1.0);
+	mic::types::MatrixPtr<double> t = MAKE_MATRIX_PTR(double, 3, 4);
+	t->setZero();
+	for (size_t i=0; i< 4; i++)
+		(*t)(i % 3, i) = 1;
+	nn.train(x, t, 0.01, 0.001);
+	ASSERT_TRUE(nn.saveBinary("saved.bin"));
+
+	mic::mlnn::BackpropagationNeuralNetwork<double> restored("restored");
+	ASSERT_TRUE(restored.loadBinary("saved.bin"));
+	std::remove("saved.bin");
+	for (size_t l=0; l< restored.layers.size(); l++)
+		ASSERT_EQ(restored.layers[l]->opt.keys(), restored.layers[l]->p.keys()) << "Optimization functions missing in layer " << l;
+
+	// Gradient descent has no internal state, so both networks follow the same trajectory.
+	for (size_t step=0; step< 3; step++) {
+		nn.train(x, t, 0.01, 0.001);
+		restored.train(x, t, 0.01, 0.001);
+	}//: for
+	expectSameParameters(nn, restored, 0);
+}
+
+/*!
+ * Tests whether the network containing layers with type-specific parameters and trained with Adam is restored from both formats
+ * with the same predictions - and whether the training resumes exactly where it stopped (with the restored optimizer state and dropout stream).
+ */
+TEST(Serialization, ResumeTraining) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> nn("nn");
+	nn.pushLayer(new mic::mlnn::convolution::Padding<double>(4, 4, 1, 2, "Padding"));
+	nn.pushLayer(new mic::mlnn::convolution::Cropping<double>(8, 8, 1, 1, "Cropping"));
+	nn.pushLayer(new mic::mlnn::convolution::Convolution<double>(6, 6, 1, 2, 3, 1, "Conv"));
+	nn.pushLayer(new mic::mlnn::convolution::MaxPooling<double>(4, 4, 2, 2, "MaxPooling"));
+	nn.pushLayer(new mic::mlnn::activation_function::ReLU<double>(8, "ReLU"));
+	nn.pushLayer(new mic::mlnn::regularisation::Dropout<double>(8, 0.5, "Dropout"));
+	nn.pushLayer(new mic::mlnn::fully_connected::FusedLinear<double>(8, 6, mic::mlnn::activation_function::kernels::Activation::ELU, "FusedLinear"));
+	nn.pushLayer(new mic::mlnn::fully_connected::Linear<double>(6, 3, "Linear"));
+	nn.pushLayer(new mic::mlnn::cost_function::Softmax<double>(3, "Softmax"));
+	nn.getLayer<mic::mlnn::convolution::Convolution<double> >(2)->setEngine(mic::mlnn::convolution::ConvolutionEngine::Winograd);
+	nn.getLayer<mic::mlnn::fully_connected::FusedLinear<double> >(6)->setFastExp(true);
+	nn.setLoss< mic::neural_nets::loss::CrossEntropyLoss<double> >();
+	nn.setOptimization< mic::neural_nets::optimization::Adam<double> >();
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 16, 4);
+	x->rand(-1.0, 1.0);
+	mic::types::MatrixPtr<double> t = MAKE_MATRIX_PTR(double, 3, 4);
+	t->setZero();
+	for (size_t i=0; i< 4; i++)
+		(*t)(i % 3, i) = 1;
+	for (size_t step=0; step< 3; step++)
+		nn.train(x, t, 0.01, 0.001);
+
+	ASSERT_TRUE(nn.save("saved.txt"));
+	ASSERT_TRUE(nn.saveBinary("saved.bin"));
+	mic::mlnn::BackpropagationNeuralNetwork<double> from_text("from_text");
+	ASSERT_TRUE(from_text.load("saved.txt"));
+	mic::mlnn::BackpropagationNeuralNetwork<double> from_binary("from_binary");
+	ASSERT_TRUE(from_binary.load("saved.bin"));
+	std::remove("saved.txt");
+	std::remove("saved.bin");
+	ASSERT_EQ(from_text.getLayer<mic::mlnn::convolution::Convolution<double> >(2)->getEngine(), mic::mlnn::convolution::ConvolutionEngine::Winograd);
+	ASSERT_EQ(from_binary.getLayer<mic::mlnn::convolution::Convolution<double> >(2)->getEngine(), mic::mlnn::convolution::ConvolutionEngine::Winograd);
+	ASSERT_EQ(from_text.getLayer<mic::mlnn::fully_connected::FusedLinear<double> >(6)->getActivation(), mic::mlnn::activation_function::kernels::Activation::ELU);
+	ASSERT_TRUE(from_binary.getLayer<mic::mlnn::fully_connected::FusedLinear<double> >(6)->getFastExp());
+
+	// Text format restores the optimizer state, binary format only the parameters.
+	mic::mlnn::BackpropagationNeuralNetwork<double>* restored[] = {&from_text, &from_binary};
+	nn.forward(x, true);
+	for (mic::mlnn::BackpropagationNeuralNetwork<double>* r : restored) {
+		r->forward(x, true);
+		for (size_t i=0; i< (size_t)nn.getPredictions()->size(); i++)
+			ASSERT_EQ((*r->getPredictions())[i], (*nn.getPredictions())[i]) << "Difference in " << r->name << " at position " << i;
+	}//: for
+
+	nn.train(x, t, 0.01, 0.001);
+	from_text.train(x, t, 0.01, 0.001);
+	expectSameParameters(nn, from_text, 0);
+}
+
+/*!
+ * Tests whether refreshed snapshots continue training exactly as the network - also after its optimization functions were replaced
+ * and with the approximation of exp changed in the meantime.
+ */
+TEST(Serialization, SnapshotRefresh) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> nn("nn");
+	createDeepNet(nn);
+	nn.setOptimization< mic::neural_nets::optimization::Adam<double> >();
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 10, 4);
+	mic::types::MatrixPtr<double> t = MAKE_MATRIX_PTR(double, 3, 4);
+	t->setZero();
+	for (size_t i=0; i< 4; i++)
+		(*t)(i % 3, i) = 1;
+
+	mic::mlnn::BackpropagationNeuralNetwork<double> snapshot("snapshot");
+	for (size_t refresh=0; refresh< 3; refresh++) {
+		if (refresh == 2) {
+			nn.setOptimization< mic::neural_nets::optimization::Adam<double> >();
+			nn.getLayer<mic::mlnn::activation_function::ELU<double> >(4)->setFastExp(true);
+		}//: if
+		for (size_t step=0; step< 2; step++) {
+			x->rand(-1.0, 1.0);
+			nn.train(x, t, 0.01, 0.001);
+		}//: for
+		ASSERT_TRUE(nn.snapshotTo(snapshot));
+	}//: for
+	ASSERT_TRUE(snapshot.getLayer<mic::mlnn::activation_function::ELU<double> >(4)->getFastExp());
+
+	for (size_t step=0; step< 2; step++) {
+		x->rand(-1.0, 1.0);
+		nn.train(x, t, 0.01, 0.001);
+		snapshot.train(x, t, 0.01, 0.001);
+		expectSameParameters(nn, snapshot, 0, "in step " + std::to_string(step));
+	}//: for
+}
+
+/*!
+ * Tests whether the approximation of exp set in ELU and Sigmoid layers is restored from both formats and copied to snapshots.
+ */
+TEST(Serialization, ActivationFastExp) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> nn("nn");
+	nn.pushLayer(new mic::mlnn::fully_connected::Linear<double>(4, 4, "Linear"));
+	nn.pushLayer(new mic::mlnn::activation_function::ELU<double>(4, "ELU"));
+	nn.pushLayer(new mic::mlnn::activation_function::Sigmoid<double>(4, "Sigmoid"));
+	nn.getLayer<mic::mlnn::activation_function::ELU<double> >(1)->setFastExp(true);
+	nn.getLayer<mic::mlnn::activation_function::Sigmoid<double> >(2)->setFastExp(true);
+
+	ASSERT_TRUE(nn.save("saved.txt"));
+	ASSERT_TRUE(nn.saveBinary("saved.bin"));
+	mic::mlnn::BackpropagationNeuralNetwork<double> from_text("from_text");
+	ASSERT_TRUE(from_text.load("saved.txt"));
+	mic::mlnn::BackpropagationNeuralNetwork<double> from_binary("from_binary");
+	ASSERT_TRUE(from_binary.load("saved.bin"));
+	mic::mlnn::BackpropagationNeuralNetwork<double> snapshot("snapshot");
+	ASSERT_TRUE(nn.snapshotTo(snapshot));
+	std::remove("saved.txt");
+	std::remove("saved.bin");
+
+	mic::mlnn::BackpropagationNeuralNetwork<double>* restored[] = {&from_text, &from_binary, &snapshot};
+	for (mic::mlnn::BackpropagationNeuralNetwork<double>* r : restored) {
+		ASSERT_TRUE(r->getLayer<mic::mlnn::activation_function::ELU<double> >(1)->getFastExp()) << "ELU in " << r->name;
+		ASSERT_TRUE(r->getLayer<mic::mlnn::activation_function::Sigmoid<double> >(2)->getFastExp()) << "Sigmoid in " << r->name;
+	}//: for
+}
+
+#ifndef MLNN_DISABLE_PROFILING
+/*!
+ * Tests whether the profiler records forward, backward and update of every layer, the loss and feeding of the inputs - and exports them to the Chrome trace.
+ */
+TEST(Profiler, RecordsAllPhases) {
+	mic::mlnn::BackpropagationNeuralNetwork<double> nn("conv");
+	createConvNet(nn);
+	std::shared_ptr<mic::mlnn::Profiler> profiler = std::make_shared<mic::mlnn::Profiler>();
+	nn.setProfiler(profiler);
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 25, 4);
+	x->rand(-1.0, 1.0);
+	mic::types::MatrixPtr<double> t = MAKE_MATRIX_PTR(double, 3, 4);
+	t->setZero();
+	for (size_t i=0; i< 4; i++)
+		(*t)(i % 3, i) = 1;
+	for (size_t step=0; step< 3; step++)
+		nn.train(x, t, 0.01, 0.001);
+
+	ASSERT_EQ(profiler->calls("input", mic::mlnn::ProfiledPhase::Feeding), 3);
+	ASSERT_EQ(profiler->calls("loss gradient", mic::mlnn::ProfiledPhase::Loss), 3);
+	ASSERT_EQ(profiler->calls("loss", mic::mlnn::ProfiledPhase::Loss), 3);
+	for (std::string layer : {"Conv", "ReLU", "Linear", "Softmax"}) {
+		ASSERT_EQ(profiler->calls(layer, mic::mlnn::ProfiledPhase::Forward), 3) << layer;
+		ASSERT_EQ(profiler->calls(layer, mic::mlnn::ProfiledPhase::Backward), 3) << layer;
+		ASSERT_EQ(profiler->calls(layer, mic::mlnn::ProfiledPhase::Update), 3) << layer;
+		ASSERT_GT(profiler->totalBytes(layer, mic::mlnn::ProfiledPhase::Forward), 0) << layer;
+	}//: for
+	ASSERT_GT(profiler->totalBytes("Conv", mic::mlnn::ProfiledPhase::Update), 0);
+	// Input, 4 forwards, 2 losses, 4 backwards and 4 updates in every step.
+	ASSERT_EQ(profiler->numberOfEvents(), 3 * 15);
+
+	// Softmax fused with the loss and multi-tensor update recorded as a single operation.
+	nn.setFusedSoftmaxCrossEntropy();
+	nn.setMultiTensorUpdate();
+	nn.train(x, t, 0.01, 0.001);
+	ASSERT_EQ(profiler->calls("Softmax", mic::mlnn::ProfiledPhase::Loss), 1);
+	ASSERT_EQ(profiler->calls("Softmax", mic::mlnn::ProfiledPhase::Forward), 3);
+	ASSERT_EQ(profiler->calls("multi-tensor", mic::mlnn::ProfiledPhase::Update), 1);
+	ASSERT_EQ(profiler->calls("Conv", mic::mlnn::ProfiledPhase::Update), 3);
+
+	std::ostringstream table;
+	table << (*profiler);
+	ASSERT_NE(table.str().find("multi-tensor"), std::string::npos);
+
+	ASSERT_TRUE(profiler->exportChromeTrace("profile.json"));
+	std::ifstream ifs("profile.json");
+	std::string trace((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+	std::remove("profile.json");
+	ASSERT_EQ(trace.find("{\"traceEvents\":["), 0);
+	ASSERT_NE(trace.find("\"name\":\"Conv\",\"cat\":\"backward\",\"ph\":\"X\""), std::string::npos);
+
+	// Disabled profiler records nothing.
+	profiler->clear();
+	nn.setProfiler(nullptr);
+	nn.train(x, t, 0.01, 0.001);
+	ASSERT_EQ(profiler->numberOfEvents(), 0);
+}
+#endif
+
 } } }//: namespaces
 
 int main(int argc, char **argv) {
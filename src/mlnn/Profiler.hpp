@@ -0,0 +1,316 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file Profiler.hpp
+ * \brief Profiler recording wall time and bytes touched by the operations of the network, with aggregated tables and Chrome trace export.
+ * \author tkornuta
+ * \date Oct 16, 2026
+ */
+
+#ifndef SRC_MLNN_PROFILER_HPP_
+#define SRC_MLNN_PROFILER_HPP_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+/*!
+ * Executes the statement, recording its time and bytes touched in the profiler (if set).
+ * Label and bytes are evaluated only when profiling, so the overhead of the disabled profiler is a single branch.
+ * Defining MLNN_DISABLE_PROFILING compiles the instrumentation out.
+ */
+#ifndef MLNN_DISABLE_PROFILING
+#define MLNN_PROFILE(profiler_, phase_, label_, bytes_, ...) \
+	do { \
+		if (profiler_) { \
+			mic::mlnn::Profiler::time_point profile_start = mic::mlnn::Profiler::now(); \
+			__VA_ARGS__; \
+			profiler_->record(label_, phase_, profile_start, bytes_); \
+		} else { \
+			__VA_ARGS__; \
+		} \
+	} while (0)
+#else
+#define MLNN_PROFILE(profiler_, phase_, label_, bytes_, ...) \
+	do { \
+		__VA_ARGS__; \
+	} while (0)
+#endif
+
+namespace mic {
+namespace mlnn {
+
+/// Profiled phases.
+enum class ProfiledPhase : short { Forward = 0, Backward, Update, Loss, Feeding };
+
+/*!
+ * Returns the name of the phase.
+ */
+inline const char* phaseName(ProfiledPhase phase_) {
+	switch (phase_) {
+	case(ProfiledPhase::Forward): return "forward";
+	case(ProfiledPhase::Backward): return "backward";
+	case(ProfiledPhase::Update): return "update";
+	case(ProfiledPhase::Loss): return "loss";
+	case(ProfiledPhase::Feeding): return "feeding";
+	default: return "unknown";
+	}//: switch
+}
+
+
+/*!
+ * \brief Profiler recording the wall time and bytes touched (sizes of the matrices read or written) by the operations of the network.
+ * Aggregates the statistics per operation (label and phase) and keeps the events for the Chrome trace (chrome://tracing, Perfetto).
+ * Operations should be recorded by a single thread.
+ * \author tkornuta
+ */
+class Profiler {
+public:
+	/// Clock used for measurements.
+	typedef std::chrono::steady_clock clock;
+
+	/// Point in time.
+	typedef clock::time_point time_point;
+
+	/*!
+	 * Constructor.
+	 * @param max_events_ Maximal number of events kept for the trace (statistics are aggregated regardless).
+	 */
+	Profiler(size_t max_events_ = 1000000) : max_events(max_events_), origin(now()) { }
+
+	/*!
+	 * Returns the current time.
+	 */
+	static time_point now() {
+		return clock::now();
+	}
+
+	/*!
+	 * Records the operation that started at the given time and has just finished.
+	 * @param label_ Label of the operation (e.g. name of the layer).
+	 * @param phase_ Phase.
+	 * @param start_ Start of the operation.
+	 * @param bytes_ Bytes touched by the operation.
+	 */
+	void record(const std::string & label_, ProfiledPhase phase_, time_point start_, size_t bytes_) {
+		time_point end = now();
+		double duration = std::chrono::duration<double, std::micro>(end - start_).count();
+
+		// Aggregate.
+		std::map<std::pair<std::string, ProfiledPhase>, size_t>::iterator it = indices.find(std::make_pair(label_, phase_));
+		size_t index;
+		if (it == indices.end()) {
+			index = statistics.size();
+			indices[std::make_pair(label_, phase_)] = index;
+			Statistics stats;
+			stats.label = label_;
+			stats.phase = phase_;
+			stats.calls = 0;
+			stats.total = 0;
+			stats.max = 0;
+			stats.bytes = 0;
+			statistics.push_back(stats);
+		} else
+			index = it->second;
+		Statistics & stats = statistics[index];
+		stats.calls++;
+		stats.total += duration;
+		stats.max = std::max(stats.max, duration);
+		stats.bytes += bytes_;
+
+		// Keep the event.
+		if (events.size() < max_events) {
+			Event event;
+			event.operation = index;
+			event.start = std::chrono::duration<double, std::micro>(start_ - origin).count();
+			event.duration = duration;
+			event.bytes = bytes_;
+			events.push_back(event);
+		}//: if
+	}
+
+	/*!
+	 * Clears the statistics and events.
+	 */
+	void clear() {
+		indices.clear();
+		statistics.clear();
+		events.clear();
+		origin = now();
+	}
+
+	/*!
+	 * Returns the number of calls of the operation.
+	 */
+	size_t calls(const std::string & label_, ProfiledPhase phase_) {
+		std::map<std::pair<std::string, ProfiledPhase>, size_t>::iterator it = indices.find(std::make_pair(label_, phase_));
+		return (it == indices.end()) ? 0 : statistics[it->second].calls;
+	}
+
+	/*!
+	 * Returns the total time of the operation [us].
+	 */
+	double totalTime(const std::string & label_, ProfiledPhase phase_) {
+		std::map<std::pair<std::string, ProfiledPhase>, size_t>::iterator it = indices.find(std::make_pair(label_, phase_));
+		return (it == indices.end()) ? 0 : statistics[it->second].total;
+	}
+
+	/*!
+	 * Returns the total number of bytes touched by the operation.
+	 */
+	size_t totalBytes(const std::string & label_, ProfiledPhase phase_) {
+		std::map<std::pair<std::string, ProfiledPhase>, size_t>::iterator it = indices.find(std::make_pair(label_, phase_));
+		return (it == indices.end()) ? 0 : statistics[it->second].bytes;
+	}
+
+	/*!
+	 * Returns the number of kept events.
+	 */
+	size_t numberOfEvents() {
+		return events.size();
+	}
+
+	/*!
+	 * Exports the events to the file in the Chrome trace format (JSON, complete events with times in microseconds).
+	 * @param filename_ Name of the file.
+	 * @return False if the file could not be written.
+	 */
+	bool exportChromeTrace(std::string filename_) {
+		std::ofstream ofs(filename_);
+		if (!ofs.good())
+			return false;
+		ofs << std::fixed << std::setprecision(3);
+		ofs << "{\"traceEvents\":[";
+		for (size_t i = 0; i < events.size(); i++) {
+			const Event & event = events[i];
+			const Statistics & stats = statistics[event.operation];
+			ofs << (i > 0 ? ",\n" : "\n") << "{\"name\":\"" << escape(stats.label) << "\",\"cat\":\"" << phaseName(stats.phase)
+				<< "\",\"ph\":\"X\",\"ts\":" << event.start << ",\"dur\":" << event.duration
+				<< ",\"pid\":0,\"tid\":0,\"args\":{\"bytes\":" << event.bytes << "}}";
+		}//: for
+		ofs << "\n],\"displayTimeUnit\":\"ms\"}\n";
+		return ofs.good();
+	}
+
+	/*!
+	 * Stream operator printing the table of the aggregated statistics, sorted by the total time.
+	 */
+	friend std::ostream& operator<<(std::ostream& os_, const Profiler& obj_) {
+		std::vector<const Statistics*> sorted;
+		double total = 0;
+		for (size_t i = 0; i < obj_.statistics.size(); i++) {
+			sorted.push_back(&obj_.statistics[i]);
+			total += obj_.statistics[i].total;
+		}//: for
+		std::sort(sorted.begin(), sorted.end(), [](const Statistics* a, const Statistics* b) { return a->total > b->total; });
+
+		std::ios::fmtflags flags = os_.flags();
+		std::streamsize precision = os_.precision();
+		os_ << std::left << std::setw(24) << "operation" << std::setw(10) << "phase" << std::right << std::setw(10) << "calls"
+			<< std::setw(12) << "total [ms]" << std::setw(8) << "[%]" << std::setw(12) << "mean [us]" << std::setw(12) << "max [us]"
+			<< std::setw(14) << "bytes/call" << std::setw(10) << "GB/s" << std::endl;
+		os_ << std::fixed;
+		for (const Statistics* stats : sorted) {
+			os_ << std::left << std::setw(24) << stats->label << std::setw(10) << phaseName(stats->phase) << std::right << std::setw(10) << stats->calls
+				<< std::setprecision(3) << std::setw(12) << stats->total / 1000.0
+				<< std::setprecision(1) << std::setw(8) << ((total > 0) ? 100.0 * stats->total / total : 0)
+				<< std::setprecision(2) << std::setw(12) << stats->total / stats->calls << std::setw(12) << stats->max
+				<< std::setw(14) << stats->bytes / stats->calls
+				<< std::setw(10) << ((stats->total > 0) ? stats->bytes / stats->total / 1000.0 : 0) << std::endl;
+		}//: for
+		os_.flags(flags);
+		os_.precision(precision);
+		return os_;
+	}
+
+private:
+	/*!
+	 * \brief Aggregated statistics of an operation.
+	 */
+	struct Statistics {
+		/// Label of the operation.
+		std::string label;
+
+		/// Phase.
+		ProfiledPhase phase;
+
+		/// Number of calls.
+		size_t calls;
+
+		/// Total time [us].
+		double total;
+
+		/// Maximal time [us].
+		double max;
+
+		/// Total number of bytes touched.
+		size_t bytes;
+	};
+
+	/*!
+	 * \brief Single execution of an operation.
+	 */
+	struct Event {
+		/// Index of the operation.
+		size_t operation;
+
+		/// Start relative to the origin [us].
+		double start;
+
+		/// Duration [us].
+		double duration;
+
+		/// Bytes touched.
+		size_t bytes;
+	};
+
+	/*!
+	 * Escapes the string for JSON.
+	 */
+	static std::string escape(const std::string & str_) {
+		std::string escaped;
+		for (char c : str_) {
+			if ((c == '"') || (c == '\\'))
+				escaped += '\\';
+			escaped += c;
+		}//: for
+		return escaped;
+	}
+
+	/// Maximal number of kept events.
+	size_t max_events;
+
+	/// Origin of the times of events.
+	time_point origin;
+
+	/// Indices of the operations.
+	std::map<std::pair<std::string, ProfiledPhase>, size_t> indices;
+
+	/// Statistics of the operations (in the order of their first occurrence).
+	std::vector<Statistics> statistics;
+
+	/// Kept events.
+	std::vector<Event> events;
+};
+
+} /* namespace mlnn */
+} /* namespace mic */
+
+#endif /* SRC_MLNN_PROFILER_HPP_ */
@@ -0,0 +1,554 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file ActivationKernels.hpp
+ * \brief Vectorized elementwise kernels of the activation layers, with the instruction set (AVX-512/AVX2/scalar) chosen at runtime.
+ * \author tkornuta
+ * \date Oct 16, 2026
+ */
+
+#ifndef SRC_MLNN_ACTIVATIONKERNELS_HPP_
+#define SRC_MLNN_ACTIVATIONKERNELS_HPP_
+
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+// Variants for the x86 instruction set extensions are compiled with target attributes (GCC/Clang), so no global -march flags are required.
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define MLNN_ACTIVATION_KERNELS_X86
+#endif
+
+// Elementwise operations must be inlined into the loops, otherwise they are not vectorized.
+#ifdef __GNUC__
+#define MLNN_KERNEL_INLINE inline __attribute__((always_inline))
+#else
+#define MLNN_KERNEL_INLINE inline
+#endif
+
+// GCC does not vectorize loops with selections followed by floating point operations, unless floating point exceptions may be ignored
+// (results are not affected, only the exception flags are not preserved).
+#if defined(__GNUC__) && !defined(__clang__)
+#define MLNN_KERNEL_LOOP __attribute__((optimize("no-trapping-math")))
+#else
+#define MLNN_KERNEL_LOOP
+#endif
+
+namespace mic {
+namespace mlnn {
+namespace activation_function {
+namespace kernels {
+
+/// Instruction sets used by the kernels.
+enum class SimdLevel : short { Scalar = 0, AVX2, AVX512 };
+
+/*!
+ * Returns the widest instruction set supported by the processor.
+ */
+inline SimdLevel detectSimdLevel() {
+#ifdef MLNN_ACTIVATION_KERNELS_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		return SimdLevel::AVX512;
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		return SimdLevel::AVX2;
+#endif
+	return SimdLevel::Scalar;
+}
+
+/*!
+ * Returns the reference to the instruction set used by the kernels (detected at the first call).
+ */
+inline SimdLevel & activeSimdLevel() {
+	static SimdLevel level = detectSimdLevel();
+	return level;
+}
+
+/*!
+ * Returns the instruction set used by the kernels.
+ */
+inline SimdLevel simdLevel() {
+	return activeSimdLevel();
+}
+
+/*!
+ * Limits the instruction set used by the kernels (e.g. for comparisons), it cannot exceed the one supported by the processor.
+ * @param level_ Instruction set.
+ */
+inline void setSimdLevel(SimdLevel level_) {
+	SimdLevel detected = detectSimdLevel();
+	activeSimdLevel() = (level_ < detected) ? level_ : detected;
+}
+
+
+/*!
+ * \brief Constants of the exp approximation for the given precision.
+ * \tparam eT Template type (single/double precision)
+ */
+template <typename eT>
+struct ExpTraits;
+
+/*!
+ * \brief Constants of the exp approximation in single precision.
+ */
+template <>
+struct ExpTraits<float> {
+	/// Integer with the size of the scalar.
+	typedef uint32_t bits_t;
+	/// Range of arguments (results are normal numbers).
+	static constexpr float min_arg = -87.0f;
+	static constexpr float max_arg = 88.0f;
+	/// Position and bias of the exponent.
+	static constexpr int mantissa_bits = 23;
+	static constexpr int exponent_bias = 127;
+	/// Adding 1.5 2^23 rounds to the nearest integer, stored in the lowest bits of the mantissa.
+	static constexpr float round_magic = 12582912.0f;
+	/*!
+	 * Taylor polynomial of exp of degree 6 (Horner scheme).
+	 */
+	static MLNN_KERNEL_INLINE float polynomial(float r_) {
+		return 1.0f + r_ * (1.0f + r_ * (1.0f / 2 + r_ * (1.0f / 6 + r_ * (1.0f / 24 + r_ * (1.0f / 120 + r_ * (1.0f / 720))))));
+	}
+};
+
+/*!
+ * \brief Constants of the exp approximation in double precision.
+ */
+template <>
+struct ExpTraits<double> {
+	/// Integer with the size of the scalar.
+	typedef uint64_t bits_t;
+	/// Range of arguments (results are normal numbers).
+	static constexpr double min_arg = -708.0;
+	static constexpr double max_arg = 709.0;
+	/// Position and bias of the exponent.
+	static constexpr int mantissa_bits = 52;
+	static constexpr int exponent_bias = 1023;
+	/// Adding 1.5 2^52 rounds to the nearest integer, stored in the lowest bits of the mantissa.
+	static constexpr double round_magic = 6755399441055744.0;
+	/*!
+	 * Taylor polynomial of exp of degree 11 (Horner scheme).
+	 */
+	static MLNN_KERNEL_INLINE double polynomial(double r_) {
+		return 1.0 + r_ * (1.0 + r_ * (1.0 / 2 + r_ * (1.0 / 6 + r_ * (1.0 / 24 + r_ * (1.0 / 120 + r_ * (1.0 / 720
+				+ r_ * (1.0 / 5040 + r_ * (1.0 / 40320 + r_ * (1.0 / 362880 + r_ * (1.0 / 3628800 + r_ * (1.0 / 39916800)))))))))));
+	}
+};
+
+/*!
+ * Approximates exp(x) with bounded error, without branches or calls, so loops using it are vectorized.
+ * The argument is clamped to the range of normal results and reduced to x = k ln2 + r, |r| <= ln2/2, then exp(x) = 2^k p(r),
+ * where p is the Taylor polynomial of degree 6 (float) or 11 (double) - the relative error is below 1e-6 (float) and 1e-13 (double).
+ * @param x_ Argument.
+ */
+template <typename eT>
+MLNN_KERNEL_INLINE eT fastExp(eT x_) {
+	typedef ExpTraits<eT> T;
+	eT x = (x_ < T::min_arg) ? (eT)T::min_arg : ((x_ > T::max_arg) ? (eT)T::max_arg : x_);
+	// Round x / ln2 to the nearest integer k - without conversions, as they prevent the vectorization of loops with clamping.
+	eT t = x * (eT)1.44269504088896341 + T::round_magic;
+	eT k = t - T::round_magic;
+	// Reduce the argument (ln2 split into two parts, so k * ln2_hi is exact).
+	eT r = x - k * (eT)0.693145751953125 - k * (eT)1.42860682030941723212e-6;
+	eT p = T::polynomial(r);
+	// Scale by 2^k - the exponent is constructed from k stored in the lowest bits of t (bits of the magic number are shifted out).
+	typename T::bits_t bits;
+	std::memcpy(&bits, &t, sizeof(eT));
+	bits = (bits + T::exponent_bias) << T::mantissa_bits;
+	eT scale;
+	std::memcpy(&scale, &bits, sizeof(eT));
+	// Propagate NaNs (all values are calculated before the selection, so it is compiled without branches).
+	eT result = p * scale;
+	return (x_ == x_) ? result : x_;
+}
+
+/*!
+ * Returns exp(x) - exact or approximated.
+ */
+template <typename eT, bool Fast>
+MLNN_KERNEL_INLINE eT expOf(eT x_) {
+	return Fast ? fastExp(x_) : std::exp(x_);
+}
+
+
+/*!
+ * \brief ReLU: y = max(x, 0).
+ */
+template <typename eT>
+struct ReLUForward {
+	MLNN_KERNEL_INLINE eT operator()(eT x_) const { return (x_ > 0) ? x_ : (eT)0; }
+};
+
+/*!
+ * \brief Gradient of ReLU (calculated from the output): dx = dy if y > 0.
+ */
+template <typename eT>
+struct ReLUBackward {
+	MLNN_KERNEL_INLINE eT operator()(eT y_, eT dy_) const { return (y_ > 0) ? dy_ : (eT)0; }
+};
+
+/*!
+ * \brief ELU: y = x if x > 0, exp(x) - 1 otherwise.
+ */
+template <typename eT, bool Fast>
+struct ELUForward {
+	MLNN_KERNEL_INLINE eT operator()(eT x_) const {
+		if (Fast) {
+			// Calculate the approximation for all elements - without branches.
+			eT e = fastExp(x_) - (eT)1;
+			return (x_ > 0) ? x_ : e;
+		}//: if
+		return (x_ > 0) ? x_ : std::exp(x_) - (eT)1;
+	}
+};
+
+/*!
+ * \brief Gradient of ELU (calculated from the output, as the derivative exp(x) is equal to y + 1): dx = dy if y > 0, dy (y + 1) otherwise.
+ */
+template <typename eT>
+struct ELUBackward {
+	MLNN_KERNEL_INLINE eT operator()(eT y_, eT dy_) const { return (y_ > 0) ? dy_ : dy_ * (y_ + (eT)1); }
+};
+
+/*!
+ * \brief Sigmoid: y = 1 / (1 + exp(-x)).
+ */
+template <typename eT, bool Fast>
+struct SigmoidForward {
+	MLNN_KERNEL_INLINE eT operator()(eT x_) const { return (eT)1 / ((eT)1 + expOf<eT, Fast>(-x_)); }
+};
+
+/*!
+ * \brief Gradient of sigmoid (calculated from the output): dx = dy y (1 - y).
+ */
+template <typename eT>
+struct SigmoidBackward {
+	MLNN_KERNEL_INLINE eT operator()(eT y_, eT dy_) const { return dy_ * (y_ * ((eT)1 - y_)); }
+};
+
+/*!
+ * \brief Identity: y = x (used when only the bias is applied).
+ */
+template <typename eT>
+struct IdentityForward {
+	MLNN_KERNEL_INLINE eT operator()(eT x_) const { return x_; }
+};
+
+/*!
+ * \brief Gradient of identity: dx = dy.
+ */
+template <typename eT>
+struct IdentityBackward {
+	MLNN_KERNEL_INLINE eT operator()(eT y_, eT dy_) const { return dy_; }
+};
+
+/*!
+ * \brief Adds the bias before the activation: y = op(x + b).
+ */
+template <typename Op, typename eT>
+struct Biased {
+	MLNN_KERNEL_INLINE eT operator()(eT x_, eT b_) const { return Op()(x_ + b_); }
+};
+
+/*!
+ * \brief Masks the gradient of the output before the gradient operation (e.g. with the dropout mask): dx = op(y, dy m).
+ */
+template <typename Op, typename eT>
+struct Masked {
+	MLNN_KERNEL_INLINE eT operator()(eT y_, eT dy_, eT mask_) const { return Op()(y_, dy_ * mask_); }
+};
+
+
+/*!
+ * Applies the unary operation to all elements: y = op(x) (in place when x == y).
+ */
+template <typename Op, typename eT>
+MLNN_KERNEL_LOOP inline void mapScalar(const eT* x_, eT* y_, size_t size_) {
+	Op op;
+#pragma omp simd
+	for (size_t i = 0; i < size_; i++)
+		y_[i] = op(x_[i]);
+}
+
+/*!
+ * Applies the binary operation to all elements: z = op(x, y).
+ */
+template <typename Op, typename eT>
+MLNN_KERNEL_LOOP inline void mapScalar(const eT* x_, const eT* y_, eT* z_, size_t size_) {
+	Op op;
+#pragma omp simd
+	for (size_t i = 0; i < size_; i++)
+		z_[i] = op(x_[i], y_[i]);
+}
+
+/*!
+ * Applies the ternary operation to all elements: z = op(x, y, w).
+ */
+template <typename Op, typename eT>
+MLNN_KERNEL_LOOP inline void mapScalar(const eT* x_, const eT* y_, const eT* w_, eT* z_, size_t size_) {
+	Op op;
+#pragma omp simd
+	for (size_t i = 0; i < size_; i++)
+		z_[i] = op(x_[i], y_[i], w_[i]);
+}
+
+#ifdef MLNN_ACTIVATION_KERNELS_X86
+/*!
+ * Applies the unary operation to all elements, vectorized with AVX2.
+ */
+template <typename Op, typename eT>
+__attribute__((target("avx2,fma"))) MLNN_KERNEL_LOOP void mapAVX2(const eT* x_, eT* y_, size_t size_) {
+	Op op;
+#pragma omp simd
+	for (size_t i = 0; i < size_; i++)
+		y_[i] = op(x_[i]);
+}
+
+/*!
+ * Applies the binary operation to all elements, vectorized with AVX2.
+ */
+template <typename Op, typename eT>
+__attribute__((target("avx2,fma"))) MLNN_KERNEL_LOOP void mapAVX2(const eT* x_, const eT* y_, eT* z_, size_t size_) {
+	Op op;
+#pragma omp simd
+	for (size_t i = 0; i < size_; i++)
+		z_[i] = op(x_[i], y_[i]);
+}
+
+/*!
+ * Applies the ternary operation to all elements, vectorized with AVX2.
+ */
+template <typename Op, typename eT>
+__attribute__((target("avx2,fma"))) MLNN_KERNEL_LOOP void mapAVX2(const eT* x_, const eT* y_, const eT* w_, eT* z_, size_t size_) {
+	Op op;
+#pragma omp simd
+	for (size_t i = 0; i < size_; i++)
+		z_[i] = op(x_[i], y_[i], w_[i]);
+}
+
+/*!
+ * Applies the unary operation to all elements, vectorized with AVX-512.
+ */
+template <typename Op, typename eT>
+__attribute__((target("avx512f"))) MLNN_KERNEL_LOOP void mapAVX512(const eT* x_, eT* y_, size_t size_) {
+	Op op;
+#pragma omp simd
+	for (size_t i = 0; i < size_; i++)
+		y_[i] = op(x_[i]);
+}
+
+/*!
+ * Applies the binary operation to all elements, vectorized with AVX-512.
+ */
+template <typename Op, typename eT>
+__attribute__((target("avx512f"))) MLNN_KERNEL_LOOP void mapAVX512(const eT* x_, const eT* y_, eT* z_, size_t size_) {
+	Op op;
+#pragma omp simd
+	for (size_t i = 0; i < size_; i++)
+		z_[i] = op(x_[i], y_[i]);
+}
+
+/*!
+ * Applies the ternary operation to all elements, vectorized with AVX-512.
+ */
+template <typename Op, typename eT>
+__attribute__((target("avx512f"))) MLNN_KERNEL_LOOP void mapAVX512(const eT* x_, const eT* y_, const eT* w_, eT* z_, size_t size_) {
+	Op op;
+#pragma omp simd
+	for (size_t i = 0; i < size_; i++)
+		z_[i] = op(x_[i], y_[i], w_[i]);
+}
+#endif
+
+/*!
+ * Applies the unary operation to all elements, with the active instruction set: y = op(x).
+ * @param x_ Input (may be equal to the output).
+ * @param y_ Output.
+ * @param size_ Number of elements.
+ */
+template <typename Op, typename eT>
+inline void map(const eT* x_, eT* y_, size_t size_) {
+#ifdef MLNN_ACTIVATION_KERNELS_X86
+	switch (simdLevel()) {
+	case(SimdLevel::AVX512): mapAVX512<Op>(x_, y_, size_); return;
+	case(SimdLevel::AVX2): mapAVX2<Op>(x_, y_, size_); return;
+	default: break;
+	}//: switch
+#endif
+	mapScalar<Op>(x_, y_, size_);
+}
+
+/*!
+ * Applies the binary operation to all elements, with the active instruction set: z = op(x, y).
+ * @param x_ First input.
+ * @param y_ Second input.
+ * @param z_ Output (may be equal to one of the inputs).
+ * @param size_ Number of elements.
+ */
+template <typename Op, typename eT>
+inline void map(const eT* x_, const eT* y_, eT* z_, size_t size_) {
+#ifdef MLNN_ACTIVATION_KERNELS_X86
+	switch (simdLevel()) {
+	case(SimdLevel::AVX512): mapAVX512<Op>(x_, y_, z_, size_); return;
+	case(SimdLevel::AVX2): mapAVX2<Op>(x_, y_, z_, size_); return;
+	default: break;
+	}//: switch
+#endif
+	mapScalar<Op>(x_, y_, z_, size_);
+}
+
+/*!
+ * Applies the ternary operation to all elements, with the active instruction set: z = op(x, y, w).
+ * @param x_ First input.
+ * @param y_ Second input.
+ * @param w_ Third input.
+ * @param z_ Output (may be equal to one of the inputs).
+ * @param size_ Number of elements.
+ */
+template <typename Op, typename eT>
+inline void map(const eT* x_, const eT* y_, const eT* w_, eT* z_, size_t size_) {
+#ifdef MLNN_ACTIVATION_KERNELS_X86
+	switch (simdLevel()) {
+	case(SimdLevel::AVX512): mapAVX512<Op>(x_, y_, w_, z_, size_); return;
+	case(SimdLevel::AVX2): mapAVX2<Op>(x_, y_, w_, z_, size_); return;
+	default: break;
+	}//: switch
+#endif
+	mapScalar<Op>(x_, y_, w_, z_, size_);
+}
+
+
+/// Activation functions that can be fused into the preceding layers.
+enum class Activation : short { Identity = 0, ReLU, ELU, Sigmoid };
+
+/*!
+ * Returns the name of the activation function.
+ */
+inline const char* activationName(Activation activation_) {
+	switch (activation_) {
+	case(Activation::ReLU): return "ReLU";
+	case(Activation::ELU): return "ELU";
+	case(Activation::Sigmoid): return "Sigmoid";
+	default: return "Identity";
+	}//: switch
+}
+
+/*!
+ * Adds the bias to all columns of the matrix and applies the operation, in a single sweep: y(:,c) = op(x(:,c) + b).
+ * Columns are processed in parallel.
+ */
+template <typename Op, typename eT>
+void mapColumns(const eT* x_, const eT* b_, eT* y_, size_t rows_, size_t cols_) {
+	if (!b_) {
+		map<Op>(x_, y_, rows_ * cols_);
+		return;
+	}//: if
+#pragma omp parallel for if(cols_ > 1)
+	for (size_t c = 0; c < cols_; c++)
+		map<Biased<Op, eT> >(x_ + c * rows_, b_, y_ + c * rows_, rows_);
+}
+
+/*!
+ * Applies the activation function to all columns of the matrix, after adding the bias: y(:,c) = f(x(:,c) + b).
+ * @param activation_ Activation function.
+ * @param fast_exp_ Flag denoting whether exp is approximated (ELU, sigmoid).
+ * @param x_ Input (column-major, may be equal to the output).
+ * @param b_ Bias vector of length rows_ (nullptr - no bias).
+ * @param y_ Output.
+ * @param rows_ Number of rows.
+ * @param cols_ Number of columns.
+ */
+template <typename eT>
+void activate(Activation activation_, bool fast_exp_, const eT* x_, const eT* b_, eT* y_, size_t rows_, size_t cols_) {
+	switch (activation_) {
+	case(Activation::ReLU):
+		mapColumns<ReLUForward<eT> >(x_, b_, y_, rows_, cols_);
+		break;
+	case(Activation::ELU):
+		if (fast_exp_)
+			mapColumns<ELUForward<eT, true> >(x_, b_, y_, rows_, cols_);
+		else
+			mapColumns<ELUForward<eT, false> >(x_, b_, y_, rows_, cols_);
+		break;
+	case(Activation::Sigmoid):
+		if (fast_exp_)
+			mapColumns<SigmoidForward<eT, true> >(x_, b_, y_, rows_, cols_);
+		else
+			mapColumns<SigmoidForward<eT, false> >(x_, b_, y_, rows_, cols_);
+		break;
+	default:
+		mapColumns<IdentityForward<eT> >(x_, b_, y_, rows_, cols_);
+	}//: switch
+}
+
+/*!
+ * Multiplies the gradient by the derivative of the activation function (calculated from its output): dx = f'(y) dy.
+ * @param activation_ Activation function.
+ * @param y_ Output of the activation function.
+ * @param dy_ Gradient of the output.
+ * @param dx_ Gradient of the input (may be equal to dy_).
+ * @param size_ Number of elements.
+ */
+template <typename eT>
+void activationGradient(Activation activation_, const eT* y_, const eT* dy_, eT* dx_, size_t size_) {
+	switch (activation_) {
+	case(Activation::ReLU):
+		map<ReLUBackward<eT> >(y_, dy_, dx_, size_);
+		break;
+	case(Activation::ELU):
+		map<ELUBackward<eT> >(y_, dy_, dx_, size_);
+		break;
+	case(Activation::Sigmoid):
+		map<SigmoidBackward<eT> >(y_, dy_, dx_, size_);
+		break;
+	default:
+		map<IdentityBackward<eT> >(y_, dy_, dx_, size_);
+	}//: switch
+}
+
+/*!
+ * Multiplies the masked gradient by the derivative of the activation function (calculated from its output): dx = f'(y) (dy m).
+ * @param activation_ Activation function.
+ * @param y_ Output of the activation function.
+ * @param dy_ Gradient of the output.
+ * @param mask_ Mask (e.g. the dropout mask).
+ * @param dx_ Gradient of the input (may be equal to dy_).
+ * @param size_ Number of elements.
+ */
+template <typename eT>
+void activationGradient(Activation activation_, const eT* y_, const eT* dy_, const eT* mask_, eT* dx_, size_t size_) {
+	switch (activation_) {
+	case(Activation::ReLU):
+		map<Masked<ReLUBackward<eT>, eT> >(y_, dy_, mask_, dx_, size_);
+		break;
+	case(Activation::ELU):
+		map<Masked<ELUBackward<eT>, eT> >(y_, dy_, mask_, dx_, size_);
+		break;
+	case(Activation::Sigmoid):
+		map<Masked<SigmoidBackward<eT>, eT> >(y_, dy_, mask_, dx_, size_);
+		break;
+	default:
+		map<Masked<IdentityBackward<eT>, eT> >(y_, dy_, mask_, dx_, size_);
+	}//: switch
+}
+
+} /* namespace kernels */
+} /* namespace activation_function */
+} /* namespace mlnn */
+} /* namespace mic */
+
+#endif /* SRC_MLNN_ACTIVATIONKERNELS_HPP_ */
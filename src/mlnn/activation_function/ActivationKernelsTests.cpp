@@ -0,0 +1,159 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * @file: ActivationKernelsTests.cpp
+ * @Author: Tomasz Kornuta <tkornut@us.ibm.com>
+ * @Date:   Oct 16, 2026
+ *
+ * Copyright (c) 2017, Tomasz Kornuta, IBM Corporation. All rights reserved.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <mlnn/activation_function/ELU.hpp>
+#include <mlnn/activation_function/ReLU.hpp>
+#include <mlnn/activation_function/Sigmoid.hpp>
+#include <loss/LossTypes.hpp>
+
+#include <vector>
+#include <limits>
+
+using namespace mic::mlnn::activation_function;
+
+/*!
+ * Checks the relative error of the exp approximation over the whole range of arguments.
+ */
+TEST(ActivationKernels, FastExpError) {
+	double max_float_error = 0, max_double_error = 0;
+	for (double x = -87.0; x <= 88.0; x += 0.0137) {
+		float ef = kernels::fastExp<float>((float)x);
+		double reference = std::exp((double)(float)x);
+		max_float_error = std::max(max_float_error, std::fabs(ef - reference) / reference);
+		double ed = kernels::fastExp<double>(x);
+		max_double_error = std::max(max_double_error, std::fabs(ed - std::exp(x)) / std::exp(x));
+	}//: for
+	ASSERT_LT(max_float_error, 1e-6);
+	ASSERT_LT(max_double_error, 1e-13);
+
+	// Arguments out of range are clamped, NaNs are propagated.
+	ASSERT_GT(kernels::fastExp<float>(-1000.0f), 0.0f);
+	ASSERT_LT(kernels::fastExp<float>(-1000.0f), 1e-37f);
+	ASSERT_GT(kernels::fastExp<float>(1000.0f), 1e38f);
+	ASSERT_TRUE(std::isnan(kernels::fastExp<float>(std::numeric_limits<float>::quiet_NaN())));
+	ASSERT_TRUE(std::isnan(kernels::fastExp<double>(std::numeric_limits<double>::quiet_NaN())));
+}
+
+/*!
+ * Applies the unary and binary operation with the given instruction set, checks results against the scalar loop.
+ */
+template <typename UnaryOp, typename BinaryOp, typename eT>
+void compareWithScalar(kernels::SimdLevel level_, const std::vector<eT> & x_, const std::vector<eT> & dy_) {
+	size_t size = x_.size();
+	std::vector<eT> y_ref(size), dx_ref(size), y(size), dx(size);
+	UnaryOp uop;
+	BinaryOp bop;
+	for (size_t i = 0; i < size; i++) {
+		y_ref[i] = uop(x_[i]);
+		dx_ref[i] = bop(y_ref[i], dy_[i]);
+	}//: for
+
+	kernels::setSimdLevel(level_);
+	kernels::map<UnaryOp>(x_.data(), y.data(), size);
+	kernels::map<BinaryOp>(y.data(), dy_.data(), dx.data(), size);
+	for (size_t i = 0; i < size; i++) {
+		ASSERT_NEAR(y[i], y_ref[i], 4 * std::numeric_limits<eT>::epsilon() * (1 + std::fabs(y_ref[i]))) << "y at position " << i << " with level " << (int)level_;
+		ASSERT_NEAR(dx[i], dx_ref[i], 4 * std::numeric_limits<eT>::epsilon() * (1 + std::fabs(dx_ref[i]))) << "dx at position " << i << " with level " << (int)level_;
+	}//: for
+
+	// In place.
+	std::vector<eT> z = x_;
+	kernels::map<UnaryOp>(z.data(), z.data(), size);
+	for (size_t i = 0; i < size; i++)
+		ASSERT_EQ(z[i], y[i]) << "in place y at position " << i << " with level " << (int)level_;
+}
+
+/*!
+ * Checks whether kernels compiled for all instruction sets supported by the processor return the results of the scalar loops
+ * (for sizes not divisible by the vector length).
+ */
+template <typename eT>
+void checkAllLevels() {
+	size_t size = 1027;
+	std::vector<eT> x(size), dy(size);
+	for (size_t i = 0; i < size; i++) {
+		x[i] = (eT)(-20.0 + 40.0 * ((i * 7919) % size) / size);
+		dy[i] = (eT)(1.0 - 2.0 * ((i * 104729) % size) / size);
+	}//: for
+	x[0] = 0;
+
+	kernels::SimdLevel detected = kernels::detectSimdLevel();
+	for (short l = 0; l <= (short)detected; l++) {
+		kernels::SimdLevel level = (kernels::SimdLevel)l;
+		compareWithScalar<kernels::ReLUForward<eT>, kernels::ReLUBackward<eT> >(level, x, dy);
+		compareWithScalar<kernels::ELUForward<eT, false>, kernels::ELUBackward<eT> >(level, x, dy);
+		compareWithScalar<kernels::ELUForward<eT, true>, kernels::ELUBackward<eT> >(level, x, dy);
+		compareWithScalar<kernels::SigmoidForward<eT, false>, kernels::SigmoidBackward<eT> >(level, x, dy);
+		compareWithScalar<kernels::SigmoidForward<eT, true>, kernels::SigmoidBackward<eT> >(level, x, dy);
+	}//: for
+	kernels::setSimdLevel(detected);
+}
+
+TEST(ActivationKernels, AllLevelsFloat) {
+	checkAllLevels<float>();
+}
+
+TEST(ActivationKernels, AllLevelsDouble) {
+	checkAllLevels<double>();
+}
+
+/*!
+ * Compares gradients of the layer with respect to its inputs with the numerical ones.
+ */
+void checkInputGradient(mic::mlnn::Layer<double> & layer_) {
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 10, 3);
+	x->rand(-3.0, 3.0);
+	mic::types::MatrixPtr<double> target_y = MAKE_MATRIX_PTR(double, 10, 3);
+	target_y->rand(-1.0, 1.0);
+	mic::neural_nets::loss::SquaredErrorLoss<double> loss;
+	layer_.resizeBatch(3);
+
+	mic::types::MatrixPtr<double> dy = loss.calculateGradient(target_y, layer_.forward(x));
+	mic::types::MatrixPtr<double> dx = MAKE_MATRIX_PTR(double, *layer_.backward(dy));
+	mic::types::MatrixPtr<double> ndx = layer_.calculateNumericalGradient<mic::neural_nets::loss::SquaredErrorLoss<double> >(x, target_y, x, loss, 1e-5);
+	for (size_t i = 0; i < (size_t)dx->size(); i++)
+		ASSERT_NEAR((*dx)[i], (*ndx)[i], 1e-7) << "Difference between gradient and numerical gradient of " << layer_.name() << " at position " << i;
+}
+
+/*!
+ * Numerical gradient tests of the activation layers (derivative of ELU is calculated from its output).
+ */
+TEST(ActivationKernels, NumericalGradientCheck) {
+	ELU<double> elu(10);
+	checkInputGradient(elu);
+	ReLU<double> relu(10);
+	checkInputGradient(relu);
+	Sigmoid<double> sigmoid(10);
+	checkInputGradient(sigmoid);
+	sigmoid.setFastExp(true);
+	checkInputGradient(sigmoid);
+}
+
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
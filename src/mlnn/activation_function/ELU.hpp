@@ -24,6 +24,7 @@
 #define SRC_MLNN_ELU_HPP_
 
 #include <mlnn/layer/Layer.hpp>
+#include <mlnn/activation_function/ActivationKernels.hpp>
 
 namespace mic {
 namespace mlnn {
@@ -61,7 +62,8 @@ public:
 	ELU(size_t height_, size_t width_, size_t depth_, std::string name_ = "ELU") :
 		Layer<eT>::Layer(height_, width_, depth_,
 				height_, width_, depth_,
-				LayerTypes::ELU, name_)
+				LayerTypes::ELU, name_),
+				fast_exp(false)
 	{
 
 	}
@@ -73,31 +75,55 @@ public:
 
 	void forward(bool test = false) {
 		// Access the data of both matrices.
-		eT* x = s['x']->data();
-		eT* y = s['y']->data();
-
-		// Iterate through elements.
-		size_t size = (size_t) s['x']->rows() * s['x']->cols();
-		for (size_t i = 0; i < size;  i++) {
-			y[i] = x[i] > 0.0f ? x[i] : (expf(x[i]) - 1.0f);
-		}//: for
+		eT* x = s[hx]->data();
+		eT* y = s[hy]->data();
+
+		// Apply the vectorized kernel to all elements.
+		size_t size = (size_t) s[hx]->rows() * s[hx]->cols();
+		if (fast_exp)
+			kernels::map<kernels::ELUForward<eT, true> >(x, y, size);
+		else
+			kernels::map<kernels::ELUForward<eT, false> >(x, y, size);
+	}
+
+	/*!
+	 * Forward pass is elementwise, so it can be performed in place.
+	 */
+	virtual bool elementwiseForward() {
+		return true;
+	}
+
+	/*!
+	 * Backward pass calculates the derivative from the output, so the input is not needed.
+	 */
+	virtual bool backwardUsesInput() {
+		return false;
 	}
 
 	void backward() {
 		// Access the data of matrices.
-		eT* gx = g['x']->data();
-		eT* gy = g['y']->data();
-		eT* y = s['y']->data();
-
-		// Iterate through elements.
-		size_t size = (size_t) g['x']->rows() * g['x']->cols();
-		for (size_t i = 0; i < size;  i++) {
-			// Calculate the ELU y derivative.
-			eT dy = y[i] > 0.0f ? 1.0f : exp(y[i]);
-			// Pass the gradient.
-			gx[i] = dy * gy[i];
-
-		}//: for
+		eT* gx = g[hx]->data();
+		eT* gy = g[hy]->data();
+		eT* y = s[hy]->data();
+
+		// Pass the gradient multiplied by the ELU derivative (calculated from y, as exp(x) = y + 1 for negative x).
+		size_t size = (size_t) g[hx]->rows() * g[hx]->cols();
+		kernels::map<kernels::ELUBackward<eT> >(y, gy, gx, size);
+	}
+
+	/*!
+	 * Sets whether the forward pass uses the polynomial approximation of exp (relative error below 1e-6 in single precision) instead of the exact one.
+	 * @param fast_exp_ Flag denoting whether the approximation is used.
+	 */
+	void setFastExp(bool fast_exp_) {
+		fast_exp = fast_exp_;
+	}
+
+	/*!
+	 * Returns true if the forward pass uses the approximation of exp.
+	 */
+	bool getFastExp() {
+		return fast_exp;
 	}
 
 	/*!
@@ -111,15 +137,33 @@ protected:
 	// Unhiding the template inherited fields via "using" statement.
     using Layer<eT>::g;
     using Layer<eT>::s;
+    using Layer<eT>::hx;
+    using Layer<eT>::hy;
+
+	/// Flag denoting whether the forward pass uses the approximation of exp.
+	bool fast_exp;
 
 private:
 	// Friend class - required for using boost serialization.
 	template<typename tmp> friend class mic::mlnn::MultiLayerNeuralNetwork;
 
+	/*!
+	 * Serializes the parameters specific to the layer type (not stored by Layer::serialize).
+	 * @param ar Used archive.
+	 * @param version_ Version of the configuration (the flag is not present in older versions - the exact exp was used).
+	 */
+	template<class Archive>
+	void serializeConfiguration(Archive & ar, const unsigned int version_) {
+		if (version_ >= 5)
+			ar & fast_exp;
+		else
+			fast_exp = false;
+	}
+
 	/*!
 	 * Private constructor, used only during the serialization.
 	 */
-	ELU<eT>() : Layer<eT> () { }
+	ELU<eT>() : Layer<eT> (), fast_exp(false) { }
 
 };
 
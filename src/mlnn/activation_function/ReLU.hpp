@@ -24,6 +24,7 @@
 #define SRC_MLNN_RELU_HPP_
 
 #include <mlnn/layer/Layer.hpp>
+#include <mlnn/activation_function/ActivationKernels.hpp>
 
 namespace mic {
 namespace mlnn {
@@ -45,7 +46,7 @@ public:
 	ReLU(size_t size_, std::string name_ = "ReLU") :
 		ReLU(size_, 1, 1, name_)
 	{
-		std::cout<<"constructor ReLU 1!\n";
+
 	}
 
 
@@ -71,34 +72,40 @@ public:
 
 	void forward(bool apply_dropout = false) {
 		// Access the data of both matrices.
-		eT* x = s['x']->data();
-		eT* y = s['y']->data();
+		eT* x = s[hx]->data();
+		eT* y = s[hy]->data();
 
-		// Iterate through elements.
-		size_t size = s['x']->rows() * s['x']->cols();
-		for (size_t i = 0; i < size;  i++) {
-			y[i] = fmax(x[i], 0.0f); //: floats - fmax
-		}//: for
+		// Apply the vectorized kernel to all elements.
+		size_t size = s[hx]->rows() * s[hx]->cols();
+		kernels::map<kernels::ReLUForward<eT> >(x, y, size);
 
 /*		std::cout << "ReLU forward: s['x'] = \n" << (*s['x']) << std::endl;
 		std::cout << "ReLU forward: s['y'] = \n" << (*s['y']) << std::endl;*/
 	}
 
+	/*!
+	 * Forward pass is elementwise, so it can be performed in place.
+	 */
+	virtual bool elementwiseForward() {
+		return true;
+	}
+
+	/*!
+	 * Backward pass calculates the derivative from the output, so the input is not needed.
+	 */
+	virtual bool backwardUsesInput() {
+		return false;
+	}
+
 	void backward() {
 		// Access the data of matrices.
-		eT* gx = g['x']->data();
-		eT* gy = g['y']->data();
-		eT* y = s['y']->data();
-
-		// Iterate through elements.
-		size_t size = g['x']->rows() * g['x']->cols();
-		for (size_t i = 0; i < size; i++) {
-			// Calculate the ReLU "derivative".
-			eT dy = (eT)(y[i] > 0.0);
-			// Pass the gradient.
-			gx[i] = dy * gy[i];
+		eT* gx = g[hx]->data();
+		eT* gy = g[hy]->data();
+		eT* y = s[hy]->data();
 
-		}//: for
+		// Pass the gradient where the ReLU "derivative" is 1.
+		size_t size = g[hx]->rows() * g[hx]->cols();
+		kernels::map<kernels::ReLUBackward<eT> >(y, gy, gx, size);
 
 /*		std::cout << "ReLU backward: g['y'] = \n" << (*g['y']) << std::endl;
 		std::cout << "ReLU backward: g['x'] = \n" << (*g['x']) << std::endl;*/
@@ -115,6 +122,8 @@ protected:
 	// Unhiding the template inherited fields via "using" statement.
     using Layer<eT>::g;
     using Layer<eT>::s;
+    using Layer<eT>::hx;
+    using Layer<eT>::hy;
 
 private:
 	// Friend class - required for using boost serialization.
@@ -123,7 +132,7 @@ private:
 	/*!
 	 * Private constructor, used only during the serialization.
 	 */
-	ReLU<eT>() : Layer<eT> () { std::cout << "Private ReLU\n";}
+	ReLU<eT>() : Layer<eT> () { }
 
 };
 
@@ -24,6 +24,7 @@
 #define SRC_MLNN_SIGMOID_HPP_
 
 #include <mlnn/layer/Layer.hpp>
+#include <mlnn/activation_function/ActivationKernels.hpp>
 
 namespace mic {
 namespace mlnn {
@@ -59,7 +60,8 @@ public:
 			std::string name_ = "Sigmoid") :
 		Layer<eT>::Layer(height_, width_, depth_,
 				height_, width_, depth_,
-				LayerTypes::Sigmoid, name_)
+				LayerTypes::Sigmoid, name_),
+				fast_exp(false)
 	{
 
 	}
@@ -71,24 +73,54 @@ public:
 
 	void forward(bool test = false) {
 		// Access the data of both matrices.
-		eT* x = s['x']->data();
-		eT* y = s['y']->data();
+		eT* x = s[hx]->data();
+		eT* y = s[hy]->data();
+
+		// Apply the vectorized kernel to all elements.
+		size_t size = (size_t)s[hx]->rows() * s[hx]->cols();
+		if (fast_exp)
+			kernels::map<kernels::SigmoidForward<eT, true> >(x, y, size);
+		else
+			kernels::map<kernels::SigmoidForward<eT, false> >(x, y, size);
+	}
 
-		for (size_t i = 0; i < (size_t)s['x']->rows() * s['x']->cols(); i++) {
-			y[i] = 1.0f / (1.0f +::exp(-x[i])); //: float -> expf
-		}//: for
+	/*!
+	 * Forward pass is elementwise, so it can be performed in place.
+	 */
+	virtual bool elementwiseForward() {
+		return true;
+	}
+
+	/*!
+	 * Backward pass calculates the derivative from the output, so the input is not needed.
+	 */
+	virtual bool backwardUsesInput() {
+		return false;
 	}
 
 	void backward() {
 		// Access the data of matrices.
-		eT* gx = g['x']->data();
-		eT* gy = g['y']->data();
-		eT* y = s['y']->data();
-
-		for (size_t i = 0; i < (size_t)g['x']->rows() * g['x']->cols(); i++) {
-			// "Pass" the gradient multiplied by the sigmoid derivative.
-			gx[i] = gy[i]* (y[i] * (1.0 - y[i]));
-		}//: for
+		eT* gx = g[hx]->data();
+		eT* gy = g[hy]->data();
+		eT* y = s[hy]->data();
+
+		// "Pass" the gradient multiplied by the sigmoid derivative.
+		kernels::map<kernels::SigmoidBackward<eT> >(y, gy, gx, (size_t)g[hx]->rows() * g[hx]->cols());
+	}
+
+	/*!
+	 * Sets whether the forward pass uses the polynomial approximation of exp (relative error below 1e-6 in single precision) instead of the exact one.
+	 * @param fast_exp_ Flag denoting whether the approximation is used.
+	 */
+	void setFastExp(bool fast_exp_) {
+		fast_exp = fast_exp_;
+	}
+
+	/*!
+	 * Returns true if the forward pass uses the approximation of exp.
+	 */
+	bool getFastExp() {
+		return fast_exp;
 	}
 
 	/*!
@@ -102,15 +134,33 @@ protected:
 	// Unhiding the template inherited fields via "using" statement.
     using Layer<eT>::g;
     using Layer<eT>::s;
+    using Layer<eT>::hx;
+    using Layer<eT>::hy;
+
+	/// Flag denoting whether the forward pass uses the approximation of exp.
+	bool fast_exp;
 
 private:
 	// Friend class - required for using boost serialization.
 	template<typename tmp> friend class mic::mlnn::MultiLayerNeuralNetwork;
 
+	/*!
+	 * Serializes the parameters specific to the layer type (not stored by Layer::serialize).
+	 * @param ar Used archive.
+	 * @param version_ Version of the configuration (the flag is not present in older versions - the exact exp was used).
+	 */
+	template<class Archive>
+	void serializeConfiguration(Archive & ar, const unsigned int version_) {
+		if (version_ >= 5)
+			ar & fast_exp;
+		else
+			fast_exp = false;
+	}
+
 	/*!
 	 * Private constructor, used only during the serialization.
 	 */
-	Sigmoid<eT>() : Layer<eT> () { }
+	Sigmoid<eT>() : Layer<eT> (), fast_exp(false) { }
 
 
 };
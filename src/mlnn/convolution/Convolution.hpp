@@ -28,10 +28,27 @@
 #include<types/MatrixTypes.hpp>
 #include<types/MatrixArray.hpp>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace mic {
 namespace mlnn {
 namespace convolution {
 
+/*!
+ * \brief Enumeration of engines (computational paths) that can be used by the convolution layer.
+ * \author tkornuta
+ */
+enum class ConvolutionEngine : short
+{
+	Direct = 0, ///< Direct convolution - iterates over receptive fields, computing a dot product per output pixel, filter and input channel.
+	Im2Col, ///< Lowers the whole batch into a single matrix of receptive fields (im2col) and computes the result with a single GEMM.
+	Winograd, ///< Winograd minimal filtering F(2x2,3x3) for 3x3 filters with stride 1 (forward and dx), im2col in all other cases.
+	Auto ///< Winograd for 3x3 filters with stride 1 connecting enough channels for the transforms to pay off, im2col in all other cases.
+};
+
+
 /*!
  * \brief Class representing a convolution layer, with "valid padding" and variable stride.
  * \author tkornuta
@@ -41,6 +58,12 @@ template <typename eT=float>
 class Convolution : public mic::mlnn::Layer<eT> {
 public:
 
+	/// Zero-copy view of a single filter slice (i.e. part of a given filter responding to a given input channel) - a row vector of length filter_size*filter_size.
+	typedef Eigen::Map<Eigen::Matrix<eT, 1, Eigen::Dynamic> > FilterSlice;
+
+	/// Zero-copy view of a single filter slice as a filter_size x filter_size matrix.
+	typedef Eigen::Map<Eigen::Matrix<eT, Eigen::Dynamic, Eigen::Dynamic> > FilterMatrix;
+
 	/*!
 	 * Creates a convolutional layer.
 	 * @param input_height_ Height of the input / rows (e.g. 28 for MNIST).
@@ -57,7 +80,9 @@ public:
 				1, 1, number_of_filters_,
 				LayerTypes::Convolution, name_),
 				filter_size(filter_size_),
-				stride(stride_)
+				stride(stride_),
+				engine(ConvolutionEngine::Auto),
+				winograd_transforms_valid(false)
 	{
 		// Calculate number of receptive fields within a "single input channel".
 		assert(input_height >= filter_size);
@@ -91,10 +116,10 @@ public:
 		LOG(LDEBUG)<<streamLayerParameters();
 
 		// Set output height and resize matrices!
-		s["y"]->resize(Layer<eT>::outputSize(), batch_size); 	// outputs
-		g["y"]->resize(Layer<eT>::outputSize(), batch_size); 	// gradients
-		m["ys"]->resize(Layer<eT>::outputSize(), 1);			// sample
-		m["yc"]->resize(output_width*output_height, 1);			// channel
+		s[hy]->resize(Layer<eT>::outputSize(), batch_size); 	// outputs
+		g[hy]->resize(Layer<eT>::outputSize(), batch_size); 	// gradients
+		m[hys]->resize(Layer<eT>::outputSize(), 1);			// sample
+		m[hyc]->resize(output_width*output_height, 1);			// channel
 
 
 		// Calculate "range" - for initialization.
@@ -102,21 +127,14 @@ public:
 				(output_width * output_height * output_depth);
 		eT range = sqrt(6.0 / range_init);
 
-		// Create filters.
-		for (size_t fi=0; fi< output_depth; fi++) {
-			// A given filter (neuron layer) has in fact connection to all input channels.
-			for (size_t ic=0; ic< input_depth; ic++) {
-				// Create the weights matrix - a row vector.
-				p.add ("W"+std::to_string(fi)+"x"+std::to_string(ic), 1, filter_size*filter_size);
-				// Initialize weights of the W matrix.
-				p["W"+std::to_string(fi)+"x"+std::to_string(ic)]->rand(-range, range);
-				//std::cout<<"W.dims = " << p["W"+std::to_string(fi)+std::to_string(ic)]->rows() << "," << p["W"+std::to_string(fi)+std::to_string(ic)]->cols() << "\n";
+		// Create filters - a single contiguous [filters x channels x filter_size x filter_size] tensor,
+		// stored as a matrix with one filter (connected to all input channels) per column.
+		p.add ("W", input_depth*filter_size*filter_size, output_depth);
+		// Initialize weights of the W matrix.
+		p["W"]->rand(-range, range);
 
-				// Create the weights matrix for updates/gradients.
-				g.add ("W"+std::to_string(fi)+"x"+std::to_string(ic), 1, filter_size*filter_size);
-			}//: for input channels.
-
-		}//: for filter
+		// Create the weights matrix for updates/gradients.
+		g.add ("W", input_depth*filter_size*filter_size, output_depth);
 
 		// Create a single bias vector for all filters.
 		p.add ("b", output_depth, 1);
@@ -124,33 +142,21 @@ public:
 		// Bias gradient.
 		g.add ("b", output_depth, 1);
 
-		// Allocate (temporary) memory for "input receptive fields".
-		for (size_t ry=0; ry< output_height; ry++) {
-			for (size_t rx=0; rx< output_width; rx++) {
-				// Create receptive field matrix.
-				m.add ("xrf"+std::to_string(ry)+"x"+std::to_string(rx), filter_size, filter_size);
-			}//: for
-		}//: for
-
-		// Allocate (temporary) memory for "output channels" - matrices.
-		for (size_t fi=0; fi< output_depth; fi++) {
-			// Create output channel matrix.
-			m.add ("yc"+std::to_string(fi), output_height, output_width);
-		}//: for
-
-		// Allocate (temporary) memory for "inverse input receptive fields" - used in backpropagation.
-		for (size_t ry=0; ry< filter_size; ry++) {
-			for (size_t rx=0; rx< filter_size; rx++) {
-				// Create receptive field matrix.
-				m.add ("ixrf"+std::to_string(ry)+"x"+std::to_string(rx), output_height, output_width);
-			}//: for
-		}//: for
-
 		// Allocate memory for "filter similarity".
 		m.add ("fs", input_depth*output_depth, input_depth*output_depth);
 
+		// Allocate memory used by the im2col engine: lowered receptive fields of the whole batch (one row per receptive field)...
+		m.add ("xcol", batch_size*output_height*output_width, input_depth*filter_size*filter_size);
+		// ... their gradients...
+		m.add ("dxcol", batch_size*output_height*output_width, input_depth*filter_size*filter_size);
+		// ... and lowered outputs/output gradients (one column per filter).
+		m.add ("ycol", batch_size*output_height*output_width, output_depth);
+
 		// Set gradient descent as default optimization function.
 		Layer<eT>::template setOptimization<mic::neural_nets::optimization::GradientDescent<eT> > ();
+
+		// Resolve handles of all matrices.
+		Convolution<eT>::resolveHandles();
 	};
 
 	/*!
@@ -175,135 +181,246 @@ public:
 		os_<<"    * stride = " << stride <<std::endl;
 		os_<<"    * output_height = " << output_height <<std::endl;
 		os_<<"    * output_width = " << output_width <<std::endl;
-		os_<<"    * output_channels = " << output_depth;
+		os_<<"    * output_channels = " << output_depth <<std::endl;
+		os_<<"    * engine = " << (engine == ConvolutionEngine::Direct ? "direct" : (useWinograd() ? "winograd" : "im2col"));
 
 		return os_.str();
 	}
 
+	/*!
+	 * Sets the engine used in forward and backward passes.
+	 * @param engine_ Engine to be used.
+	 */
+	void setEngine(ConvolutionEngine engine_) {
+		engine = engine_;
+	}
+
+	/*!
+	 * Returns the engine used in forward and backward passes.
+	 */
+	ConvolutionEngine getEngine() {
+		return engine;
+	}
+
+	/*!
+	 * Returns true if forward pass and back-propagation to dx will be computed with the Winograd F(2x2,3x3) algorithm,
+	 * i.e. if the layer has 3x3 filters with stride 1 and the Winograd engine is selected (or the Auto engine and there are at least winograd_min_channels input and output channels).
+	 */
+	bool useWinograd() {
+		if ((filter_size != 3) || (stride != 1))
+			return false;
+		if (engine == ConvolutionEngine::Winograd)
+			return true;
+		return (engine == ConvolutionEngine::Auto) && (input_depth >= winograd_min_channels) && (output_depth >= winograd_min_channels);
+	}
+
+	/*!
+	 * Invalidates the cached filter transforms - called after every update of the parameters.
+	 */
+	virtual void invalidateParameterCaches() {
+		winograd_transforms_valid = false;
+	}
+
+	/*!
+	 * Returns a zero-copy view of a given filter slice (i.e. the part of a given filter responding to a given input channel).
+	 * @param fi_ Filter (output channel) index.
+	 * @param ic_ Input channel index.
+	 */
+	FilterSlice getFilterSlice(size_t fi_, size_t ic_) {
+		return FilterSlice(p[hW]->data() + (fi_*input_depth + ic_)*filter_size*filter_size, filter_size*filter_size);
+	}
+
+	/*!
+	 * Returns a zero-copy view of the gradient of a given filter slice.
+	 * @param fi_ Filter (output channel) index.
+	 * @param ic_ Input channel index.
+	 */
+	FilterSlice getFilterGradientSlice(size_t fi_, size_t ic_) {
+		return FilterSlice(g[hdW]->data() + (fi_*input_depth + ic_)*filter_size*filter_size, filter_size*filter_size);
+	}
+
+	/*!
+	 * Repacks parameters of models saved in the old format (with every filter slice stored as a separate "W{fi}x{ic}" matrix)
+	 * into the packed filter tensor. Restores filter size and stride from dimensions of the deserialized matrices.
+	 */
+	void repackLegacyFilters() {
+		// Restore filter size and stride.
+		if (p.keyExists("W0x0"))
+			filter_size = (size_t)round(sqrt((eT)p["W0x0"]->size()));
+		else if (p.keyExists("W") && (input_depth > 0))
+			filter_size = (size_t)round(sqrt((eT)p["W"]->rows() / input_depth));
+		stride = (output_height > 1) ? (input_height - filter_size) / (output_height - 1) : 1;
+
+		// Models saved before introduction of the im2col engine lack its matrices.
+		if (!m.keyExists("xcol")) {
+			m.add ("xcol", batch_size*output_height*output_width, input_depth*filter_size*filter_size);
+			m.add ("dxcol", batch_size*output_height*output_width, input_depth*filter_size*filter_size);
+			m.add ("ycol", batch_size*output_height*output_width, output_depth);
+		}//: if
+
+		// Nothing more to do with models in the current format - apart from resolving handles using the restored filter size.
+		if (!p.keyExists("W0x0")) {
+			Convolution<eT>::resolveHandles();
+			return;
+		}
+		LOG(LINFO) << "Repacking filters of layer " << Layer<eT>::layer_name << " into a single filter tensor";
+
+		size_t filter_length = filter_size*filter_size;
+		mic::types::MatrixPtr<eT> W = MAKE_MATRIX_PTR(eT, input_depth*filter_length, output_depth);
+		for (size_t fi=0; fi< output_depth; fi++) {
+			for (size_t ic=0; ic< input_depth; ic++) {
+				mic::types::MatrixPtr<eT> Wfc = p["W"+std::to_string(fi)+"x"+std::to_string(ic)];
+				W->block(ic*filter_length, fi, filter_length, 1) = Eigen::Map<Eigen::Matrix<eT, Eigen::Dynamic, 1> >(Wfc->data(), filter_length);
+			}//: for channels
+		}//: for filters
+
+		// Recreate parameters and their gradients.
+		mic::types::MatrixPtr<eT> b = p["b"];
+		p = mic::types::MatrixArray<eT>("parameters");
+		p.add("W", W);
+		p.add("b", b);
+		g = mic::types::MatrixArray<eT>("gradients");
+		g.add("x", input_depth*input_height*input_width, batch_size);
+		g.add("y", output_depth*output_height*output_width, batch_size);
+		g.add("W", input_depth*filter_length, output_depth);
+		g.add("b", output_depth, 1);
+
+		// Recreate optimization functions - one per parameter matrix.
+		Layer<eT>::template setOptimization<mic::neural_nets::optimization::GradientDescent<eT> > ();
+		invalidateParameterCaches();
+
+		// Resolve handles of the recreated matrices.
+		Convolution<eT>::resolveHandles();
+	}
+
 	/*!
 	 * Performs forward pass through the filters. Can process batches.
 	 */
 	void forward(bool test = false) {
-//		std::cout << "forward()\n";
-		// Get input matrix.
-		mic::types::MatrixPtr<eT> batch_x = s['x'];
-		//std::cout<< "forward batch_x=\n" << (*batch) << std::endl;
-		//std::cout << "forward input x activation: min:" << (*batch_x).minCoeff() <<" max: " << (*batch_x).maxCoeff() << std::endl;
+		if (engine == ConvolutionEngine::Direct)
+			forwardDirect();
+		else if (useWinograd())
+			forwardWinograd();
+		else
+			forwardIm2Col();
+	}
+
+	/*!
+	 * Performs forward pass using the Winograd F(2x2,3x3) minimal filtering algorithm.
+	 */
+	void forwardWinograd() {
+		prepareWinogradTransforms();
+		winogradCorrelate(s[hx], input_depth, input_height, input_width, 0, winograd_U, s[hy], output_depth, output_height, output_width, p[hb]->data());
+	}
+
+	/*!
+	 * Performs forward pass by lowering the batch into a matrix of receptive fields and multiplying it by the packed filter matrix.
+	 */
+	void forwardIm2Col() {
+		// Get matrices.
+		mic::types::MatrixPtr<eT> batch_x = s[hx];
+		mic::types::MatrixPtr<eT> batch_y = s[hy];
+		mic::types::MatrixPtr<eT> b = p[hb];
+		mic::types::MatrixPtr<eT> W = p[hW];
 
-		// Get output pointer - so the results will be stored!
-		mic::types::MatrixPtr<eT> batch_y = s['y'];
-		batch_y->setZero();
+		size_t output_channel_size = output_height*output_width;
+		size_t rows = batch_size*output_channel_size;
+
+		// Lower the batch - one receptive field per row (kept for the backward pass).
+		m[hxcol]->resize(rows, input_depth*filter_size*filter_size);
+		ScratchMatrix xcol(m[hxcol]->data(), rows, input_depth*filter_size*filter_size);
+		im2col(batch_x, xcol);
+
+		// Convolve all receptive fields of all samples with all filters at once.
+		ScratchMatrix ycol = scratchMatrix(hycol, rows, output_depth, 0);
+		ycol.noalias() = xcol * (*W);
+
+		// Rearrange the results into output batch and add biases.
+#pragma omp parallel for schedule(static)
+		for (size_t ib=0; ib< batch_size; ib++) {
+			for (size_t fi=0; fi< output_depth; fi++) {
+				batch_y->block(fi*output_channel_size, ib, output_channel_size, 1) =
+						ycol.block(ib*output_channel_size, fi, output_channel_size, 1).array() + (*b)[fi];
+			}//: for filters
+		}//: for batch
+	}
+
+	/*!
+	 * Performs forward pass through the filters, iterating through the receptive fields.
+	 * Samples are processed in parallel, every thread using its own workspace.
+	 */
+	void forwardDirect() {
+		// Get matrices.
+		mic::types::MatrixPtr<eT> batch_x = s[hx];
+		mic::types::MatrixPtr<eT> batch_y = s[hy];
+		mic::types::MatrixPtr<eT> b = p[hb];
+
+		size_t output_channel_size = output_height*output_width;
+		size_t input_channel_size = input_height*input_width;
+
+		prepareWorkspaces();
 
 		// Iterate through samples in the input batch.
-//#pragma omp parallel for
+#pragma omp parallel for schedule(static)
 		for (size_t ib=0; ib< batch_size; ib++) {
+			Workspace & ws = workspaces[threadId()];
 
-			// The "output sample" that will "concatenate" the output channels into one "column vector".
-			mic::types::MatrixPtr<eT> y_sample = m["ys"];
+			// 1. "Reset" output channels of a given sample, i.e. set value of all cells to bias (so we can skip adding it later).
+			for (size_t fi=0; fi< output_depth; fi++)
+				batch_y->block(fi*output_channel_size, ib, output_channel_size, 1).setConstant((*b)[fi]);
 
-			// 1. "Reset" output "channels".
-			for (size_t fi=0; fi< output_depth; fi++) {
-				// Get output channel matrix.
-				mic::types::MatrixPtr<eT> y_channel = m["yc"+std::to_string(fi)];
-				// Resize it to a matrix (!).
-				y_channel->resize(output_height, output_width);
-				// And "reset" i.e. set value of all cells to bias (so we can skip adding it later).
-				y_channel->setValue((*p["b"])[fi]);
-			}//: filters
-
-			// 2. Get input sample from batch!
-			mic::types::MatrixPtr<eT> sample = m["xs"];
-			(*sample) = batch_x->col(ib);
-			//std::cout<< "sample=\n" << (*sample) << std::endl;
-
-			// 3. Iterate through input channels.
+			// 2. Iterate through input channels.
 			for (size_t ic=0; ic< input_depth; ic++) {
-				// 3.1. Get input channel from image.
-				mic::types::MatrixPtr<eT> ichannel = m["xc"];
-				// Copy block - resizes the input channel matrix.
-				(*ichannel) = sample->block(ic*input_height*input_width, 0, input_height*input_width, 1);
-				// Resize channel using the given dimensions.
-				ichannel->resize(input_height, input_width);
-				//std::cout<< "======  switching input channel = " << ic <<" ichannel=\n" << (*ichannel) << std::endl;
-
-				// 3.2. Fill receptive fields from given input channel.
-				// Iterate through receptive fields - vertical and horizontal
-				// and copy data from given channel to array of "input receptive fields".
+				// 2.1. Get input channel of a given sample.
+				ChannelMatrix xc(batch_x->data() + ib*batch_x->rows() + ic*input_channel_size, input_height, input_width);
+
+				// 2.2. Fill receptive fields from given input channel - one column per receptive field, ordered as outputs.
 				// Image coordinates: ix, iy.
 				// Receptive field "id" coordinates: rx, ry.
-				for (size_t ry=0, iy = 0; ry< output_height; ry++, iy+=stride) {
-					for (size_t rx=0, ix = 0; rx< output_width; rx++, ix+=stride) {
-						//std::cout<<"ry =" << ry <<" rx =" << rx <<" iy =" << iy <<" ix =" << ix << std::endl;
-						// Get receptive field matrix...
-						mic::types::MatrixPtr<eT> field = m["xrf"+std::to_string(ry)+"x"+std::to_string(rx)];
-						// Copy block from channel - resizes the field matrix.
-						(*field) = ichannel->block(iy,ix,filter_size, filter_size);
-						//std::cout<< "field=\n" << (*field) << std::endl;
-						// Resize the field to a column vector.
-						field->resize(filter_size*filter_size, 1);
-					}//: for rx
-				}//: for ry
-
-				// 3.3. Convolve receptive fields with filters.
-
-				// Iterate through filters and calculate the result of the convolution.
-				for (size_t fi=0; fi< output_depth; fi++) {
-					// Get output channel for a given filter.
-					mic::types::MatrixPtr<eT> y_channel = m["yc"+std::to_string(fi)];
-					// Resize to matrix.
-					y_channel->resize(output_height, output_width);
-					//std::cout << "====  switching to oc " << fi << " = \n" << (*y_channel)<<std::endl;
-					// Get "part of a given neuron" responding to a given input channel.
-					mic::types::MatrixPtr<eT> W = p["W"+std::to_string(fi)+"x"+std::to_string(ic)];
-					// Not required - just in case. :]
-					W->resize(1,filter_size*filter_size);
-					// Iterate through receptive fields.
-					for (size_t ry=0; ry< output_height; ry++) {
-						for (size_t rx=0; rx< output_width; rx++) {
-							// Get receptive field matrix of size (1, filter_size^2)...
-							mic::types::MatrixPtr<eT> xrf = m["xrf"+std::to_string(ry)+"x"+std::to_string(rx)];
-							// ... and result of "convolution" of that filter with the part of the input "below" the receptive field.
-							/*std::cout<<"ic = " << ic  << " filter = " << fi << " ry =" << ry <<" rx =" << rx <<std::endl;
-							std::cout<< "W=\n" << (*W) << std::endl;
-							std::cout<< "xrf=\n" << (*xrf) << std::endl;
-							std::cout<< " result = " << ((*W)*(*xrf)) << std::endl;*/
-							(*y_channel)(ry, rx) += ((*W)*(*xrf))(0);
-						}//: for rx
+				for (size_t rx=0, ix = 0; rx< output_width; rx++, ix+=stride) {
+					for (size_t ry=0, iy = 0; ry< output_height; ry++, iy+=stride) {
+						ChannelMatrix field(ws.xrf.col(rx*output_height + ry).data(), filter_size, filter_size);
+						field = xc.block(iy, ix, filter_size, filter_size);
 					}//: for ry
-					//std::cout << "====  ic = " << ic << " filter= " << fi << " oc = \n" << (*y_channel)<<std::endl;
+				}//: for rx
 
-					// Resize output channel to a column vector.
-					y_channel->resize(output_height*output_width, 1);
-					// Concatenate.
-					y_sample->block(fi*output_height*output_width, 0, output_height*output_width, 1)
-							= (*y_channel);
+				// 2.3. Convolve receptive fields with filters - "part of a given neuron" responding to a given input channel.
+				for (size_t fi=0; fi< output_depth; fi++) {
+					FilterSlice yc(batch_y->data() + ib*batch_y->rows() + fi*output_channel_size, output_channel_size);
+					yc.noalias() += getFilterSlice(fi, ic) * ws.xrf;
 				}//: for filters
-
 			}//: for channels
-			//std::cout <<"output before adding y =" << (*y) <<std::endl;
-			// Set column in the output batch.
-			batch_y->col(ib) = (*y_sample);
-
 		}//: for batch
-
-		//std::cout <<"output y =" << (*batch_y).transpose() <<std::endl;
-		//std::cout << "forward output y activation: min:" << (*batch_y).minCoeff() <<" max: " << (*batch_y).maxCoeff() << std::endl;
 	}//: forward
 
 	/*!
 	 * Back-propagates the gradients through the layer.
 	 */
 	void backward() {
-		mic::types::MatrixPtr<eT> batch_dy = g['y'];
+		mic::types::MatrixPtr<eT> batch_dy = g[hy];
 		//std::cout << "backward gradient dy: min:" << (*batch_dy).minCoeff() <<" max: " << (*batch_dy).maxCoeff() << std::endl;
 
-		//std::cout<<"backpropagade_dy_to_dx!\n";
-		// To dx.
-		backpropagade_dy_to_dx();
+		if (engine == ConvolutionEngine::Direct) {
+			//std::cout<<"backpropagade_dy_to_dx!\n";
+			// To dx.
+			backpropagade_dy_to_dx_direct();
+
+			//std::cout<<"backpropagade_dy_to_dW!\n";
+			// To dW.
+			backpropagade_dy_to_dW_direct();
+		} else {
+			// Lower dy once - used by both dx (im2col) and dW.
+			ScratchMatrix ycol = lowerOutputGradients();
 
-		//std::cout<<"backpropagade_dy_to_dW!\n";
-		// To dW.
-		backpropagade_dy_to_dW();
+			// To dx.
+			if (useWinograd())
+				backpropagade_dy_to_dx_winograd();
+			else
+				backpropagade_dy_to_dx_im2col(ycol);
+
+			// To dW.
+			backpropagade_dy_to_dW_im2col(ycol);
+		}//: else
 
 		//std::cout<<"backpropagade_dy_to_db!\n";
 		// To db.
@@ -333,221 +450,167 @@ public:
 	 * Back-propagates the gradients from dy to dx.
 	 */
 	void backpropagade_dy_to_dx() {
-		// Get matrices.
-		mic::types::MatrixPtr<eT> batch_dy = g['y'];
-		mic::types::MatrixPtr<eT> batch_x = s['x'];
-		//std::cout<< "backpropagate to dx batch_x=\n" << (*batch_x) << std::endl;
-		// Get output pointers - so the results will be stored!
-		mic::types::MatrixPtr<eT> batch_dx = g['x'];
-
-		// Backpropagate gradient from dy to dx.
+		if (engine == ConvolutionEngine::Direct)
+			backpropagade_dy_to_dx_direct();
+		else if (useWinograd())
+			backpropagade_dy_to_dx_winograd();
+		else
+			backpropagade_dy_to_dx_im2col(lowerOutputGradients());
+	}
 
+	/*!
+	 * Back-propagates the gradients from dy to dx using the Winograd F(2x2,3x3) algorithm - "full" correlation of dy with filters rotated by 180 degrees.
+	 */
+	void backpropagade_dy_to_dx_winograd() {
+		prepareWinogradTransforms();
+		winogradCorrelate(g[hy], output_depth, output_height, output_width, 2, winograd_dU, g[hx], input_depth, input_height, input_width, nullptr);
+	}
 
-		// Calculate dx for a given batch of dy gradients.
-		// Iterate through samples in the input batch.
-//#pragma omp parallel for
-		for (size_t ib=0; ib< batch_size; ib++) {
+	/*!
+	 * Back-propagates the gradients from dy to dx - multiplies lowered dy by transposed packed filters and accumulates the result back into dx (col2im).
+	 * @param ycol_ Lowered dy (see lowerOutputGradients()).
+	 */
+	void backpropagade_dy_to_dx_im2col(typename Layer<eT>::ScratchMatrix ycol_) {
+		// Get matrices.
+		mic::types::MatrixPtr<eT> batch_dx = g[hx];
+		mic::types::MatrixPtr<eT> W = p[hW];
+		size_t rows = batch_size*output_height*output_width;
+		ScratchMatrix dxcol = scratchMatrix(hdxcol, rows, input_depth*filter_size*filter_size, rows*output_depth);
 
-			// Get y gradient sample from batch.
-			mic::types::MatrixPtr<eT> gys = m["ys"];
-			(*gys) = batch_dy->col(ib);
+		// Gradients of all receptive fields of all samples.
+		dxcol.noalias() = ycol_ * W->transpose();
 
-			/*///////////////////////
-			// Get gradient y channel.
-			mic::types::MatrixPtr<eT> gyc = m["yc"];
-			for (size_t fi=0; fi< number_of_filters; fi++) {
-				(*gyc) = gys->block(fi*output_height*output_width, 0, output_height*output_width, 1);
-				(*gyc).resize(output_height, output_width);
-				std::cout<< "============  dy channel = " << fi << "(*gyc) = \n" << (*gyc) << std::endl;
-			}// to remove*/
+		// Accumulate gradients of receptive fields in dx.
+		col2im(dxcol, batch_dx);
+	}
 
+	/*!
+	 * Back-propagates the gradients from dy to dx, iterating through the "stride blocks".
+	 * Samples are processed in parallel - every sample writes to its own column of dx.
+	 */
+	void backpropagade_dy_to_dx_direct() {
+		// Get matrices.
+		mic::types::MatrixPtr<eT> batch_dy = g[hy];
+		mic::types::MatrixPtr<eT> batch_dx = g[hx];
 
-			// Get pointer to x gradient sample matrix.
-			mic::types::MatrixPtr<eT> gxs = m["xs"];
-			gxs->setZero();
+		size_t output_channel_size = output_height*output_width;
+		size_t input_channel_size = input_height*input_width;
 
-			// Convolve reWs with sample channel by channel.
+		// Iterate through samples in the input batch.
+#pragma omp parallel for schedule(static)
+		for (size_t ib=0; ib< batch_size; ib++) {
+			// Iterate through input channels.
 			for (size_t ic=0; ic< input_depth; ic++) {
-				//std::cout<< "======  switching input channel = " << ic << std::endl;
-
-				// Get pointer to x gradient channel "storage".
-				mic::types::MatrixPtr<eT> gxc = m["xc"];
-				// Clean it up!
-				gxc->setZero();
-				// Resize just in case.
-				gxc->resize(input_height, input_width);
-
+				// Get x gradient channel of a given sample.
+				ChannelMatrix gxc(batch_dx->data() + ib*batch_dx->rows() + ic*input_channel_size, input_height, input_width);
+				gxc.setZero();
 
 				// For each filter.
 				for (size_t fi=0; fi< output_depth; fi++) {
-					//std::cout<< "======  switching filter = " << fi << std::endl;
-
 					// Get filter weight matrix.
-					mic::types::MatrixPtr<eT> W = p["W"+std::to_string(fi)+"x"+std::to_string(ic)];
-					W->resize(filter_size, filter_size);
-
+					FilterMatrix W(getFilterSlice(fi, ic).data(), filter_size, filter_size);
 					// Get gradient y channel.
-					mic::types::MatrixPtr<eT> gyc = m["yc"];
-					// Copy block - resizes the input channel matrix.
-					(*gyc) = gys->block(fi*output_height*output_width, 0, output_height*output_width, 1);
-					(*gyc).resize(output_height, output_width);
-					//std::cout<< "fi = " << fi << "(*gyc) = \n" << (*gyc) << std::endl;
-
-/*					// Get reW.
-					mic::types::MatrixPtr<eT> reW = m["reW"+std::to_string(fi)+std::to_string(ic)];
-					// Get pointer to "reverse receptive field".
-					mic::types::MatrixPtr<eT> rerf = m["rerf"];*/
+					ChannelMatrix gyc(batch_dy->data() + ib*batch_dy->rows() + fi*output_channel_size, output_height, output_width);
 
 					// Iterate through "stride blocks" - their number is equal to output size.
 					// Those are also coordinates of the outputs.
-					for(size_t oy=0; oy < output_height; oy++) {
-						for(size_t ox=0; ox < output_width; ox++) {
-							// Get top upper coordinate of input block.
-							size_t isby = oy * stride;
-							size_t isbx = ox * stride;
-							//std::cout<< "block coordinates: isby = " << isby << " isbx=" << isbx << std::endl;
-
-							// Iterate through the elements and add them to gxc.
-							for (size_t iy=0; iy<filter_size; iy++) {
-								for (size_t ix=0; ix<filter_size; ix++) {
-
-									eT conv = (*W)(iy,ix)*(*gyc)(oy,ox);//((*rerf)*(*gyc))(0);//1;
-									size_t y = isby+iy;
-									size_t x = isbx+ix;
-									//std::cout<< "adding to (*gxc) = \n" << (*gxc) << "\n in: " << " y=" << y<< " x=" << x << std::endl;
-									(*gxc)(y,x) += conv;
-
-								}//: for ix
-							}//: for iy
-
-
+					for(size_t ox=0; ox < output_width; ox++) {
+						for(size_t oy=0; oy < output_height; oy++) {
+							gxc.block(oy*stride, ox*stride, filter_size, filter_size) += gyc(oy,ox) * W;
 						}//: for stride blocks y
 					}//: for stride blocks x
-					//std::cout<< "filter = "<< fi << " resulting (*gxc) = \n" << (*gxc) << std::endl;
 				}//: for filters
-				//std::cout<< "result for input channel = "<< ic << " (*gxc) = \n" << (*gxc) << std::endl;
-				// Resize gradient channel to a column vector.
-				gxc->resize(input_height * input_width, 1);
-
-				// Concatenate gradient.
-				gxs->block(ic*input_height*input_width, 0, input_height*input_width, 1)
-						= (*gxc);
-
-				//std::cout<< "(*gs) = \n" << (*gxs) << std::endl;
 			}//: for channels
-
-			// Set column in the gradient batch.
-			batch_dx->col(ib) = (*gxs);
-
 		}//: batch
-
 	}
 
 	/*!
 	 * Back-propagates the gradients from dy to dW.
 	 */
 	void backpropagade_dy_to_dW() {
-		// Get weight delta matrix.
-		//mic::types::MatrixPtr<eT> dW = g['W'];
+		if (engine == ConvolutionEngine::Direct)
+			backpropagade_dy_to_dW_direct();
+		else
+			backpropagade_dy_to_dW_im2col(lowerOutputGradients());
+	}
 
+	/*!
+	 * Back-propagates the gradients from dy to dW - multiplies the transposed receptive fields lowered in the forward pass by lowered dy.
+	 * @param ycol_ Lowered dy (see lowerOutputGradients()).
+	 */
+	void backpropagade_dy_to_dW_im2col(typename Layer<eT>::ScratchMatrix ycol_) {
 		// Get matrices.
-		mic::types::MatrixPtr<eT> batch_dy = g['y'];
-		mic::types::MatrixPtr<eT> batch_x = s['x'];
-		//std::cout<< "backpropagate to dW batch_x=\n" << (*batch_x) << std::endl;
+		mic::types::MatrixPtr<eT> dW = g[hdW];
+		size_t rows = batch_size*output_height*output_width;
+
+		// The Winograd engine does not lower the input batch in the forward pass - it is lowered into a temporary matrix.
+		ScratchMatrix xcol = useWinograd() ?
+				scratchMatrix(hxcol, rows, input_depth*filter_size*filter_size, rows*output_depth) :
+				ScratchMatrix(m[hxcol]->data(), m[hxcol]->rows(), m[hxcol]->cols());
+		if (useWinograd())
+			im2col(s[hx], xcol);
+
+		// Calculate gradients of all filters at once - sums over all receptive fields of all samples.
+		// Every thread multiplies its own range of receptive fields, accumulating the result in its own workspace.
+		prepareWorkspaces();
+#pragma omp parallel
+		{
+			size_t t = threadId();
+			size_t threads = numThreads();
+			size_t begin = rows*t/threads;
+			size_t end = rows*(t+1)/threads;
+			workspaces[t].dW.noalias() = xcol.middleRows(begin, end-begin).transpose() * ycol_.middleRows(begin, end-begin);
+		}//: parallel
+
+		reduceWeightGradients(dW);
+	}
 
-		// Reset weight gradiends.
-		for (size_t fi=0; fi< output_depth; fi++) {
-			// A given filter (neuron layer) has in fact connection to all input channels.
-			for (size_t ic=0; ic< input_depth; ic++) {
-				g["W"+std::to_string(fi)+"x"+std::to_string(ic)]->setZero();
-			}//: for ic
-		}//: for fi
+	/*!
+	 * Back-propagates the gradients from dy to dW, iterating through "inverse receptive fields".
+	 * Samples are processed in parallel, every thread accumulating gradients in its own workspace.
+	 */
+	void backpropagade_dy_to_dW_direct() {
+		// Get matrices.
+		mic::types::MatrixPtr<eT> batch_dy = g[hy];
+		mic::types::MatrixPtr<eT> batch_x = s[hx];
+
+		size_t output_channel_size = output_height*output_width;
+		size_t input_channel_size = input_height*input_width;
+		size_t filter_length = filter_size*filter_size;
 
+		prepareWorkspaces();
 
 		// Iterate through samples in the input batch.
+#pragma omp parallel for schedule(static)
 		for (size_t ib=0; ib< batch_size; ib++) {
-
-			// Get y gradient sample from batch.
-			mic::types::MatrixPtr<eT> gys = m["ys"];
-			(*gys) = batch_dy->col(ib);
-
-			// Get x sample from batch.
-			mic::types::MatrixPtr<eT> xs = m["xs"];
-			(*xs) = batch_x->col(ib);
-			//std::cout<< "xs=\n" << (*xs) << std::endl;
+			Workspace & ws = workspaces[threadId()];
 
 			// Iterate through input channels.
 			for (size_t ic=0; ic< input_depth; ic++) {
-				// 3.1. Get input channel from image.
-				mic::types::MatrixPtr<eT> x_channel = m["xc"];
-				// Copy block - resizes the input channel matrix.
-				(*x_channel) = xs->block(ic*input_height*input_width, 0, input_height*input_width, 1);
-				// Resize channel using the given dimensions.
-				x_channel->resize(input_height, input_width);
-				//std::cout<< "======  switching input channel = " << ic << " x_channel=\n" << (*x_channel) << std::endl;
-
-				// Fill "inverse input receptive fields" from given input channel.
-				// Image coordinates: ix, iy.
+				// Get input channel of a given sample.
+				ChannelMatrix xc(batch_x->data() + ib*batch_x->rows() + ic*input_channel_size, input_height, input_width);
+
+				// Fill "inverse input receptive fields" from given input channel - one column per filter element, ordered as in filters.
 				// Coordinates in the filter space: fx, fy.
-				for (size_t fy=0; fy< filter_size; fy++) {
-					for (size_t fx=0; fx< filter_size; fx++) {
-						// Get inverse receptive field matrix.
-						mic::types::MatrixPtr<eT> ixrf = m["ixrf"+std::to_string(fy)+"x"+std::to_string(fx)];
-						ixrf->setZero();
-						//std::cout << (*x_field).rows() << "x" << (*x_field).cols() <<std::endl;
-						//std::cout<< "x_field=\n" << (*x_field) << std::endl;
-						ixrf->resize(output_height, output_width);
-						ixrf->setZero();
+				for (size_t fx=0; fx< filter_size; fx++) {
+					for (size_t fy=0; fy< filter_size; fy++) {
+						ChannelMatrix ixrf(ws.ixrf.col(fx*filter_size + fy).data(), output_height, output_width);
 						// Iterate through the input channel using stride.
-						for (size_t iy=0; iy< output_height; iy++) {
-							for (size_t ix=0; ix< output_width; ix++) {
-								/*std::cout<<"fy =" << fy <<" fx =" << fx <<" iy =" << iy <<" ix =" << ix << std::endl;
-								std::cout<<"fy*iy*stride =" << fy*iy*stride <<" fx+ix*stride =" << fx+ix*stride <<std::endl;*/
-								// Copy cell - one by one :]
-								(*ixrf)(iy, ix) = (*x_channel)(fy+iy*stride,fx+ix*stride);
-
-							}//: for ix
-						}//: for iy
-						//(*ixrf) = (*x_channel).block(fy, fx, output_height, output_width);
-						// Resize the field to a column vector.
-						ixrf->resize(1, output_height*output_width);
-						//std::cout<< "x_field=\n" << (*x_field) << std::endl;
-					}//: for rx
-				}//: for ry
-
-				// For each filter (= each output channel).
-				for (size_t fi=0; fi< output_depth; fi++) {
-					// Get output channel for a given filter.
-					mic::types::MatrixPtr<eT> gyc = m["yc"+std::to_string(fi)];
-					(*gyc) = gys->block(fi*output_height*output_width, 0, output_height*output_width, 1);
-					//std::cout<< "gyc=\n" << (*gyc) << std::endl;
-
-					// Get matrix of a given "part of a given neuron".
-					mic::types::MatrixPtr<eT> dW = g["W"+std::to_string(fi)+"x"+std::to_string(ic)];
-					// Not required - just in case. :]
-					dW->resize(filter_size, filter_size);
-					// Iterate through inverse receptive fields and CONVOLVE.
-					for (size_t ry=0; ry< filter_size; ry++) {
-						for (size_t rx=0; rx< filter_size; rx++) {
-							//std::cout<<"filter = " << fi << " ry =" << ry <<" rx =" << rx <<std::endl;
-							// Get inverse receptive field matrix of size (filter_size^2, 1)...
-							mic::types::MatrixPtr<eT> ixrf = m["ixrf"+std::to_string(ry)+"x"+std::to_string(rx)];
-							ixrf->resize(1, output_height*output_width);
-							/*std::cout<< "x_field=\n" << (*ixrf) << std::endl;
-							std::cout<< "gyc=\n" << (*gyc) << std::endl;
-							std::cout<< " result = \n" << ((*ixrf)*(*gyc)) << std::endl;*/
-							// ... and convolve it with dy channel.
-							(*dW)(ry, rx) += ((*ixrf)*(*gyc))(0);
-						}//: for rx
-					}//: for ry
-					//std::cout << "==== result: dW [" << fi << ic <<"] = " << (*dW)<<std::endl;
-					//std::cout<<"fi = " << fi << std::endl<< (*dW) << std::endl;
-					//dW->setValue(fi);
+						for (size_t ix=0; ix< output_width; ix++)
+							for (size_t iy=0; iy< output_height; iy++)
+								ixrf(iy, ix) = xc(fy+iy*stride, fx+ix*stride);
+					}//: for fy
+				}//: for fx
 
+				// For each filter (= each output channel) convolve inverse receptive fields with dy channel.
+				for (size_t fi=0; fi< output_depth; fi++) {
+					Eigen::Map<Eigen::Matrix<eT, Eigen::Dynamic, 1> > gyc(batch_dy->data() + ib*batch_dy->rows() + fi*output_channel_size, output_channel_size);
+					ws.dW.block(ic*filter_length, fi, filter_length, 1).noalias() += ws.ixrf.transpose() * gyc;
 				}//: for filter
-
 			}//: for input_channels
 		}//: for batch
+
+		reduceWeightGradients(g[hdW]);
 	}
 
 
@@ -557,9 +620,9 @@ public:
 	 */
 	void backpropagade_dy_to_db() {
 		// Get bias delta matrix (vector).
-		mic::types::MatrixPtr<eT> db = g['b'];
+		mic::types::MatrixPtr<eT> db = g[hdb];
 		// Get dy matrix - input.
-		mic::types::MatrixPtr<eT> batch_dy = g['y'];
+		mic::types::MatrixPtr<eT> batch_dy = g[hy];
 
 		// Iterate through output channels i.e. filters.
 		for (size_t fi=0; fi< output_depth; fi++) {
@@ -588,21 +651,62 @@ public:
 	 * @param decay_ Weight decay rate (determining that the "unused/unupdated" weights will decay to 0) (DEFAULT=0.0 - no decay).
 	 */
 	void update(eT alpha_, eT decay_  = 0.0f) {
-		// Get keys of all parameters.
-		std::map<std::string, size_t> keys = p.keys();
-
-		for (auto& i: keys) {
-/*			std::cout << "* " << i.first << "\t = < " << (*p[i.first]).minCoeff() << ",\t " << (*p[i.first]).maxCoeff() << ">" <<
-					" * d" << i.first << "\t = <" << (*g[i.first]).minCoeff() << ",\t " << (*g[i.first]).maxCoeff() << ">" << std::endl;*/
-			opt[i.first]->update(p[i.first], g[i.first], 1.0*alpha_, decay_);
-			/*for (size_t j=0; j<(size_t)p[i.first]->size(); j++)
-				(*p[i.first])[j] -= alpha_ * (*g[i.first])[j];*/
-		}//: for
+		// Update filters and biases - optimization functions share handles with the parameters.
+		opt[hW]->update(p[hW], g[hdW], alpha_, decay_);
+		opt[hb]->update(p[hb], g[hdb], alpha_, decay_);
 
-		/*std::string key = "W0x0";
-		std::cout << "* " << key << "\t = < " << (*p[key])[0]  <<",\t " << (*p[key])[1];
-		std::cout << "\t* d" << key << "\t = < " << (*g[key])[0]  <<",\t " << (*g[key])[1] << std::endl;*/
+		// Filters have changed.
+		invalidateParameterCaches();
+	}
 
+	/*!
+	 * Appends segments of filters and biases (both with weight decay) - the same as updated by update().
+	 * The network calls invalidateParameterCaches() after updating the segments.
+	 * @param segments_ Vector of segments.
+	 */
+	virtual bool getParameterSegments(std::vector<ParameterSegment<eT> > & segments_) {
+		segments_.push_back({p[hW], g[hdW], opt[hW], true});
+		segments_.push_back({p[hb], g[hdb], opt[hb], true});
+		return true;
+	}
+
+	/*!
+	 * Switches the layer to the inference-only mode - releases the gradients and the matrix of gradients of receptive fields.
+	 */
+	virtual void freeze() {
+		Layer<eT>::freeze();
+		m[hdxcol] = MAKE_MATRIX_PTR(eT, 0, 0);
+	}
+
+	/*!
+	 * Backward pass does not read the output (gradients are calculated from the input).
+	 */
+	virtual bool backwardUsesOutput() {
+		return false;
+	}
+
+	/*!
+	 * Returns the number of elements of the lowered outputs/output gradients, followed by gradients of receptive fields
+	 * (or receptive fields lowered in the backward pass of the Winograd engine). The direct engine does not use the arena.
+	 */
+	virtual size_t scratchSize() {
+		if (engine == ConvolutionEngine::Direct)
+			return 0;
+		return batch_size*output_height*output_width * (output_depth + input_depth*filter_size*filter_size);
+	}
+
+	/*!
+	 * Sets the scratch arena - releases the own matrices of lowered outputs and gradients of receptive fields
+	 * (and of receptive fields, as the forward pass of the im2col engine restores it).
+	 * @param arena_ Arena (nullptr restores the own temporary matrices).
+	 */
+	virtual void setScratchArena(std::shared_ptr<ScratchArena<eT> > arena_) {
+		Layer<eT>::setScratchArena(arena_);
+		if (arena_) {
+			m[hxcol] = MAKE_MATRIX_PTR(eT, 0, 0);
+			m[hdxcol] = MAKE_MATRIX_PTR(eT, 0, 0);
+			m[hycol] = MAKE_MATRIX_PTR(eT, 0, 0);
+		}//: if
 	}
 
 
@@ -620,14 +724,10 @@ public:
 
 			// Iterate through input channels.
 			for (size_t ic=0; ic< input_depth; ic++) {
-				// Get matrix of a given "part of a given neuron".
-				mic::types::MatrixPtr<eT> W = p["W"+std::to_string(fi)+"x"+std::to_string(ic)];
-
 				// Get row.
 				mic::types::MatrixPtr<eT> row = w_activations[fi*input_depth + ic];
-				// Copy data.
-				(*row) = (*W);
-				row->resize(filter_size, filter_size);
+				// Copy data of a given "part of a given neuron".
+				(*row) = FilterMatrix(getFilterSlice(fi, ic).data(), filter_size, filter_size);
 
 			}//: for channels
 		}//: for filters
@@ -652,13 +752,10 @@ public:
 			// Iterate through input channels.
 			for (size_t ic=0; ic< input_depth; ic++) {
 
-				// Get matrix of a given "part of a given neuron dW".
-				mic::types::MatrixPtr<eT> W = g["W"+std::to_string(fi)+"x"+std::to_string(ic)];
-
 				// Get row.
 				mic::types::MatrixPtr<eT> row = dw_activations[fi*input_depth + ic];
-				// Copy data.
-				(*row) = (*W);
+				// Copy data of a given "part of a given neuron dW".
+				(*row) = getFilterGradientSlice(fi, ic);
 
 			}//: for channel
 		}//: for filter
@@ -670,29 +767,26 @@ public:
 
 	/*!
 	 * Returns activations of receptive fields.
-	 * Limitation: displays receptive fields of the last sample from batch!
+	 * Limitation: displays receptive fields of the last channel of the last sample from batch!
 	 */
 	std::vector< std::shared_ptr <mic::types::Matrix<eT> > > & getReceptiveFields() {
 
-		// TODO: batch!
-		//assert(batch_size==1);
-
 		// Allocate memory.
 		lazyAllocateMatrixVector(xrf_activations, output_height * output_width, filter_size, filter_size);
 
+		// Get the last channel of the last sample.
+		mic::types::MatrixPtr<eT> batch_x = s[hx];
+		ChannelMatrix xc(batch_x->data() + (batch_size-1)*batch_x->rows() + (input_depth-1)*input_height*input_width, input_height, input_width);
+
 		// Receptive field "id" coordinates: rx, ry.
 		for (size_t ry=0; ry< output_height; ry++) {
 			for (size_t rx=0; rx< output_width; rx++) {
-				// Get receptive field matrix...
-				mic::types::MatrixPtr<eT> xrf = m["xrf"+std::to_string(ry)+"x"+std::to_string(rx)];
-
 				// Get activation "row".
 				mic::types::MatrixPtr<eT> row = xrf_activations[ry*output_width + rx];
 
 				// Copy field.
-				(*row) = *(xrf);
 				row->resize(filter_size, filter_size);
-
+				(*row) = xc.block(ry*stride, rx*stride, filter_size, filter_size);
 			}//: for ry
 		}//: for rx
 
@@ -702,30 +796,29 @@ public:
 
 	/*!
 	 * Returns activations of inverse receptive fields.
-	 * Limitation: displays receptive fields of the last sample from batch!
+	 * Limitation: displays receptive fields of the last channel of the last sample from batch!
 	 */
 	std::vector< std::shared_ptr <mic::types::Matrix<eT> > > & getInverseReceptiveFields() {
 
-		// TODO: batch!
-		//assert(batch_size==1);
-
 		// Allocate memory.
 		lazyAllocateMatrixVector(irf_activations, filter_size*filter_size, output_height, output_width);
 
+		// Get the last channel of the last sample.
+		mic::types::MatrixPtr<eT> batch_x = s[hx];
+		ChannelMatrix xc(batch_x->data() + (batch_size-1)*batch_x->rows() + (input_depth-1)*input_height*input_width, input_height, input_width);
+
 		for (size_t fy=0; fy< filter_size; fy++) {
 			for (size_t fx=0; fx< filter_size; fx++) {
-				// Get inverse receptive field matrix.
-				mic::types::MatrixPtr<eT> ixrf = m["ixrf"+std::to_string(fy)+"x"+std::to_string(fx)];
-
 				// Get activation "row".
 				mic::types::MatrixPtr<eT> row = irf_activations[fy*filter_size + fx];
-
-				// Copy field.
-				(*row) = *(ixrf);
 				row->resize(output_height, output_width);
 
-				}//: for rx
-			}//: for ry
+				// Copy field - cell by cell, using stride.
+				for (size_t iy=0; iy< output_height; iy++)
+					for (size_t ix=0; ix< output_width; ix++)
+						(*row)(iy, ix) = xc(fy+iy*stride, fx+ix*stride);
+			}//: for rx
+		}//: for ry
 
 		// Return activations.
 		return irf_activations;
@@ -737,7 +830,7 @@ public:
 	 */
 	mic::types::MatrixPtr<eT> getFilterSimilarityMatrix() {
 		// Get filter similarity matrix.
-		mic::types::MatrixPtr<eT> fs = m["fs"];
+		mic::types::MatrixPtr<eT> fs = m[hfs];
 		// Reset.
 		fs->zeros();
 
@@ -746,7 +839,7 @@ public:
 			// A given filter (neuron layer) has in fact connection to all input channels.
 			for (size_t ic=0; ic< input_depth; ic++) {
 				// Get i-th filter.
-				mic::types::MatrixPtr<eT> iW = p["W"+std::to_string(fi)+"x"+std::to_string(ic)];
+				FilterSlice iW = getFilterSlice(fi, ic);
 				// Calculate index.
 				size_t i = fi*input_depth + ic;
 
@@ -754,13 +847,13 @@ public:
 					// A given filter (neuron layer) has in fact connection to all input channels.
 					for (size_t jc=0; jc< input_depth; jc++) {
 						// Get j-th filter.
-						mic::types::MatrixPtr<eT> jW = p["W"+std::to_string(fj)+"x"+std::to_string(jc)];
+						FilterSlice jW = getFilterSlice(fj, jc);
 						// Calculate index.
 						size_t j = fj*input_depth + jc;
 
 						// Calculate the similarity - absolute value!
 						//(*fs)(j, i) =
-						(*fs)(i, j) = cosineSimilarity(iW->data(), jW->data(), filter_size*filter_size);
+						(*fs)(i, j) = cosineSimilarity(iW.data(), jW.data(), filter_size*filter_size);
 					}
 				}// :for j
 			}
@@ -794,9 +887,17 @@ protected:
 	// Unhide the fields inherited from the template class Layer via "using" statement.
     using Layer<eT>::g;
     using Layer<eT>::s;
+    using Layer<eT>::hx;
+    using Layer<eT>::hy;
+    using Layer<eT>::hxs;
+    using Layer<eT>::hxc;
+    using Layer<eT>::hys;
+    using Layer<eT>::hyc;
     using Layer<eT>::p;
     using Layer<eT>::m;
     using Layer<eT>::opt;
+    using Layer<eT>::scratchMatrix;
+    typedef typename Layer<eT>::ScratchMatrix ScratchMatrix;
 
     // Uncover "sizes" for visualization.
     using Layer<eT>::input_height;
@@ -813,6 +914,366 @@ protected:
 	/// Stride (assuming equal vertical and horizontal strides).
 	 size_t stride;
 
+	/// Engine used in forward and backward passes.
+	ConvolutionEngine engine;
+
+	/// Handles of filters and biases (in parameters and optimization functions).
+	size_t hW, hb;
+
+	/// Handles of gradients of filters and biases.
+	size_t hdW, hdb;
+
+	/// Handles of matrices used by the im2col engine.
+	size_t hxcol, hdxcol, hycol;
+
+	/// Handle of the filter similarity matrix.
+	size_t hfs;
+
+
+	/*!
+	 * Resolves handles of the matrices used by the layer.
+	 */
+	virtual void resolveHandles() {
+		Layer<eT>::resolveHandles();
+		// Deserialized models are resolved after restoring the filter size (and repacking filters of models in the old format).
+		if ((filter_size == 0) || !p.keyExists("W"))
+			return;
+		hW = Layer<eT>::resolveHandle(p, "W");
+		hb = Layer<eT>::resolveHandle(p, "b");
+		hdW = Layer<eT>::resolveHandle(g, "W");
+		hdb = Layer<eT>::resolveHandle(g, "b");
+		hxcol = Layer<eT>::resolveHandle(m, "xcol");
+		hdxcol = Layer<eT>::resolveHandle(m, "dxcol");
+		hycol = Layer<eT>::resolveHandle(m, "ycol");
+		hfs = Layer<eT>::resolveHandle(m, "fs");
+	}
+
+	/*!
+	 * Lowers the input batch into a matrix of receptive fields (im2col).
+	 * Every row of the resulting matrix contains a single receptive field of a given sample (rows of sample ib start at ib*output_height*output_width),
+	 * with columns ordered as in the filters, i.e. channel by channel, with filter_size*filter_size elements per channel.
+	 * @param batch_x_ Input batch.
+	 * @param xcol_ Resulting matrix (of size [batch_size*output_height*output_width x input_depth*filter_size*filter_size]).
+	 */
+	void im2col(mic::types::MatrixPtr<eT> batch_x_, ScratchMatrix xcol_) {
+		size_t output_channel_size = output_height*output_width;
+		size_t input_channel_size = input_height*input_width;
+		size_t rows = batch_size*output_channel_size;
+
+#pragma omp parallel for schedule(static)
+		for (size_t ib=0; ib< batch_size; ib++) {
+			for (size_t ic=0; ic< input_depth; ic++) {
+				// Pointer to a given channel of a given sample.
+				eT* ichannel = batch_x_->data() + ib*batch_x_->rows() + ic*input_channel_size;
+				for (size_t fx=0; fx< filter_size; fx++) {
+					for (size_t fy=0; fy< filter_size; fy++) {
+						// Pointer to the part of the column storing a given filter element of all receptive fields of a given sample.
+						eT* col = xcol_.data() + (ic*filter_size*filter_size + fx*filter_size + fy)*rows + ib*output_channel_size;
+						for (size_t rx=0; rx< output_width; rx++) {
+							eT* src = ichannel + (rx*stride + fx)*input_height + fy;
+							eT* dst = col + rx*output_height;
+							for (size_t ry=0; ry< output_height; ry++)
+								dst[ry] = src[ry*stride];
+						}//: for rx
+					}//: for fy
+				}//: for fx
+			}//: for channels
+		}//: for batch
+	}
+
+	/*!
+	 * Accumulates gradients of receptive fields into the gradient batch (col2im) - inverse of im2col().
+	 * @param dxcol_ Matrix of gradients of receptive fields.
+	 * @param batch_dx_ Resulting gradient batch.
+	 */
+	void col2im(ScratchMatrix dxcol_, mic::types::MatrixPtr<eT> batch_dx_) {
+		size_t output_channel_size = output_height*output_width;
+		size_t input_channel_size = input_height*input_width;
+		size_t rows = batch_size*output_channel_size;
+		batch_dx_->setZero();
+
+		// Every sample writes to its own column of dx.
+#pragma omp parallel for schedule(static)
+		for (size_t ib=0; ib< batch_size; ib++) {
+			for (size_t ic=0; ic< input_depth; ic++) {
+				// Pointer to a given channel of a given sample.
+				eT* ichannel = batch_dx_->data() + ib*batch_dx_->rows() + ic*input_channel_size;
+				for (size_t fx=0; fx< filter_size; fx++) {
+					for (size_t fy=0; fy< filter_size; fy++) {
+						eT* col = dxcol_.data() + (ic*filter_size*filter_size + fx*filter_size + fy)*rows + ib*output_channel_size;
+						for (size_t rx=0; rx< output_width; rx++) {
+							eT* dst = ichannel + (rx*stride + fx)*input_height + fy;
+							eT* src = col + rx*output_height;
+							for (size_t ry=0; ry< output_height; ry++)
+								dst[ry*stride] += src[ry];
+						}//: for rx
+					}//: for fy
+				}//: for fx
+			}//: for channels
+		}//: for batch
+	}
+
+	/*!
+	 * Lowers the output gradients - every column of the resulting matrix contains gradients of a given output channel (filter) of all samples.
+	 * @return Lowered dy (of size [batch_size*output_height*output_width x output_depth]), stored in the temporary matrix (or the scratch arena).
+	 */
+	ScratchMatrix lowerOutputGradients() {
+		mic::types::MatrixPtr<eT> batch_dy = g[hy];
+		size_t output_channel_size = output_height*output_width;
+		ScratchMatrix ycol = scratchMatrix(hycol, batch_size*output_channel_size, output_depth, 0);
+
+#pragma omp parallel for schedule(static)
+		for (size_t ib=0; ib< batch_size; ib++) {
+			for (size_t fi=0; fi< output_depth; fi++) {
+				ycol.block(ib*output_channel_size, fi, output_channel_size, 1) =
+						batch_dy->block(fi*output_channel_size, ib, output_channel_size, 1);
+			}//: for filters
+		}//: for batch
+		return ycol;
+	}
+
+	/// Zero-copy view of a single channel of a given sample.
+	typedef Eigen::Map<Eigen::Matrix<eT, Eigen::Dynamic, Eigen::Dynamic> > ChannelMatrix;
+
+	/*!
+	 * \brief Structure containing scratch memory used by a single thread processing samples of the batch.
+	 */
+	struct Workspace {
+		/// Receptive fields of a given input channel - one column per receptive field.
+		mic::types::Matrix<eT> xrf;
+
+		/// Inverse receptive fields of a given input channel - one column per filter element.
+		mic::types::Matrix<eT> ixrf;
+
+		/// Accumulator of gradients of filters.
+		mic::types::Matrix<eT> dW;
+	};
+
+	/// Workspaces - one per thread.
+	std::vector<Workspace> workspaces;
+
+	/// Minimal number of input and output channels for which the Auto engine uses Winograd - with fewer channels the tile transforms cost more than the saved multiplications.
+	static const size_t winograd_min_channels = 8;
+
+	/// Flag indicating whether the cached Winograd filter transforms are up to date.
+	bool winograd_transforms_valid;
+
+	/// Winograd transforms of filters (U = G g G^T) - one [input channels x filters] matrix per element of the 4x4 transformed tile.
+	std::vector<mic::types::Matrix<eT> > winograd_U;
+
+	/// Winograd transforms of filters rotated by 180 degrees, used in back-propagation to dx - one [filters x input channels] matrix per element of the tile.
+	std::vector<mic::types::Matrix<eT> > winograd_dU;
+
+	/// Winograd transforms of input tiles (V = B^T d B) - one column storing a [tiles x channels] block per element of the tile.
+	mic::types::Matrix<eT> winograd_V;
+
+	/// Products of transformed tiles and filters - one column storing a [tiles x channels] block per element of the tile.
+	mic::types::Matrix<eT> winograd_M;
+
+	/*!
+	 * Computes (if required) the cached Winograd transforms of filters - both the ones used in the forward pass and the ones used in back-propagation to dx.
+	 */
+	void prepareWinogradTransforms() {
+		if (winograd_transforms_valid)
+			return;
+
+		// Filter transform matrix G.
+		Eigen::Matrix<eT, 4, 3> G;
+		G << 1.0, 0.0, 0.0,
+			0.5, 0.5, 0.5,
+			0.5, -0.5, 0.5,
+			0.0, 0.0, 1.0;
+
+		winograd_U.resize(16);
+		winograd_dU.resize(16);
+		for (size_t k=0; k< 16; k++) {
+			winograd_U[k].resize(input_depth, output_depth);
+			winograd_dU[k].resize(output_depth, input_depth);
+		}//: for
+
+		for (size_t fi=0; fi< output_depth; fi++) {
+			for (size_t ic=0; ic< input_depth; ic++) {
+				Eigen::Matrix<eT, 3, 3> W = FilterMatrix(getFilterSlice(fi, ic).data(), 3, 3);
+				Eigen::Matrix<eT, 4, 4> u = G * W * G.transpose();
+				Eigen::Matrix<eT, 4, 4> du = G * W.reverse() * G.transpose();
+				for (size_t k=0; k< 16; k++) {
+					winograd_U[k](ic, fi) = u.data()[k];
+					winograd_dU[k](fi, ic) = du.data()[k];
+				}//: for
+			}//: for channels
+		}//: for filters
+
+		winograd_transforms_valid = true;
+	}
+
+	/*!
+	 * Correlates a batch of multi-channel images with 3x3 filters using the Winograd F(2x2,3x3) algorithm:
+	 * every 2x2 output tile is computed from a 4x4 input tile as A^T [ sum_c U (.) (B^T d B) ] A, with the sums over channels computed as 16 GEMMs
+	 * (one per element of the transformed tile, multiplying [tiles x input channels] by [input channels x output channels] matrices).
+	 * @param in_ Input batch (one sample per column, channel after channel).
+	 * @param in_channels_ Number of input channels.
+	 * @param in_height_ Height of the input channels.
+	 * @param in_width_ Width of the input channels.
+	 * @param pad_ Zero padding added (virtually) on every side of the input channels.
+	 * @param U_ Transformed filters, one [input channels x output channels] matrix per element of the tile.
+	 * @param out_ Output batch.
+	 * @param out_channels_ Number of output channels.
+	 * @param out_height_ Height of the output channels.
+	 * @param out_width_ Width of the output channels.
+	 * @param bias_ Biases added to the output channels (or nullptr).
+	 */
+	void winogradCorrelate(mic::types::MatrixPtr<eT> in_, size_t in_channels_, size_t in_height_, size_t in_width_, size_t pad_,
+			std::vector<mic::types::Matrix<eT> > & U_,
+			mic::types::MatrixPtr<eT> out_, size_t out_channels_, size_t out_height_, size_t out_width_, const eT* bias_) {
+		size_t tiles_height = (out_height_ + 1) / 2;
+		size_t tiles_width = (out_width_ + 1) / 2;
+		size_t tiles = tiles_height * tiles_width;
+
+		// Transformed tiles and products are stored in 16 blocks (columns) - element (tile, c) of a given block lies at c*batch_size*tiles + tile.
+		// Blocks are padded, so they do not start at addresses mapped to the same cache sets.
+		size_t P = batch_size*tiles;
+		winograd_V.resize(in_channels_*batch_size*tiles + 16, 16);
+		winograd_M.resize(out_channels_*batch_size*tiles + 16, 16);
+		eT* V[16];
+		const eT* M[16];
+		for (size_t k=0; k< 16; k++) {
+			V[k] = winograd_V.col(k).data();
+			M[k] = winograd_M.col(k).data();
+		}//: for
+
+		// 1. Transform input tiles.
+#pragma omp parallel for schedule(static)
+		for (size_t ib=0; ib< batch_size; ib++) {
+			eT d[16], t[16];
+			for (size_t ic=0; ic< in_channels_; ic++) {
+				const eT* channel = in_->data() + ib*in_->rows() + ic*in_height_*in_width_;
+				for (size_t tx=0; tx< tiles_width; tx++) {
+					for (size_t ty=0; ty< tiles_height; ty++) {
+						// Gather the 4x4 tile (column-major), filling cells outside of the channel with zeros.
+						for (size_t j=0; j< 4; j++) {
+							long x = (long)(2*tx + j) - (long)pad_;
+							for (size_t i=0; i< 4; i++) {
+								long y = (long)(2*ty + i) - (long)pad_;
+								d[i + 4*j] = ((x >= 0) && (x < (long)in_width_) && (y >= 0) && (y < (long)in_height_)) ? channel[x*in_height_ + y] : 0;
+							}//: for i
+						}//: for j
+						// t = B^T d.
+						for (size_t j=0; j< 4; j++) {
+							t[0 + 4*j] = d[0 + 4*j] - d[2 + 4*j];
+							t[1 + 4*j] = d[1 + 4*j] + d[2 + 4*j];
+							t[2 + 4*j] = d[2 + 4*j] - d[1 + 4*j];
+							t[3 + 4*j] = d[1 + 4*j] - d[3 + 4*j];
+						}//: for
+						// v = t B.
+						size_t col = ib*tiles + tx*tiles_height + ty;
+						for (size_t i=0; i< 4; i++) {
+							V[i + 0][ic*P + col] = t[i + 0] - t[i + 8];
+							V[i + 4][ic*P + col] = t[i + 4] + t[i + 8];
+							V[i + 8][ic*P + col] = t[i + 8] - t[i + 4];
+							V[i + 12][ic*P + col] = t[i + 4] - t[i + 12];
+						}//: for
+					}//: for ty
+				}//: for tx
+			}//: for channels
+		}//: for batch
+
+		// 2. Multiply transformed filters and tiles, summing over input channels.
+		for (size_t k=0; k< 16; k++) {
+			ChannelMatrix Vk(winograd_V.col(k).data(), P, in_channels_);
+			ChannelMatrix Mk(winograd_M.col(k).data(), P, out_channels_);
+			Mk.noalias() = Vk * U_[k];
+		}//: for
+
+		// 3. Transform the products back to output tiles.
+#pragma omp parallel for schedule(static)
+		for (size_t ib=0; ib< batch_size; ib++) {
+			eT mt[16], t[8];
+			for (size_t oc=0; oc< out_channels_; oc++) {
+				eT* channel = out_->data() + ib*out_->rows() + oc*out_height_*out_width_;
+				eT bias = (bias_ != nullptr) ? bias_[oc] : 0;
+				for (size_t tx=0; tx< tiles_width; tx++) {
+					for (size_t ty=0; ty< tiles_height; ty++) {
+						size_t col = ib*tiles + tx*tiles_height + ty;
+						for (size_t k=0; k< 16; k++)
+							mt[k] = M[k][oc*P + col];
+						// t = A^T m.
+						for (size_t j=0; j< 4; j++) {
+							t[0 + 2*j] = mt[0 + 4*j] + mt[1 + 4*j] + mt[2 + 4*j];
+							t[1 + 2*j] = mt[1 + 4*j] - mt[2 + 4*j] - mt[3 + 4*j];
+						}//: for
+						// y = t A - store only cells lying inside of the output channel.
+						for (size_t i=0; i< 2; i++) {
+							size_t y = 2*ty + i;
+							if (y >= out_height_)
+								continue;
+							size_t x = 2*tx;
+							channel[x*out_height_ + y] = t[i + 0] + t[i + 2] + t[i + 4] + bias;
+							if (x + 1 < out_width_)
+								channel[(x+1)*out_height_ + y] = t[i + 2] - t[i + 4] - t[i + 6] + bias;
+						}//: for
+					}//: for ty
+				}//: for tx
+			}//: for channels
+		}//: for batch
+	}
+
+	/*!
+	 * Returns the maximal number of threads that can process the batch.
+	 */
+	static size_t maxThreads() {
+#ifdef _OPENMP
+		return omp_get_max_threads();
+#else
+		return 1;
+#endif
+	}
+
+	/*!
+	 * Returns the number of threads in the current parallel region.
+	 */
+	static size_t numThreads() {
+#ifdef _OPENMP
+		return omp_get_num_threads();
+#else
+		return 1;
+#endif
+	}
+
+	/*!
+	 * Returns the id of the current thread.
+	 */
+	static size_t threadId() {
+#ifdef _OPENMP
+		return omp_get_thread_num();
+#else
+		return 0;
+#endif
+	}
+
+	/*!
+	 * Allocates workspaces for all threads (if required) and resets their gradient accumulators.
+	 */
+	void prepareWorkspaces() {
+		if (workspaces.size() != maxThreads())
+			workspaces.resize(maxThreads());
+		for (Workspace & ws : workspaces) {
+			ws.xrf.resize(filter_size*filter_size, output_height*output_width);
+			ws.ixrf.resize(output_height*output_width, filter_size*filter_size);
+			ws.dW.resize(input_depth*filter_size*filter_size, output_depth);
+			ws.dW.setZero();
+		}//: for
+	}
+
+	/*!
+	 * Sums gradients of filters accumulated by all threads - always in the same order, so the result is deterministic.
+	 * @param dW_ Resulting gradients of filters.
+	 */
+	void reduceWeightGradients(mic::types::MatrixPtr<eT> dW_) {
+		dW_->setZero();
+		for (Workspace & ws : workspaces)
+			(*dW_) += ws.dW;
+	}
+
 	 // Uncover methods useful in visualization.
 	 using Layer<eT>::lazyAllocateMatrixVector;
 
@@ -832,10 +1293,21 @@ private:
 	/// Vector containing inverse receptive fields.
 	std::vector<mic::types::MatrixPtr<eT> > irf_activations;
 
+	/*!
+	 * Serializes the parameters specific to the layer type (not stored by Layer::serialize).
+	 * @param ar Used archive.
+	 */
+	template<class Archive>
+	void serializeConfiguration(Archive & ar) {
+		ar & filter_size;
+		ar & stride;
+		ar & engine;
+	}
+
 	/*!
 	 * Private constructor, used only during the serialization.
 	 */
-	Convolution<eT>() : Layer<eT> () { }
+	Convolution<eT>() : Layer<eT> (), filter_size(0), stride(1), engine(ConvolutionEngine::Auto), winograd_transforms_valid(false) { }
 
 };
 
@@ -77,10 +77,10 @@ TEST(Convolutions, LayerDimensions) {
  */
 TEST_F(Conv2x2x2Filter2x1x1s1Double, Forward) {
 
-	/*std::cout<<"W00 = \n" << (*layer.p["W0x0"]) <<std::endl;
-	std::cout<<"W01 = \n" << (*layer.p["W0x1"]) <<std::endl;
-	std::cout<<"W10 = \n" << (*layer.p["W1x0"]) <<std::endl;
-	std::cout<<"W11 = \n" << (*layer.p["W1x1"]) <<std::endl;
+	/*std::cout<<"W00 = \n" << layer.getFilterSlice(0,0) <<std::endl;
+	std::cout<<"W01 = \n" << layer.getFilterSlice(0,1) <<std::endl;
+	std::cout<<"W10 = \n" << layer.getFilterSlice(1,0) <<std::endl;
+	std::cout<<"W11 = \n" << layer.getFilterSlice(1,1) <<std::endl;
 	std::cout<<"x = \n" << (*x) <<std::endl;
 	std::cout<<"desired_y = \n" << (*desired_y) <<std::endl;*/
 
@@ -116,15 +116,15 @@ TEST_F(Conv2x2x2Filter2x1x1s1Double, Backward) {
 		ASSERT_EQ((*desired_db)[i], (*db)[i]) << "at position " << i;
 
 	// Check resulting dW gradient.
-	std::cout<<"dW0x0 = \n" << (*layer.g["W0x0"]).transpose() <<std::endl;
-	std::cout<<"dW1x1 = \n" << (*layer.g["W1x1"]).transpose() <<std::endl;
-	std::cout<<"dW0x1 = \n" << (*layer.g["W0x1"]).transpose() <<std::endl;
-	std::cout<<"dW1x0 = \n" << (*layer.g["W1x0"]).transpose() <<std::endl;
+	std::cout<<"dW0x0 = \n" << layer.getFilterGradientSlice(0,0).transpose() <<std::endl;
+	std::cout<<"dW1x1 = \n" << layer.getFilterGradientSlice(1,1).transpose() <<std::endl;
+	std::cout<<"dW0x1 = \n" << layer.getFilterGradientSlice(0,1).transpose() <<std::endl;
+	std::cout<<"dW1x0 = \n" << layer.getFilterGradientSlice(1,0).transpose() <<std::endl;
 
-	ASSERT_EQ((*desired_dW)[0], (*layer.g["W0x0"])[0]);
-	ASSERT_EQ((*desired_dW)[1], (*layer.g["W1x1"])[0]);
-	ASSERT_EQ((*desired_dW)[2], (*layer.g["W0x1"])[0]);
-	ASSERT_EQ((*desired_dW)[3], (*layer.g["W1x0"])[0]);
+	ASSERT_EQ((*desired_dW)[0], layer.getFilterGradientSlice(0,0)[0]);
+	ASSERT_EQ((*desired_dW)[1], layer.getFilterGradientSlice(1,1)[0]);
+	ASSERT_EQ((*desired_dW)[2], layer.getFilterGradientSlice(0,1)[0]);
+	ASSERT_EQ((*desired_dW)[3], layer.getFilterGradientSlice(1,0)[0]);
 
 	// Second backward - just to assure that all the "internal dimensions" are ok after the first pass.
 //	layer.backward(dy);
@@ -186,9 +186,9 @@ TEST_F(Conv4x4x1Filter1x2x2s2Float, Backward) {
 	ASSERT_EQ((*desired_db)[0], (*db)[0]);
 
 	// Check resulting dW gradient.
-	mic::types::MatrixPtr<float> dW = layer.g["W0x0"];
+	mic::mlnn::convolution::Convolution<float>::FilterSlice dW = layer.getFilterGradientSlice(0,0);
 	for (size_t i=0; i<4; i++)
-		ASSERT_EQ((*desired_dW)[i], (*dW)[i]) << "at position " << i;
+		ASSERT_EQ((*desired_dW)[i], dW[i]) << "at position " << i;
 }
 
 
@@ -229,9 +229,9 @@ TEST_F(Conv4x4x1Filter3x1x1s3Double, Backward) {
 		ASSERT_EQ((*desired_db)[i], (*db)[i]);
 
 	// Check resulting dW gradient.
-	ASSERT_EQ((*desired_dW)[0], (*layer.g["W0x0"])[0]);
-	ASSERT_EQ((*desired_dW)[1], (*layer.g["W1x0"])[0]);
-	ASSERT_EQ((*desired_dW)[2], (*layer.g["W2x0"])[0]);
+	ASSERT_EQ((*desired_dW)[0], layer.getFilterGradientSlice(0,0)[0]);
+	ASSERT_EQ((*desired_dW)[1], layer.getFilterGradientSlice(1,0)[0]);
+	ASSERT_EQ((*desired_dW)[2], layer.getFilterGradientSlice(2,0)[0]);
 }
 
 /*!
@@ -243,8 +243,12 @@ TEST_F(Conv4x4x1Filter3x1x1s3Double, Backward) {
 TEST_F(Conv5x5x1Filter1x3x3s1Float, Dimensions) {
 
 	// Check filter size - W.
-	ASSERT_EQ((*layer.p["W0x0"]).rows(), 1);
-	ASSERT_EQ((*layer.p["W0x0"]).cols(), 9);
+	ASSERT_EQ((*layer.p["W"]).rows(), 9);
+	ASSERT_EQ((*layer.p["W"]).cols(), 1);
+
+	// Check size of the filter slice.
+	ASSERT_EQ(layer.getFilterSlice(0,0).rows(), 1);
+	ASSERT_EQ(layer.getFilterSlice(0,0).cols(), 9);
 
 	// Check filter size - b.
 	ASSERT_EQ((*layer.p["b"]).rows(), 1);
@@ -314,7 +318,7 @@ TEST_F(Conv5x5x1Filter1x2x2s3Float, Backward) {
 
 	// Check resulting dW gradient.
 	for (size_t i=0; i<4; i++)
-	ASSERT_EQ((*desired_dW)[i], (*layer.g["W0x0"])[i]);
+	ASSERT_EQ((*desired_dW)[i], layer.getFilterGradientSlice(0,0)[i]);
 }
 
 /*!
@@ -353,6 +357,359 @@ TEST_F(Conv7x7x3Filter3x3x3s2Float, Forward) {
 
 
 
+/*!
+ * Checks whether the im2col and direct engines return the same outputs and gradients for layers of different geometries.
+ * \author tkornuta
+ */
+TEST(Convolutions, Im2ColEngineVsDirect) {
+	// Geometries: input height, width, channels, number of filters, filter size, stride.
+	size_t geometries[][6] = {
+			{2, 2, 2, 2, 1, 1},
+			{3, 3, 2, 3, 2, 1},
+			{5, 6, 1, 1, 4, 1},
+			{7, 7, 3, 2, 3, 2},
+			{10, 13, 2, 3, 4, 3},
+			{28, 28, 1, 4, 3, 1}
+	};
+	size_t batch_size = 3;
+
+	for (auto& gm : geometries) {
+		mic::mlnn::convolution::Convolution<double> im2col(gm[0], gm[1], gm[2], gm[3], gm[4], gm[5]);
+		mic::mlnn::convolution::Convolution<double> direct(gm[0], gm[1], gm[2], gm[3], gm[4], gm[5]);
+		im2col.setEngine(mic::mlnn::convolution::ConvolutionEngine::Im2Col);
+		direct.setEngine(mic::mlnn::convolution::ConvolutionEngine::Direct);
+		im2col.resizeBatch(batch_size);
+		direct.resizeBatch(batch_size);
+
+		// Use the same parameters in both layers.
+		std::map<std::string, size_t> keys = im2col.p.keys();
+		for (auto& i: keys) {
+			im2col.p[i.first]->rand(-1.0, 1.0);
+			(*direct.p[i.first]) = (*im2col.p[i.first]);
+		}//: for
+
+		mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, im2col.inputSize(), batch_size);
+		x->rand(-1.0, 1.0);
+		mic::types::MatrixPtr<double> dy = MAKE_MATRIX_PTR(double, im2col.outputSize(), batch_size);
+		dy->rand(-1.0, 1.0);
+
+		// Compare outputs.
+		mic::types::MatrixPtr<double> y1 = im2col.forward(x);
+		mic::types::MatrixPtr<double> y2 = direct.forward(x);
+		for (size_t i=0; i<(size_t)y1->size(); i++)
+			ASSERT_NEAR((*y1)[i], (*y2)[i], 1e-10) << "y at position " << i;
+
+		// Compare gradients.
+		mic::types::MatrixPtr<double> dx1 = im2col.backward(dy);
+		mic::types::MatrixPtr<double> dx2 = direct.backward(dy);
+		for (size_t i=0; i<(size_t)dx1->size(); i++)
+			ASSERT_NEAR((*dx1)[i], (*dx2)[i], 1e-10) << "dx at position " << i;
+
+		for (auto& i: keys) {
+			mic::types::MatrixPtr<double> dp1 = im2col.g[i.first];
+			mic::types::MatrixPtr<double> dp2 = direct.g[i.first];
+			for (size_t j=0; j<(size_t)dp1->size(); j++)
+				ASSERT_NEAR((*dp1)[j], (*dp2)[j], 1e-10) << "d" << i.first << " at position " << j;
+		}//: for
+	}//: for geometries
+}
+
+
+/*!
+ * Checks whether the Winograd engine returns the same results as the direct one - also after an update of filters.
+ */
+TEST(Convolutions, WinogradEngineVsDirect) {
+	// Geometries: input height, width, channels, number of filters.
+	size_t geometries[][4] = {
+			{3, 3, 1, 1},
+			{4, 4, 2, 3},
+			{5, 6, 3, 2},
+			{7, 9, 2, 4},
+			{28, 28, 1, 4},
+			{12, 12, 16, 8}
+	};
+	size_t batch_size = 3;
+
+	for (auto& gm : geometries) {
+		mic::mlnn::convolution::Convolution<double> winograd(gm[0], gm[1], gm[2], gm[3], 3, 1);
+		mic::mlnn::convolution::Convolution<double> direct(gm[0], gm[1], gm[2], gm[3], 3, 1);
+		winograd.setEngine(mic::mlnn::convolution::ConvolutionEngine::Winograd);
+		direct.setEngine(mic::mlnn::convolution::ConvolutionEngine::Direct);
+		ASSERT_TRUE(winograd.useWinograd());
+		winograd.resizeBatch(batch_size);
+		direct.resizeBatch(batch_size);
+
+		// Use the same parameters in both layers.
+		std::map<std::string, size_t> keys = winograd.p.keys();
+		for (auto& i: keys) {
+			winograd.p[i.first]->rand(-1.0, 1.0);
+			(*direct.p[i.first]) = (*winograd.p[i.first]);
+		}//: for
+
+		mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, winograd.inputSize(), batch_size);
+		x->rand(-1.0, 1.0);
+		mic::types::MatrixPtr<double> dy = MAKE_MATRIX_PTR(double, winograd.outputSize(), batch_size);
+		dy->rand(-1.0, 1.0);
+
+		// Two iterations - the second one checks whether the cached filter transforms were refreshed after the update.
+		for (size_t it=0; it< 2; it++) {
+			// Compare outputs.
+			mic::types::MatrixPtr<double> y1 = winograd.forward(x);
+			mic::types::MatrixPtr<double> y2 = direct.forward(x);
+			for (size_t i=0; i<(size_t)y1->size(); i++)
+				ASSERT_NEAR((*y1)[i], (*y2)[i], 1e-10) << "y at position " << i;
+
+			// Compare gradients.
+			mic::types::MatrixPtr<double> dx1 = winograd.backward(dy);
+			mic::types::MatrixPtr<double> dx2 = direct.backward(dy);
+			for (size_t i=0; i<(size_t)dx1->size(); i++)
+				ASSERT_NEAR((*dx1)[i], (*dx2)[i], 1e-10) << "dx at position " << i;
+
+			for (auto& i: keys) {
+				mic::types::MatrixPtr<double> dp1 = winograd.g[i.first];
+				mic::types::MatrixPtr<double> dp2 = direct.g[i.first];
+				for (size_t j=0; j<(size_t)dp1->size(); j++)
+					ASSERT_NEAR((*dp1)[j], (*dp2)[j], 1e-10) << "d" << i.first << " at position " << j;
+			}//: for
+
+			winograd.update(0.1);
+			direct.update(0.1);
+		}//: for iterations
+	}//: for geometries
+}
+
+
+/*!
+ * Checks whether the Winograd and Auto engines fall back to im2col in case of filters other than 3x3 with stride 1 (and, in the case of Auto, too few channels).
+ */
+TEST(Convolutions, WinogradEngineFallback) {
+	mic::mlnn::convolution::Convolution<double> s2(7, 7, 8, 8, 3, 2);
+	mic::mlnn::convolution::Convolution<double> f2(7, 7, 8, 8, 2, 1);
+	mic::mlnn::convolution::Convolution<double> f3(7, 7, 8, 8, 3, 1);
+	mic::mlnn::convolution::Convolution<double> c1(7, 7, 1, 8, 3, 1);
+
+	// Auto engine.
+	ASSERT_EQ(s2.getEngine(), mic::mlnn::convolution::ConvolutionEngine::Auto);
+	ASSERT_FALSE(s2.useWinograd());
+	ASSERT_FALSE(f2.useWinograd());
+	ASSERT_TRUE(f3.useWinograd());
+	ASSERT_FALSE(c1.useWinograd());
+
+	// Winograd engine.
+	s2.setEngine(mic::mlnn::convolution::ConvolutionEngine::Winograd);
+	f2.setEngine(mic::mlnn::convolution::ConvolutionEngine::Winograd);
+	c1.setEngine(mic::mlnn::convolution::ConvolutionEngine::Winograd);
+	ASSERT_FALSE(s2.useWinograd());
+	ASSERT_FALSE(f2.useWinograd());
+	ASSERT_TRUE(c1.useWinograd());
+
+	// Other engines.
+	f3.setEngine(mic::mlnn::convolution::ConvolutionEngine::Im2Col);
+	ASSERT_FALSE(f3.useWinograd());
+	f3.setEngine(mic::mlnn::convolution::ConvolutionEngine::Direct);
+	ASSERT_FALSE(f3.useWinograd());
+}
+
+
+/*!
+ * Checks whether results of the batch-parallel passes do not depend on the number of threads.
+ */
+TEST(Convolutions, BatchParallelVsSequential) {
+#ifdef _OPENMP
+	int max_threads = omp_get_max_threads();
+	size_t batch_size = 7;
+
+	for (auto engine : {mic::mlnn::convolution::ConvolutionEngine::Direct, mic::mlnn::convolution::ConvolutionEngine::Im2Col}) {
+		mic::mlnn::convolution::Convolution<double> layer(10, 13, 2, 3, 4, 3);
+		layer.setEngine(engine);
+		layer.resizeBatch(batch_size);
+
+		mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, layer.inputSize(), batch_size);
+		x->rand(-1.0, 1.0);
+		mic::types::MatrixPtr<double> dy = MAKE_MATRIX_PTR(double, layer.outputSize(), batch_size);
+		dy->rand(-1.0, 1.0);
+
+		// Sequential passes.
+		omp_set_num_threads(1);
+		mic::types::Matrix<double> y1 = (*layer.forward(x));
+		mic::types::Matrix<double> dx1 = (*layer.backward(dy));
+		mic::types::Matrix<double> dW1 = (*layer.g["W"]);
+
+		// Parallel passes.
+		omp_set_num_threads(4);
+		mic::types::Matrix<double> y2 = (*layer.forward(x));
+		mic::types::Matrix<double> dx2 = (*layer.backward(dy));
+		mic::types::Matrix<double> dW2 = (*layer.g["W"]);
+		omp_set_num_threads(max_threads);
+
+		for (size_t i=0; i<(size_t)y1.size(); i++)
+			ASSERT_EQ(y1(i), y2(i)) << "y at position " << i;
+		for (size_t i=0; i<(size_t)dx1.size(); i++)
+			ASSERT_EQ(dx1(i), dx2(i)) << "dx at position " << i;
+		for (size_t i=0; i<(size_t)dW1.size(); i++)
+			ASSERT_NEAR(dW1(i), dW2(i), 1e-10) << "dW at position " << i;
+	}//: for engines
+#endif
+}
+
+
+/*!
+ * Checks whether filters stored in the old format (every filter slice as a separate "W{fi}x{ic}" matrix) are properly repacked into the filter tensor.
+ * \author tkornuta
+ */
+TEST(Convolutions, RepackLegacyFilters) {
+	mic::mlnn::convolution::Convolution<double> reference(7,7,3,2,3,2);
+	mic::mlnn::convolution::Convolution<double> legacy(7,7,3,2,3,2);
+	reference.p["b"]->rand(-1.0, 1.0);
+
+	// Store parameters of the reference layer in the old format.
+	legacy.p = mic::types::MatrixArray<double>("parameters");
+	for (size_t fi=0; fi<2; fi++)
+		for (size_t ic=0; ic<3; ic++)
+			legacy.p.add("W"+std::to_string(fi)+"x"+std::to_string(ic), MAKE_MATRIX_PTR(double, reference.getFilterSlice(fi,ic)));
+	legacy.p.add("b", MAKE_MATRIX_PTR(double, *reference.p["b"]));
+	legacy.filter_size = 0;
+	legacy.stride = 0;
+
+	legacy.repackLegacyFilters();
+	ASSERT_EQ(legacy.filter_size, 3);
+	ASSERT_EQ(legacy.stride, 2);
+	ASSERT_EQ(legacy.p.keys().size(), 2);
+	ASSERT_EQ(legacy.g["W"]->rows(), 3*3*3);
+	ASSERT_EQ(legacy.g["W"]->cols(), 2);
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 7*7*3, 1);
+	x->rand(-1.0, 1.0);
+	mic::types::MatrixPtr<double> y1 = MAKE_MATRIX_PTR(double, *reference.forward(x));
+	mic::types::MatrixPtr<double> y2 = legacy.forward(x);
+	for (size_t i=0; i<(size_t)y1->size(); i++)
+		ASSERT_EQ((*y1)[i], (*y2)[i]) << "at position " << i;
+}
+
+
+/*!
+ * Checks max pooling with overlapping windows (3x3, stride 2) on a batch of multi-channel samples against a naive implementation,
+ * along with the accumulation of gradients of the overlapping windows - for different numbers of threads.
+ */
+TEST(MaxPooling, OverlappingWindowsVsNaive) {
+	size_t batch_size = 5, height = 7, width = 9, depth = 3, window = 3, stride = 2;
+	mic::mlnn::convolution::MaxPooling<double> layer(height, width, depth, window, stride);
+	ASSERT_EQ(layer.output_height, 3);
+	ASSERT_EQ(layer.output_width, 4);
+	layer.resizeBatch(batch_size);
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, layer.inputSize(), batch_size);
+	x->rand(-1.0, 1.0);
+	mic::types::MatrixPtr<double> dy = MAKE_MATRIX_PTR(double, layer.outputSize(), batch_size);
+	dy->rand(-1.0, 1.0);
+
+	// Naive max pooling - channels are stored column-major.
+	mic::types::Matrix<double> y_ref(layer.outputSize(), batch_size);
+	mic::types::Matrix<double> dx_ref(layer.inputSize(), batch_size);
+	dx_ref.setZero();
+	for (size_t ib=0; ib< batch_size; ib++)
+		for (size_t ic=0; ic< depth; ic++)
+			for (size_t oh=0; oh< 3; oh++)
+				for (size_t ow=0; ow< 4; ow++) {
+					size_t max_i = 0;
+					double max_val = -2.0;
+					for (size_t h=oh*stride; h< oh*stride+window; h++)
+						for (size_t w=ow*stride; w< ow*stride+window; w++) {
+							size_t i = ic*height*width + w*height + h;
+							if ((*x)(i, ib) > max_val) {
+								max_val = (*x)(i, ib);
+								max_i = i;
+							}//: if
+						}//: for
+					size_t o = ic*3*4 + ow*3 + oh;
+					y_ref(o, ib) = max_val;
+					dx_ref(max_i, ib) += (*dy)(o, ib);
+				}//: for
+
+	std::vector<int> threads = {1};
+#ifdef _OPENMP
+	int max_threads = omp_get_max_threads();
+	threads.push_back(4);
+#endif
+	for (int t : threads) {
+#ifdef _OPENMP
+		omp_set_num_threads(t);
+#endif
+		mic::types::Matrix<double> y = (*layer.forward(x));
+		mic::types::Matrix<double> dx = (*layer.backward(dy));
+		for (size_t i=0; i<(size_t)y.size(); i++)
+			ASSERT_EQ(y(i), y_ref(i)) << "y at position " << i << " for " << t << " threads";
+		for (size_t i=0; i<(size_t)dx.size(); i++)
+			ASSERT_NEAR(dx(i), dx_ref(i), 1e-12) << "dx at position " << i << " for " << t << " threads";
+	}//: for
+#ifdef _OPENMP
+	omp_set_num_threads(max_threads);
+#endif
+}
+
+
+/*!
+ * Checks whether the default (non-overlapping) max pooling handles inputs not divisible by the window and resized batches.
+ */
+TEST(MaxPooling, NonOverlappingWindows) {
+	mic::mlnn::convolution::MaxPooling<float> layer(5, 4, 1, 2);
+	ASSERT_EQ(layer.stride, 2);
+	ASSERT_EQ(layer.outputSize(), 4);
+
+	// Single channel 5x4 (column-major), samples differ by sign.
+	mic::types::MatrixPtr<float> x = MAKE_MATRIX_PTR(float, 20, 2);
+	for (size_t i=0; i< 20; i++) {
+		(*x)(i, 0) = (float)i;
+		(*x)(i, 1) = -(float)i;
+	}//: for
+	layer.resizeBatch(2);
+	mic::types::MatrixPtr<float> y = layer.forward(x);
+	float expected[2][4] = {{6, 8, 16, 18}, {0, -2, -10, -12}};
+	for (size_t ib=0; ib< 2; ib++)
+		for (size_t o=0; o< 4; o++)
+			ASSERT_EQ((*y)(o, ib), expected[ib][o]) << "sample " << ib << " output " << o;
+
+	mic::types::MatrixPtr<float> dy = MAKE_MATRIX_PTR(float, 4, 2);
+	dy->setOnes();
+	mic::types::MatrixPtr<float> dx = layer.backward(dy);
+	ASSERT_EQ(dx->sum(), 8);
+	ASSERT_EQ((*dx)(6, 0), 1);
+	ASSERT_EQ((*dx)(0, 1), 1);
+	ASSERT_EQ((*dx)(4, 1), 0);
+}
+
+/*!
+ * \brief Checks whether backward pass of the cropping layer passes the gradients of the kept elements and zeroes the gradients of the cropped border
+ * (even if the gradient of the input contains values from previous batches).
+ */
+TEST(Cropping, BackwardZeroesBorder) {
+	// Single channel 4x4 cropped to 2x2.
+	mic::mlnn::convolution::Cropping<float> layer(4, 4, 1, 1);
+	ASSERT_EQ(layer.outputSize(), 4);
+
+	mic::types::MatrixPtr<float> x = MAKE_MATRIX_PTR(float, 16, 2);
+	for (size_t i=0; i< 16; i++) {
+		(*x)(i, 0) = (float)i;
+		(*x)(i, 1) = -(float)i;
+	}//: for
+	layer.resizeBatch(2);
+	mic::types::MatrixPtr<float> y = layer.forward(x);
+	float expected[4] = {5, 6, 9, 10};
+	for (size_t ib=0; ib< 2; ib++)
+		for (size_t o=0; o< 4; o++)
+			ASSERT_EQ((*y)(o, ib), (ib == 0 ? 1 : -1) * expected[o]) << "sample " << ib << " output " << o;
+
+	// Stale gradients.
+	layer.g["x"]->setConstant(7);
+	mic::types::MatrixPtr<float> dy = MAKE_MATRIX_PTR(float, 4, 2);
+	dy->setOnes();
+	mic::types::MatrixPtr<float> dx = layer.backward(dy);
+	for (size_t ib=0; ib< 2; ib++)
+		for (size_t i=0; i< 16; i++) {
+			bool kept = (i == 5) || (i == 6) || (i == 9) || (i == 10);
+			ASSERT_EQ((*dx)(i, ib), kept ? 1 : 0) << "sample " << ib << " input " << i;
+		}//: for
+}
 
 } } } //: namespaces
 
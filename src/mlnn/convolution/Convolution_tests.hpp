@@ -31,6 +31,8 @@
 #define private public
 #define protected public
 #include <mlnn/convolution/Convolution.hpp>
+#include <mlnn/convolution/MaxPooling.hpp>
+#include <mlnn/convolution/Cropping.hpp>
 #include <loss/LossTypes.hpp>
 
 namespace mic { namespace neural_nets { namespace unit_tests {
@@ -64,11 +66,11 @@ public:
 protected:
 	// Sets values
 	virtual void SetUp() {
-		(*layer.p["W0x0"]) << 0;
-		(*layer.p["W0x1"]) << 2;
+		layer.getFilterSlice(0,0) << 0;
+		layer.getFilterSlice(0,1) << 2;
 
-		(*layer.p["W1x0"]) << 3;
-		(*layer.p["W1x1"]) << 1;
+		layer.getFilterSlice(1,0) << 3;
+		layer.getFilterSlice(1,1) << 1;
 
 		// Set biases of both neurons.
 		(*layer.p["b"]) << 0, 1;
@@ -135,14 +137,14 @@ public:
 protected:
 	// Sets values
 	virtual void SetUp() {
-		(*layer.p["W0x0"]) << 0, 1, 1, 0;
-		(*layer.p["W0x1"]) << 0, -1, -1, 0;
+		layer.getFilterSlice(0,0) << 0, 1, 1, 0;
+		layer.getFilterSlice(0,1) << 0, -1, -1, 0;
 
-		(*layer.p["W1x0"]) << -1, 0, 0, 1;
-		(*layer.p["W1x1"]) << 1, 0, 0, -1;
+		layer.getFilterSlice(1,0) << -1, 0, 0, 1;
+		layer.getFilterSlice(1,1) << 1, 0, 0, -1;
 
-		(*layer.p["W2x0"]) << 0, 0, 1, 1;
-		(*layer.p["W2x1"]) << 0, 0, -1, -1;
+		layer.getFilterSlice(2,0) << 0, 0, 1, 1;
+		layer.getFilterSlice(2,1) << 0, 0, -1, -1;
 
 		// Set biases of all three neurons.
 		(*layer.p["b"]) << 1, 0, -1;
@@ -191,7 +193,7 @@ public:
 protected:
 	// Sets values
 	virtual void SetUp() {
-		(*layer.p["W0x0"]) << 0, 1, 2, 3;
+		layer.getFilterSlice(0,0) << 0, 1, 2, 3;
 
 		// Set biases of both neurons.
 		(*layer.p["b"]) << 0;
@@ -259,9 +261,9 @@ public:
 protected:
 	// Sets values
 	virtual void SetUp() {
-		(*layer.p["W0x0"]) << 0;
-		(*layer.p["W1x0"]) << 1;
-		(*layer.p["W2x0"]) << 2;
+		layer.getFilterSlice(0,0) << 0;
+		layer.getFilterSlice(1,0) << 1;
+		layer.getFilterSlice(2,0) << 2;
 
 		// Set biases of neurons.
 		(*layer.p["b"]) << -1, 0, 1;
@@ -328,7 +330,7 @@ public:
 protected:
 	// Sets values
 	virtual void SetUp() {
-		(*layer.p["W0x0"]) << 1, 0, 1, 0, 1, 0, 1, 0, 1;
+		layer.getFilterSlice(0,0) << 1, 0, 1, 0, 1, 0, 1, 0, 1;
 		(*layer.p["b"]) << 0;
 
 		(*x) << 1, 1, 1, 0, 0, 0, 1, 1, 1, 0, 0, 0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0;
@@ -379,7 +381,7 @@ public:
 protected:
 	// Sets values
 	virtual void SetUp() {
-		(*layer.p["W0x0"]).enumerate();
+		(*layer.p["W"]).enumerate();
 		(*layer.p["b"]) << 0;
 
 		(*x).enumerate();
@@ -438,14 +440,14 @@ protected:
 	virtual void SetUp() {
 
 		// Set weights of first neuron.
-		(*layer.p["W0x0"]) << 0, -1, 0, 0, 1, -1, 1, 1, -1;
-		(*layer.p["W0x1"]) << 1, 0, 1, 0, -1, -1, 1, 1, -1;
-		(*layer.p["W0x2"]) << 1, 1, 0, -1, 1, -1, 1, 0, 1;
+		layer.getFilterSlice(0,0) << 0, -1, 0, 0, 1, -1, 1, 1, -1;
+		layer.getFilterSlice(0,1) << 1, 0, 1, 0, -1, -1, 1, 1, -1;
+		layer.getFilterSlice(0,2) << 1, 1, 0, -1, 1, -1, 1, 0, 1;
 
 		// Set weights of second neuron.
-		(*layer.p["W1x0"]) << 1, 1, -1, -1, -1, 1, 0, -1, -1;
-		(*layer.p["W1x1"]) << 0, 1, 1, -1, 1, -1, 0, -1, -1;
-		(*layer.p["W1x2"]) << 0, 0, 0, 1, 1, -1, -1, 0, 1;
+		layer.getFilterSlice(1,0) << 1, 1, -1, -1, -1, 1, 0, -1, -1;
+		layer.getFilterSlice(1,1) << 0, 1, 1, -1, 1, -1, 0, -1, -1;
+		layer.getFilterSlice(1,2) << 0, 0, 0, 1, 1, -1, -1, 0, 1;
 
 		// Set biases of both neurons.
 		(*layer.p["b"]) << 1, 0;
@@ -519,12 +521,10 @@ public:
 protected:
 	// Sets values
 	virtual void SetUp() {
-		for (size_t i=0; i<16; i++)
-			(*layer.p["W0x0"])(i) = i+1;
-		(*layer.p["W0x0"]).resize(4,4);
-		(*layer.p["W0x0"]).transposeInPlace();
-		//std::cout<<"*layer.p[W00] = \n" << (*layer.p["W00"]) << std::endl;
-		(*layer.p["W0x0"]).resize(1, 4*4);
+		// Filter with values enumerated in rows.
+		for (size_t i=0; i<4; i++)
+			for (size_t j=0; j<4; j++)
+				layer.getFilterSlice(0,0)(i + 4*j) = 4*i + j + 1;
 
 		// Set neuron bias.
 		(*layer.p["b"]) << 0;
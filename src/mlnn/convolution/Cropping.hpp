@@ -68,11 +68,11 @@ public:
 	void forward(bool test = false) {
 
 		// Get pointer to input batch.
-		mic::types::MatrixPtr<eT> batch_x = s['x'];
+		mic::types::MatrixPtr<eT> batch_x = s[hx];
 		LOG(LTRACE) << "Cropping::forward input x activation: min:" << (*batch_x).minCoeff() <<" max: " << (*batch_x).maxCoeff() << std::endl;
 
 		// Get pointer to output batch - so the results will be stored!
-		mic::types::MatrixPtr<eT> batch_y = s['y'];
+		mic::types::MatrixPtr<eT> batch_y = s[hy];
 		batch_y->setZero();
 
 		// TODO: should work for more channels - but requires testing!
@@ -111,14 +111,15 @@ public:
 	void backward() {
 		LOG(LTRACE) << "Cropping::backward\n";
 		// Get pointer to dy batch.
-		mic::types::MatrixPtr<eT> batch_dy = g['y'];
+		mic::types::MatrixPtr<eT> batch_dy = g[hy];
 
 		//std::cout << "batch_dy [batch x height x width] = " << batch_size << " x " << output_height << " x " << output_width << std::endl;
 		//std::cout << "batch_dx [batch x height x width] = " << batch_size << " x " << input_height << " x " << input_width << std::endl;
 
 		// Get pointer to dx batch.
-		mic::types::MatrixPtr<eT> batch_dx = g['x'];
-		//batch_dx->setZero();
+		mic::types::MatrixPtr<eT> batch_dx = g[hx];
+		// Gradients of the cropped border are zero.
+		batch_dx->setZero();
 
 		// Iterate through batch.
 		//#pragma omp parallel for
@@ -148,6 +149,20 @@ public:
 		LOG(LTRACE) << "Cropping::backward end\n";
 	}
 
+	/*!
+	 * Backward pass only copies the gradients - neither the input...
+	 */
+	virtual bool backwardUsesInput() {
+		return false;
+	}
+
+	/*!
+	 * ... nor the output are needed.
+	 */
+	virtual bool backwardUsesOutput() {
+		return false;
+	}
+
 	/*!
 	 * Update - empty as this layer is not "plastic".
 	 * @param alpha_ Learning rate - passed to the optimization functions of all layers.
@@ -163,6 +178,8 @@ protected:
 	// Unhide the fields inherited from the template class Layer via "using" statement.
     using Layer<eT>::g;
     using Layer<eT>::s;
+    using Layer<eT>::hx;
+    using Layer<eT>::hy;
     using Layer<eT>::p;
     using Layer<eT>::m;
 
@@ -182,6 +199,15 @@ private:
 	// Friend class - required for using boost serialization.
 	template<typename tmp> friend class mic::mlnn::MultiLayerNeuralNetwork;
 
+	/*!
+	 * Serializes the parameters specific to the layer type (not stored by Layer::serialize).
+	 * @param ar Used archive.
+	 */
+	template<class Archive>
+	void serializeConfiguration(Archive & ar) {
+		ar & cropping;
+	}
+
 	/*!
 	 * Private constructor, used only during the serialization.
 	 */
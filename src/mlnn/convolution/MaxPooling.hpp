@@ -15,7 +15,7 @@
  */
 /*!
  * \file Pooling.hpp
- * \brief 
+ * \brief Layer performing max pooling.
  * \author tkornut
  * \date Mar 31, 2016
  */
@@ -24,6 +24,11 @@
 #define SRC_MLNN_POOLING_HPP_
 
 #include <mlnn/layer/Layer.hpp>
+#include <mlnn/activation_function/ActivationKernels.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
 
 namespace mic {
 namespace mlnn {
@@ -41,7 +46,7 @@ public:
 
 
 	/*!
-	 * Creates a max pooling layer.
+	 * Creates a max pooling layer with non-overlapping windows.
 	 * @param input_height_ Height of the input sample.
 	 * @param input_width_ Width of the input sample.
 	 * @param depth_ Depth of the input/output sample.
@@ -51,13 +56,32 @@ public:
 	MaxPooling(size_t input_height_, size_t input_width_, size_t depth_,
 			size_t window_size_,
 			std::string name_ = "MaxPooling") :
+		MaxPooling(input_height_, input_width_, depth_, window_size_, window_size_, name_)
+	{
+
+	}
+
+	/*!
+	 * Creates a max pooling layer.
+	 * @param input_height_ Height of the input sample.
+	 * @param input_width_ Width of the input sample.
+	 * @param depth_ Depth of the input/output sample.
+	 * @param window_size_ Max pooling window in each channel (width and height).
+	 * @param stride_ Stride of the window (windows overlap when smaller than window size).
+	 * @param name_ Name of the layer.
+	 */
+	MaxPooling(size_t input_height_, size_t input_width_, size_t depth_,
+			size_t window_size_, size_t stride_,
+			std::string name_ = "MaxPooling") :
 		Layer<eT>::Layer(input_height_, input_width_, depth_,
-				(input_height_ /window_size_), (input_width_ / window_size_), depth_,
+				(input_height_ - window_size_) / stride_ + 1, (input_width_ - window_size_) / stride_ + 1, depth_,
 				LayerTypes::MaxPooling, name_),
-				window_size(window_size_)
+				window_size(window_size_),
+				stride(stride_)
 	{
-		// Mapping from input to output - every cell will contain address of input image.
-		m.add("pooling_map", Layer<eT>::outputSize(), 1);
+		assert(input_height_ >= window_size_);
+		assert(input_width_ >= window_size_);
+		assert(stride_ > 0);
 	};
 
 	/*!
@@ -66,112 +90,114 @@ public:
 	virtual ~MaxPooling() {};
 
 	/*!
-	 * Changes the size of the batch - calls base Layer class resize and additionally resizes the cache size.
-	 * @param New size of the batch.
+	 * Forward pass.
+	 * @param test_ It is set to true in test mode (network verification).
 	 */
-	virtual void resizeBatch(size_t batch_size_) {
-		// Call base Layer resize.
-		Layer<eT>::resizeBatch(batch_size_);
-
-		// Reshape pooling mask and map.
-		m["pooling_map"]->resize(Layer<eT>::outputSize(), batch_size_);
-
-	}
-
-
 	void forward(bool test_ = false) {
 		LOG(LTRACE) << "MaxPooling::forward\n";
-
-		// Get pointer to input batch.
-		mic::types::MatrixPtr<eT> batch_x = s['x'];
-		//std::cout<< "forward batch_x=\n" << (*batch) << std::endl;
-		//std::cout << "forward input x activation: min:" << (*batch_x).minCoeff() <<" max: " << (*batch_x).maxCoeff() << std::endl;
-
-		// Get pointer to output batch - so the results will be stored!
-		mic::types::MatrixPtr<eT> batch_y = s['y'];
-		// Reset the whole batch.
-		batch_y->setZero();
-
-		// Get pointer to the mask.
-		mic::types::MatrixPtr<eT> pooling_map = m["pooling_map"];
-		pooling_map->setZero();
-
-		// TODO: should work for more channels - but requires testing!
-		//assert(input_depth == 1);
-
-		// Iterate through batch - cannot be done in parallel:
-		// * pooling mask is shared (ok)
-		// * tmp variables storing input samples/channels are multiplied and OMP secured (ok)
-		// * pooling mask and output batch are edited on different addresses - OMP secured (ok)
-		#pragma omp parallel for
-		for (size_t ib = 0; ib < batch_size; ib++) {
-			// Get input sample from batch.
-			mic::types::MatrixPtr<eT> xs = lazyReturnInputSample(batch_x, ib);
-
-			// Iterate through input/output channels.
-			for (size_t ic=0; ic< input_depth; ic++) {
-				// Get input channel from input sample.
-				mic::types::MatrixPtr<eT> xc = lazyReturnInputChannel(xs, ib, ic);
-
-				// Iterate through "blocks" in a given channel.
-				for (size_t ih=0, oh=0; ih< input_height; ih+=window_size, oh++) {
-					for (size_t iw=0, ow=0; iw< input_width; iw+=window_size, ow++) {
-
-					#pragma omp critical
-					{
-						// Get location of max element.
-						size_t maxRow, maxCol;
-						eT max_val = xc->block(ih, iw, window_size, window_size).maxCoeff(&maxRow, &maxCol);
-
-						//std::cout << "xc->block(ih, iw, window_size, window_size) = " <<xc->block(ih, iw, window_size, window_size) <<std::endl;
-						//std::cout << " maxRow = " << maxRow << " maxCol = "<< maxCol << " max_val = "<< max_val << std::endl;
-
-						// Calculate "absolute addresses.
-						size_t ia = (ib * Layer<eT>::inputSize()) + ic * input_height * input_width + (iw + maxCol) * input_height + (ih + maxRow);
-						size_t oa = (ib * Layer<eT>::outputSize()) + ic * output_height * output_width + (ow) * output_height + (oh);
-						/*std::cout << " ih = " << ih << " iw = " << iw << " ia = " << ia << std::endl;
-						std::cout << " oh = " << oh << " ow = " << ow << " oa = " << oa << std::endl;*/
-
-						// Map output to input.
-						(*pooling_map)[oa] = ia;
-
-						// Copy value to output.
-						(*batch_y)[oa] = max_val;
-					}
-
-					}//: for width
-				}//: for width
-			}//: for channels
-		}//: for batch
+		pool(s[hx]->data(), s[hy]->data());
 		LOG(LTRACE) << "MaxPooling::forward end\n";
 	}
 
 	/*!
-	 * Backward pass.
+	 * Backward pass - passes the gradients to the max elements (accumulating them when windows overlap).
 	 */
 	void backward() {
 		LOG(LTRACE) << "MaxPooling::backward\n";
+		unpool<mic::mlnn::activation_function::kernels::IdentityBackward<eT> >(s[hy]->data(), g[hy]->data(), g[hx]->data());
+		LOG(LTRACE) << "MaxPooling::backward end\n";
+	}
 
-		// Get pointer to dy batch.
-		mic::types::MatrixPtr<eT> batch_dy = g['y'];
+	/*!
+	 * Backward pass routes the gradients through the pooling map, so the input is not needed.
+	 */
+	virtual bool backwardUsesInput() {
+		return false;
+	}
 
-		// Get pointer to dx batch.
-		mic::types::MatrixPtr<eT> batch_dx = g['x'];
-		batch_dx->setZero();
+	/*!
+	 * The output is not needed either.
+	 */
+	virtual bool backwardUsesOutput() {
+		return false;
+	}
+
+	/*!
+	 * Pools the batch and stores positions of the max elements in the pooling map. Samples and channels are processed in parallel - every one reads its own input channel
+	 * directly from the batch and writes its own (disjoint) part of the output and pooling map, so no synchronization is required.
+	 * @param batch_x_ Input batch.
+	 * @param batch_y_ Output batch.
+	 */
+	void pool(const eT* batch_x_, eT* batch_y_) {
+		// Every output stores the position of the max element in the input sample.
+		pooling_map.resize(Layer<eT>::outputSize() * batch_size);
+		int32_t* map = pooling_map.data();
 
-		mic::types::MatrixPtr<eT> pooling_map = m["pooling_map"];
+		const size_t input_size = Layer<eT>::inputSize();
+		const size_t output_size = Layer<eT>::outputSize();
 
-		// Iterate through batch.
 		#pragma omp parallel for
-		for (size_t oi = 0; oi < batch_size * Layer<eT>::outputSize(); oi++) {
+		for (size_t ibc = 0; ibc < batch_size * input_depth; ibc++) {
+			size_t ib = ibc / input_depth;
+			size_t ic = ibc % input_depth;
+			// Offsets of the channel in the input and output sample.
+			size_t ic_offset = ic * input_height * input_width;
+			size_t oc_offset = ic * output_height * output_width;
+			const eT* xs = batch_x_ + ib * input_size;
+
+			// Iterate through windows - channels are stored column-major.
+			for (size_t ow=0; ow< output_width; ow++) {
+				for (size_t oh=0; oh< output_height; oh++) {
+					size_t first = ic_offset + (ow * stride) * input_height + (oh * stride);
+					size_t max_index = first;
+					eT max_val = xs[first];
+					for (size_t iw=0; iw< window_size; iw++) {
+						const eT* column = xs + first + iw * input_height;
+						for (size_t ih=0; ih< window_size; ih++) {
+							if (column[ih] > max_val) {
+								max_val = column[ih];
+								max_index = first + iw * input_height + ih;
+							}//: if
+						}//: for height
+					}//: for width
 
-			// Map outputs to inputs.
-			//std::cout << " oi = " << oi << " (*pooling_map)[oi] = " << (*pooling_map)[oi] << std::endl;
-			(*batch_dx)[(size_t)(*pooling_map)[oi]] = (*batch_dy)[oi];
+					size_t oa = ib * output_size + oc_offset + ow * output_height + oh;
+					batch_y_[oa] = max_val;
+					map[oa] = (int32_t)max_index;
+				}//: for height
+			}//: for width
+		}//: for samples and channels
+	}
 
-		}//: for batch
+	/*!
+	 * Passes the gradients to the max elements found by the last pool(), transformed by the gradient operation: dx[max] += op(y, dy)
+	 * (e.g. by the derivative of an activation function applied to the pooled outputs). Samples and channels are processed in parallel, as every one maps to a disjoint part of dx.
+	 * @param batch_y_ Output batch (passed to the gradient operation).
+	 * @param batch_dy_ Gradient of the output batch.
+	 * @param batch_dx_ Gradient of the input batch (zeroed first).
+	 * @tparam GradientOp Gradient operation.
+	 */
+	template <typename GradientOp>
+	void unpool(const eT* batch_y_, const eT* batch_dy_, eT* batch_dx_) {
+		GradientOp op;
+		const int32_t* map = pooling_map.data();
 
-		LOG(LTRACE) << "MaxPooling::backward end\n";
+		const size_t input_size = Layer<eT>::inputSize();
+		const size_t output_size = Layer<eT>::outputSize();
+		const size_t input_channel_size = input_height * input_width;
+		const size_t channel_size = output_height * output_width;
+
+		#pragma omp parallel for
+		for (size_t ibc = 0; ibc < batch_size * input_depth; ibc++) {
+			size_t ib = ibc / input_depth;
+			size_t ic = ibc % input_depth;
+			size_t first = ib * output_size + ic * channel_size;
+			eT* dxs = batch_dx_ + ib * input_size;
+			// Positions of the max elements lie in the same channel of dx.
+			std::fill(dxs + ic * input_channel_size, dxs + (ic + 1) * input_channel_size, (eT)0);
+			for (size_t oa = first; oa < first + channel_size; oa++)
+				dxs[map[oa]] += op(batch_y_[oa], batch_dy_[oa]);
+		}//: for samples and channels
 	}
 
 
@@ -190,6 +216,8 @@ protected:
 	// Unhide the fields inherited from the template class Layer via "using" statement.
     using Layer<eT>::g;
     using Layer<eT>::s;
+    using Layer<eT>::hx;
+    using Layer<eT>::hy;
     using Layer<eT>::p;
     using Layer<eT>::m;
 
@@ -202,21 +230,40 @@ protected:
 	using Layer<eT>::output_depth;
     using Layer<eT>::batch_size;
 
-    using Layer<eT>::lazyReturnInputSample;
-    using Layer<eT>::lazyReturnOutputSample;
-    using Layer<eT>::lazyReturnInputChannel;
-    using Layer<eT>::lazyReturnOutputChannel;
-
 	/*!
 	 * Size of the pooling window.
 	 */
 	size_t window_size;
 
+	/*!
+	 * Stride of the pooling window.
+	 */
+	size_t stride;
+
+	/*!
+	 * Positions of the max elements in the input samples, for every output of the batch (filled in forward, used in backward).
+	 */
+	std::vector<int32_t> pooling_map;
+
 private:
 	// Friend class - required for using boost serialization.
 	template<typename tmp> friend class mic::mlnn::MultiLayerNeuralNetwork;
 
 
+	/*!
+	 * Serializes the parameters specific to the layer type (not stored by Layer::serialize).
+	 * @param ar Used archive.
+	 * @param version_ Version of the configuration (stride is not present in older versions - the windows did not overlap).
+	 */
+	template<class Archive>
+	void serializeConfiguration(Archive & ar, const unsigned int version_) {
+		ar & window_size;
+		if (version_ >= 4)
+			ar & stride;
+		else
+			stride = window_size;
+	}
+
 	/*!
 	 * Private constructor, used only during the serialization.
 	 */
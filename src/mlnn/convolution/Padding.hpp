@@ -69,12 +69,12 @@ public:
 		LOG(LTRACE) << "Padding::forward\n";
 
 		// Get pointer to input batch.
-		mic::types::MatrixPtr<eT> batch_x = s['x'];
+		mic::types::MatrixPtr<eT> batch_x = s[hx];
 		//std::cout<< "forward batch_x=\n" << (*batch) << std::endl;
 		//std::cout << "forward input x activation: min:" << (*batch_x).minCoeff() <<" max: " << (*batch_x).maxCoeff() << std::endl;
 
 		// Get pointer to output batch - so the results will be stored!
-		mic::types::MatrixPtr<eT> batch_y = s['y'];
+		mic::types::MatrixPtr<eT> batch_y = s[hy];
 		batch_y->setZero();
 
 		// TODO: should work for more channels - but requires testing!
@@ -115,10 +115,10 @@ public:
 		LOG(LTRACE) << "Padding::backward\n";
 
 		// Get pointer to dy batch.
-		mic::types::MatrixPtr<eT> batch_dy = g['y'];
+		mic::types::MatrixPtr<eT> batch_dy = g[hy];
 
 		// Get pointer to dx batch.
-		mic::types::MatrixPtr<eT> batch_dx = g['x'];
+		mic::types::MatrixPtr<eT> batch_dx = g[hx];
 
 
 		// Iterate through batch.
@@ -145,6 +145,20 @@ public:
 		LOG(LTRACE) << "Padding::backward end\n";
 	}
 
+	/*!
+	 * Backward pass only copies the gradients - neither the input...
+	 */
+	virtual bool backwardUsesInput() {
+		return false;
+	}
+
+	/*!
+	 * ... nor the output are needed.
+	 */
+	virtual bool backwardUsesOutput() {
+		return false;
+	}
+
 	/*!
 	 * Update - empty as this layer is not "plastic".
 	 * @param alpha_ Learning rate - passed to the optimization functions of all layers.
@@ -160,6 +174,8 @@ protected:
 	// Unhide the fields inherited from the template class Layer via "using" statement.
     using Layer<eT>::g;
     using Layer<eT>::s;
+    using Layer<eT>::hx;
+    using Layer<eT>::hy;
     using Layer<eT>::p;
     using Layer<eT>::m;
 
@@ -179,6 +195,15 @@ private:
 	// Friend class - required for using boost serialization.
 	template<typename tmp> friend class mic::mlnn::MultiLayerNeuralNetwork;
 
+	/*!
+	 * Serializes the parameters specific to the layer type (not stored by Layer::serialize).
+	 * @param ar Used archive.
+	 */
+	template<class Archive>
+	void serializeConfiguration(Archive & ar) {
+		ar & padding;
+	}
+
 	/*!
 	 * Private constructor, used only during the serialization.
 	 */
@@ -23,6 +23,8 @@
 #ifndef SRC_MLNN_SOFTMAX_HPP_
 #define SRC_MLNN_SOFTMAX_HPP_
 
+#include <cmath>
+
 #include <mlnn/layer/Layer.hpp>
 
 namespace mic {
@@ -67,6 +69,9 @@ public:
 		m.add("e", Layer<eT>::inputSize(), 1);
 		m.add("sum", 1, 1);
 		m.add("max", 1, 1);
+
+		// Resolve handles of the matrices.
+		Softmax<eT>::resolveHandles();
 	}
 
 
@@ -84,47 +89,79 @@ public:
 		Layer<eT>::resizeBatch(batch_size_);
 
 		// Reshape the temporary matrices.
-		m["e"]->resize(m["e"]->rows(), batch_size_);
-		m["sum"]->resize(m["sum"]->rows(), batch_size_);
-		m["max"]->resize(m["max"]->rows(), batch_size_);
+		m[he]->resize(m[he]->rows(), batch_size_);
+		m[hsum]->resize(m[hsum]->rows(), batch_size_);
+		m[hmax]->resize(m[hmax]->rows(), batch_size_);
 	}
 
 
 
 	void forward(bool test_ = false) {
-		mic::types::MatrixPtr<eT> x = s["x"];
-		mic::types::MatrixPtr<eT> y = s["y"];
-		mic::types::MatrixPtr<eT> e = m["e"];
-		mic::types::MatrixPtr<eT> max = m["max"];
-		mic::types::MatrixPtr<eT> sum = m["sum"];
+		mic::types::MatrixPtr<eT> x = s[hx];
+		mic::types::MatrixPtr<eT> y = s[hy];
+		mic::types::MatrixPtr<eT> e = m[he];
+		mic::types::MatrixPtr<eT> max = m[hmax];
+		mic::types::MatrixPtr<eT> sum = m[hsum];
 
 		//std::cout << "Softmax forward: s['x'] = \n" << (*s['x']) << std::endl;
 
-		// Prevent overflow according to: http://eric-yuan.me/softmax/
-		(*max) = x->colwise().maxCoeff();
-
-		// Calculate the e matrix - with overflow prevention.
-		for (size_t i = 0; i < (size_t)y->rows(); i++)
-			for (size_t j = 0; j < (size_t)y->cols(); j++)
-				(*e)(i, j) = std::exp( (*x)(i, j) - (*max)(j) );
+		// Process the batch sample by sample, so every column is read while still in cache.
+		for (size_t j = 0; j < (size_t)x->cols(); j++) {
+			// Prevent overflow according to: http://eric-yuan.me/softmax/
+			(*max)(j) = x->col(j).maxCoeff();
+			// Calculate the exponentials - with overflow prevention.
+			e->col(j) = (x->col(j).array() - (*max)(j)).exp().matrix();
+			// Sum the values in column (single sample).
+			(*sum)(j) = e->col(j).sum();
+			// Normalize.
+			y->col(j) = e->col(j) / (*sum)(j);
+		}//: for
 
-		// Sum the values in columns (single batch), one by one.
-		(*sum) = e->colwise().sum();
+//		std::cout << "Softmax forward: s['y'] = \n" << (*s['y']) << std::endl;
+	}
 
-		// Iterate through elements.
-		for (size_t i = 0; i < (size_t)y->rows(); i++) {
-			for (size_t j = 0; j < (size_t)y->cols(); j++) {
-				(*y)(i, j) = (*e)(i, j) / (*sum)(j);
-			}//: for
+	/*!
+	 * Fused softmax and cross-entropy: in a single pass over the batch computes the softmax outputs y, the cross-entropy loss
+	 * (from numerically stable log-softmax) and the gradient of the loss with respect to the layer inputs (i.e. dx = y - t).
+	 * The gradient is stored directly in g[x], so there is no need to call backward() of the layer afterwards.
+	 * @param target_y_ Targets (labels) - matrix of size [output_size x batch_size].
+	 * @return Cross-entropy loss (summed over the batch, using log2, as CrossEntropyLoss).
+	 */
+	eT forwardCrossEntropy(mic::types::MatrixPtr<eT> target_y_) {
+		mic::types::MatrixPtr<eT> x = s[hx];
+		mic::types::MatrixPtr<eT> y = s[hy];
+		mic::types::MatrixPtr<eT> dx = g[hx];
+		mic::types::MatrixPtr<eT> e = m[he];
+		mic::types::MatrixPtr<eT> max = m[hmax];
+		mic::types::MatrixPtr<eT> sum = m[hsum];
+
+		// Sizes must match.
+		assert(target_y_->rows() == y->rows());
+		assert(target_y_->cols() == y->cols());
+
+		eT loss = 0;
+		for (size_t j = 0; j < (size_t)x->cols(); j++) {
+			(*max)(j) = x->col(j).maxCoeff();
+			e->col(j) = (x->col(j).array() - (*max)(j)).exp().matrix();
+			(*sum)(j) = e->col(j).sum();
+			y->col(j) = e->col(j) / (*sum)(j);
+
+			// log(y) = x - max - log(sum) - finite even if y underflows to 0.
+			eT log_sum = std::log((*sum)(j));
+			loss -= (target_y_->col(j).array() * (x->col(j).array() - ((*max)(j) + log_sum))).sum();
+
+			// Gradient of cross-entropy composed with softmax.
+			dx->col(j) = y->col(j) - target_y_->col(j);
 		}//: for
 
-//		std::cout << "Softmax forward: s['y'] = \n" << (*s['y']) << std::endl;
+		// Convert from natural logarithm to log2.
+		return loss / std::log((eT)2.0);
 	}
 
 	void backward() {
-		mic::types::MatrixPtr<eT> y = s["y"];
-		mic::types::MatrixPtr<eT> dx = g["x"];
-		mic::types::MatrixPtr<eT> dy = g["y"];
+		mic::types::MatrixPtr<eT> y = s[hy];
+		mic::types::MatrixPtr<eT> dx = g[hx];
+		mic::types::MatrixPtr<eT> dy = g[hy];
 
 		// Pass the gradient.
 		for (size_t i = 0; i < (size_t)y->size(); i++)
@@ -150,8 +187,22 @@ protected:
 	// Unhiding the template inherited fields via "using" statement.
     using Layer<eT>::g;
     using Layer<eT>::s;
+    using Layer<eT>::hx;
+    using Layer<eT>::hy;
     using Layer<eT>::m;
 
+	/// Handles of the temporary matrices: exponentials, their sums and maximal inputs (one per sample).
+	size_t he, hsum, hmax;
+
+	/*!
+	 * Resolves handles of the matrices used by the layer.
+	 */
+	virtual void resolveHandles() {
+		Layer<eT>::resolveHandles();
+		he = Layer<eT>::resolveHandle(m, "e");
+		hsum = Layer<eT>::resolveHandle(m, "sum");
+		hmax = Layer<eT>::resolveHandle(m, "max");
+	}
 
 private:
 	// Friend class - required for using boost serialization.
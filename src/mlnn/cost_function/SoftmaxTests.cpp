@@ -41,6 +41,28 @@ TEST_F(Softmax4x1Float, Forward) {
 
 
 
+/*!
+ * Tests fused softmax and cross-entropy - outputs, loss and gradient dx = y - t.
+ */
+TEST_F(Softmax4x1Float, ForwardCrossEntropy) {
+	double eps = 1e-5;
+
+	// Fused pass.
+	(*layer.s["x"]) = (*input_x);
+	float loss = layer.forwardCrossEntropy(target_y);
+	mic::types::MatrixPtr<float> y = layer.s["y"];
+
+	for (size_t i=0; i<4; i++) {
+		ASSERT_LE( fabs((*y)[i] - (*output_y)[i]), eps) << "Difference at position i=" << i << " where " << (*y)[i] << " and should be " << (*output_y)[i];
+		ASSERT_LE( fabs((*layer.g["x"])[i] - ((*output_y)[i] - (*target_y)[i])), eps) << "Difference of gradients at position i=" << i;
+	}//: for
+
+	// Compare with cross-entropy loss.
+	mic::neural_nets::loss::CrossEntropyLoss<float> ce;
+	ASSERT_LE( fabs(loss - ce.calculateLoss(target_y, y)), 1e-4);
+}
+
+
 /*!
  * Numerical gradient test dW, size of layer is 2x3.
  */
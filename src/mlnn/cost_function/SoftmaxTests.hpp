@@ -32,6 +32,7 @@
 #define protected public
 #include <mlnn/cost_function/Softmax.hpp>
 #include <loss/SquaredErrorLoss.hpp>
+#include <loss/CrossEntropyLoss.hpp>
 
 /*!
  * \brief Test Fixture - 4x1 softmax layer.
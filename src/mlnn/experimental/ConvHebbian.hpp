@@ -56,11 +56,14 @@ public:
     {
         // Create the weights matrix, each row is a filter kernel
         p.add("W", nfilters, filter_size * filter_size);
-        mic::types::MatrixPtr<eT> W = p["W"];
 
         // Set normalized, zero sum, hebbian learning as default optimization function.
         Layer<eT>::template setOptimization<mic::neural_nets::learning::NormalizedZerosumHebbianRule<eT> > ();
 
+        // Resolve handles of all matrices.
+        ConvHebbian<eT>::resolveHandles();
+        mic::types::MatrixPtr<eT> W = p[hW];
+
         // Initialize weights of all the columns of W.
         W->rand();
         for(auto i = 0 ; i < W->rows() ; i++) {
@@ -84,10 +87,10 @@ public:
      */
     void forward(bool test_ = false) {
         // Get input matrices.
-        mic::types::Matrix<eT> x = (*s["x"]);
-        mic::types::Matrix<eT> W = (*p["W"]);
+        mic::types::Matrix<eT> x = (*s[hx]);
+        mic::types::Matrix<eT> W = (*p[hW]);
         // Get output pointer - so the results will be stored!
-        mic::types::MatrixPtr<eT> y = s["y"];
+        mic::types::MatrixPtr<eT> y = s[hy];
 
         // IM2COL
         // Iterate over the output matrix (number of image patches)
@@ -121,7 +124,7 @@ public:
      * @param decay_ Weight decay rate (determining that the "unused/unupdated" weights will decay to 0) (DEFAULT=0.0 - no decay).
      */
     void update(eT alpha_, eT decay_  = 0.0f) {
-        opt["W"]->update(p["W"], x2col, s["y"], alpha_);
+        opt[hW]->update(p[hW], x2col, s[hy], alpha_);
     }
 
 
@@ -134,7 +137,7 @@ public:
         // Allocate memory.
         lazyAllocateMatrixVector(o_activations, nfilters, output_height * output_width, 1);
 
-        mic::types::MatrixPtr<eT> W = s["y"];
+        mic::types::MatrixPtr<eT> W = s[hy];
 
         // Iterate through "neurons" and generate "activation image" for each one.
         for (size_t i = 0 ; i < nfilters ; i++) {
@@ -161,8 +164,8 @@ public:
         o_reconstruction[0]->zeros();
         conv2col->zeros();
 
-        mic::types::MatrixPtr<eT> o = s["y"];
-        mic::types::MatrixPtr<eT> w = p["W"];
+        mic::types::MatrixPtr<eT> o = s[hy];
+        mic::types::MatrixPtr<eT> w = p[hW];
 
         //Reconstruct in im2col format
         for(size_t i = 0 ; i < output_width * output_height ; i++){
@@ -207,7 +210,7 @@ public:
         Eigen::Map<Eigen::Matrix<eT, Eigen::Dynamic, 1> > r(o_reconstruction[0]->data(), o_reconstruction[0]->size());
 
         mic::types::Matrix<eT> diff;
-        diff = r.normalized() - (*s["x"]).normalized();
+        diff = r.normalized() - (*s[hx]).normalized();
         eT error = diff.squaredNorm();
         return error;
     }
@@ -220,7 +223,7 @@ public:
         // Allocate memory.
         lazyAllocateMatrixVector(w_activations, nfilters, filter_size*filter_size, 1);
 
-        mic::types::MatrixPtr<eT> W = p["W"];
+        mic::types::MatrixPtr<eT> W = p[hW];
 
         // Iterate through "neurons" and generate "activation image" for each one.
         for (size_t i = 0 ; i < nfilters ; i++) {
@@ -246,7 +249,7 @@ public:
         // Allocate memory.
         lazyAllocateMatrixVector(w_similarity, 1, nfilters * nfilters, 1);
 
-        mic::types::MatrixPtr<eT> W = p["W"];
+        mic::types::MatrixPtr<eT> W = p[hW];
         mic::types::MatrixPtr<eT> row = w_similarity[0];
 
         // Iterate through "neurons" and generate "activation image" for each one.
@@ -283,7 +286,7 @@ public:
         // Allocate memory.
         lazyAllocateMatrixVector(w_dissimilarity, 1, nfilters * nfilters, 1);
 
-        mic::types::MatrixPtr<eT> W = p["W"];
+        mic::types::MatrixPtr<eT> W = p[hW];
         mic::types::MatrixPtr<eT> row = w_dissimilarity[0];
 
         // Iterate through "neurons" and generate "activation image" for each one.
@@ -316,6 +319,8 @@ public:
 protected:
     // Unhide the fields inherited from the template class Layer via "using" statement.
     using Layer<eT>::s;
+    using Layer<eT>::hx;
+    using Layer<eT>::hy;
     using Layer<eT>::m;
     using Layer<eT>::p;
     using Layer<eT>::opt;
@@ -340,6 +345,17 @@ protected:
     mic::types::MatrixPtr<eT> x2col;
     mic::types::MatrixPtr<eT> conv2col;
 
+    /// Handle of the weight matrix (in parameters and optimization functions).
+    size_t hW = 0;
+
+    /*!
+     * Resolves handles of the matrices used by the layer.
+     */
+    virtual void resolveHandles() {
+        Layer<eT>::resolveHandles();
+        hW = Layer<eT>::resolveHandle(p, "W");
+    }
+
 private:
     // Friend class - required for using boost serialization.
     template<typename tmp> friend class mic::mlnn::MultiLayerNeuralNetwork;
@@ -82,9 +82,12 @@ public:
 		//double range = sqrt(6.0 / double(inputs_ + outputs_));
 		p['p']->rand(0, 1);
 
+		// Resolve handles of the matrices.
+		BinaryCorrelator<eT>::resolveHandles();
+
 		// Initialize connectivity.
-		mic::types::MatrixPtr<eT> c = m['c'];
-		mic::types::MatrixPtr<eT> perm = p['p'];
+		mic::types::MatrixPtr<eT> c = m[hc];
+		mic::types::MatrixPtr<eT> perm = p[hp];
 		// Threshold.
 		for (size_t i = 0; i < (size_t)c->size(); i++) {
 			(*c)[i] = ((*perm)[i] > permanence_threshold) ? 1.0f : 0.0f;
@@ -106,10 +109,10 @@ public:
 	 */
 	void forward(bool test_ = false) {
 		// Get input matrices.
-		mic::types::Matrix<eT> x = (*s['x']);
-		mic::types::Matrix<eT> c = (*m['c']);
+		mic::types::Matrix<eT> x = (*s[hx]);
+		mic::types::Matrix<eT> c = (*m[hc]);
 		// Get output pointer - so the results will be stored!
-		mic::types::MatrixPtr<eT> y = s['y'];
+		mic::types::MatrixPtr<eT> y = s[hy];
 
 		// Forward pass.
 		(*y) = c * x;
@@ -134,12 +137,12 @@ public:
 	void update(eT alpha_, eT decay_ = 0.0f) {
 		//std::cout<<"p before update: " << (*p['p']) << std::endl;
 		// Update permanence using the learning rule.
-		opt["p"]->update(p['p'], s['x'], s['y'], alpha_);
+		opt[hp]->update(p[hp], s[hx], s[hy], alpha_);
 		//std::cout<<"p after update: " << (*p['p']) << std::endl;
 
 		// Update connectivity matrix.
-		mic::types::MatrixPtr<eT> c = m['c'];
-		mic::types::MatrixPtr<eT> perm = p['p'];
+		mic::types::MatrixPtr<eT> c = m[hc];
+		mic::types::MatrixPtr<eT> perm = p[hp];
 		//std::cout<<"C before threshold: " << (*c) << std::endl;
 		// Threshold.
 		for (size_t i = 0; i < (size_t)c->size(); i++) {
@@ -164,7 +167,7 @@ public:
 		// Epsilon added for numerical stability.
 		eT eps = 1e-10;
 
-		mic::types::MatrixPtr<eT> perm =  p["p"];
+		mic::types::MatrixPtr<eT> perm =  p[hp];
 		// Iterate through "neurons" and generate "activation image" for each one.
 		for (size_t i=0; i < outputSize(); i++) {
 			// Get row.
@@ -191,6 +194,8 @@ public:
 protected:
 	// Unhide the fields inherited from the template class Layer via "using" statement.
     using Layer<eT>::s;
+    using Layer<eT>::hx;
+    using Layer<eT>::hy;
     using Layer<eT>::p;
     using Layer<eT>::m;
     using Layer<eT>::inputSize;
@@ -198,6 +203,21 @@ protected:
     using Layer<eT>::batch_size;
     using Layer<eT>::opt;
 
+	/// Handle of the permanence matrix - in parameters array (and array of their optimization functions).
+	size_t hp;
+
+	/// Handle of the connectivity matrix.
+	size_t hc;
+
+	/*!
+	 * Resolves handles of the matrices used by the layer.
+	 */
+	virtual void resolveHandles() {
+		Layer<eT>::resolveHandles();
+		hp = Layer<eT>::resolveHandle(p, "p");
+		hc = Layer<eT>::resolveHandle(m, "c");
+	}
+
 private:
 	// Friend class - required for using boost serialization.
 	template<typename tmp> friend class mic::mlnn::MultiLayerNeuralNetwork;
@@ -0,0 +1,249 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file FusedLinear.hpp
+ * \brief Linear layer fused with the activation function.
+ * \author tkornuta
+ * \date Oct 16, 2026
+ */
+
+#ifndef SRC_MLNN_FUSEDLINEAR_HPP_
+#define SRC_MLNN_FUSEDLINEAR_HPP_
+
+#include <mlnn/fully_connected/Linear.hpp>
+#include <mlnn/activation_function/ActivationKernels.hpp>
+
+namespace mic {
+namespace mlnn {
+namespace fully_connected {
+
+/*!
+ * \brief Class implementing a linear, fully connected layer fused with the activation function: y = f(W x + b).
+ * The product is written directly to the output, then the bias and the activation are applied in a single sweep over it,
+ * so neither the replicated bias nor the input/output of a separate activation layer are stored.
+ * In the backward pass the derivative of the activation is applied on the fly (calculated from the output).
+ * \author tkornuta
+ * \tparam eT Template parameter denoting precision of variables (float for calculations/double for testing).
+ */
+template <typename eT=float>
+class FusedLinear : public mic::mlnn::fully_connected::Linear<eT> {
+public:
+	/*!
+	 * Creates a fused linear layer.
+	 * @param inputs_ Length of the input vector.
+	 * @param outputs_ Length of the output vector.
+	 * @param activation_ Activation function.
+	 * @param name_ Name of the layer.
+	 */
+	FusedLinear(size_t inputs_, size_t outputs_, mic::mlnn::activation_function::kernels::Activation activation_, std::string name_ = "FusedLinear") :
+		FusedLinear(inputs_, 1, 1, outputs_, 1, 1, activation_, name_)
+	{
+
+	}
+
+	/*!
+	 * Creates a fused linear layer.
+	 * @param input_height_ Height of the input sample.
+	 * @param input_width_ Width of the input sample.
+	 * @param input_depth_ Depth of the input sample.
+	 * @param output_height_ Width of the output sample.
+	 * @param output_width_ Height of the output sample.
+	 * @param output_depth_ Depth of the output sample.
+	 * @param activation_ Activation function.
+	 * @param name_ Name of the layer.
+	 */
+	FusedLinear(size_t input_height_, size_t input_width_, size_t input_depth_,
+			size_t output_height_, size_t output_width_, size_t output_depth_,
+			mic::mlnn::activation_function::kernels::Activation activation_,
+			std::string name_ = "FusedLinear") :
+		Linear<eT>(input_height_, input_width_, input_depth_,
+				output_height_, output_width_, output_depth_, name_),
+		activation(activation_),
+		fast_exp(false)
+	{
+		// Change type to FusedLinear.
+		Layer<eT>::layer_type = LayerTypes::FusedLinear;
+
+		// Gradient of the activation input (i.e. of W x + b) - temporary matrix, allocated in the first backward pass.
+		m.add ("dz", Layer<eT>::outputSize(), 0);
+
+		// Resolve handles of the matrices.
+		FusedLinear<eT>::resolveHandles();
+	}
+
+	/*!
+	 * Virtual destructor - empty.
+	 */
+	virtual ~FusedLinear() {};
+
+	/*!
+	 * Forward pass.
+	 * @param test_ It is set to true in test mode (network verification).
+	 */
+	void forward(bool test_ = false) {
+		mic::types::MatrixPtr<eT> y = s[hy];
+
+		// Product written directly to the output.
+		(*y).noalias() = (*p[hW]) * (*s[hx]);
+
+		// Epilogue: bias and activation applied in a single sweep.
+		mic::mlnn::activation_function::kernels::activate(activation, fast_exp, y->data(), p[hb]->data(), y->data(), (size_t)y->rows(), (size_t)y->cols());
+	}
+
+	/*!
+	 * Backward pass.
+	 */
+	void backward() {
+		// Gradient of W x + b, the derivative of the activation is calculated from the output.
+		ScratchMatrix dz = scratchMatrix(hdz, Layer<eT>::outputSize(), batch_size, 0);
+		mic::mlnn::activation_function::kernels::activationGradient(activation, s[hy]->data(), g[hy]->data(), dz.data(), (size_t)dz.size());
+
+		(*g[hdW]).noalias() = dz * (*s[hx]).transpose();
+		(*g[hdb]) = dz.rowwise().sum();
+		(*g[hx]).noalias() = (*p[hW]).transpose() * dz;
+	}
+
+	/*!
+	 * Backward pass calculates the derivative of the activation from the output.
+	 */
+	virtual bool backwardUsesOutput() {
+		return true;
+	}
+
+	/*!
+	 * Returns the number of elements of the gradient of the activation input.
+	 */
+	virtual size_t scratchSize() {
+		return Layer<eT>::outputSize() * batch_size;
+	}
+
+	/*!
+	 * Sets the scratch arena - releases the own gradient of the activation input.
+	 * @param arena_ Arena (nullptr restores the own temporary matrices).
+	 */
+	virtual void setScratchArena(std::shared_ptr<ScratchArena<eT> > arena_) {
+		Layer<eT>::setScratchArena(arena_);
+		if (arena_)
+			m[hdz]->resize(m[hdz]->rows(), 0);
+	}
+
+	/*!
+	 * Switches the layer to the inference-only mode - releases also the gradient of the activation input.
+	 */
+	virtual void freeze() {
+		Layer<eT>::freeze();
+		m[hdz]->resize(m[hdz]->rows(), 0);
+	}
+
+	/*!
+	 * Returns the activation function.
+	 */
+	mic::mlnn::activation_function::kernels::Activation getActivation() {
+		return activation;
+	}
+
+	/*!
+	 * Sets whether exp used by the activation function (ELU, sigmoid) is approximated.
+	 * @param fast_exp_ Flag denoting whether the approximation should be used.
+	 */
+	void setFastExp(bool fast_exp_) {
+		fast_exp = fast_exp_;
+	}
+
+	/*!
+	 * Returns true if exp used by the activation function is approximated.
+	 */
+	bool getFastExp() {
+		return fast_exp;
+	}
+
+	/*!
+	 * Stream layer parameters.
+	 * @return Ostream object.
+	 */
+	virtual std::string streamLayerParameters() {
+		std::ostringstream os_;
+		os_ << Layer<eT>::streamLayerParameters();
+		os_ << std::endl << "    * activation = " << mic::mlnn::activation_function::kernels::activationName(activation) << (fast_exp ? " (fast exp)" : "");
+		return os_.str();
+	}
+
+	// Unhide the overloaded methods inherited from the template class Layer fields via "using" statement.
+	using Layer<eT>::forward;
+	using Layer<eT>::backward;
+
+protected:
+	// Unhide the fields inherited from the template class Layer via "using" statement.
+    using Layer<eT>::g;
+    using Layer<eT>::s;
+    using Layer<eT>::p;
+    using Layer<eT>::m;
+    using Layer<eT>::hx;
+    using Layer<eT>::hy;
+    using Layer<eT>::batch_size;
+    using Layer<eT>::scratchMatrix;
+    typedef typename Layer<eT>::ScratchMatrix ScratchMatrix;
+    using Linear<eT>::hW;
+    using Linear<eT>::hb;
+    using Linear<eT>::hdW;
+    using Linear<eT>::hdb;
+
+	/// Handle of the gradient of the activation input.
+	size_t hdz;
+
+	/// Activation function.
+	mic::mlnn::activation_function::kernels::Activation activation;
+
+	/// Flag denoting whether exp is approximated.
+	bool fast_exp;
+
+	/*!
+	 * Resolves handles of the matrices used by the layer.
+	 */
+	virtual void resolveHandles() {
+		Linear<eT>::resolveHandles();
+		hdz = Layer<eT>::resolveHandle(m, "dz");
+	}
+
+private:
+	// Friend class - required for using boost serialization.
+	template<typename tmp> friend class mic::mlnn::MultiLayerNeuralNetwork;
+
+	/*!
+	 * Serializes the parameters specific to the layer type (not stored by Layer::serialize).
+	 * @param ar Used archive.
+	 */
+	template<class Archive>
+	void serializeConfiguration(Archive & ar) {
+		ar & activation;
+		ar & fast_exp;
+	}
+
+	/*!
+	 * Private constructor, used only during the deserialization.
+	 */
+	FusedLinear<eT>() : mic::mlnn::fully_connected::Linear<eT> (),
+		activation(mic::mlnn::activation_function::kernels::Activation::Identity),
+		fast_exp(false)
+	{ }
+};
+
+
+} /* namespace fully_connected */
+} /* namespace mlnn */
+} /* namespace mic */
+
+#endif /* SRC_MLNN_FUSEDLINEAR_HPP_ */
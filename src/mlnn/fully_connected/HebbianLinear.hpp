@@ -78,6 +78,9 @@ public:
 		double range = sqrt(6.0 / double(Layer<eT>::outputSize() + Layer<eT>::inputSize()));
 		Layer<eT>::p['W']->rand(-range, range);
 
+		// Resolve handles of the matrices.
+		HebbianLinear<eT>::resolveHandles();
+
 		// Set hebbian learning as default optimization function.
 		Layer<eT>::template setOptimization<mic::neural_nets::learning::HebbianRule<eT> > ();
 	};
@@ -94,14 +97,15 @@ public:
 	 */
 	void forward(bool test_ = false) {
 		// Get input matrices.
-		mic::types::Matrix<eT> x = (*s['x']);
-		mic::types::Matrix<eT> W = (*p['W']);
+		mic::types::Matrix<eT> x = (*s[hx]);
+		mic::types::Matrix<eT> W = (*p[hW]);
 		// Get output pointer - so the results will be stored!
-		mic::types::MatrixPtr<eT> y = s['y'];
+		mic::types::MatrixPtr<eT> y = s[hy];
 
 		// Forward pass.
 		(*y) = W * x;
-		for (size_t i = 0; i < (size_t)s['x']->rows() * s['x']->cols(); i++) {
+		// Threshold all outputs (their number might differ from the number of inputs).
+		for (size_t i = 0; i < (size_t)y->size(); i++) {
 			// Sigmoid.
 			//(*y)[i] = 1.0f / (1.0f +::exp(-(*y)[i]));
 			// Threshold.
@@ -122,7 +126,7 @@ public:
 	 * @param decay_ Weight decay rate (determining that the "unused/unupdated" weights will decay to 0) (DEFAULT=0.0 - no decay).
 	 */
 	void update(eT alpha_, eT decay_  = 0.0f) {
-		opt["W"]->update(p['W'], s['x'], s['y'], alpha_);
+		opt[hW]->update(p[hW], s[hx], s[hy], alpha_);
 	}
 
 	/*!
@@ -141,7 +145,7 @@ public:
 		// Epsilon added for numerical stability.
 		eT eps = 1e-10;
 
-		mic::types::MatrixPtr<eT> W =  p["W"];
+		mic::types::MatrixPtr<eT> W =  p[hW];
 		// Iterate through "neurons" and generate "activation image" for each one.
 		for (size_t i=0; i < outputSize(); i++) {
 			// Get row.
@@ -168,6 +172,8 @@ public:
 protected:
 	// Unhide the fields inherited from the template class Layer via "using" statement.
     using Layer<eT>::s;
+    using Layer<eT>::hx;
+    using Layer<eT>::hy;
     using Layer<eT>::p;
     using Layer<eT>::m;
     using Layer<eT>::inputSize;
@@ -175,6 +181,17 @@ protected:
     using Layer<eT>::batch_size;
     using Layer<eT>::opt;
 
+	/// Handle of the weights - in parameters array (and array of their optimization functions).
+	size_t hW;
+
+	/*!
+	 * Resolves handles of the matrices used by the layer.
+	 */
+	virtual void resolveHandles() {
+		Layer<eT>::resolveHandles();
+		hW = Layer<eT>::resolveHandle(p, "W");
+	}
+
 private:
 	// Friend class - required for using boost serialization.
 	template<typename tmp> friend class mic::mlnn::MultiLayerNeuralNetwork;
@@ -33,6 +33,10 @@ namespace fully_connected {
 template <typename eT>
 class SparseLinear;
 
+// Forward declaration of FusedLinear class.
+template <typename eT>
+class FusedLinear;
+
 /*!
  * \brief Class implementing a linear, fully connected layer.
  * \author tkornuta
@@ -70,7 +74,7 @@ public:
 			std::string name_ = "Linear") :
 		Layer<eT>::Layer(input_height_, input_width_, input_depth_,
 				output_height_, output_width_, output_depth_,
-				LayerTypes::Convolution, name_)
+				LayerTypes::Linear, name_)
 	{
 		// Create the weights matrix.
 		p.add ("W", Layer<eT>::outputSize(), Layer<eT>::inputSize());
@@ -88,6 +92,9 @@ public:
 		Layer<eT>::g.add ("W", Layer<eT>::outputSize(), Layer<eT>::inputSize());
 		Layer<eT>::g.add ("b", Layer<eT>::outputSize(), 1 );
 
+		// Resolve handles of the matrices.
+		Linear<eT>::resolveHandles();
+
 		// Set gradient descent as default optimization function.
 		Layer<eT>::template setOptimization<mic::neural_nets::optimization::GradientDescent<eT> > ();
 	};
@@ -104,14 +111,15 @@ public:
 	 */
 	void forward(bool test_ = false) {
 		// Get pointers to data matrices.
-		mic::types::MatrixPtr<eT> x = s['x'];
-		mic::types::MatrixPtr<eT> W = p['W'];
-		mic::types::MatrixPtr<eT> b = p['b'];
+		mic::types::MatrixPtr<eT> x = s[hx];
+		mic::types::MatrixPtr<eT> W = p[hW];
+		mic::types::MatrixPtr<eT> b = p[hb];
 		// Get output pointer - so the results will be stored!
-		mic::types::MatrixPtr<eT> y = s['y'];
+		mic::types::MatrixPtr<eT> y = s[hy];
 
-		// Forward pass.
-		(*y) = (*W) * (*x) + (*b).replicate(1, (*x).cols());
+		// Forward pass - the product is written directly to the output and the bias is added to its columns (without replicating it).
+		(*y).noalias() = (*W) * (*x);
+		(*y).colwise() += (*b).col(0);
 
 /*		std::cout << "Linear forward: s['x'] = \n" << (*s['x']) << std::endl;
 		std::cout << "Linear forward: p['W'] = \n" << (*p['W']) << std::endl;
@@ -125,13 +133,13 @@ public:
 	 */
 	void backward() {
 		// Get pointer to data matrices.
-		mic::types::MatrixPtr<eT> dy = g['y'];
-		mic::types::MatrixPtr<eT> x = s['x'];
-		mic::types::MatrixPtr<eT> W = p['W'];
+		mic::types::MatrixPtr<eT> dy = g[hy];
+		mic::types::MatrixPtr<eT> x = s[hx];
+		mic::types::MatrixPtr<eT> W = p[hW];
 		// Get output pointers - so the results will be stored!
-		mic::types::MatrixPtr<eT> dW = g['W'];
-		mic::types::MatrixPtr<eT> db = g['b'];
-		mic::types::MatrixPtr<eT> dx = g['x'];
+		mic::types::MatrixPtr<eT> dW = g[hdW];
+		mic::types::MatrixPtr<eT> db = g[hdb];
+		mic::types::MatrixPtr<eT> dx = g[hx];
 
 		// Backward pass.
 		(*dW) = (*dy) * (*x).transpose();
@@ -146,8 +154,8 @@ public:
 	 * Resets the gradients for W and b.
 	 */
 	void resetGrads() {
-		g['W']->setZero();
-		g['b']->setZero();
+		g[hdW]->setZero();
+		g[hdb]->setZero();
 	}
 
 
@@ -160,12 +168,29 @@ public:
 		//std::cout << "p['W'] = \n" << (*p['W']) << std::endl;
 		//std::cout << "g['W'] = \n" << (*g['W']) << std::endl;
 
-		opt["W"]->update(p['W'], g['W'], alpha_, decay_);
-		opt["b"]->update(p['b'], g['b'], alpha_, 0.0);
+		opt[hW]->update(p[hW], g[hdW], alpha_, decay_);
+		opt[hb]->update(p[hb], g[hdb], alpha_, 0.0);
 
 		//std::cout << "p['W'] after update= \n" << (*p['W']) << std::endl;
 	}
 
+	/*!
+	 * Appends segments of W (with weight decay) and b (without decay) - the same as updated by update().
+	 * @param segments_ Vector of segments.
+	 */
+	virtual bool getParameterSegments(std::vector<ParameterSegment<eT> > & segments_) {
+		segments_.push_back({p[hW], g[hdW], opt[hW], true});
+		segments_.push_back({p[hb], g[hdb], opt[hb], false});
+		return true;
+	}
+
+	/*!
+	 * Backward pass does not read the output (gradients are calculated from the input).
+	 */
+	virtual bool backwardUsesOutput() {
+		return false;
+	}
+
 
 	/*!
 	 * Returns activations of weights.
@@ -176,7 +201,7 @@ public:
 		lazyAllocateMatrixVector(w_activations, 1, Layer<eT>::outputSize()*Layer<eT>::inputSize(), 1);
 
 		// Get matrix of a given "part of a given neuron".
-		mic::types::MatrixPtr<eT> W = p["W"];
+		mic::types::MatrixPtr<eT> W = p[hW];
 
 		// Get row.
 		mic::types::MatrixPtr<eT> row = w_activations[0];
@@ -199,7 +224,7 @@ public:
 		lazyAllocateMatrixVector(dw_activations, 1, Layer<eT>::outputSize()*Layer<eT>::inputSize(), 1);
 
 		// Get matrix of a given "part of a given neuron".
-		mic::types::MatrixPtr<eT> dW = g["W"];
+		mic::types::MatrixPtr<eT> dW = g[hdW];
 
 		// Get row.
 		mic::types::MatrixPtr<eT> row = dw_activations[0];
@@ -223,7 +248,7 @@ public:
 
 		// TODO: check different input-output depths.
 
-		mic::types::MatrixPtr<eT> W =  p["W"];
+		mic::types::MatrixPtr<eT> W =  p[hW];
 		// Iterate through "neurons" and generate "activation image" for each one.
 		for (size_t i=0; i < output_height*output_width*output_depth; i++) {
 
@@ -251,19 +276,19 @@ public:
 		lazyAllocateMatrixVector(inverse_y_activations, batch_size*input_depth, input_height, input_width);
 
 		// Get y batch.
-		mic::types::MatrixPtr<eT> batch_y = s['y'];
+		mic::types::MatrixPtr<eT> batch_y = s[hy];
 		// Get weights.
-		mic::types::MatrixPtr<eT> W =  p["W"];
+		mic::types::MatrixPtr<eT> W =  p[hW];
 
 		// Iterate through batch samples and generate "activation image" for each one.
 		for (size_t ib=0; ib< batch_size; ib++) {
 
 			// Get output sample from batch.
-			mic::types::MatrixPtr<eT> sample_y = m["ys"];
+			mic::types::MatrixPtr<eT> sample_y = m[hys];
 			(*sample_y) = batch_y->col(ib);
 
 			// Get pointer to "x sample".
-			mic::types::MatrixPtr<eT> x_act = m["xs"];
+			mic::types::MatrixPtr<eT> x_act = m[hxs];
 			(*x_act) = W->transpose() * (*sample_y);
 
 			// Iterate through input channels.
@@ -289,7 +314,7 @@ public:
 	eT calculateMeanReconstructionError() {
 
 		// Get input batch.
-		mic::types::MatrixPtr<eT> batch_x = s['x'];
+		mic::types::MatrixPtr<eT> batch_x = s[hx];
 		// Calculate the reconstruction.
 		std::vector< mic::types::MatrixPtr<eT> > reconstructed_batch_x = getInverseOutputActivations();
 
@@ -299,7 +324,7 @@ public:
 		for (size_t ib=0; ib< batch_size; ib++) {
 
 			// Get input sample from batch!
-			mic::types::MatrixPtr<eT> sample_x = m["xs"];
+			mic::types::MatrixPtr<eT> sample_x = m[hxs];
 			(*sample_x) = batch_x->col(ib);
 			eT* sample_x_ptr = (*sample_x).data();
 
@@ -325,6 +350,10 @@ protected:
 	// Unhide the fields inherited from the template class Layer via "using" statement.
     using Layer<eT>::g;
     using Layer<eT>::s;
+    using Layer<eT>::hx;
+    using Layer<eT>::hy;
+    using Layer<eT>::hxs;
+    using Layer<eT>::hys;
     using Layer<eT>::p;
     using Layer<eT>::m;
     using Layer<eT>::opt;
@@ -341,6 +370,23 @@ protected:
 	 // Uncover methods useful in visualization.
 	 using Layer<eT>::lazyAllocateMatrixVector;
 
+	/// Handles of the weights and biases - in parameters array (and array of their optimization functions).
+	size_t hW, hb;
+
+	/// Handles of the weight and bias gradients.
+	size_t hdW, hdb;
+
+	/*!
+	 * Resolves handles of the matrices used by the layer.
+	 */
+	virtual void resolveHandles() {
+		Layer<eT>::resolveHandles();
+		hW = Layer<eT>::resolveHandle(p, "W");
+		hb = Layer<eT>::resolveHandle(p, "b");
+		hdW = Layer<eT>::resolveHandle(g, "W");
+		hdb = Layer<eT>::resolveHandle(g, "b");
+	}
+
 
 private:
 	// Friend class - required for using boost serialization.
@@ -348,6 +394,7 @@ private:
 
 	// Friend class - required for accessing private constructor.
 	template<typename tmp> friend class mic::mlnn::fully_connected::SparseLinear;
+	template<typename tmp> friend class mic::mlnn::fully_connected::FusedLinear;
 
 	/// Vector containing activations of weights/filters.
 	std::vector< mic::types::MatrixPtr<eT> > w_activations;
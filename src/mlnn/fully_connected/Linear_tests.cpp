@@ -38,6 +38,25 @@ TEST_F(Linear5x2Float, WbInitialization) {
 		ASSERT_EQ( (*layer.p["b"])[i], 0.0 ) << "Bias b is not zero at position i=" << i;
 }
 
+/*!
+ * \brief Makes sure that the layer reports its own type (used e.g. for recreating it during deserialization).
+ * \author tkornuta
+ */
+TEST_F(Linear5x2Float, LayerType) {
+	ASSERT_EQ( layer.layer_type, mic::mlnn::LayerTypes::Linear );
+	ASSERT_EQ( layer.type(), "Linear" );
+}
+
+/*!
+ * \brief Makes sure that names of matrices are resolved into their handles and that missing matrices are reported (instead of aliasing the matrix at handle 0).
+ * \author tkornuta
+ */
+TEST_F(Linear5x2Float, ResolveHandle) {
+	ASSERT_EQ( (*layer.p[mic::mlnn::Layer<float>::resolveHandle(layer.p, "b")]).size(), 2 );
+	ASSERT_EQ( (*layer.p[mic::mlnn::Layer<float>::resolveHandle(layer.p, "W")]).size(), 10 );
+	ASSERT_THROW( mic::mlnn::Layer<float>::resolveHandle(layer.p, "V"), std::runtime_error );
+}
+
 /*!
  * \brief Makes sure that the layer is properly initialized - all W are numbers!
  * \author tkornuta
@@ -331,6 +350,125 @@ TEST_F(Linear50x100Double, NumericalGradientCheck_dx) {
 }
 
 
+/*!
+ * \brief Checks whether the fused layer gives the same outputs and gradients as the linear layer followed by the activation layer.
+ * \author tkornuta
+ */
+TEST(FusedLinear20x10Double, SameAsLinearAndActivation) {
+	using mic::mlnn::activation_function::kernels::Activation;
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 20, 5);
+	x->rand(-2.0, 2.0);
+	mic::types::MatrixPtr<double> dy = MAKE_MATRIX_PTR(double, 10, 5);
+	dy->rand(-1.0, 1.0);
+
+	for (Activation activation : {Activation::Identity, Activation::ReLU, Activation::ELU, Activation::Sigmoid}) {
+		mic::mlnn::fully_connected::FusedLinear<double> fused(20, 10, activation);
+		mic::mlnn::fully_connected::Linear<double> linear(20, 10);
+		(*linear.p["W"]) = (*fused.p["W"]);
+		(*fused.p["b"]).rand(-1.0, 1.0);
+		(*linear.p["b"]) = (*fused.p["b"]);
+		std::shared_ptr<mic::mlnn::Layer<double> > act;
+		if (activation == Activation::ReLU)
+			act = std::make_shared<mic::mlnn::activation_function::ReLU<double> >(10);
+		else if (activation == Activation::ELU)
+			act = std::make_shared<mic::mlnn::activation_function::ELU<double> >(10);
+		else if (activation == Activation::Sigmoid)
+			act = std::make_shared<mic::mlnn::activation_function::Sigmoid<double> >(10);
+		fused.resizeBatch(5);
+		linear.resizeBatch(5);
+
+		// Forward.
+		mic::types::MatrixPtr<double> y = fused.forward(x);
+		mic::types::MatrixPtr<double> ref_y = linear.forward(x);
+		if (act) {
+			act->resizeBatch(5);
+			ref_y = act->forward(ref_y);
+		}//: if
+		for (size_t i=0; i< (size_t)y->size(); i++)
+			ASSERT_NEAR((*y)[i], (*ref_y)[i], 1e-12) << "Difference in y of " << fused.streamLayerParameters() << " at position i=" << i;
+
+		// Backward.
+		mic::types::MatrixPtr<double> dx = fused.backward(dy);
+		mic::types::MatrixPtr<double> ref_dx = linear.backward(act ? act->backward(dy) : dy);
+		for (size_t i=0; i< (size_t)dx->size(); i++)
+			ASSERT_NEAR((*dx)[i], (*ref_dx)[i], 1e-12) << "Difference in dx of " << fused.streamLayerParameters() << " at position i=" << i;
+		for (size_t i=0; i< (size_t)fused.g["W"]->size(); i++)
+			ASSERT_NEAR((*fused.g["W"])[i], (*linear.g["W"])[i], 1e-12) << "Difference in dW of " << fused.streamLayerParameters() << " at position i=" << i;
+		for (size_t i=0; i< (size_t)fused.g["b"]->size(); i++)
+			ASSERT_NEAR((*fused.g["b"])[i], (*linear.g["b"])[i], 1e-12) << "Difference in db of " << fused.streamLayerParameters() << " at position i=" << i;
+	}//: for
+}
+
+
+/*!
+ * \brief Numerical gradient test of dW, db and dx of the fused layer, for all activation functions.
+ * \author tkornuta
+ */
+TEST(FusedLinear20x10Double, NumericalGradientCheck) {
+	using mic::mlnn::activation_function::kernels::Activation;
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 20, 3);
+	x->rand(-2.0, 2.0);
+	mic::types::MatrixPtr<double> target_y = MAKE_MATRIX_PTR(double, 10, 3);
+	target_y->rand(-1.0, 1.0);
+	mic::neural_nets::loss::SquaredErrorLoss<double> loss;
+	double delta = 1e-5;
+	double eps = 1e-7;
+
+	for (Activation activation : {Activation::ReLU, Activation::ELU, Activation::Sigmoid}) {
+		mic::mlnn::fully_connected::FusedLinear<double> layer(20, 10, activation);
+		(*layer.p["b"]).rand(-1.0, 1.0);
+		layer.resizeBatch(3);
+
+		// Calculate gradients - make copies!
+		mic::types::MatrixPtr<double> dy = loss.calculateGradient(target_y, layer.forward(x));
+		mic::types::MatrixPtr<double> dx = MAKE_MATRIX_PTR(double, *layer.backward(dy));
+		mic::types::MatrixPtr<double> dW = MAKE_MATRIX_PTR(double, *layer.g["W"]);
+		mic::types::MatrixPtr<double> db = MAKE_MATRIX_PTR(double, *layer.g["b"]);
+
+		// Calculate numerical gradients.
+		mic::types::MatrixPtr<double> nW = layer.calculateNumericalGradient<mic::neural_nets::loss::SquaredErrorLoss<double> >(x, target_y, layer.p["W"], loss, delta);
+		mic::types::MatrixPtr<double> nb = layer.calculateNumericalGradient<mic::neural_nets::loss::SquaredErrorLoss<double> >(x, target_y, layer.p["b"], loss, delta);
+		mic::types::MatrixPtr<double> nx = layer.calculateNumericalGradient<mic::neural_nets::loss::SquaredErrorLoss<double> >(x, target_y, x, loss, delta);
+
+		// Compare gradients.
+		for (size_t i=0; i<(size_t)dW->size(); i++)
+			EXPECT_LE( fabs((*dW)[i] - (*nW)[i]), eps) << "Too big difference between dW and numerical dW of " << layer.streamLayerParameters() << " at position i=" << i;
+		for (size_t i=0; i<(size_t)db->size(); i++)
+			EXPECT_LE( fabs((*db)[i] - (*nb)[i]), eps) << "Too big difference between db and numerical db of " << layer.streamLayerParameters() << " at position i=" << i;
+		for (size_t i=0; i<(size_t)dx->size(); i++)
+			EXPECT_LE( fabs((*dx)[i] - (*nx)[i]), eps) << "Too big difference between dx and numerical dx of " << layer.streamLayerParameters() << " at position i=" << i;
+	}//: for
+}
+
+
+/*!
+ * \brief Makes sure that the Hebbian layer thresholds all its outputs - and only the outputs, also when their number differs from the number of inputs.
+ * \author tkornuta
+ */
+TEST(HebbianLinear, ForwardThresholdsAllOutputs) {
+	size_t sizes[2][2] = {{2, 5}, {10, 3}};
+	for (size_t si=0; si< 2; si++) {
+		size_t inputs = sizes[si][0];
+		size_t outputs = sizes[si][1];
+		mic::mlnn::fully_connected::HebbianLinear<float> layer(inputs, outputs);
+		mic::types::MatrixPtr<float> x = MAKE_MATRIX_PTR(float, inputs, 2);
+		x->setOnes();
+		// Weighted sums of the first output stay below the threshold, of the remaining ones exceed it.
+		(*layer.p["W"]).setConstant(0.6);
+		(*layer.p["W"]).row(0).setConstant(0.05);
+
+		layer.resizeBatch(2);
+		mic::types::MatrixPtr<float> y = layer.forward(x);
+		ASSERT_EQ(y->rows(), (int)outputs);
+		ASSERT_EQ(y->cols(), 2);
+		for (size_t ib=0; ib< 2; ib++) {
+			ASSERT_EQ((*y)(0, ib), 0.0f) << "Layer " << inputs << "x" << outputs << " sample " << ib;
+			for (size_t o=1; o< outputs; o++)
+				ASSERT_EQ((*y)(o, ib), 1.0f) << "Layer " << inputs << "x" << outputs << " sample " << ib << " output " << o;
+		}//: for
+	}//: for
+}
+
 } } } //: namespaces
 
 
@@ -31,6 +31,11 @@
 #define private public
 #define protected public
 #include <mlnn/fully_connected/Linear.hpp>
+#include <mlnn/fully_connected/FusedLinear.hpp>
+#include <mlnn/fully_connected/HebbianLinear.hpp>
+#include <mlnn/activation_function/ELU.hpp>
+#include <mlnn/activation_function/ReLU.hpp>
+#include <mlnn/activation_function/Sigmoid.hpp>
 #include <loss/SquaredErrorLoss.hpp>
 
 namespace mic { namespace neural_nets { namespace unit_tests {
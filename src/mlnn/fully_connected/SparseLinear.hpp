@@ -58,6 +58,9 @@ public:
 		// For penalty.
 		m.add ("penalty", outputSize(), 1 );
 
+		// Resolve handles of the matrices.
+		SparseLinear<eT>::resolveHandles();
+
 		// Set desired sparsity and penalty term.
 		desired_ro = 0.1; // 10 %
 		beta = 0.5;
@@ -75,19 +78,26 @@ public:
 	void backward() {
 		eT eps = 1e-10;
 		// Calculate the current "activation sparsity".
-		mic::types::MatrixPtr<eT> ro = m["ro"];
-		(*ro) = ((*s['y']).rowwise().sum()/batch_size);
+		mic::types::MatrixPtr<eT> ro = m[hro];
+		(*ro) = ((*s[hy]).rowwise().sum()/batch_size);
 
 		// Calculate the sparsity penalty - for every output neuron.
-		mic::types::MatrixPtr<eT> penalty = m["penalty"];
+		mic::types::MatrixPtr<eT> penalty = m[hpenalty];
 		for (size_t i=0; i<outputSize(); i++)
 			(*penalty)[i] = beta*(-desired_ro/((*ro)[i] + eps) + (1-desired_ro)/(1-(*ro)[i] + eps));
 
 
 		// Calculate derivatives of W,b and x.
-		(*g['W']) = (*g['y']) * ((*s['x']).transpose());
-		(*g['b']) = (*g['y']).rowwise().mean();
-		(*g['x']) = (*p['W']).transpose() * (*g['y']);
+		(*g[hdW]) = (*g[hy]) * ((*s[hx]).transpose());
+		(*g[hdb]) = (*g[hy]).rowwise().mean();
+		(*g[hx]) = (*p[hW]).transpose() * (*g[hy]);
+	}
+
+	/*!
+	 * Backward pass calculates the sparsity penalty from the output.
+	 */
+	virtual bool backwardUsesOutput() {
+		return true;
 	}
 
 	/*!
@@ -100,12 +110,11 @@ public:
 		//std::cout << "g['W'] = \n" << (*g['W']) << std::endl;
 
 		// Apply selected learning rule to W.
-		opt["W"]->update(p['W'], g['W'], alpha_, decay_);
+		opt[hW]->update(p[hW], g[hdW], alpha_, decay_);
 
 		// Apply sparsity learning rule to b, incorporating the KL-divergence term.
-		mic::types::MatrixPtr<eT> penalty = m["penalty"];
-		// (*p['b']) -=  alpha_ * beta * (*penalty);
-		opt["b"]->update(p['b'], g['b'], alpha_, 0.0);
+		// (*p['b']) -=  alpha_ * beta * (*m[hpenalty]);
+		opt[hb]->update(p[hb], g[hdb], alpha_, 0.0);
 
 		//std::cout << "p['W'] after update= \n" << (*p['W']) << std::endl;
 	}
@@ -124,6 +133,24 @@ protected:
     using Layer<eT>::outputSize;
     using Layer<eT>::batch_size;
     using Layer<eT>::opt;
+    using Layer<eT>::hx;
+    using Layer<eT>::hy;
+    using Linear<eT>::hW;
+    using Linear<eT>::hb;
+    using Linear<eT>::hdW;
+    using Linear<eT>::hdb;
+
+	/// Handles of the current sparsity and penalty vectors.
+	size_t hro, hpenalty;
+
+	/*!
+	 * Resolves handles of the matrices used by the layer.
+	 */
+	virtual void resolveHandles() {
+		Linear<eT>::resolveHandles();
+		hro = Layer<eT>::resolveHandle(m, "ro");
+		hpenalty = Layer<eT>::resolveHandle(m, "penalty");
+	}
 
 private:
 	// Friend class - required for using boost serialization.
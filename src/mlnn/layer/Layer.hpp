@@ -25,11 +25,13 @@
 
 #include <iostream>
 #include <string>
+#include <stdexcept>
 
 #include<types/MatrixTypes.hpp>
 #include<types/MatrixArray.hpp>
 #include <optimization/OptimizationFunctionTypes.hpp>
 #include <optimization/OptimizationArray.hpp>
+#include <mlnn/layer/ScratchArena.hpp>
 
 #include <boost/serialization/serialization.hpp>
 // include this header to serialize vectors
@@ -76,7 +78,9 @@ enum class LayerTypes : short
 	// regularization
     Dropout,
     // Experimental
-    ConvHebbian
+    ConvHebbian,
+	// fully_connected (added later, so the values of the former types are preserved)
+	FusedLinear
 };
 
 
@@ -85,6 +89,26 @@ enum class LayerTypes : short
 template <typename eT>
 class MultiLayerNeuralNetwork;
 
+/*!
+ * \brief Structure describing a single parameter updated by a gradient-based optimization function - used by the multi-tensor update of the network.
+ * \author tkornuta
+ * \tparam eT Template parameter denoting precision of variables.
+ */
+template <typename eT>
+struct ParameterSegment {
+	/// Parameter.
+	mic::types::MatrixPtr<eT> p;
+
+	/// Gradient of the parameter.
+	mic::types::MatrixPtr<eT> dp;
+
+	/// Optimization function updating the parameter.
+	std::shared_ptr<mic::neural_nets::optimization::OptimizationFunction<eT> > opt;
+
+	/// Flag denoting whether weight decay is applied to the parameter.
+	bool decay;
+};
+
 /*!
  * Template base (abstract) class representing a layer.
  * \author tkornuta/krocki
@@ -117,6 +141,7 @@ public:
 		output_depth(output_depth_),
 		// Set batch size.
 		batch_size(1),
+		frozen(false),
 		// Set layer type and name.
 		layer_type(layer_type_),
 		layer_name(name_),
@@ -145,6 +170,8 @@ public:
 		// Allocate (temporary) memory for "output sample" - a column vector.
 		m.add ("yc", output_height * output_width, 1);
 
+		// Resolve handles of the matrices.
+		Layer<eT>::resolveHandles();
 	};
 
 
@@ -164,13 +191,13 @@ public:
 	 */
 	mic::types::MatrixPtr<eT> forward(mic::types::MatrixPtr<eT> x_, bool test = false) {
 		// Copy "input" sample/batch.
-		(*s["x"]) = (*x_);
+		(*s[hx]) = (*x_);
 
 		// Call the (abstract, implemented by a given layer) forward pass.
 		forward(test);
 
 		// Return "output".
-		return s["y"];
+		return s[hy];
 	}
 
 	/*!
@@ -183,13 +210,13 @@ public:
 	 */
 	mic::types::MatrixPtr<eT> backward(mic::types::MatrixPtr<eT> dy_) {
 		// Copy "output" sample/batch gradient.
-		(*g["y"]) = (*dy_);
+		(*g[hy]) = (*dy_);
 
 		// Call the (abstract, implemented by a given layer) backward pass.
 		backward();
 
 		// Return "input" gradient.
-		return g["x"];
+		return g[hx];
 	}
 
 	/*!
@@ -200,11 +227,47 @@ public:
 		// Change the "value". (depricated)
 		batch_size = batch_size_;
 		// Reshape the inputs...
-		s["x"]->resize(s["x"]->rows(), batch_size_);
-		g["x"]->resize(g["x"]->rows(), batch_size_);
+		s[hx]->resize(s[hx]->rows(), batch_size_);
+		g[hx]->resize(g[hx]->rows(), batch_size_);
 		// ... and outputs.
-		s["y"]->resize(s["y"]->rows(), batch_size_);
-		g["y"]->resize(g["y"]->rows(), batch_size_);
+		s[hy]->resize(s[hy]->rows(), batch_size_);
+		g[hy]->resize(g[hy]->rows(), batch_size_);
+	}
+
+	/*!
+	 * Resolves the name of a matrix stored in a given array into a handle, i.e. stable index of the matrix in that array.
+	 * Matrices should be accessed by handles on the hot paths (forward, backward, update), as it does not involve string allocations and map traversals.
+	 * @param array_ Array containing the matrix.
+	 * @param name_ Name of the matrix.
+	 * @return Handle of the matrix.
+	 * @throws std::runtime_error if the array does not contain the matrix (e.g. loaded from a file with different matrices).
+	 */
+	static size_t resolveHandle(mic::types::MatrixArray<eT> & array_, std::string name_) {
+		std::map<std::string, size_t> keys = array_.keys();
+		std::map<std::string, size_t>::const_iterator it = keys.find(name_);
+		if (it == keys.end()) {
+			LOG(LFATAL) << "Matrix " << name_ << " not found in array " << array_.name() << "!";
+			throw std::runtime_error("Matrix " + name_ + " not found in array " + array_.name());
+		}//: if
+		return it->second;
+	}
+
+	/*!
+	 * Resolves handles of the matrices used by the layer - called in the constructor and after deserialization.
+	 * Derived classes that use additional matrices should overload it (and call the parent method).
+	 */
+	virtual void resolveHandles() {
+		// Input and output have identical handles in the state and gradient arrays.
+		hx = resolveHandle(s, "x");
+		hy = resolveHandle(s, "y");
+		assert(resolveHandle(g, "x") == hx);
+		assert(resolveHandle(g, "y") == hy);
+
+		// Temporary sample/channel matrices.
+		hxs = resolveHandle(m, "xs");
+		hxc = resolveHandle(m, "xc");
+		hys = resolveHandle(m, "ys");
+		hyc = resolveHandle(m, "yc");
 	}
 
 	/*!
@@ -222,10 +285,12 @@ public:
 		for (size_t i=0; i<(size_t)param_->size(); i++) {
 			// Add delta.
 			(*param_)[i] += delta_;
+			invalidateParameterCaches();
 			// Calculate loss.
 			eT p = loss_.calculateLoss(target_y_, forward(x_));
 			// Substract delta.
 			(*param_)[i] -= 2*delta_;
+			invalidateParameterCaches();
 			// Calculate loss.
 			eT m = loss_.calculateLoss(target_y_, forward(x_));
 
@@ -233,12 +298,18 @@ public:
 			(*nGrad)[i] = (p-m)/(2*delta_);
 			// Set original value.
 			(*param_)[i] += delta_;
+			invalidateParameterCaches();
 
 		}//: for
 		return nGrad;
 	}
 
 
+	/*!
+	 * Notifies the layer that its parameters were modified. Virtual empty method - to be implemented by layers caching values computed from parameters.
+	 */
+	virtual void invalidateParameterCaches() { }
+
 	/*!
 	 * Reset gradients. Virtual empty method - to be implemented by the inherited classes.
 	 */
@@ -251,6 +322,65 @@ public:
 	 */
 	virtual void update(eT alpha_, eT decay_  = 0.0f) = 0;
 
+	/*!
+	 * Appends segments describing the parameters that update() modifies with gradient-based optimization functions, so the network can update them all at once.
+	 * Returns false (default) if the layer must be updated by its own update() instead.
+	 * @param segments_ Vector of segments the ones of the layer will be appended to.
+	 */
+	virtual bool getParameterSegments(std::vector<ParameterSegment<eT> > & segments_) {
+		return false;
+	}
+
+	/*!
+	 * Returns true if the forward pass computes every element of the output only from the element of the input with the same index,
+	 * so the output can overwrite the input (i.e. share the matrix with it) in the inference-only mode. False by default.
+	 */
+	virtual bool elementwiseForward() {
+		return false;
+	}
+
+	/*!
+	 * Returns true if the backward pass reads the input of the layer, i.e. the input must be kept until the backward pass. True by default.
+	 */
+	virtual bool backwardUsesInput() {
+		return true;
+	}
+
+	/*!
+	 * Returns true if the backward pass reads the output of the layer, i.e. the output must be kept until the backward pass. True by default.
+	 */
+	virtual bool backwardUsesOutput() {
+		return true;
+	}
+
+	/*!
+	 * Returns the number of elements of the temporary matrices the layer needs at once during its forward or backward pass (for the current batch size),
+	 * i.e. the part of the scratch arena it uses. Zero (default) if the layer does not use the arena.
+	 */
+	virtual size_t scratchSize() {
+		return 0;
+	}
+
+	/*!
+	 * Sets the scratch arena shared by the layers of the network, serving the temporary matrices of the layer instead of its own ones.
+	 * Derived classes using the arena should overload it (and call the parent method) in order to release their own temporary matrices.
+	 * @param arena_ Arena (nullptr restores the own temporary matrices).
+	 */
+	virtual void setScratchArena(std::shared_ptr<ScratchArena<eT> > arena_) {
+		scratch_arena = arena_;
+	}
+
+	/*!
+	 * Switches the layer to the inference-only mode - releases the gradients and optimization functions.
+	 * Afterwards the layer can perform only the forward pass (in the test mode).
+	 */
+	virtual void freeze() {
+		frozen = true;
+		for (auto key : g.keys())
+			g[key.second] = MAKE_MATRIX_PTR(eT, 0, 0);
+		opt.clear();
+	}
+
 	/// Returns size (length) of inputs.
 	inline size_t inputSize() {
 		return input_height*input_width*input_depth;
@@ -308,11 +438,18 @@ public:
 		// Remove all previous optimization functions.
 		opt.clear();
 
+		// Order parameters by their handles.
+		std::map<std::string, size_t> keys = p.keys();
+		std::vector<std::string> names(keys.size());
+		for (auto& i: keys)
+			names[i.second] = i.first;
+
 		// Iterate through parameters and add a separate optimization function for each parameter.
-		for (auto& i: p.keys()) {
+		// Functions are added in the order of parameters, so handle of a given parameter is also the handle of its optimization function.
+		for (size_t i=0; i < names.size(); i++) {
 			opt.add(
-					i.first,
-					std::make_shared< omT > (omT ( (p[i.second])->rows(), (p[i.second])->cols() ))
+					names[i],
+					std::make_shared< omT > (omT ( (p[i])->rows(), (p[i])->cols() ))
 					);
 		}//: for keys
 	}
@@ -332,6 +469,8 @@ public:
 		// convolution
 		case(LayerTypes::Convolution):
 			return "Convolution";
+		case(LayerTypes::Cropping):
+			return "Cropping";
 		case(LayerTypes::Padding):
 			return "Padding";
 		case(LayerTypes::MaxPooling):
@@ -348,9 +487,14 @@ public:
 			return "HebbianLinear";
 		case(LayerTypes::BinaryCorrelator):
 			return "BinaryCorrelator";
+		case(LayerTypes::FusedLinear):
+			return "FusedLinear";
 		// regularization
 		case(LayerTypes::Dropout):
 			return "Dropout";
+		// experimental
+		case(LayerTypes::ConvHebbian):
+			return "ConvHebbian";
 		default:
 			return "Undefined";
 		}//: switch
@@ -589,13 +733,13 @@ public:
 		lazyAllocateMatrixVector(x_activations, input_depth * batch_size, input_height*input_width, 1);
 
 		// Get y batch.
-		mic::types::MatrixPtr<eT> batch_x = s['x'];
+		mic::types::MatrixPtr<eT> batch_x = s[hx];
 
 		// Iterate through filters and generate "activation image" for each one.
 		for (size_t ib=0; ib< batch_size; ib++) {
 
 			// Get input sample from batch!
-			mic::types::MatrixPtr<eT> sample_x = m["xs"];
+			mic::types::MatrixPtr<eT> sample_x = m[hxs];
 			(*sample_x) = batch_x->col(ib);
 
 			// Iterate through input channels.
@@ -624,13 +768,13 @@ public:
 		lazyAllocateMatrixVector(dx_activations, batch_size * input_depth, input_height*input_width, 1);
 
 		// Get dx batch.
-		mic::types::MatrixPtr<eT> batch_dx = g['x'];
+		mic::types::MatrixPtr<eT> batch_dx = g[hx];
 
 		// Iterate through filters and generate "activation image" for each one.
 		for (size_t ib=0; ib< batch_size; ib++) {
 
 			// Get input sample from batch!
-			mic::types::MatrixPtr<eT> sample_dx = m["xs"];
+			mic::types::MatrixPtr<eT> sample_dx = m[hxs];
 			(*sample_dx) = batch_dx->col(ib);
 
 			// Iterate through input channels.
@@ -659,13 +803,13 @@ public:
 		lazyAllocateMatrixVector(y_activations, batch_size*output_depth, output_height*output_width, 1);
 
 		// Get y batch.
-		mic::types::MatrixPtr<eT> batch_y = s['y'];
+		mic::types::MatrixPtr<eT> batch_y = s[hy];
 
 		// Iterate through filters and generate "activation image" for each one.
 		for (size_t ib=0; ib< batch_size; ib++) {
 
 			// Get input sample from batch!
-			mic::types::MatrixPtr<eT> sample_y = m["ys"];
+			mic::types::MatrixPtr<eT> sample_y = m[hys];
 			(*sample_y) = batch_y->col(ib);
 
 			// Iterate through output channels.
@@ -694,13 +838,13 @@ public:
 		lazyAllocateMatrixVector(dy_activations, output_depth*batch_size, output_height*output_width, 1);
 
 		// Get dy batch.
-		mic::types::MatrixPtr<eT> batch_dy = g['y'];
+		mic::types::MatrixPtr<eT> batch_dy = g[hy];
 
 		// Iterate through filters and generate "activation image" for each one.
 		for (size_t ib=0; ib< batch_size; ib++) {
 
 			// Get input sample from batch!
-			mic::types::MatrixPtr<eT> sample_dy = m["ys"];
+			mic::types::MatrixPtr<eT> sample_dy = m[hys];
 			(*sample_dy) = batch_dy->col(ib);
 
 			// Iterate through output channels.
@@ -743,6 +887,9 @@ protected:
 	/// Size (length) of (mini)batch.
 	size_t batch_size;
 
+	/// Flag denoting whether the layer is in the inference-only mode.
+	bool frozen;
+
 	/// Type of the layer.
 	LayerTypes layer_type;
 
@@ -764,6 +911,40 @@ protected:
 	/// Array of optimization functions.
 	mic::neural_nets::optimization::OptimizationArray<eT> opt;
 
+	/// Handle of the input [x] matrix - in both state and gradient arrays.
+	size_t hx;
+
+	/// Handle of the output [y] matrix - in both state and gradient arrays.
+	size_t hy;
+
+	/// Handles of the temporary matrices (stored in memory array): input sample, input channel, output sample and output channel.
+	size_t hxs, hxc, hys, hyc;
+
+	/// Scratch arena shared by the layers of the network (nullptr if the layer uses its own temporary matrices).
+	std::shared_ptr<ScratchArena<eT> > scratch_arena;
+
+	/// View of a temporary matrix - being a part of the scratch arena or of a matrix of the layer.
+	typedef Eigen::Map<Eigen::Matrix<eT, Eigen::Dynamic, Eigen::Dynamic> > ScratchMatrix;
+
+	/*!
+	 * Returns the temporary matrix of a given size - served from the scratch arena (if set) or from the temporary matrix of the layer (resized if required).
+	 * @param handle_ Handle of the temporary matrix of the layer.
+	 * @param rows_ Number of rows.
+	 * @param cols_ Number of columns.
+	 * @param offset_ Offset of the matrix in the arena (in elements) - must not exceed scratchSize().
+	 */
+	ScratchMatrix scratchMatrix(size_t handle_, size_t rows_, size_t cols_, size_t offset_) {
+		if (scratch_arena) {
+			// Reserve all the memory of the layer at once, so the previous views remain valid.
+			size_t size = offset_ + rows_*cols_;
+			scratch_arena->reserve((size > scratchSize()) ? size : scratchSize());
+			return ScratchMatrix(scratch_arena->data() + offset_, rows_, cols_);
+		}//: if
+		if (((size_t)m[handle_]->rows() != rows_) || ((size_t)m[handle_]->cols() != cols_))
+			m[handle_]->resize(rows_, cols_);
+		return ScratchMatrix(m[handle_]->data(), rows_, cols_);
+	}
+
 	/// Vector containing activations of input neurons - used in visualization.
 	std::vector< std::shared_ptr <mic::types::Matrix<eT> > > x_activations;
 
@@ -780,7 +961,7 @@ protected:
 	/*!
 	 * Protected constructor, used only by the derived classes during the serialization. Empty!!
 	 */
-	Layer () { }
+	Layer () : frozen(false) { }
 
 private:
 	// Friend class - required for using boost serialization.
@@ -794,7 +975,7 @@ private:
     /*!
      * Serializes the layer to and from archive.
      * @param ar Used archive.
-     * @param version Version of the layer class (not used currently).
+     * @param version Version of the layer class.
      */
     template<class Archive>
     void serialize(Archive & ar, const unsigned int version) {
@@ -813,7 +994,15 @@ private:
         ar & g;
         ar & p;
         ar & m;
-        // TODO: serialize optimization function!
+        // Archive optimization functions along with their internal state (not present in older versions).
+        if (version >= 3)
+        	ar & opt;
+        else if (Archive::is_loading::value)
+        	setOptimization<mic::neural_nets::optimization::GradientDescent<eT> > ();
+
+        // Matrices were (re)created - resolve their handles.
+        if (Archive::is_loading::value)
+        	resolveHandles();
     }
 
 
@@ -825,7 +1014,7 @@ private:
 
 
 // Just in the case that something important will change in the Layer class - set version.
-BOOST_CLASS_VERSION(mic::mlnn::Layer<float>, 2)
-BOOST_CLASS_VERSION(mic::mlnn::Layer<double>, 2)
+BOOST_CLASS_VERSION(mic::mlnn::Layer<float>, 3)
+BOOST_CLASS_VERSION(mic::mlnn::Layer<double>, 3)
 
 #endif /* SRC_MLNN_LAYER_HPP_ */
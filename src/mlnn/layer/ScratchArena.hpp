@@ -0,0 +1,86 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file ScratchArena.hpp
+ * \brief Contiguous block of memory serving temporary matrices of all layers of the network.
+ * \author tkornuta
+ * \date Oct 16, 2026
+ */
+
+#ifndef SRC_MLNN_SCRATCHARENA_HPP_
+#define SRC_MLNN_SCRATCHARENA_HPP_
+
+#include <Eigen/Dense>
+#include <cstddef>
+
+namespace mic {
+namespace mlnn {
+
+/*!
+ * \brief Contiguous block of memory shared by the layers of a network, serving the temporary matrices they need only during their forward or backward pass.
+ * As layers are processed one by one, every layer lays out its temporary matrices from the beginning of the arena,
+ * so the arena is as large as the temporary matrices of the most demanding layer (instead of the sum over all layers).
+ * \author tkornuta
+ * \tparam eT Template parameter denoting precision of variables.
+ */
+template <typename eT>
+class ScratchArena {
+public:
+	/*!
+	 * Creates an empty arena.
+	 */
+	ScratchArena() { }
+
+	/*!
+	 * Makes sure that the arena holds at least the given number of elements.
+	 * Growing the arena invalidates the views of its memory, so a layer should reserve all memory it needs before taking the first view.
+	 * @param size_ Number of elements.
+	 */
+	void reserve(size_t size_) {
+		if (size_ > (size_t)buffer.size())
+			buffer.resize(size_);
+	}
+
+	/*!
+	 * Returns pointer to the memory of the arena.
+	 */
+	eT* data() {
+		return buffer.data();
+	}
+
+	/*!
+	 * Returns the number of elements of the arena.
+	 */
+	size_t size() {
+		return buffer.size();
+	}
+
+	/*!
+	 * Returns the number of bytes occupied by the arena.
+	 */
+	size_t bytes() {
+		return buffer.size() * sizeof(eT);
+	}
+
+private:
+	/// Memory of the arena (aligned by Eigen).
+	Eigen::Matrix<eT, Eigen::Dynamic, 1> buffer;
+};
+
+} /* namespace mlnn */
+} /* namespace mic */
+
+#endif /* SRC_MLNN_SCRATCHARENA_HPP_ */
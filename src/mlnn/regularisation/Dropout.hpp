@@ -23,6 +23,8 @@
 #ifndef SRC_MLNN_DROPOUT_HPP_
 #define SRC_MLNN_DROPOUT_HPP_
 
+#include <cstdint>
+
 #include <mlnn/layer/Layer.hpp>
 
 namespace mic {
@@ -46,66 +48,119 @@ public:
 		Layer<eT>(inputs_, 1, 1,
 				inputs_, 1, 1,
 				LayerTypes::Dropout, name_),
-				keep_ratio(ratio_)
+				keep_ratio(ratio_),
+				seed(0x853c49e6748fea9bULL),
+				counter(0)
 	{
-		// Create matrices with temporary variables: random and dropout of size [inputxinput], so we can simply calculate: y=mask*x.
-		m.add ("random", inputs_, inputs_);
-		m.add ("dropout_mask", inputs_, inputs_);
+		// Create matrix with the dropout mask of size [inputs x batch] - the mask stores 0 for the dropped elements and 1/keep_ratio for the passed ones, so y = mask .* x.
+		m.add ("dropout_mask", inputs_, 1);
+
+		// Resolve handles of the matrices.
+		Dropout<eT>::resolveHandles();
 	}
 
 	virtual ~Dropout() {};
 
 	/*!
-	 * Changes the size of the batch - calls base Layer class resize and additionally resizes the cache size.
+	 * Changes the size of the batch - calls base Layer class resize and additionally resizes the dropout mask.
 	 * @param New size of the batch.
 	 */
 	virtual void resizeBatch(size_t batch_size_) {
 		// Call base Layer resize.
 		Layer<eT>::resizeBatch(batch_size_);
 
-		// Reshape pooling mask and map.
-		m["dropout_mask"]->resize(Layer<eT>::inputSize(), batch_size_);
+		// Reshape dropout mask (not used in the inference-only mode).
+		if (!frozen)
+			m[hmask]->resize(Layer<eT>::inputSize(), batch_size_);
+	}
+
+	/*!
+	 * Sets the seed of the random generator used for generation of dropout masks.
+	 * @param seed_ New seed.
+	 */
+	void setSeed(uint64_t seed_) {
+		seed = seed_;
+		counter = 0;
 	}
 
+	/*!
+	 * Returns the seed of the random generator.
+	 */
+	uint64_t getSeed() {
+		return seed;
+	}
 
 	void forward(bool test = false) {
-		if (test) {
+		// Access the data of matrices.
+		eT* x = s[hx]->data();
+		eT* y = s[hy]->data();
+		size_t size = s[hx]->rows() * s[hx]->cols();
+
+		if (test || frozen) {
 			// In test run copy data as it is.
-			(*s['y']) = (*s['x']);
+			for (size_t i = 0; i < size; i++)
+				y[i] = x[i];
 
 		} else {
-			// Get pointers to input and output batches.
-			mic::types::MatrixPtr<eT> batch_x = s['x'];
-			mic::types::MatrixPtr<eT> batch_y = s['y'];
-
-			// Generate random matrix.
-			mic::types::MatrixPtr<eT> rand = m["random"];
-			rand->rand(0.0f, 1.0f);
-
-			// Generate the dropout mask.
-			mic::types::MatrixPtr<eT> mask = m["dropout_mask"];
+			eT* mask = m[hmask]->data();
+
+			// Scale passed activations, so that we don't have to do anything at test time.
+			eT scale = (eT)1.0 / keep_ratio;
+			// Compare 32 bits of the random number with the threshold, so that the element is kept with probability keep_ratio.
+			uint64_t threshold = (uint64_t)((double)keep_ratio * 4294967296.0);
+			uint64_t base = seed + counter;
+
+			// Generate mask and apply it in a single pass - every element gets its own random number, so iterations are independent.
+			#pragma omp parallel for schedule(static)
+			for (size_t i = 0; i < size; i++) {
+				mask[i] = ((randomBits(base + i) >> 32) < threshold) ? scale : (eT)0.0;
+				y[i] = mask[i] * x[i];
+			}//: for
+
+			// Next batch will use different random numbers.
+			counter += size;
+		}//: else
+	}
 
-			#pragma omp parallel for
-			for(size_t i=0; i< (size_t)mask->size(); i++)
-				(*mask)[i] = ((*rand)[i] < keep_ratio);
+	/*!
+	 * Forward pass is elementwise, so it can be performed in place.
+	 */
+	virtual bool elementwiseForward() {
+		return true;
+	}
 
-			// Apply the dropout_mask - discard the elements where mask is 0.
-			(*batch_y) =  (*mask) * (*batch_x);
+	/*!
+	 * Backward pass uses only the dropout mask, so neither the input...
+	 */
+	virtual bool backwardUsesInput() {
+		return false;
+	}
 
-			// Normalize, so that we don't have to do anything at test time.
-			(*batch_y) /= keep_ratio;
+	/*!
+	 * ... nor the output are needed.
+	 */
+	virtual bool backwardUsesOutput() {
+		return false;
+	}
 
-		}
+	/*!
+	 * Switches the layer to the inference-only mode - releases the gradients and the dropout mask.
+	 */
+	virtual void freeze() {
+		Layer<eT>::freeze();
+		m[hmask] = MAKE_MATRIX_PTR(eT, 0, 0);
 	}
 
 	void backward() {
-		// Get pointers to input and output batches.
-		mic::types::MatrixPtr<eT> batch_dx = g['x'];
-		mic::types::MatrixPtr<eT> batch_dy = g['y'];
-		mic::types::MatrixPtr<eT> mask = m["dropout_mask"];
+		// Access the data of matrices.
+		eT* gx = g[hx]->data();
+		eT* gy = g[hy]->data();
+		eT* mask = m[hmask]->data();
 
 		// Always use dropout mask as backward pass is used only during learning.
-		(*batch_dy) =  (*mask).transpose() * (*batch_dx);
+		size_t size = g[hx]->rows() * g[hx]->cols();
+		for (size_t i = 0; i < size; i++)
+			gx[i] = mask[i] * gy[i];
 	}
 
 	/*!
@@ -123,9 +178,12 @@ protected:
 	// Unhide the fields inherited from the template class Layer via "using" statement.
     using Layer<eT>::g;
     using Layer<eT>::s;
+    using Layer<eT>::hx;
+    using Layer<eT>::hy;
     using Layer<eT>::p;
     using Layer<eT>::m;
     using Layer<eT>::batch_size;
+    using Layer<eT>::frozen;
 
 
 	/*!
@@ -133,14 +191,53 @@ protected:
 	 */
 	eT keep_ratio;
 
+	/// Seed of the random generator.
+	uint64_t seed;
+
+	/// Number of random numbers generated so far.
+	uint64_t counter;
+
+	/// Handle of the dropout mask.
+	size_t hmask;
+
+	/*!
+	 * Counter-based random generator (SplitMix64 finalizer) - returns 64 random bits for a given counter value.
+	 * Being stateless, it lets the compiler vectorize and OpenMP split the masking loop, while the masks do not depend on the number of threads.
+	 */
+	static inline uint64_t randomBits(uint64_t counter_) {
+		uint64_t z = counter_ * 0x9e3779b97f4a7c15ULL;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	}
+
+	/*!
+	 * Resolves handles of the matrices used by the layer.
+	 */
+	virtual void resolveHandles() {
+		Layer<eT>::resolveHandles();
+		hmask = Layer<eT>::resolveHandle(m, "dropout_mask");
+	}
+
 private:
 	// Friend class - required for using boost serialization.
 	template<typename tmp> friend class mic::mlnn::MultiLayerNeuralNetwork;
 
+	/*!
+	 * Serializes the parameters specific to the layer type (not stored by Layer::serialize).
+	 * @param ar Used archive.
+	 */
+	template<class Archive>
+	void serializeConfiguration(Archive & ar) {
+		ar & keep_ratio;
+		ar & seed;
+		ar & counter;
+	}
+
 	/*!
 	 * Private constructor, used only during the serialization.
 	 */
-	Dropout<eT>() : Layer<eT> () { }
+	Dropout<eT>() : Layer<eT> (), keep_ratio(1.0), seed(0x853c49e6748fea9bULL), counter(0) { }
 
 
 };
@@ -0,0 +1,91 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * @file: DropoutTests.cpp
+ * @Author: Tomasz Kornuta <tkornut@us.ibm.com>
+ * @Date:   Oct 16, 2026
+ *
+ * Copyright (c) 2017, Tomasz Kornuta, IBM Corporation. All rights reserved.
+ *
+ */
+
+#include "DropoutTests.hpp"
+
+
+/*!
+ * Tests forward pass in test mode - data should be passed as it is.
+ */
+TEST_F(Dropout4096x16Float, ForwardTest) {
+	mic::types::MatrixPtr<float> y = layer.forward(input_x, true);
+
+	for (size_t i=0; i< (size_t)y->size(); i++)
+		ASSERT_EQ((*y)[i], (*input_x)[i]) << "Difference at position i=" << i;
+}
+
+
+/*!
+ * Tests forward pass in training mode - elements should be either dropped or scaled by 1/keep_ratio, with the ratio of kept elements close to keep_ratio.
+ */
+TEST_F(Dropout4096x16Float, ForwardTraining) {
+	double eps = 1e-5;
+	mic::types::MatrixPtr<float> y = layer.forward(input_x);
+
+	size_t kept = 0;
+	for (size_t i=0; i< (size_t)y->size(); i++) {
+		if ((*y)[i] == 0.0f)
+			continue;
+		kept++;
+		ASSERT_LE( fabs((*y)[i] - (*input_x)[i] / 0.75), eps) << "Difference at position i=" << i;
+	}//: for
+
+	ASSERT_LE( fabs((double)kept / y->size() - 0.75), 0.01);
+}
+
+
+/*!
+ * Tests backward pass - the gradient should pass through exactly the elements kept in the forward pass, scaled by 1/keep_ratio.
+ */
+TEST_F(Dropout4096x16Float, Backward) {
+	double eps = 1e-5;
+	mic::types::MatrixPtr<float> y = layer.forward(input_x);
+	mic::types::MatrixPtr<float> dx = layer.backward(output_dy);
+
+	for (size_t i=0; i< (size_t)dx->size(); i++) {
+		float expected = ((*y)[i] == 0.0f) ? 0.0f : (*output_dy)[i] / 0.75f;
+		ASSERT_LE( fabs((*dx)[i] - expected), eps) << "Difference at position i=" << i;
+	}//: for
+}
+
+
+/*!
+ * Tests whether the masks differ between batches and can be reproduced by resetting the seed.
+ */
+TEST_F(Dropout4096x16Float, Masks) {
+	layer.setSeed(7);
+	mic::types::Matrix<float> y1 = *layer.forward(input_x);
+	mic::types::Matrix<float> y2 = *layer.forward(input_x);
+	layer.setSeed(7);
+	mic::types::Matrix<float> y3 = *layer.forward(input_x);
+
+	ASSERT_NE(y1, y2);
+	ASSERT_EQ(y1, y3);
+}
+
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
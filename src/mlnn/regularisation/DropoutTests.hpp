@@ -0,0 +1,68 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * @file: DropoutTests.hpp
+ * @Author: Tomasz Kornuta <tkornut@us.ibm.com>
+ * @Date:   Oct 16, 2026
+ *
+ * Copyright (c) 2017, Tomasz Kornuta, IBM Corporation. All rights reserved.
+ *
+ */
+
+#ifndef DROPOUTTESTS_HPP_
+#define DROPOUTTESTS_HPP_
+
+#include <gtest/gtest.h>
+
+// Redefine word "public" so every class field/method will be accessible for tests.
+#define private public
+#define protected public
+#include <mlnn/regularisation/Dropout.hpp>
+
+/*!
+ * \brief Test Fixture - 4096x16 dropout layer with keep ratio 0.75.
+ * \author tkornuta
+ */
+class Dropout4096x16Float : public ::testing::Test {
+public:
+	// Constructor. Sets layer size.
+	Dropout4096x16Float () : layer(4096, 0.75f) {
+		layer.resizeBatch(16);
+		input_x = MAKE_MATRIX_PTR(float, 4096, 16);
+		output_dy = MAKE_MATRIX_PTR(float, 4096, 16);
+	}
+
+protected:
+	// Sets test values.
+	virtual void SetUp() {
+		input_x->rand(1.0, 2.0);
+		output_dy->rand(-1.0, 1.0);
+	}
+
+private:
+	// Object to be tested.
+	mic::mlnn::regularisation::Dropout<float> layer;
+
+	// Test input x - used in forward pass.
+	mic::types::MatrixPtr<float> input_x;
+
+	// Test gradient dy - used in backward pass.
+	mic::types::MatrixPtr<float> output_dy;
+};
+
+
+
+#endif /* DROPOUTTESTS_HPP_ */
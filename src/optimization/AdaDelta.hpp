@@ -63,37 +63,78 @@ public:
 	 * @param learning_rate_ Learning rate (default=0.001). NOT USED!
 	 */
 	mic::types::MatrixPtr<eT> calculateUpdate(mic::types::MatrixPtr<eT> x_, mic::types::MatrixPtr<eT> dx_, eT learning_rate_) {
-		assert(x_->size() == dx_->size());
-		assert(x_->size() == EG->size());
-
-/*		for (size_t i=0; i<x_->size(); i++) {
-			std::cout << "(*x)["<< i <<"] = " << (*x_)[i] <<std::endl;
-		}
-		for (size_t i=0; i<x_->size(); i++) {
-			std::cout << "(*dx_)["<< i <<"] = " << (*dx_)[i] <<std::endl;
-		}*/
-
-		// Update decaying sum of squares of gradients - up to time t.
-		for (size_t i=0; i<(size_t)x_->size(); i++) {
-			(*EG)[i] = decay *(*EG)[i] + (1.0 - decay) * (*dx_)[i] * (*dx_)[i];
-//			std::cout << "(*EG)["<< i <<"] = " << (*EG)[i] <<std::endl;
-			assert(std::isfinite((*EG)[i]));
-		}
-
-		// Update decaying sum of squares of updates - up to time t-1.
-		for (size_t i=0; i<(size_t)x_->size(); i++)
-			(*ED)[i] = decay *(*ED)[i] + (1 - decay) * (*delta)[i] * (*delta)[i];
-
-		// Calculate updates - and store as previous (already) = - RMS(ED)/(RMS(G) * dx
-		for (size_t i=0; i<(size_t)x_->size(); i++){
-//			(*prev_d)[i] = (0.1 / std::sqrt((*EG)[i] + eps)) * (*dx_)[i];
-			(*delta)[i] = (std::sqrt((*ED)[i] + eps) / std::sqrt((*EG)[i] + eps)) * (*dx_)[i];
-//			std::cout << "(*prev_d)["<< i <<"] = " << (*prev_d)[i] <<std::endl;
-			assert(std::isfinite((*delta)[i]));
-		}
-
-		// Return the update.
-		return delta;
+		return OptimizationFunction<eT>::calculateFusedUpdate(x_, dx_, learning_rate_);
+	}
+
+	/*!
+	 * Performs the fused in-place AdaDelta update of the parameter elements from the [begin_, end_) range.
+	 * @param p_ Pointer to the data of the parameter.
+	 * @param dp_ Pointer to the data of the gradient of that parameter.
+	 * @param begin_ Index of the first updated element.
+	 * @param end_ Index following the last updated element.
+	 * @param learning_rate_ Learning rate.
+	 * @param decay_ Weight decay rate.
+	 */
+	void applyUpdate(eT* p_, const eT* dp_, size_t begin_, size_t end_, eT learning_rate_, eT decay_) {
+		assert(end_ <= (size_t)EG->size());
+		eT* EG_data = EG->data();
+		eT* ED_data = ED->data();
+		eT* delta_data = delta->data();
+		eT keep = 1.0f - decay_;
+
+#pragma omp simd
+		for (size_t i=begin_; i< end_; i++) {
+			eT dx = dp_[i];
+			// Update decaying sum of squares of gradients - up to time t.
+			eT EGi = decay * EG_data[i] + (1.0 - decay) * dx * dx;
+			// Update decaying sum of squares of updates - up to time t-1.
+			eT EDi = decay * ED_data[i] + (1.0 - decay) * delta_data[i] * delta_data[i];
+			// Calculate update = RMS(ED)/RMS(G) * dx - and store it as previous.
+			eT di = (std::sqrt(EDi + eps) / std::sqrt(EGi + eps)) * dx;
+			EG_data[i] = EGi;
+			ED_data[i] = EDi;
+			delta_data[i] = di;
+			p_[i] = keep * p_[i] - di;
+		}//: for
+	}
+
+	/*!
+	 * Returns true - disjoint ranges of the parameter can be updated concurrently.
+	 */
+	bool supportsRanges() {
+		return true;
+	}
+
+	/*!
+	 * Creates a copy of the optimization function with its own internal state.
+	 */
+	std::shared_ptr<OptimizationFunction<eT> > clone() {
+		std::shared_ptr<AdaDelta<eT> > copy = std::make_shared<AdaDelta<eT> >(*this);
+		copy->EG = MAKE_MATRIX_PTR(eT, *EG);
+		copy->ED = MAKE_MATRIX_PTR(eT, *ED);
+		copy->delta = MAKE_MATRIX_PTR(eT, *delta);
+		return copy;
+	}
+
+	/*!
+	 * Returns the type of the optimization function.
+	 */
+	OptimizationFunctionTypes type() {
+		return OptimizationFunctionTypes::AdaDelta;
+	}
+
+	/*!
+	 * Returns the matrices storing the internal state of the optimization function.
+	 */
+	std::vector<mic::types::MatrixPtr<eT> > stateMatrices() {
+		return {EG, ED, delta};
+	}
+
+	/*!
+	 * Returns pointers to the hyperparameters and the step-dependent scalars of the optimization function.
+	 */
+	std::vector<eT*> stateScalars() {
+		return {&decay, &eps};
 	}
 
 protected:
@@ -109,7 +150,7 @@ protected:
 	/// Decaying average of the squares of updates up to time t ("diagonal matrix") - E[delta Theta^2].
 	mic::types::MatrixPtr<eT> ED;
 
-	/// Calculated update.
+	/// Previous update.
 	mic::types::MatrixPtr<eT> delta;
 };
 
@@ -48,32 +48,78 @@ public:
 		G = MAKE_MATRIX_PTR(eT, rows_, cols_);
 		// Reset G.
 		G->zeros();
-
-		// Allocate and reset delta.
-		delta = MAKE_MATRIX_PTR(eT, rows_, cols_);
-		delta->zeros();
 	}
 
 	/*!
-	 * Performs update according to the AdaGrad update rule.
+	 * Calculates the update according to the AdaGrad update rule.
 	 * @param x_ Pointer to the current matrix.
 	 * @param dx_ Pointer to current gradient of that matrix.
 	 * @param learning_rate_ Learning rate (default=0.001).
 	 */
 	mic::types::MatrixPtr<eT> calculateUpdate(mic::types::MatrixPtr<eT> x_, mic::types::MatrixPtr<eT> dx_, eT learning_rate_) {
-		assert(x_->size() == dx_->size());
-		assert(x_->size() == G->size());
+		return OptimizationFunction<eT>::calculateFusedUpdate(x_, dx_, learning_rate_);
+	}
+
+	/*!
+	 * Performs the fused in-place AdaGrad update of the parameter elements from the [begin_, end_) range.
+	 * @param p_ Pointer to the data of the parameter.
+	 * @param dp_ Pointer to the data of the gradient of that parameter.
+	 * @param begin_ Index of the first updated element.
+	 * @param end_ Index following the last updated element.
+	 * @param learning_rate_ Learning rate.
+	 * @param decay_ Weight decay rate.
+	 */
+	void applyUpdate(eT* p_, const eT* dp_, size_t begin_, size_t end_, eT learning_rate_, eT decay_) {
+		assert(end_ <= (size_t)G->size());
+		eT* G_data = G->data();
+		eT keep = 1.0f - decay_;
+
+#pragma omp simd
+		for (size_t i=begin_; i< end_; i++) {
+			eT dx = dp_[i];
+			// Update G - add square of the gradients.
+			eT Gi = G_data[i] + dx * dx;
+			G_data[i] = Gi;
+			// x = x - alpha * dx / sqrt(G).
+			p_[i] = keep * p_[i] - learning_rate_ * dx / (std::sqrt(Gi + eps));
+		}//: for
+	}
+
+	/*!
+	 * Returns true - disjoint ranges of the parameter can be updated concurrently.
+	 */
+	bool supportsRanges() {
+		return true;
+	}
+
+	/*!
+	 * Creates a copy of the optimization function with its own internal state.
+	 */
+	std::shared_ptr<OptimizationFunction<eT> > clone() {
+		std::shared_ptr<AdaGrad<eT> > copy = std::make_shared<AdaGrad<eT> >(*this);
+		copy->G = MAKE_MATRIX_PTR(eT, *G);
+		return copy;
+	}
 
-		// Update G - add square of the gradients.
-		for (size_t i=0; i<(size_t)x_->size(); i++)
-				(*G)[i] += (*dx_)[i] * (*dx_)[i];
+	/*!
+	 * Returns the type of the optimization function.
+	 */
+	OptimizationFunctionTypes type() {
+		return OptimizationFunctionTypes::AdaGrad;
+	}
 
-		// delta = alpha * dW.
-		for (size_t i=0; i<(size_t)x_->size(); i++)
-			(*delta)[i] = learning_rate_ * (*dx_)[i] / (std::sqrt((*G)[i] + eps));
+	/*!
+	 * Returns the matrices storing the internal state of the optimization function.
+	 */
+	std::vector<mic::types::MatrixPtr<eT> > stateMatrices() {
+		return {G};
+	}
 
-		// Return the update.
-		return delta;
+	/*!
+	 * Returns pointers to the hyperparameters and the step-dependent scalars of the optimization function.
+	 */
+	std::vector<eT*> stateScalars() {
+		return {&eps};
 	}
 
 protected:
@@ -82,9 +128,6 @@ protected:
 
 	/// Sum of all of the squares of the gradients up to time t ("diagonal matrix").
 	mic::types::MatrixPtr<eT> G;
-
-	/// Calculated update.
-	mic::types::MatrixPtr<eT> delta;
 };
 
 } //: optimization
@@ -53,10 +53,6 @@ public:
 		v = MAKE_MATRIX_PTR(eT, rows_, cols_);
 		v->zeros();
 
-		// Allocate and reset delta.
-		delta = MAKE_MATRIX_PTR(eT, rows_, cols_);
-		delta->zeros();
-
 		beta1_powt = beta1;
 		beta2_powt = beta2;
 	}
@@ -68,27 +64,81 @@ public:
 	 * @param learning_rate_ Learning rate (default=0.001).
 	 */
 	mic::types::MatrixPtr<eT> calculateUpdate(mic::types::MatrixPtr<eT> x_, mic::types::MatrixPtr<eT> dx_, eT learning_rate_  = 0.001) {
-		assert(x_->size() == dx_->size());
-		assert(x_->size() == m->size());
-
-		// Update the decaying average of past gradients.
-		for (size_t i=0; i<(size_t)x_->size(); i++)
-			(*m)[i] = beta1 * (*m)[i] + (1-beta1) * (*dx_)[i];
-
-		// Update the decaying average of past squared gradients.
-		for (size_t i=0; i<(size_t)x_->size(); i++)
-			(*v)[i] = beta2 * (*v)[i] + (1-beta2) * (*dx_)[i] * (*dx_)[i];
+		return OptimizationFunction<eT>::calculateFusedUpdate(x_, dx_, learning_rate_);
+	}
 
-		// Calculate the update.
-		for (size_t i=0; i<(size_t)x_->size(); i++)
-			(*delta)[i] = learning_rate_ / (sqrt( (*v)[i] / (1 - beta2_powt)) + eps) * (*m)[i] / (1 - beta1_powt);
+	/*!
+	 * Performs the fused in-place ADAM update of the parameter elements from the [begin_, end_) range.
+	 * @param p_ Pointer to the data of the parameter.
+	 * @param dp_ Pointer to the data of the gradient of that parameter.
+	 * @param begin_ Index of the first updated element.
+	 * @param end_ Index following the last updated element.
+	 * @param learning_rate_ Learning rate.
+	 * @param decay_ Weight decay rate.
+	 */
+	void applyUpdate(eT* p_, const eT* dp_, size_t begin_, size_t end_, eT learning_rate_, eT decay_) {
+		assert(end_ <= (size_t)m->size());
+		eT* m_data = m->data();
+		eT* v_data = v->data();
+		eT keep = 1.0f - decay_;
+
+#pragma omp simd
+		for (size_t i=begin_; i< end_; i++) {
+			eT dx = dp_[i];
+			// Update the decaying averages of past gradients and past squared gradients.
+			eT mi = beta1 * m_data[i] + (1-beta1) * dx;
+			eT vi = beta2 * v_data[i] + (1-beta2) * dx * dx;
+			m_data[i] = mi;
+			v_data[i] = vi;
+			// Apply the update.
+			p_[i] = keep * p_[i] - learning_rate_ / (std::sqrt( vi / (1 - beta2_powt)) + eps) * mi / (1 - beta1_powt);
+		}//: for
+	}
 
-		// Update "powered" factors.
+	/*!
+	 * Updates "powered" factors.
+	 */
+	void nextStep() {
 		beta1_powt *= beta1;
 		beta2_powt *= beta2;
+	}
 
-		// Return the update.
-		return delta;
+	/*!
+	 * Returns true - disjoint ranges of the parameter can be updated concurrently.
+	 */
+	bool supportsRanges() {
+		return true;
+	}
+
+	/*!
+	 * Creates a copy of the optimization function with its own internal state.
+	 */
+	std::shared_ptr<OptimizationFunction<eT> > clone() {
+		std::shared_ptr<Adam<eT> > copy = std::make_shared<Adam<eT> >(*this);
+		copy->m = MAKE_MATRIX_PTR(eT, *m);
+		copy->v = MAKE_MATRIX_PTR(eT, *v);
+		return copy;
+	}
+
+	/*!
+	 * Returns the type of the optimization function.
+	 */
+	OptimizationFunctionTypes type() {
+		return OptimizationFunctionTypes::Adam;
+	}
+
+	/*!
+	 * Returns the matrices storing the internal state of the optimization function.
+	 */
+	std::vector<mic::types::MatrixPtr<eT> > stateMatrices() {
+		return {m, v};
+	}
+
+	/*!
+	 * Returns pointers to the hyperparameters and the step-dependent scalars of the optimization function.
+	 */
+	std::vector<eT*> stateScalars() {
+		return {&beta1, &beta2, &eps, &beta1_powt, &beta2_powt};
 	}
 
 protected:
@@ -98,9 +148,6 @@ protected:
 	/// Exponentially decaying average of past squared gradients.
 	mic::types::MatrixPtr<eT> v;
 
-	/// Calculated update.
-	mic::types::MatrixPtr<eT> delta;
-
 	/// Decay rate 1 (momentum for past gradients).
 	eT beta1;
 
@@ -56,10 +56,6 @@ public:
 		dx_prev = MAKE_MATRIX_PTR(eT, rows_, cols_);
 		dx_prev->zeros();
 
-		// Allocate and reset delta.
-		delta = MAKE_MATRIX_PTR(eT, rows_, cols_);
-		delta->zeros();
-
 		beta1_powt = beta1;
 		beta2_powt = beta2;
 	}
@@ -71,46 +67,88 @@ public:
 	 * @param learning_rate_ Learning rate (default=0.001).
 	 */
 	mic::types::MatrixPtr<eT> calculateUpdate(mic::types::MatrixPtr<eT> x_, mic::types::MatrixPtr<eT> dx_, eT learning_rate_) {
-		assert(x_->size() == dx_->size());
-		assert(x_->size() == Edx->size());
-
-		// Update decaying sum of gradients - up to time t. INTEGRAL.
-		for (size_t i=0; i< (size_t)Edx->size(); i++) {
-			(*Edx)[i] = beta1 *(*Edx)[i] + (1.0 - beta1) * (*dx_)[i];
-			assert(std::isfinite((*Edx)[i]));
-		}
-
-		// Update decaying sum of squared gradients - up to time t. NORMALIZER.
-		for (size_t i=0; i< (size_t)Edx2->size(); i++) {
-			(*Edx2)[i] = beta2 *(*Edx2)[i] + (1.0 - beta2) * (*dx_)[i] * (*dx_)[i];
-			assert(std::isfinite((*Edx2)[i]));
-		}
-
-		// Calculate update.
-//		std::cout <<"Delta = ";
-		for(size_t i=0; i< (size_t)delta->size(); i++) {
+		return OptimizationFunction<eT>::calculateFusedUpdate(x_, dx_, learning_rate_);
+	}
+
+	/*!
+	 * Performs the fused in-place AdamID update of the parameter elements from the [begin_, end_) range.
+	 * @param p_ Pointer to the data of the parameter.
+	 * @param dp_ Pointer to the data of the gradient of that parameter.
+	 * @param begin_ Index of the first updated element.
+	 * @param end_ Index following the last updated element.
+	 * @param learning_rate_ Learning rate.
+	 * @param decay_ Weight decay rate.
+	 */
+	void applyUpdate(eT* p_, const eT* dp_, size_t begin_, size_t end_, eT learning_rate_, eT decay_) {
+		assert(end_ <= (size_t)Edx->size());
+		eT* Edx_data = Edx->data();
+		eT* Edx2_data = Edx2->data();
+		eT* dx_prev_data = dx_prev->data();
+		eT keep = 1.0f - decay_;
+
+#pragma omp simd
+		for (size_t i=begin_; i< end_; i++) {
+			eT dx = dp_[i];
+			// Update decaying sum of gradients - up to time t. INTEGRAL.
+			eT Edxi = beta1 * Edx_data[i] + (1.0 - beta1) * dx;
+			// Update decaying sum of squared gradients - up to time t. NORMALIZER.
+			eT Edx2i = beta2 * Edx2_data[i] + (1.0 - beta2) * dx * dx;
 			// update = integral + small derivative correction.
 			// i.e. lr * I + lr^2 * D.
-			eT delta_ID =  learning_rate_ * (*Edx)[i] + learning_rate_*learning_rate_ * ((*dx_)[i] - (*dx_prev)[i]);
-			(*delta)[i] = 1.0 / (sqrt( (*Edx2)[i] / (1 - beta2_powt)) + eps) * ( delta_ID  ) / (1 - beta1_powt);
-//			std::cout<< (*delta)[i] << " | ";
-			assert(std::isfinite((*delta)[i]));
-		}
-//		std::cout << std::endl;
-
-		// Store past gradients.
-		for (size_t i=0; i< (size_t)dx_->size(); i++) {
-			(*dx_prev)[i] = (*dx_)[i];
-		}
-
-//		std::cout << std::endl;
+			eT delta_ID =  learning_rate_ * Edxi + learning_rate_*learning_rate_ * (dx - dx_prev_data[i]);
+			Edx_data[i] = Edxi;
+			Edx2_data[i] = Edx2i;
+			// Store past gradient.
+			dx_prev_data[i] = dx;
+			p_[i] = keep * p_[i] - 1.0 / (std::sqrt( Edx2i / (1 - beta2_powt)) + eps) * ( delta_ID  ) / (1 - beta1_powt);
+		}//: for
+	}
 
-		// Update "powered" factors.
+	/*!
+	 * Updates "powered" factors.
+	 */
+	void nextStep() {
 		beta1_powt *= beta1;
 		beta2_powt *= beta2;
+	}
+
+	/*!
+	 * Returns true - disjoint ranges of the parameter can be updated concurrently.
+	 */
+	bool supportsRanges() {
+		return true;
+	}
 
-		// Return the update.
-		return delta;
+	/*!
+	 * Creates a copy of the optimization function with its own internal state.
+	 */
+	std::shared_ptr<OptimizationFunction<eT> > clone() {
+		std::shared_ptr<AdamID<eT> > copy = std::make_shared<AdamID<eT> >(*this);
+		copy->Edx = MAKE_MATRIX_PTR(eT, *Edx);
+		copy->Edx2 = MAKE_MATRIX_PTR(eT, *Edx2);
+		copy->dx_prev = MAKE_MATRIX_PTR(eT, *dx_prev);
+		return copy;
+	}
+
+	/*!
+	 * Returns the type of the optimization function.
+	 */
+	OptimizationFunctionTypes type() {
+		return OptimizationFunctionTypes::AdamID;
+	}
+
+	/*!
+	 * Returns the matrices storing the internal state of the optimization function.
+	 */
+	std::vector<mic::types::MatrixPtr<eT> > stateMatrices() {
+		return {Edx, Edx2, dx_prev};
+	}
+
+	/*!
+	 * Returns pointers to the hyperparameters and the step-dependent scalars of the optimization function.
+	 */
+	std::vector<eT*> stateScalars() {
+		return {&beta1, &beta2, &eps, &beta1_powt, &beta2_powt};
 	}
 
 protected:
@@ -137,9 +175,6 @@ protected:
 
 	/// Previous value of gradients.
 	mic::types::MatrixPtr<eT> dx_prev;
-
-	/// Calculated update.
-	mic::types::MatrixPtr<eT> delta;
 };
 
 
@@ -86,6 +86,13 @@ public:
 	}
 
 
+	/*!
+	 * Returns the type of the optimization function.
+	 */
+	mic::neural_nets::optimization::OptimizationFunctionTypes type() {
+		return mic::neural_nets::optimization::OptimizationFunctionTypes::BinaryCorrelatorLearningRule;
+	}
+
 protected:
 	/// Calculated update.
 	mic::types::MatrixPtr<eT> delta;
@@ -53,18 +53,6 @@ public:
 		dx_prev = MAKE_MATRIX_PTR(eT, rows_,  cols_);
 		dx_prev->zeros();
 
-		deltaP = MAKE_MATRIX_PTR(eT, rows_,  cols_);
-		deltaP->zeros();
-
-		deltaI = MAKE_MATRIX_PTR(eT, rows_,  cols_);
-		deltaI->zeros();
-
-		deltaD = MAKE_MATRIX_PTR(eT, rows_,  cols_);
-		deltaD->zeros();
-
-		delta = MAKE_MATRIX_PTR(eT, rows_,  cols_);
-		delta->zeros();
-
 	}
 
 	/*!
@@ -74,63 +62,79 @@ public:
 	 * @param learning_rate_ Learning rate (default=0.001).
 	 */
 	mic::types::MatrixPtr<eT> calculateUpdate(mic::types::MatrixPtr<eT> x_, mic::types::MatrixPtr<eT> dx_, eT learning_rate_ = 0.001) {
-		assert(x_->size() == dx_->size());
-		assert(x_->size() == Edx->size());
+		return OptimizationFunction<eT>::calculateFusedUpdate(x_, dx_, learning_rate_);
+	}
 
-		// Initialize ratios and variables.
-		p_rate = learning_rate_ * learning_rate_ * learning_rate_ * learning_rate_ ;
-		i_rate = learning_rate_;
-		d_rate = learning_rate_ * learning_rate_ * learning_rate_ ;
-
-		// Update decaying sum of gradients - up to time t.
-		for (size_t i=0; i< (size_t)Edx->size(); i++) {
-			(*Edx)[i] = decay *(*Edx)[i] + (1.0 - decay) * (*dx_)[i];
-			assert(std::isfinite((*Edx)[i]));
-		}
-
-		// DEBUG
-/*		for(size_t i=0; i< delta->size(); i++){
-			std::cout<< "(*x_)[" << i << "]=" << (*x_)[i] << std::endl;
-		}
-		for(size_t i=0; i< delta->size(); i++){
-			std::cout<< "(*dx_)[" << i << "]=" << (*dx_)[i] << std::endl;
-		}*/
-
-		// Calculate gradients updates.
-		// Proportional.
-		for(size_t i=0; i< (size_t)delta->size(); i++){
-			(*deltaP)[i] = p_rate * (*dx_)[i];
-//			std::cout<< "(*deltaP)[" << i << "]=" << (*deltaP)[i] << std::endl;
-		}
-
-		// Integral.
-		for(size_t i=0; i< (size_t)delta->size(); i++){
-			(*deltaI)[i] = i_rate * (*Edx)[i];
-//			std::cout<< "(*deltaI)[" << i << "]=" << (*deltaI)[i] << std::endl;
-		}
-
-		// Derivative.
-		for(size_t i=0; i< (size_t)delta->size(); i++){
-			(*deltaD)[i] = d_rate * ((*dx_)[i] - (*dx_prev)[i]);
-//			std::cout<< "(*deltaD)[" << i << "]=" << (*deltaD)[i] << std::endl;
-		}
-
-		// Calculate the update.
-		for(size_t i=0; i< (size_t)delta->size(); i++) {
-			(*delta)[i] = (*deltaP)[i] + (*deltaI)[i] + (*deltaD)[i];
-//			std::cout<< "(*delta)[" << i << "]=" << (*delta)[i] << std::endl;
-			assert(std::isfinite((*delta)[i]));
-		}
-
-		// Store past gradients.
-		for (size_t i=0; i< (size_t)dx_->size(); i++) {
-			(*dx_prev)[i] = (*dx_)[i];
-		}
-
-//		std::cout << std::endl;
-
-		// Return the update.
-		return delta;
+	/*!
+	 * Performs the fused in-place GradPID update of the parameter elements from the [begin_, end_) range.
+	 * @param p_ Pointer to the data of the parameter.
+	 * @param dp_ Pointer to the data of the gradient of that parameter.
+	 * @param begin_ Index of the first updated element.
+	 * @param end_ Index following the last updated element.
+	 * @param learning_rate_ Learning rate.
+	 * @param decay_ Weight decay rate.
+	 */
+	void applyUpdate(eT* p_, const eT* dp_, size_t begin_, size_t end_, eT learning_rate_, eT decay_) {
+		assert(end_ <= (size_t)Edx->size());
+		eT* Edx_data = Edx->data();
+		eT* dx_prev_data = dx_prev->data();
+		eT keep = 1.0f - decay_;
+
+		// Initialize ratios.
+		eT p_rate = learning_rate_ * learning_rate_ * learning_rate_ * learning_rate_ ;
+		eT i_rate = learning_rate_;
+		eT d_rate = learning_rate_ * learning_rate_ * learning_rate_ ;
+
+#pragma omp simd
+		for (size_t i=begin_; i< end_; i++) {
+			eT dx = dp_[i];
+			// Update decaying sum of gradients - up to time t.
+			eT Edxi = decay * Edx_data[i] + (1.0 - decay) * dx;
+			// Update = proportional + integral + derivative.
+			eT delta = p_rate * dx + i_rate * Edxi + d_rate * (dx - dx_prev_data[i]);
+			Edx_data[i] = Edxi;
+			// Store past gradient.
+			dx_prev_data[i] = dx;
+			p_[i] = keep * p_[i] - delta;
+		}//: for
+	}
+
+	/*!
+	 * Returns true - disjoint ranges of the parameter can be updated concurrently.
+	 */
+	bool supportsRanges() {
+		return true;
+	}
+
+	/*!
+	 * Creates a copy of the optimization function with its own internal state.
+	 */
+	std::shared_ptr<OptimizationFunction<eT> > clone() {
+		std::shared_ptr<GradPID<eT> > copy = std::make_shared<GradPID<eT> >(*this);
+		copy->Edx = MAKE_MATRIX_PTR(eT, *Edx);
+		copy->dx_prev = MAKE_MATRIX_PTR(eT, *dx_prev);
+		return copy;
+	}
+
+	/*!
+	 * Returns the type of the optimization function.
+	 */
+	OptimizationFunctionTypes type() {
+		return OptimizationFunctionTypes::GradPID;
+	}
+
+	/*!
+	 * Returns the matrices storing the internal state of the optimization function.
+	 */
+	std::vector<mic::types::MatrixPtr<eT> > stateMatrices() {
+		return {Edx, dx_prev};
+	}
+
+	/*!
+	 * Returns pointers to the hyperparameters and the step-dependent scalars of the optimization function.
+	 */
+	std::vector<eT*> stateScalars() {
+		return {&decay, &eps};
 	}
 
 protected:
@@ -141,32 +145,11 @@ protected:
 	/// Smoothing term that avoids division by zero.
 	eT eps;
 
-	/// Adaptive proportional factor (learning rate).
-	eT p_rate;
-
-	/// Adaptive integral factor (learning rate).
-	eT i_rate;
-
-	/// Adaptive proportional factor (learning rate).
-	eT d_rate;
-
 	/// Decaying average of gradients up to time t - E[g].
 	mic::types::MatrixPtr<eT> Edx;
 
 	/// Previous value of gradients.
 	mic::types::MatrixPtr<eT> dx_prev;
-
-	/// Proportional update.
-	mic::types::MatrixPtr<eT> deltaP;
-
-	/// Integral update.
-	mic::types::MatrixPtr<eT> deltaI;
-
-	/// Derivative update.
-	mic::types::MatrixPtr<eT> deltaD;
-
-	/// Calculated update.
-	mic::types::MatrixPtr<eT> delta;
 };
 
 
@@ -225,111 +208,80 @@ public:
 	 * @param learning_rate_ Learning rate (default=0.001).
 	 */
 	mic::types::MatrixPtr<eT> calculateUpdate(mic::types::MatrixPtr<eT> x_, mic::types::MatrixPtr<eT> dx_, eT learning_rate_ = 0.001) {
-		assert(x_->size() == dx_->size());
-		assert(x_->size() == Edx->size());
-
-		// Update decaying sum of gradients - up to time t.
-/*		for (size_t i=0; i<Edx->size(); i++) {
-			(*Edx)[i] = decay *(*Edx)[i] + (1.0 - decay) * (*dx_)[i];
-			assert(std::isfinite((*Edx)[i]));
-		}*/
-
-		// DEBUG
-/*		std::cout << "surprisal = " << surprisal << std::endl;
-		std::cout << "p_rate = " << p_rate << std::endl;
-		std::cout << "i_rate = " << i_rate << std::endl;
-		std::cout << "d_rate = " << d_rate << std::endl;*/
-/*		std::cout<< " x: ";
-		for(size_t i=0; i< delta->size(); i++)
-			std::cout<< (*x_)[i] << " | ";
-		std::cout << std::endl;
-
-		std::cout<< " dx: ";
-		for(size_t i=0; i< delta->size(); i++)
-			std::cout<<  (*dx_)[i] << " | ";
-		std::cout << std::endl << std::endl;*/
-
-		// Calculate gradients updates.
-		// Proportional.
-//		std::cout<< " deltaP: ";
-		for(size_t i=0; i< (size_t)delta->size(); i++){
-			// Calculate surprisal.
-//			double surp_p = logistic(calculateSigmoidSurprisalMod((*deltaP)[i], (*dx_)[i]), 1.0);
-//			(*deltaP)[i] = (1-surp_p) * (*deltaP)[i] + (*p_rate)[i] * surp_p * (*dx_)[i];
-//			std::cout<< (*deltaP)[i] << " | ";
-		}
-//		std::cout << std::endl ;
-
-		// Integral.
-//		std::cout<< " deltaI: ";
-		for(size_t i=0; i< (size_t)delta->size(); i++){
-//			double surp_i = logistic(calculateSigmoidSurprisalMod((*deltaI)[i], (decay *(*deltaI)[i] + (1.0 - decay) * (*dx_)[i])), 1.0);
-//			(*deltaI)[i] = (1-surp_i) * (*deltaI)[i] + (*i_rate)[i] * surp_i * (decay *(*deltaI)[i] + (1.0 - decay) * (*dx_)[i]);
-//			std::cout<< (*deltaI)[i] << " | ";
-		}
-//		std::cout << std::endl ;
-
-		// Derivative.
-//		std::cout<< " deltaD: ";
-		for(size_t i=0; i< (size_t)delta->size(); i++){
-//			double surp_d = logistic(calculateSigmoidSurprisalMod((*deltaD)[i], ((*dx_)[i] - (*dx_prev)[i])), 1.0);
-//			(*deltaD)[i] = (1-surp_d) * (*deltaD)[i] + (*d_rate)[i] * surp_d * ((*dx_)[i] - (*dx_prev)[i]);
-//			std::cout<< (*deltaD)[i] << " | ";
-		}
-//		std::cout << std::endl ;
-
-		// Adaptive rate update.
-/*		// Update P ratio.
-		eT up;
-		std::cout<< " p_rate: ";
-		for (size_t i=0; i<delta->size(); i++){
-//			up = std::abs((*deltaP)[i] / ((*dx_)[i] + eps)); // softsign
-//			std::cout << "up = " << up << std::endl;
-//			std::cout << "tanh(up) = " << tanh(up) << std::endl;
-			//decay * (*p_rate)[i] + (1 - decay) * tanh(up);//(logistic<eT>(up ,5) / 5);
-			std::cout << (*p_rate)[i] << " | ";
-		}
-		std::cout << std::endl;
-
-		// Update I ratio.
-		eT ui;
-		std::cout<< " i_rate: ";
-		for (size_t i=0; i<delta->size(); i++){
-//			ui = std::abs((*deltaI)[i] / ((*dx_)[i] + eps)); // softsign
-//			(*i_rate)[i] = decay * (*i_rate)[i] + (1 - decay) * calculateSigmoidSurprisal((*i_rate)[i], ui);
-			//decay * (*i_rate)[i] + (1 - decay) * tanh(ui);//(logistic<eT>(ui ,5) / 5);
-			std::cout << (*i_rate)[i] << " | ";
-		}
-		std::cout << std::endl ;
-
-		// Update D ratio.
-		eT ud;
-/		std::cout<< " d_rate: ";
-		for (size_t i=0; i<delta->size(); i++){
-//			ud = std::abs((*deltaD)[i] / ((*dx_)[i] + eps)); // softsign
-//			(*d_rate)[i] = decay * (*d_rate)[i] + (1 - decay) * calculateSigmoidSurprisal((*d_rate)[i], ud);
-			//decay * (*d_rate)[i] + (1 - decay) * tanh(ud);//(logistic<eT>(ud, 5) / 5);
-			std::cout << (*d_rate)[i] << " | ";
-		}
-		std::cout << std::endl ;*/
-
-		// Calculate update.
-//		std::cout<< " delta: ";
-		for(size_t i=0; i< (size_t)delta->size(); i++) {
-			(*delta)[i] = (*deltaP)[i] + (*deltaI)[i] + (*deltaD)[i];
-	//		std::cout<< (*delta)[i] << " | ";
-			assert(std::isfinite((*delta)[i]));
-		}
-	//	std::cout << std::endl << std::endl;
-
-		// Store past gradiens.
-		for (size_t i=0; i< (size_t)dx_->size(); i++) {
-			(*dx_prev)[i] = (*dx_)[i];
-		}
-
-		// Return the update.
-		return delta;
-//		std::cout << "-------------------" <<  std::endl;
+		return OptimizationFunction<eT>::calculateFusedUpdate(x_, dx_, learning_rate_);
+	}
+
+	/*!
+	 * Performs the fused in-place AdaGradPID update of the parameter elements from the [begin_, end_) range.
+	 * @param p_ Pointer to the data of the parameter.
+	 * @param dp_ Pointer to the data of the gradient of that parameter.
+	 * @param begin_ Index of the first updated element.
+	 * @param end_ Index following the last updated element.
+	 * @param learning_rate_ Learning rate.
+	 * @param decay_ Weight decay rate.
+	 */
+	void applyUpdate(eT* p_, const eT* dp_, size_t begin_, size_t end_, eT learning_rate_, eT decay_) {
+		assert(end_ <= (size_t)delta->size());
+		const eT* deltaP_data = deltaP->data();
+		const eT* deltaI_data = deltaI->data();
+		const eT* deltaD_data = deltaD->data();
+		eT* delta_data = delta->data();
+		eT* dx_prev_data = dx_prev->data();
+		eT keep = 1.0f - decay_;
+
+		for (size_t i=begin_; i< end_; i++) {
+			// Update = proportional + integral + derivative.
+			delta_data[i] = deltaP_data[i] + deltaI_data[i] + deltaD_data[i];
+			assert(std::isfinite(delta_data[i]));
+			// Store past gradient.
+			dx_prev_data[i] = dp_[i];
+			p_[i] = keep * p_[i] - delta_data[i];
+		}//: for
+	}
+
+	/*!
+	 * Returns true - disjoint ranges of the parameter can be updated concurrently.
+	 */
+	bool supportsRanges() {
+		return true;
+	}
+
+	/*!
+	 * Creates a copy of the optimization function with its own internal state.
+	 */
+	std::shared_ptr<OptimizationFunction<eT> > clone() {
+		std::shared_ptr<AdaGradPID<eT> > copy = std::make_shared<AdaGradPID<eT> >(*this);
+		copy->p_rate = MAKE_MATRIX_PTR(eT, *p_rate);
+		copy->i_rate = MAKE_MATRIX_PTR(eT, *i_rate);
+		copy->d_rate = MAKE_MATRIX_PTR(eT, *d_rate);
+		copy->Edx = MAKE_MATRIX_PTR(eT, *Edx);
+		copy->dx_prev = MAKE_MATRIX_PTR(eT, *dx_prev);
+		copy->deltaP = MAKE_MATRIX_PTR(eT, *deltaP);
+		copy->deltaI = MAKE_MATRIX_PTR(eT, *deltaI);
+		copy->deltaD = MAKE_MATRIX_PTR(eT, *deltaD);
+		copy->delta = MAKE_MATRIX_PTR(eT, *delta);
+		return copy;
+	}
+
+	/*!
+	 * Returns the type of the optimization function.
+	 */
+	OptimizationFunctionTypes type() {
+		return OptimizationFunctionTypes::AdaGradPID;
+	}
+
+	/*!
+	 * Returns the matrices storing the internal state of the optimization function.
+	 */
+	std::vector<mic::types::MatrixPtr<eT> > stateMatrices() {
+		return {p_rate, i_rate, d_rate, Edx, dx_prev};
+	}
+
+	/*!
+	 * Returns pointers to the hyperparameters and the step-dependent scalars of the optimization function.
+	 */
+	std::vector<eT*> stateScalars() {
+		return {&decay, &eps};
 	}
 
 protected:		// Initialize ratios and variables.
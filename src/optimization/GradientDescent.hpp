@@ -44,11 +44,7 @@ public:
 	 * @param rows_ Number of rows of the updated matrix/its gradient.
 	 * @param cols_ Number of columns of the updated matrix/its gradient.
 	 */
-	GradientDescent(size_t rows_, size_t cols_) {
-		// Allocate and reset delta.
-		delta = MAKE_MATRIX_PTR(eT, rows_, cols_);
-		delta->zeros();
-	}
+	GradientDescent(size_t rows_, size_t cols_) { }
 
 	/*!
 	 * Calculates the update in the direction of gradient descent.
@@ -57,19 +53,47 @@ public:
 	 * @param learning_rate_ Learning rate (default=0.001).
 	 */
 	mic::types::MatrixPtr<eT> calculateUpdate(mic::types::MatrixPtr<eT> x_, mic::types::MatrixPtr<eT> dx_, eT learning_rate_ = 0.001) {
-		assert(x_->size() == dx_->size());
-		// daltea = - alpha * dW.
-		//for (size_t i=0; i<(size_t)x_->size(); i++)
-			(*delta) = learning_rate_ * (*dx_);
+		return OptimizationFunction<eT>::calculateFusedUpdate(x_, dx_, learning_rate_);
+	}
+
+	/*!
+	 * Performs the fused in-place gradient descent update of the parameter elements from the [begin_, end_) range.
+	 * @param p_ Pointer to the data of the parameter.
+	 * @param dp_ Pointer to the data of the gradient of that parameter.
+	 * @param begin_ Index of the first updated element.
+	 * @param end_ Index following the last updated element.
+	 * @param learning_rate_ Learning rate.
+	 * @param decay_ Weight decay rate.
+	 */
+	void applyUpdate(eT* p_, const eT* dp_, size_t begin_, size_t end_, eT learning_rate_, eT decay_) {
+		eT keep = 1.0f - decay_;
 
-		// Return the update.
-		return delta;
+		// x = (1 - decay) * x - alpha * dx.
+#pragma omp simd
+		for (size_t i=begin_; i< end_; i++)
+			p_[i] = keep * p_[i] - learning_rate_ * dp_[i];
 	}
 
-private:
-	/// Calculated update.
-	mic::types::MatrixPtr<eT> delta;
+	/*!
+	 * Returns true - disjoint ranges of the parameter can be updated concurrently.
+	 */
+	bool supportsRanges() {
+		return true;
+	}
 
+	/*!
+	 * Creates a copy of the optimization function with its own internal state.
+	 */
+	std::shared_ptr<OptimizationFunction<eT> > clone() {
+		return std::make_shared<GradientDescent<eT> >(*this);
+	}
+
+	/*!
+	 * Returns the type of the optimization function.
+	 */
+	OptimizationFunctionTypes type() {
+		return OptimizationFunctionTypes::GradientDescent;
+	}
 };
 
 } //: optimization
@@ -70,6 +70,13 @@ public:
 	}
 
 
+	/*!
+	 * Returns the type of the optimization function.
+	 */
+	mic::neural_nets::optimization::OptimizationFunctionTypes type() {
+		return mic::neural_nets::optimization::OptimizationFunctionTypes::HebbianRule;
+	}
+
 protected:
 	/// Calculated update.
 	mic::types::MatrixPtr<eT> delta;
@@ -54,18 +54,70 @@ public:
 	 * Calculates the update according to the Momentum update rule.
 	 * @param x_ Pointer to the current matrix.
 	 * @param dx_ Pointer to current gradient of that matrix.
-	 * @param learning_rate_ Learning rate (default=0.001). NOT USED!
+	 * @param learning_rate_ Learning rate (default=0.001).
 	 */
 	mic::types::MatrixPtr<eT> calculateUpdate(mic::types::MatrixPtr<eT> x_, mic::types::MatrixPtr<eT> dx_, eT learning_rate_ = 0.001) {
-		assert(x_->size() == dx_->size());
-		assert(x_->size() == v->size());
+		return OptimizationFunction<eT>::calculateFusedUpdate(x_, dx_, learning_rate_);
+	}
+
+	/*!
+	 * Performs the fused in-place Momentum update of the parameter elements from the [begin_, end_) range.
+	 * @param p_ Pointer to the data of the parameter.
+	 * @param dp_ Pointer to the data of the gradient of that parameter.
+	 * @param begin_ Index of the first updated element.
+	 * @param end_ Index following the last updated element.
+	 * @param learning_rate_ Learning rate.
+	 * @param decay_ Weight decay rate.
+	 */
+	void applyUpdate(eT* p_, const eT* dp_, size_t begin_, size_t end_, eT learning_rate_, eT decay_) {
+		assert(end_ <= (size_t)v->size());
+		eT* v_data = v->data();
+		eT keep = 1.0f - decay_;
+
+#pragma omp simd
+		for (size_t i=begin_; i< end_; i++) {
+			// Update the update vector (delta).
+			eT vi = momentum * v_data[i] + learning_rate_ * dp_[i];
+			v_data[i] = vi;
+			p_[i] = keep * p_[i] - vi;
+		}//: for
+	}
 
-		// Calculate the update vector (delta).
-		for (size_t i=0; i<(size_t)x_->size(); i++)
-			(*v)[i] = momentum * (*v)[i] + learning_rate_ * (*dx_)[i];
+	/*!
+	 * Returns true - disjoint ranges of the parameter can be updated concurrently.
+	 */
+	bool supportsRanges() {
+		return true;
+	}
 
-		// Return the update.
-		return v;
+	/*!
+	 * Creates a copy of the optimization function with its own internal state.
+	 */
+	std::shared_ptr<OptimizationFunction<eT> > clone() {
+		std::shared_ptr<Momentum<eT> > copy = std::make_shared<Momentum<eT> >(*this);
+		copy->v = MAKE_MATRIX_PTR(eT, *v);
+		return copy;
+	}
+
+	/*!
+	 * Returns the type of the optimization function.
+	 */
+	OptimizationFunctionTypes type() {
+		return OptimizationFunctionTypes::Momentum;
+	}
+
+	/*!
+	 * Returns the matrices storing the internal state of the optimization function.
+	 */
+	std::vector<mic::types::MatrixPtr<eT> > stateMatrices() {
+		return {v};
+	}
+
+	/*!
+	 * Returns pointers to the hyperparameters and the step-dependent scalars of the optimization function.
+	 */
+	std::vector<eT*> stateScalars() {
+		return {&momentum};
 	}
 
 protected:
@@ -73,15 +73,10 @@ public:
 		// Calculate the update using hebbian "fire together, wire together".
 		mic::types::MatrixPtr<eT> delta = calculateUpdate(x_, y_, learning_rate_);
 
-		std::cout<<"x: " << (*x_).transpose() << std::endl;
-		std::cout<<"y: " << (*y_).transpose() << std::endl;
-		std::cout<<"przed update: " << (*p_)[0] << std::endl;
 		// weight += delta;
 		(*p_) += (*delta);
-		std::cout<<"przed normalizacją: " << (*p_)[0] << std::endl;
 		// Normalize.
 		(*p_) /= p_->squaredNorm();
-		std::cout<<"po normalizacji: " << (*p_)[0] << std::endl;
 	}
 
 	/*!
@@ -100,6 +95,13 @@ public:
 	}
 
 
+	/*!
+	 * Returns the type of the optimization function.
+	 */
+	mic::neural_nets::optimization::OptimizationFunctionTypes type() {
+		return mic::neural_nets::optimization::OptimizationFunctionTypes::NormalizedHebbianRule;
+	}
+
 protected:
 	/// Calculated update.
 	mic::types::MatrixPtr<eT> delta;
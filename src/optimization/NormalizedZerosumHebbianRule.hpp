@@ -119,6 +119,13 @@ public:
     }
 
 
+    /*!
+     * Returns the type of the optimization function.
+     */
+    mic::neural_nets::optimization::OptimizationFunctionTypes type() {
+        return mic::neural_nets::optimization::OptimizationFunctionTypes::NormalizedZerosumHebbianRule;
+    }
+
 protected:
     /// Calculated update.
     mic::types::MatrixPtr<eT> delta;
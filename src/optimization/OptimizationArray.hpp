@@ -27,8 +27,15 @@
 
 #include <string>
 #include <map>
+#include <vector>
+#include <stdexcept>
 #include <stdio.h>
 
+#include <optimization/OptimizationFunctionTypes.hpp>
+
+#include <boost/serialization/map.hpp>
+#include <boost/serialization/split_member.hpp>
+
 
 // Forward declaration of class boost::serialization::access
 namespace boost {
@@ -147,7 +154,7 @@ public:
 	/*!
 	 * Returns the size of array.
 	 */
-	std::string size() {
+	size_t size() {
 		return functions.size();
 	}
 
@@ -163,6 +170,75 @@ private:
 	// Friend class - required for using boost serialization.
     friend class boost::serialization::access;
 
+    /*!
+     * Serialization save - saves the types and the internal state of the optimization functions.
+     * @param ar Used archive.
+     * @param version Version of the array (not used currently).
+     */
+    template<class Archive>
+    void save(Archive & ar, const unsigned int version) const {
+        ar & keys_map;
+        size_t size = functions.size();
+        ar & size;
+        for (size_t i = 0; i < size; i++) {
+            OptimizationFunctionTypes type = functions[i]->type();
+            ar & type;
+
+            std::vector<mic::types::MatrixPtr<T> > matrices = functions[i]->stateMatrices();
+            size_t num_matrices = matrices.size();
+            ar & num_matrices;
+            for (size_t j = 0; j < num_matrices; j++)
+                ar & (*matrices[j]);
+
+            std::vector<T*> scalars = functions[i]->stateScalars();
+            size_t num_scalars = scalars.size();
+            ar & num_scalars;
+            for (size_t j = 0; j < num_scalars; j++)
+                ar & (*scalars[j]);
+        }//: for
+    }
+
+    /*!
+     * Serialization load - recreates the optimization functions and restores their internal state.
+     * @param ar Used archive.
+     * @param version Version of the array (not used currently).
+     */
+    template<class Archive>
+    void load(Archive & ar, const unsigned int version) {
+        functions.clear();
+        ar & keys_map;
+        size_t size;
+        ar & size;
+        for (size_t i = 0; i < size; i++) {
+            OptimizationFunctionTypes type;
+            ar & type;
+            // Sizes are restored along with the state matrices.
+            std::shared_ptr<OptimizationFunction<T> > function = createOptimizationFunction<T>(type, 0, 0);
+            if (!function)
+                throw std::runtime_error("Undefined type of optimization function");
+
+            std::vector<mic::types::MatrixPtr<T> > matrices = function->stateMatrices();
+            size_t num_matrices;
+            ar & num_matrices;
+            if (num_matrices != matrices.size())
+                throw std::runtime_error("Invalid state of optimization function");
+            for (size_t j = 0; j < num_matrices; j++)
+                ar & (*matrices[j]);
+
+            std::vector<T*> scalars = function->stateScalars();
+            size_t num_scalars;
+            ar & num_scalars;
+            if (num_scalars != scalars.size())
+                throw std::runtime_error("Invalid state of optimization function");
+            for (size_t j = 0; j < num_scalars; j++)
+                ar & (*scalars[j]);
+
+            functions.push_back(function);
+        }//: for
+    }
+
+    // The serialization must be splited as load requires to allocate the memory.
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
 };
 
 
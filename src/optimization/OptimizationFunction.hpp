@@ -26,12 +26,37 @@
 #ifndef OPTIMIZATIONFUNCTIONS_HPP_
 #define OPTIMIZATIONFUNCTIONS_HPP_
 
+#include <cmath>
+#include <vector>
+
 #include <types/MatrixTypes.hpp>
 
 namespace mic {
 namespace neural_nets {
 namespace optimization {
 
+/*!
+ * \brief Enumeration of types of optimization functions - used during the serialization.
+ * \author tkornuta
+ */
+enum class OptimizationFunctionTypes : short
+{
+	Undefined = 0,
+	GradientDescent,
+	Momentum,
+	AdaGrad,
+	RMSProp,
+	AdaDelta,
+	Adam,
+	AdamID,
+	GradPID,
+	AdaGradPID,
+	HebbianRule,
+	NormalizedHebbianRule,
+	BinaryCorrelatorLearningRule,
+	NormalizedZerosumHebbianRule
+};
+
 /*!
  * \brief Abstract class representing interface to optimization function.
  * \author tkornuta
@@ -45,29 +70,109 @@ public:
 	 */
 	OptimizationFunction () { }
 
+	/*!
+	 * Copy constructor. Does not copy the cached update, so the copies (e.g. clones) calculate their updates independently.
+	 */
+	OptimizationFunction (const OptimizationFunction<eT> &) { }
+
 	/// Virtual destructor - empty.
 	virtual ~OptimizationFunction () { }
 
 	/*!
-	 * Method responsible for performing the update using backpropagation and gradient descent. Calls abstract method calculateUpdate().
+	 * Method responsible for performing the update using backpropagation and gradient descent.
+	 * Updates all elements of the parameter in place with applyUpdate() and then advances the optimization function to the next step.
 	 * @param p_ Pointer to the current parameter (matrix).
 	 * @param dp_ Pointer to current gradient of that parameter (matrix).
 	 * @param learning_rate_ Learning rate.
 	 * @param decay_ Weight decay rate (determining that the "unused/unupdated" weights will decay to 0) (DEFAULT = 0.0 means "no decay").
 	 */
 	virtual void update(mic::types::MatrixPtr<eT> p_, mic::types::MatrixPtr<eT> dp_, eT learning_rate_, eT decay_ = 0.0) {
+		assert(p_->size() == dp_->size());
+
+		// Perform the update: x = x - delta (with optional weight decay).
+		applyUpdate(p_->data(), dp_->data(), 0, p_->size(), learning_rate_, decay_);
+
+		// Advance the step-dependent state.
+		nextStep();
+	}
+
+	/*!
+	 * Fused in-place update of the parameter elements with indices from the [begin_, end_) range: x = (1 - decay) * x - delta,
+	 * with the gradient read and the parameter written exactly once (the internal state of the optimization function is updated on the way).
+	 * Disjoint ranges can be updated concurrently, nextStep() must be called once all elements were updated.
+	 * The default implementation calculates the update with calculateUpdate(), hence supports only updates of whole parameters (see supportsRanges()).
+	 * @param p_ Pointer to the data of the parameter.
+	 * @param dp_ Pointer to the data of the gradient of that parameter.
+	 * @param begin_ Index of the first updated element.
+	 * @param end_ Index following the last updated element.
+	 * @param learning_rate_ Learning rate.
+	 * @param decay_ Weight decay rate.
+	 */
+	virtual void applyUpdate(eT* p_, const eT* dp_, size_t begin_, size_t end_, eT learning_rate_, eT decay_) {
+		assert(begin_ == 0);
+
+		// Copy the parameter and its gradient.
+		mic::types::MatrixPtr<eT> p = MAKE_MATRIX_PTR(eT, end_, 1);
+		mic::types::MatrixPtr<eT> dp = MAKE_MATRIX_PTR(eT, end_, 1);
+		for (size_t i=0; i< end_; i++) {
+			(*p)[i] = p_[i];
+			(*dp)[i] = dp_[i];
+		}//: for
 
 		// Calculate the update.
-		mic::types::MatrixPtr<eT> delta = calculateUpdate(p_, dp_, learning_rate_);
+		mic::types::MatrixPtr<eT> delta = calculateUpdate(p, dp, learning_rate_);
 
 		//assert(std::isfinite((*delta)[i]));
 
-		// Perform the update: x = x - delta (with optional weight decay).
-		for (size_t i=0; i< (size_t)delta->size(); i++) {
-			(*p_)[i] = (1.0f - decay_) * (*p_)[i] - (*delta)[i];
+		for (size_t i=0; i< end_; i++) {
+			p_[i] = (1.0f - decay_) * p_[i] - (*delta)[i];
 		}//: for
 	}
 
+	/*!
+	 * Returns true if applyUpdate() supports arbitrary [begin_, end_) ranges, so disjoint ranges of the parameter can be updated concurrently.
+	 * False (default) for functions updating only whole parameters - e.g. relying on the default applyUpdate().
+	 */
+	virtual bool supportsRanges() {
+		return false;
+	}
+
+	/*!
+	 * Advances the step-dependent state of the optimization function (e.g. bias corrections) - called once per update of the whole parameter. Empty by default.
+	 */
+	virtual void nextStep() { }
+
+	/*!
+	 * Creates a copy of the optimization function with its own internal state (e.g. for a replica of a layer updating the shared parameters).
+	 * Returns nullptr (default) if the optimization function cannot be copied.
+	 */
+	virtual std::shared_ptr<OptimizationFunction<eT> > clone() {
+		return nullptr;
+	}
+
+	/*!
+	 * Returns the type of the optimization function. Functions of undefined type (default) are not serialized.
+	 */
+	virtual OptimizationFunctionTypes type() {
+		return OptimizationFunctionTypes::Undefined;
+	}
+
+	/*!
+	 * Returns the matrices storing the internal state of the optimization function (e.g. moments) - serialized along with the network.
+	 * Empty (default) for stateless functions.
+	 */
+	virtual std::vector<mic::types::MatrixPtr<eT> > stateMatrices() {
+		return std::vector<mic::types::MatrixPtr<eT> >();
+	}
+
+	/*!
+	 * Returns pointers to the scalars of the optimization function (hyperparameters and step-dependent scalars, e.g. bias corrections) - serialized along with the network.
+	 * Empty (default) for functions without scalars.
+	 */
+	virtual std::vector<eT*> stateScalars() {
+		return std::vector<eT*>();
+	}
+
 	/*!
 	 * Updates the weight matrix according to the hebbian rule.
 	 * @param p_ Pointer to the parameter (weight) matrix.
@@ -96,6 +201,32 @@ public:
 	 */
 	virtual mic::types::MatrixPtr<eT> calculateUpdate(mic::types::MatrixPtr<eT> x_, mic::types::MatrixPtr<eT> dx_, eT learning_rate_) = 0;
 
+protected:
+	/*!
+	 * Calculates the update by applying the fused update (applyUpdate() followed by nextStep()) to a copy of the current matrix.
+	 * Used by the optimization functions implementing applyUpdate() to provide calculateUpdate().
+	 * @param x_ Pointer to the current matrix.
+	 * @param dx_ Pointer to current gradient of that matrix.
+	 * @param learning_rate_ Learning rate.
+	 */
+	mic::types::MatrixPtr<eT> calculateFusedUpdate(mic::types::MatrixPtr<eT> x_, mic::types::MatrixPtr<eT> dx_, eT learning_rate_) {
+		assert(x_->size() == dx_->size());
+
+		// Allocate the update only once (or when the size of the matrix changes).
+		if ((!fused_delta) || (fused_delta->rows() != x_->rows()) || (fused_delta->cols() != x_->cols()))
+			fused_delta = MAKE_MATRIX_PTR(eT, x_->rows(), x_->cols());
+
+		(*fused_delta) = (*x_);
+		applyUpdate(fused_delta->data(), dx_->data(), 0, fused_delta->size(), learning_rate_, 0.0);
+		nextStep();
+
+		// delta = x - updated x.
+		(*fused_delta) = (*x_) - (*fused_delta);
+		return fused_delta;
+	}
+
+	/// Update calculated by calculateFusedUpdate() - reused in the consecutive calls.
+	mic::types::MatrixPtr<eT> fused_delta;
 
 
 };
@@ -31,6 +31,8 @@
 #include <optimization/GradientDescent.hpp>
 #include <optimization/Momentum.hpp>
 #include <optimization/RMSProp.hpp>
+#include <optimization/AdamID.hpp>
+#include <optimization/GradPID.hpp>
 
 
 #include <optimization/HebbianRule.hpp>
@@ -39,4 +41,93 @@
 
 #include <optimization/NormalizedZerosumHebbianRule.hpp>
 
+#include <memory>
+#include <string>
+
+namespace mic {
+namespace neural_nets {
+namespace optimization {
+
+/*!
+ * Creates an optimization function of a given type - e.g. to be filled during deserialization.
+ * @param type_ Type of the optimization function.
+ * @param rows_ Number of rows of the updated matrix.
+ * @param cols_ Number of columns of the updated matrix.
+ * @return Pointer to the function (empty if the type is undefined).
+ */
+template <typename eT>
+std::shared_ptr<OptimizationFunction<eT> > createOptimizationFunction(OptimizationFunctionTypes type_, size_t rows_, size_t cols_) {
+	switch(type_) {
+	case(OptimizationFunctionTypes::GradientDescent):
+		return std::make_shared<GradientDescent<eT> >(rows_, cols_);
+	case(OptimizationFunctionTypes::Momentum):
+		return std::make_shared<Momentum<eT> >(rows_, cols_);
+	case(OptimizationFunctionTypes::AdaGrad):
+		return std::make_shared<AdaGrad<eT> >(rows_, cols_);
+	case(OptimizationFunctionTypes::RMSProp):
+		return std::make_shared<RMSProp<eT> >(rows_, cols_);
+	case(OptimizationFunctionTypes::AdaDelta):
+		return std::make_shared<AdaDelta<eT> >(rows_, cols_);
+	case(OptimizationFunctionTypes::Adam):
+		return std::make_shared<Adam<eT> >(rows_, cols_);
+	case(OptimizationFunctionTypes::AdamID):
+		return std::make_shared<AdamID<eT> >(rows_, cols_);
+	case(OptimizationFunctionTypes::GradPID):
+		return std::make_shared<GradPID<eT> >(rows_, cols_);
+	case(OptimizationFunctionTypes::AdaGradPID):
+		return std::make_shared<AdaGradPID<eT> >(rows_, cols_);
+	case(OptimizationFunctionTypes::HebbianRule):
+		return std::make_shared<mic::neural_nets::learning::HebbianRule<eT> >(rows_, cols_);
+	case(OptimizationFunctionTypes::NormalizedHebbianRule):
+		return std::make_shared<mic::neural_nets::learning::NormalizedHebbianRule<eT> >(rows_, cols_);
+	case(OptimizationFunctionTypes::BinaryCorrelatorLearningRule):
+		return std::make_shared<mic::neural_nets::learning::BinaryCorrelatorLearningRule<eT> >(rows_, cols_);
+	case(OptimizationFunctionTypes::NormalizedZerosumHebbianRule):
+		return std::make_shared<mic::neural_nets::learning::NormalizedZerosumHebbianRule<eT> >(rows_, cols_);
+	default:
+		return nullptr;
+	}//: switch
+}
+
+/*!
+ * Returns the name of the type of the optimization function.
+ * @param type_ Type of the optimization function.
+ */
+inline std::string optimizationFunctionName(OptimizationFunctionTypes type_) {
+	switch(type_) {
+	case(OptimizationFunctionTypes::GradientDescent):
+		return "GradientDescent";
+	case(OptimizationFunctionTypes::Momentum):
+		return "Momentum";
+	case(OptimizationFunctionTypes::AdaGrad):
+		return "AdaGrad";
+	case(OptimizationFunctionTypes::RMSProp):
+		return "RMSProp";
+	case(OptimizationFunctionTypes::AdaDelta):
+		return "AdaDelta";
+	case(OptimizationFunctionTypes::Adam):
+		return "Adam";
+	case(OptimizationFunctionTypes::AdamID):
+		return "AdamID";
+	case(OptimizationFunctionTypes::GradPID):
+		return "GradPID";
+	case(OptimizationFunctionTypes::AdaGradPID):
+		return "AdaGradPID";
+	case(OptimizationFunctionTypes::HebbianRule):
+		return "HebbianRule";
+	case(OptimizationFunctionTypes::NormalizedHebbianRule):
+		return "NormalizedHebbianRule";
+	case(OptimizationFunctionTypes::BinaryCorrelatorLearningRule):
+		return "BinaryCorrelatorLearningRule";
+	case(OptimizationFunctionTypes::NormalizedZerosumHebbianRule):
+		return "NormalizedZerosumHebbianRule";
+	default:
+		return "Undefined";
+	}//: switch
+}
+
+} //: optimization
+} //: neural_nets
+} //: mic
+
 #endif /* OPTIMIZATIONFUNCTIONTYPES_HPP_ */
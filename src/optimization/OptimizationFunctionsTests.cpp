@@ -38,6 +38,117 @@
 
 #include <gtest/gtest.h>
 
+#include <optimization/OptimizationFunctionTypes.hpp>
+#include <optimization/AdamID.hpp>
+#include <optimization/GradPID.hpp>
+
+using namespace mic::neural_nets::optimization;
+
+/*!
+ * \brief Test Fixture - types of optimization functions implementing the fused update.
+ * \author tkornuta
+ */
+template <typename OptimizationFunctionType>
+class FusedUpdate : public ::testing::Test { };
+
+typedef ::testing::Types<GradientDescent<double>, Momentum<double>, AdaGrad<double>, AdaDelta<double>, RMSProp<double>, Adam<double>, AdamID<double>, GradPID<double>, AdaGradPID<double> > FusedOptimizationFunctions;
+TYPED_TEST_CASE(FusedUpdate, FusedOptimizationFunctions);
+
+
+/*!
+ * Checks whether updating a parameter in two disjoint ranges gives the same result as updating it at once.
+ */
+TYPED_TEST(FusedUpdate, Ranges) {
+	TypeParam whole(5, 4);
+	TypeParam ranges(5, 4);
+
+	mic::types::MatrixPtr<double> x1 = MAKE_MATRIX_PTR(double, 5, 4);
+	x1->rand(-1.0, 1.0);
+	mic::types::MatrixPtr<double> x2 = MAKE_MATRIX_PTR(double, 5, 4);
+	(*x2) = (*x1);
+	mic::types::MatrixPtr<double> dx = MAKE_MATRIX_PTR(double, 5, 4);
+
+	for (size_t step=0; step < 3; step++) {
+		dx->rand(-1.0, 1.0);
+		whole.update(x1, dx, 0.01, 0.001);
+
+		ranges.applyUpdate(x2->data(), dx->data(), 7, 20, 0.01, 0.001);
+		ranges.applyUpdate(x2->data(), dx->data(), 0, 7, 0.01, 0.001);
+		ranges.nextStep();
+
+		for (size_t i=0; i< (size_t)x1->size(); i++)
+			ASSERT_EQ((*x1)[i], (*x2)[i]) << "Difference at position i=" << i << " in step " << step;
+	}//: for
+}
+
+
+/*!
+ * Checks whether the update returned by calculateUpdate() is equal to the one applied by update().
+ */
+TYPED_TEST(FusedUpdate, CalculateUpdate) {
+	TypeParam calculate(5, 4);
+	TypeParam apply(5, 4);
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 5, 4);
+	x->rand(-1.0, 1.0);
+	mic::types::MatrixPtr<double> dx = MAKE_MATRIX_PTR(double, 5, 4);
+
+	for (size_t step=0; step < 3; step++) {
+		dx->rand(-1.0, 1.0);
+		mic::types::Matrix<double> expected = (*x) - (*calculate.calculateUpdate(x, dx, 0.01));
+		apply.update(x, dx, 0.01);
+
+		for (size_t i=0; i< (size_t)x->size(); i++)
+			ASSERT_LE(fabs((*x)[i] - expected[i]), 1e-12) << "Difference at position i=" << i << " in step " << step;
+	}//: for
+}
+
+/*!
+ * Checks whether calculateUpdate() reuses the matrix with the update instead of allocating a new one in every call.
+ */
+TYPED_TEST(FusedUpdate, CalculateUpdateReusesDelta) {
+	TypeParam original(5, 4);
+
+	mic::types::MatrixPtr<double> x = MAKE_MATRIX_PTR(double, 5, 4);
+	x->rand(-1.0, 1.0);
+	mic::types::MatrixPtr<double> dx = MAKE_MATRIX_PTR(double, 5, 4);
+	dx->rand(-1.0, 1.0);
+
+	mic::types::MatrixPtr<double> delta = original.calculateUpdate(x, dx, 0.01);
+	ASSERT_EQ(original.calculateUpdate(x, dx, 0.01), delta);
+
+	// The clone has its own update.
+	std::shared_ptr<OptimizationFunction<double> > copy = original.clone();
+	ASSERT_NE(copy->calculateUpdate(x, dx, 0.01), delta);
+}
+
+/*!
+ * Checks whether a clone continues from the state of the original, but does not share the state with it.
+ */
+TYPED_TEST(FusedUpdate, Clone) {
+	TypeParam original(5, 4);
+
+	mic::types::MatrixPtr<double> x1 = MAKE_MATRIX_PTR(double, 5, 4);
+	x1->rand(-1.0, 1.0);
+	mic::types::MatrixPtr<double> dx = MAKE_MATRIX_PTR(double, 5, 4);
+	dx->rand(-1.0, 1.0);
+	original.update(x1, dx, 0.01);
+
+	std::shared_ptr<OptimizationFunction<double> > copy = original.clone();
+	ASSERT_NE(copy, nullptr);
+	mic::types::MatrixPtr<double> x2 = MAKE_MATRIX_PTR(double, 5, 4);
+	(*x2) = (*x1);
+
+	for (size_t step=0; step < 3; step++) {
+		dx->rand(-1.0, 1.0);
+		original.update(x1, dx, 0.01);
+		copy->update(x2, dx, 0.01);
+
+		for (size_t i=0; i< (size_t)x1->size(); i++)
+			ASSERT_EQ((*x1)[i], (*x2)[i]) << "Difference at position i=" << i << " in step " << step;
+	}//: for
+}
+
 
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
@@ -46,36 +46,80 @@ public:
 	 */
 	RMSProp(size_t rows_, size_t cols_, eT decay_ = 0.9, eT eps_ = 1e-8) : decay(decay_), eps(eps_) {
 		EG = MAKE_MATRIX_PTR(eT, rows_, cols_);
-		delta = MAKE_MATRIX_PTR(eT, rows_, cols_);
-		// Reset EG and delta.
+		// Reset EG.
 		EG->zeros();
-		delta->zeros();
 	}
 
 	/*!
 	 * Calculates the update according to the RMSProp update rule.
 	 * @param x_ Pointer to the current matrix.
 	 * @param dx_ Pointer to current gradient of that matrix.
-	 * @param learning_rate_ Learning rate (default=0.001). NOT USED!
+	 * @param learning_rate_ Learning rate.
 	 */
 	mic::types::MatrixPtr<eT> calculateUpdate(mic::types::MatrixPtr<eT> x_, mic::types::MatrixPtr<eT> dx_, eT learning_rate_) {
-		assert(x_->size() == dx_->size());
-		assert(x_->size() == EG->size());
-
-		// Update decaying sum of squares of gradients - up to time t.
-		for (size_t i=0; i<(size_t)x_->size(); i++) {
-			(*EG)[i] = decay *(*EG)[i] + (1.0 - decay) * (*dx_)[i] * (*dx_)[i];
-			assert(std::isfinite((*EG)[i]));
-		}
-
-		// Calculate updates - and store as previous (already) = - RMS(ED)/(RMS(G) * dx
-		for (size_t i=0; i<(size_t)x_->size(); i++){
-			(*delta)[i] = (learning_rate_ / std::sqrt((*EG)[i] + eps)) * (*dx_)[i];
-			assert(std::isfinite((*delta)[i]));
-		}
-
-		// Return the update.
-		return delta;
+		return OptimizationFunction<eT>::calculateFusedUpdate(x_, dx_, learning_rate_);
+	}
+
+	/*!
+	 * Performs the fused in-place RMSProp update of the parameter elements from the [begin_, end_) range.
+	 * @param p_ Pointer to the data of the parameter.
+	 * @param dp_ Pointer to the data of the gradient of that parameter.
+	 * @param begin_ Index of the first updated element.
+	 * @param end_ Index following the last updated element.
+	 * @param learning_rate_ Learning rate.
+	 * @param decay_ Weight decay rate.
+	 */
+	void applyUpdate(eT* p_, const eT* dp_, size_t begin_, size_t end_, eT learning_rate_, eT decay_) {
+		assert(end_ <= (size_t)EG->size());
+		eT* EG_data = EG->data();
+		eT keep = 1.0f - decay_;
+
+#pragma omp simd
+		for (size_t i=begin_; i< end_; i++) {
+			eT dx = dp_[i];
+			// Update decaying sum of squares of gradients - up to time t.
+			eT EGi = decay * EG_data[i] + (1.0 - decay) * dx * dx;
+			EG_data[i] = EGi;
+			// x = x - alpha / RMS(G) * dx.
+			p_[i] = keep * p_[i] - (learning_rate_ / std::sqrt(EGi + eps)) * dx;
+		}//: for
+	}
+
+	/*!
+	 * Returns true - disjoint ranges of the parameter can be updated concurrently.
+	 */
+	bool supportsRanges() {
+		return true;
+	}
+
+	/*!
+	 * Creates a copy of the optimization function with its own internal state.
+	 */
+	std::shared_ptr<OptimizationFunction<eT> > clone() {
+		std::shared_ptr<RMSProp<eT> > copy = std::make_shared<RMSProp<eT> >(*this);
+		copy->EG = MAKE_MATRIX_PTR(eT, *EG);
+		return copy;
+	}
+
+	/*!
+	 * Returns the type of the optimization function.
+	 */
+	OptimizationFunctionTypes type() {
+		return OptimizationFunctionTypes::RMSProp;
+	}
+
+	/*!
+	 * Returns the matrices storing the internal state of the optimization function.
+	 */
+	std::vector<mic::types::MatrixPtr<eT> > stateMatrices() {
+		return {EG};
+	}
+
+	/*!
+	 * Returns pointers to the hyperparameters and the step-dependent scalars of the optimization function.
+	 */
+	std::vector<eT*> stateScalars() {
+		return {&decay, &eps};
 	}
 
 protected:
@@ -87,9 +131,6 @@ protected:
 
 	/// Decaying average of the squares of gradients up to time t ("diagonal matrix") - E[g^2].
 	mic::types::MatrixPtr<eT> EG;
-
-	/// Calculated update.
-	mic::types::MatrixPtr<eT> delta;
 };
 
 } //: optimization
@@ -0,0 +1,114 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file conv_winograd_benchmark.cpp
+ * \brief Benchmark comparing the im2col and Winograd F(2x2,3x3) engines of the convolution layer - both in terms of multiplications and time.
+ * \author tkornuta
+ * \date Oct 16, 2026
+ */
+
+#include <logger/Log.hpp>
+#include <logger/ConsoleOutput.hpp>
+using namespace mic::logger;
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+
+#include <mlnn/convolution/Convolution.hpp>
+
+using namespace mic::mlnn::convolution;
+using namespace mic::types;
+
+/// Number of measured passes.
+const size_t iterations = 20;
+
+/// Size of the batch.
+const size_t batch_size = 64;
+
+/*!
+ * Returns the average duration (in milliseconds) of forward and backward (dx only) passes of a given layer.
+ */
+std::pair<double, double> measure(Convolution<float> & layer_, MatrixPtr<float> x_, MatrixPtr<float> dy_) {
+	// Warm-up.
+	layer_.forward(x_);
+	layer_.backward(dy_);
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (size_t i=0; i< iterations; i++)
+		layer_.forward(x_);
+	double forward_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / iterations;
+
+	// Set the gradient once, then measure back-propagation to dx only (dW is computed by im2col in both engines).
+	layer_.backward(dy_);
+	start = std::chrono::high_resolution_clock::now();
+	for (size_t i=0; i< iterations; i++)
+		layer_.backpropagade_dy_to_dx();
+	double dx_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / iterations;
+
+	return std::make_pair(forward_ms, dx_ms);
+}
+
+/*!
+ * Compares engines on a given geometry of a 3x3 stride 1 convolution.
+ */
+void benchmark(size_t height_, size_t width_, size_t channels_, size_t filters_) {
+	Convolution<float> im2col(height_, width_, channels_, filters_, 3, 1);
+	im2col.setEngine(ConvolutionEngine::Im2Col);
+	im2col.resizeBatch(batch_size);
+	Convolution<float> winograd(height_, width_, channels_, filters_, 3, 1);
+	winograd.setEngine(ConvolutionEngine::Winograd);
+	winograd.resizeBatch(batch_size);
+
+	MatrixPtr<float> x = MAKE_MATRIX_PTR(float, im2col.inputSize(), batch_size);
+	x->rand(-1.0, 1.0);
+	MatrixPtr<float> dy = MAKE_MATRIX_PTR(float, im2col.outputSize(), batch_size);
+	dy->rand(-1.0, 1.0);
+
+	// Multiplications in the forward pass: 9 per output pixel in im2col, 16 per 2x2 output tile in Winograd (both per filter and input channel).
+	size_t out_h = height_ - 2, out_w = width_ - 2;
+	double im2col_mults = (double)batch_size * filters_ * channels_ * out_h * out_w * 9;
+	double winograd_mults = (double)batch_size * filters_ * channels_ * ((out_h+1)/2) * ((out_w+1)/2) * 16;
+
+	std::pair<double, double> t_im2col = measure(im2col, x, dy);
+	std::pair<double, double> t_winograd = measure(winograd, x, dy);
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "Convolution " << height_ << "x" << width_ << "x" << channels_ << " -> " << out_h << "x" << out_w << "x" << filters_ << " (batch of " << batch_size << "):" << std::endl;
+	std::cout << "  * multiplications : im2col " << im2col_mults / 1e6 << " M, winograd " << winograd_mults / 1e6 << " M (reduction "
+			<< im2col_mults / winograd_mults << "x)" << std::endl;
+	std::cout << "  * forward         : im2col " << t_im2col.first << " ms, winograd " << t_winograd.first << " ms (speedup "
+			<< t_im2col.first / t_winograd.first << "x)" << std::endl;
+	std::cout << "  * dx              : im2col " << t_im2col.second << " ms, winograd " << t_winograd.second << " ms (speedup "
+			<< t_im2col.second / t_winograd.second << "x)" << std::endl;
+	// Engine selected by default.
+	Convolution<float> automatic(height_, width_, channels_, filters_, 3, 1);
+	std::cout << "  * auto engine     : " << (automatic.useWinograd() ? "winograd" : "im2col") << std::endl;
+}
+
+
+int main() {
+	// Set console output.
+	LOGGER->addOutput(new ConsoleOutput());
+
+	// Convolutional layers of the mnist_convnet topology.
+	benchmark(26, 26, 1, 16);
+	benchmark(12, 12, 16, 32);
+	// Wider layer.
+	benchmark(32, 32, 64, 64);
+
+	return 0;
+}
@@ -0,0 +1,368 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file layer_benchmark.cpp
+ * \brief Microbenchmark suite measuring the throughput of forward, backward and update of every type of layer and of every optimization function,
+ * across a sweep of sizes, batch sizes and both precisions. Results are written in CSV or JSON, runs stored in CSV can be compared to catch regressions.
+ * \author tkornuta
+ * \date Oct 16, 2026
+ */
+
+#include <logger/Log.hpp>
+#include <logger/ConsoleOutput.hpp>
+using namespace mic::logger;
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <functional>
+#include <vector>
+#include <map>
+#include <string>
+#include <cstdlib>
+
+#include <mlnn/layer/LayerTypes.hpp>
+#include <optimization/OptimizationFunctionTypes.hpp>
+
+// Using multi layer neural networks
+using namespace mic::mlnn;
+using namespace mic::types;
+using namespace mic::neural_nets::optimization;
+
+/// Minimal duration of the measurement of a single operation [ms].
+double min_time_ms = 50;
+
+/// Size of the batch used by the hebbian rules.
+const size_t hebbian_batch_size = 16;
+
+/*!
+ * \brief Result of a single measurement.
+ */
+struct Measurement {
+	/// Precision (float/double).
+	std::string precision;
+
+	/// Kind of the benchmarked object (layer/optimizer).
+	std::string kind;
+
+	/// Type of the layer or optimization function.
+	std::string name;
+
+	/// Configuration (sizes).
+	std::string config;
+
+	/// Size of the batch (0 - not applicable).
+	size_t batch;
+
+	/// Measured phase (forward/backward/update).
+	std::string phase;
+
+	/// Number of measured repetitions.
+	size_t iterations;
+
+	/// Mean time of the operation [us].
+	double mean_us;
+
+	/// Throughput.
+	double throughput;
+
+	/// Unit of the throughput.
+	std::string unit;
+
+	/*!
+	 * Returns the key identifying the measurement across runs.
+	 */
+	std::string key() const {
+		return precision + "," + kind + "," + name + "," + config + "," + std::to_string(batch) + "," + phase;
+	}
+};
+
+/// Results of all measurements.
+std::vector<Measurement> results;
+
+/*!
+ * Measures the mean time of the operation [us] - after a warm-up repeats it until the minimal time elapses (at least three times).
+ * @param op_ Operation.
+ * @param iterations_ Set to the number of repetitions.
+ */
+double measure(std::function<void()> op_, size_t & iterations_) {
+	op_();
+	iterations_ = 0;
+	double elapsed_us = 0;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	do {
+		op_();
+		iterations_++;
+		elapsed_us = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+	} while ((elapsed_us < 1000.0 * min_time_ms) || (iterations_ < 3));
+	return elapsed_us / iterations_;
+}
+
+/*!
+ * Measures the operation and stores the result.
+ * @param units_ Number of units (samples, elements) processed by a single operation.
+ */
+template <typename eT>
+void record(std::string kind_, std::string name_, std::string config_, size_t batch_, std::string phase_, std::function<void()> op_, double units_, std::string unit_) {
+	Measurement m;
+	m.precision = (sizeof(eT) == sizeof(float)) ? "float" : "double";
+	m.kind = kind_;
+	m.name = name_;
+	m.config = config_;
+	m.batch = batch_;
+	m.phase = phase_;
+	m.mean_us = measure(op_, m.iterations);
+	m.throughput = (m.mean_us > 0) ? 1e6 * units_ / m.mean_us : 0;
+	m.unit = unit_;
+	results.push_back(m);
+	std::cerr << std::left << std::setw(7) << m.precision << std::setw(30) << m.name << std::setw(22) << m.config << std::right << std::setw(4) << m.batch
+			<< " " << std::left << std::setw(9) << m.phase << std::right << std::fixed << std::setprecision(2) << std::setw(12) << m.mean_us << " us" << std::endl;
+}
+
+/*!
+ * Measures forward, backward and update of the layer.
+ * @param layer_ Layer.
+ * @param config_ Configuration of the layer.
+ * @param batch_ Size of the batch.
+ * @param backward_ Flag denoting whether the layer supports backpropagation.
+ * @param update_ Flag denoting whether the layer has parameters to be updated.
+ */
+template <typename eT>
+void benchmarkLayer(std::shared_ptr<Layer<eT> > layer_, std::string config_, size_t batch_, bool backward_, bool update_) {
+	layer_->resizeBatch(batch_);
+	MatrixPtr<eT> x = MAKE_MATRIX_PTR(eT, layer_->inputSize(), batch_);
+	x->rand(0.0, 1.0);
+	MatrixPtr<eT> dy = MAKE_MATRIX_PTR(eT, layer_->outputSize(), batch_);
+	dy->rand(-1.0, 1.0);
+
+	record<eT>("layer", layer_->type(), config_, batch_, "forward", [&]() { layer_->forward(x); }, batch_, "samples/s");
+	if (backward_)
+		record<eT>("layer", layer_->type(), config_, batch_, "backward", [&]() { layer_->backward(dy); }, batch_, "samples/s");
+	if (update_)
+		record<eT>("layer", layer_->type(), config_, batch_, "update", [&]() { layer_->update(0.001, 0.0); }, batch_, "samples/s");
+}
+
+/*!
+ * Returns the configuration string (dimensions joined with 'x').
+ */
+std::string dims(std::vector<size_t> dims_) {
+	std::string config;
+	for (size_t i = 0; i < dims_.size(); i++)
+		config += (i > 0 ? "x" : "") + std::to_string(dims_[i]);
+	return config;
+}
+
+/*!
+ * Benchmarks all types of layers.
+ */
+template <typename eT>
+void benchmarkLayers() {
+	for (size_t batch : {1, 16, 64}) {
+		// Activation functions, cost functions and regularisation - sizes of inputs.
+		for (size_t n : {256, 1024, 4096}) {
+			std::string config = dims({n});
+			benchmarkLayer<eT>(std::make_shared<activation_function::ELU<eT> >(n), config, batch, true, false);
+			benchmarkLayer<eT>(std::make_shared<activation_function::ReLU<eT> >(n), config, batch, true, false);
+			benchmarkLayer<eT>(std::make_shared<activation_function::Sigmoid<eT> >(n), config, batch, true, false);
+			benchmarkLayer<eT>(std::make_shared<cost_function::Softmax<eT> >(n), config, batch, true, false);
+			benchmarkLayer<eT>(std::make_shared<regularisation::Dropout<eT> >(n, 0.5f), config, batch, true, false);
+		}//: for
+
+		// Fully connected layers - inputs x outputs.
+		for (std::pair<size_t, size_t> io : std::vector<std::pair<size_t, size_t> >{{256, 64}, {1024, 256}, {4096, 1024}}) {
+			std::string config = dims({io.first, io.second});
+			benchmarkLayer<eT>(std::make_shared<fully_connected::Linear<eT> >(io.first, io.second), config, batch, true, true);
+			benchmarkLayer<eT>(std::make_shared<fully_connected::SparseLinear<eT> >(io.first, io.second), config, batch, true, true);
+			benchmarkLayer<eT>(std::make_shared<fully_connected::FusedLinear<eT> >(io.first, io.second, activation_function::kernels::Activation::ELU), config, batch, true, true);
+			benchmarkLayer<eT>(std::make_shared<fully_connected::HebbianLinear<eT> >(io.first, io.second), config, batch, false, true);
+			benchmarkLayer<eT>(std::make_shared<fully_connected::BinaryCorrelator<eT> >(io.first, io.second), config, batch, false, true);
+		}//: for
+
+		// Convolutions (3x3, stride 1) - height/width x channels x filters.
+		for (std::vector<size_t> hcf : std::vector<std::vector<size_t> >{{12, 4, 8}, {26, 1, 16}, {12, 16, 32}}) {
+			benchmarkLayer<eT>(std::make_shared<convolution::Convolution<eT> >(hcf[0], hcf[0], hcf[1], hcf[2], 3, 1), dims({hcf[0], hcf[0], hcf[1], hcf[2]}), batch, true, true);
+		}//: for
+
+		// Pooling (window 2) - height/width x channels.
+		for (std::pair<size_t, size_t> hc : std::vector<std::pair<size_t, size_t> >{{12, 4}, {24, 16}, {48, 16}}) {
+			benchmarkLayer<eT>(std::make_shared<convolution::MaxPooling<eT> >(hc.first, hc.first, hc.second, 2), dims({hc.first, hc.first, hc.second}), batch, true, false);
+		}//: for
+
+		// Padding and cropping (margin 2) handle single channel inputs - height/width.
+		for (size_t h : {12, 24, 48}) {
+			std::string config = dims({h, h, 1});
+			benchmarkLayer<eT>(std::make_shared<convolution::Padding<eT> >(h, h, 1, 2), config, batch, true, false);
+			benchmarkLayer<eT>(std::make_shared<convolution::Cropping<eT> >(h, h, 1, 2), config, batch, true, false);
+		}//: for
+	}//: for
+
+	// Hebbian convolution processes single samples - height/width x filters x filter size.
+	for (std::vector<size_t> hff : std::vector<std::vector<size_t> >{{12, 8, 3}, {28, 16, 5}}) {
+		benchmarkLayer<eT>(std::make_shared<experimental::ConvHebbian<eT> >(hff[0], hff[0], 1, hff[1], hff[2]), dims({hff[0], hff[0], hff[1], hff[2]}), 1, false, true);
+	}//: for
+}
+
+/*!
+ * Benchmarks all optimization functions.
+ */
+template <typename eT>
+void benchmarkOptimizers() {
+	for (short t = (short)OptimizationFunctionTypes::GradientDescent; t <= (short)OptimizationFunctionTypes::NormalizedZerosumHebbianRule; t++) {
+		OptimizationFunctionTypes type = (OptimizationFunctionTypes)t;
+		bool hebbian = (type >= OptimizationFunctionTypes::HebbianRule);
+		// Rows x cols of the updated matrix.
+		for (std::pair<size_t, size_t> rc : std::vector<std::pair<size_t, size_t> >{{64, 256}, {256, 1024}, {1024, 4096}}) {
+			std::shared_ptr<OptimizationFunction<eT> > opt = createOptimizationFunction<eT>(type, rc.first, rc.second);
+			MatrixPtr<eT> p = MAKE_MATRIX_PTR(eT, rc.first, rc.second);
+			p->rand(-0.1, 0.1);
+			std::string config = dims({rc.first, rc.second});
+			double elements = rc.first * rc.second;
+			if (hebbian) {
+				// Hebbian rules learn from inputs and outputs.
+				MatrixPtr<eT> x = MAKE_MATRIX_PTR(eT, rc.second, hebbian_batch_size);
+				x->rand(0.0, 1.0);
+				MatrixPtr<eT> y = MAKE_MATRIX_PTR(eT, rc.first, hebbian_batch_size);
+				y->rand(0.0, 1.0);
+				record<eT>("optimizer", optimizationFunctionName(type), config, hebbian_batch_size, "update", [&]() { opt->update(p, x, y, 0.001); }, elements, "elements/s");
+			} else {
+				MatrixPtr<eT> dp = MAKE_MATRIX_PTR(eT, rc.first, rc.second);
+				dp->rand(-0.1, 0.1);
+				record<eT>("optimizer", optimizationFunctionName(type), config, 0, "update", [&]() { opt->update(p, dp, 0.001, 0.0); }, elements, "elements/s");
+			}//: else
+		}//: for
+	}//: for
+}
+
+/*!
+ * Writes the results in CSV format.
+ */
+void writeCSV(std::ostream & os_) {
+	os_ << "precision,kind,name,config,batch,phase,iterations,mean_us,throughput,unit" << std::endl;
+	for (const Measurement & m : results)
+		os_ << m.key() << "," << m.iterations << "," << std::setprecision(9) << m.mean_us << "," << m.throughput << "," << m.unit << std::endl;
+}
+
+/*!
+ * Writes the results in JSON format.
+ */
+void writeJSON(std::ostream & os_) {
+	os_ << "{\"benchmark\":\"layer_benchmark\",\"min_time_ms\":" << min_time_ms << ",\"results\":[";
+	for (size_t i = 0; i < results.size(); i++) {
+		const Measurement & m = results[i];
+		os_ << (i > 0 ? ",\n" : "\n") << "{\"precision\":\"" << m.precision << "\",\"kind\":\"" << m.kind << "\",\"name\":\"" << m.name
+			<< "\",\"config\":\"" << m.config << "\",\"batch\":" << m.batch << ",\"phase\":\"" << m.phase << "\",\"iterations\":" << m.iterations
+			<< ",\"mean_us\":" << std::setprecision(9) << m.mean_us << ",\"throughput\":" << m.throughput << ",\"unit\":\"" << m.unit << "\"}";
+	}//: for
+	os_ << "\n]}" << std::endl;
+}
+
+/*!
+ * Reads mean times from the file with results in CSV format.
+ * @return Mean times indexed by keys of the measurements.
+ */
+std::map<std::string, double> readCSV(std::string filename_) {
+	std::map<std::string, double> times;
+	std::ifstream ifs(filename_);
+	std::string line;
+	// Skip header.
+	std::getline(ifs, line);
+	while (std::getline(ifs, line)) {
+		std::vector<std::string> fields;
+		std::stringstream ss(line);
+		std::string field;
+		while (std::getline(ss, field, ','))
+			fields.push_back(field);
+		if (fields.size() != 10)
+			continue;
+		std::string key = fields[0];
+		for (size_t i = 1; i < 6; i++)
+			key += "," + fields[i];
+		times[key] = atof(fields[7].c_str());
+	}//: while
+	return times;
+}
+
+/*!
+ * Compares two runs, reports operations that got slower by more than the threshold.
+ * @return Number of regressions.
+ */
+size_t compare(std::string baseline_, std::string current_, double threshold_) {
+	std::map<std::string, double> baseline = readCSV(baseline_);
+	std::map<std::string, double> current = readCSV(current_);
+	size_t regressions = 0;
+	size_t compared = 0;
+	std::cout << std::fixed << std::setprecision(2);
+	for (std::pair<const std::string, double> & entry : current) {
+		std::map<std::string, double>::iterator it = baseline.find(entry.first);
+		if ((it == baseline.end()) || (it->second <= 0))
+			continue;
+		compared++;
+		double change = 100.0 * (entry.second - it->second) / it->second;
+		if (change > threshold_) {
+			std::cout << "REGRESSION " << entry.first << ": " << it->second << " us -> " << entry.second << " us (+" << change << " %)" << std::endl;
+			regressions++;
+		}//: if
+	}//: for
+	std::cout << compared << " operations compared, " << regressions << " regressions above " << threshold_ << " %" << std::endl;
+	return regressions;
+}
+
+
+/**
+ * \brief Main function of the benchmark.
+ * Usage:
+ *   layer_benchmark [csv|json] [output_file=- (stdout)] [min_time_ms=50]
+ *   layer_benchmark compare <baseline.csv> <current.csv> [threshold_percent=10]
+ */
+int main(int argc, char* argv[]) {
+	// Set console output.
+	LOGGER->addOutput(new ConsoleOutput());
+
+	if ((argc > 1) && (std::string(argv[1]) == "compare")) {
+		if (argc < 4) {
+			std::cout << "Usage: " << argv[0] << " compare <baseline.csv> <current.csv> [threshold_percent=10]" << std::endl;
+			return -1;
+		}//: if
+		return (compare(argv[2], argv[3], (argc > 4) ? atof(argv[4]) : 10.0) > 0) ? 1 : 0;
+	}//: if
+
+	std::string format = (argc > 1) ? argv[1] : "csv";
+	std::string output = (argc > 2) ? argv[2] : "-";
+	if (argc > 3)
+		min_time_ms = atof(argv[3]);
+	if ((format != "csv") && (format != "json")) {
+		std::cout << "Usage: " << argv[0] << " [csv|json] [output_file=-] [min_time_ms=50]" << std::endl;
+		return -1;
+	}//: if
+
+	benchmarkLayers<float>();
+	benchmarkLayers<double>();
+	benchmarkOptimizers<float>();
+	benchmarkOptimizers<double>();
+
+	std::ofstream ofs;
+	if (output != "-")
+		ofs.open(output);
+	std::ostream & os = (output != "-") ? ofs : std::cout;
+	if (format == "csv")
+		writeCSV(os);
+	else
+		writeJSON(os);
+
+	return 0;
+}
@@ -0,0 +1,85 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file layer_handles_benchmark.cpp
+ * \brief Microbenchmark comparing string-keyed and handle-based matrix lookups. Per-layer timings are measured by layer_benchmark.
+ * \author tkornuta
+ * \date Oct 16, 2026
+ */
+
+#include <logger/Log.hpp>
+#include <logger/ConsoleOutput.hpp>
+using namespace mic::logger;
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+
+#include <mlnn/layer/LayerTypes.hpp>
+
+// Using multi layer neural networks
+using namespace mic::mlnn;
+using namespace mic::types;
+
+/// Number of iterations of the lookup benchmark.
+const size_t lookup_iterations = 1000000;
+
+/*!
+ * Returns time (in microseconds) elapsed since the given time point.
+ */
+double elapsed(std::chrono::high_resolution_clock::time_point start_) {
+	return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start_).count();
+}
+
+/*!
+ * Compares the cost of looking a matrix up by its name and by its handle.
+ */
+void benchmarkLookups() {
+	// Array resembling the temporary matrices of a convolutional layer.
+	MatrixArray<float> m("m");
+	for (size_t ry=0; ry< 8; ry++)
+		for (size_t rx=0; rx< 8; rx++)
+			m.add ("xrf"+std::to_string(ry)+"x"+std::to_string(rx), 3, 3);
+	m.setZero();
+	size_t handle = Layer<float>::resolveHandle(m, "xrf7x7");
+
+	float sum = 0;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (size_t i=0; i< lookup_iterations; i++) {
+		size_t ry = i % 8, rx = (i/8) % 8;
+		sum += (*m["xrf"+std::to_string(ry)+"x"+std::to_string(rx)])(0);
+	}//: for
+	double string_us = elapsed(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	for (size_t i=0; i< lookup_iterations; i++)
+		sum += (*m[handle])(0);
+	double handle_us = elapsed(start);
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "Lookup of a matrix (average of " << lookup_iterations << " lookups, checksum " << sum << "):" << std::endl;
+	std::cout << "  * by name   : " << 1000.0 * string_us / lookup_iterations << " ns" << std::endl;
+	std::cout << "  * by handle : " << 1000.0 * handle_us / lookup_iterations << " ns" << std::endl;
+}
+
+int main() {
+	// Set console output.
+	LOGGER->addOutput(new ConsoleOutput());
+
+	benchmarkLookups();
+
+	return 0;
+}
@@ -29,6 +29,8 @@ using namespace mic::logger;
 #include <encoders/UIntMatrixXfEncoder.hpp>
 
 #include <mlnn/BackpropagationNeuralNetwork.hpp>
+#include <mlnn/BatchPipeline.hpp>
+#include <mlnn/CheckpointWriter.hpp>
 
 using namespace mic::types;
 // Using multi layer neural networks
@@ -110,26 +112,36 @@ int main() {
 	double 	weight_decay = 1e-5;
 	size_t iterations = training.size() / batch_size;
 
+	// Batches returned by the pipelines remain unchanged till the next ones are requested - so the network can read them directly.
+	nn.setInputBinding();
+
+	// Pipelines preparing (sampling and encoding) the batches on a background thread, up to 8 batches in advance.
+	BatchPipeline<float> training_pipeline(28*28, 10, batch_size, 8, 1, BatchPipeline<float>::randomBatches(training, mnist_encoder, label_encoder));
+	BatchPipeline<float> training_test_pipeline(28*28, 10, batch_size, 8, 1, BatchPipeline<float>::nextBatches(training, mnist_encoder, label_encoder));
+	BatchPipeline<float> test_pipeline(28*28, 10, batch_size, 8, 1, BatchPipeline<float>::nextBatches(test, mnist_encoder, label_encoder));
+
+	// Checkpoints of the network (with the state of Adam) written on a background thread after every epoch, the last 3 are kept.
+	CheckpointWriter<float> checkpoints("mnist_conv", iterations, 3);
+
 	MatrixXfPtr encoded_batch, encoded_targets;
 	// For all epochs.
 	for (size_t e = 0; e < epochs; e++) {
 		LOG(LSTATUS) << "Epoch " << e + 1 << ": starting the training of neural network...";
 		// Perform the training.
+		training_pipeline.start(iterations);
 		for (size_t ii = 0; ii < iterations; ii++) {
 			std::cout<< "[" << std::setw(4) << ii << "/" << std::setw(4) << iterations << "] ";
 
 			// Get random batch [784 x batch_size].
-            MNISTBatch<float> rand_batch = training.getRandomBatch();
-			encoded_batch  = mnist_encoder.encodeBatch(rand_batch.data());
-			encoded_targets  = label_encoder.encodeBatch(rand_batch.labels());
+			training_pipeline.next(encoded_batch, encoded_targets);
 
 			// Train network with batch.
 			float loss = nn.train (encoded_batch, encoded_targets, learning_rate, weight_decay);
 			std::cout << " loss = " << loss << std::endl;
-		}//: for iteration
 
-		// Save results to file.
-		nn.save("mnist_conv");
+			// Take the snapshot of the network at the end of the epoch.
+			checkpoints.step(nn);
+		}//: for iteration
 
 		LOG(LSTATUS) << "Training finished";
 
@@ -137,12 +149,9 @@ int main() {
 		LOG(LSTATUS) << "Calculating performance for test dataset...";
 		size_t correct = 0;
 		test.setNextSampleIndex(0);
-		while(!test.isLastBatch()) {
-
-			// Get next batch [784 x batch_size].
-            MNISTBatch<float> next_batch = test.getNextBatch();
-			encoded_batch  = mnist_encoder.encodeBatch(next_batch.data());
-			encoded_targets  = label_encoder.encodeBatch(next_batch.labels());
+		test_pipeline.start((test.size() + batch_size - 1) / batch_size);
+		// Get next batch [784 x batch_size].
+		while(test_pipeline.next(encoded_batch, encoded_targets)) {
 
 			// Test network response.
 			correct += nn.test(encoded_batch, encoded_targets);
@@ -155,12 +164,9 @@ int main() {
 		LOG(LSTATUS) << "Calculating performance for the training dataset...";
 		correct = 0;
 		training.setNextSampleIndex(0);
-		while(!training.isLastBatch()) {
-
-			// Get next batch [784 x batch_size].
-            MNISTBatch<float> next_batch = training.getNextBatch();
-			encoded_batch  = mnist_encoder.encodeBatch(next_batch.data());
-			encoded_targets  = label_encoder.encodeBatch(next_batch.labels());
+		training_test_pipeline.start((training.size() + batch_size - 1) / batch_size);
+		// Get next batch [784 x batch_size].
+		while(training_test_pipeline.next(encoded_batch, encoded_targets)) {
 
 			// Test network response.
 			correct += nn.test(encoded_batch, encoded_targets);
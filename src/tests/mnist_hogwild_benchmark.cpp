@@ -0,0 +1,147 @@
+/*!
+ * Copyright (C) tkornuta, IBM Corporation 2015-2019
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*!
+ * \file mnist_hogwild_benchmark.cpp
+ * \brief Benchmark comparing the sequential train() with the asynchronous (Hogwild!) training of the mnist_simple_mlnn network - in terms of samples/sec and final accuracy.
+ * \author tkornuta
+ * \date Oct 16, 2026
+ */
+
+#include <logger/Log.hpp>
+#include <logger/ConsoleOutput.hpp>
+using namespace mic::logger;
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <importers/MNISTMatrixImporter.hpp>
+#include <encoders/MatrixXfMatrixXfEncoder.hpp>
+#include <encoders/UIntMatrixXfEncoder.hpp>
+
+#include <mlnn/BackpropagationNeuralNetwork.hpp>
+
+// Using multi layer neural networks
+using namespace mic::mlnn;
+using namespace mic::types;
+
+/// Size of the batch.
+const size_t batch_size = 20;
+
+/// Learning rate.
+const float learning_rate = 0.001;
+
+/*!
+ * Creates the network of the mnist_simple_mlnn application.
+ */
+void createNetwork(BackpropagationNeuralNetwork<float> & nn_) {
+	nn_.pushLayer(new mic::mlnn::convolution::Convolution<float>(28, 28, 1, 20, 14, 7));
+	nn_.pushLayer(new ReLU<float>(180));
+	nn_.pushLayer(new Linear<float>(180, 10));
+	nn_.pushLayer(new Softmax<float>(10));
+	nn_.verify();
+}
+
+/*!
+ * Returns the accuracy of the network on a given dataset.
+ */
+double accuracy(BackpropagationNeuralNetwork<float> & nn_, mic::importers::MNISTMatrixImporter<float> & dataset_,
+		mic::encoders::MatrixXfMatrixXfEncoder & mnist_encoder_, mic::encoders::UIntMatrixXfEncoder & label_encoder_) {
+	size_t correct = 0;
+	dataset_.setNextSampleIndex(0);
+	while(!dataset_.isLastBatch()) {
+		MNISTBatch<float> next_batch = dataset_.getNextBatch();
+		MatrixXfPtr encoded_batch  = mnist_encoder_.encodeBatch(next_batch.data());
+		MatrixXfPtr encoded_targets  = label_encoder_.encodeBatch(next_batch.labels());
+
+		nn_.forward(encoded_batch, true);
+		correct += nn_.countCorrectPredictions(encoded_targets, nn_.getPredictions());
+	}//: while
+	return (double)correct / (double)(dataset_.size());
+}
+
+
+int main(int argc, char* argv[]) {
+	// Set console output.
+	LOGGER->addOutput(new ConsoleOutput());
+
+	// Number of workers - passed as the first argument, equal to the number of threads by default.
+	size_t workers = 1;
+#ifdef _OPENMP
+	workers = omp_get_max_threads();
+#endif
+	if (argc > 1)
+		workers = atoi(argv[1]);
+
+	// Load the MNIST training...
+	mic::importers::MNISTMatrixImporter<float> training;
+	training.setDataFilename("../data/mnist/train-images.idx3-ubyte");
+	training.setLabelsFilename("../data/mnist/train-labels.idx1-ubyte");
+	training.setBatchSize(batch_size);
+	if (!training.importData())
+		return -1;
+
+	// ... and test datasets.
+	mic::importers::MNISTMatrixImporter<float> test;
+	test.setDataFilename("../data/mnist/t10k-images.idx3-ubyte");
+	test.setLabelsFilename("../data/mnist/t10k-labels.idx1-ubyte");
+	test.setBatchSize(batch_size);
+	if (!test.importData())
+		return -1;
+
+	// Initialize the encoders.
+	mic::encoders::MatrixXfMatrixXfEncoder mnist_encoder(28, 28);
+	mic::encoders::UIntMatrixXfEncoder label_encoder(10);
+
+	// Encode a single epoch of random batches up front, so both modes are measured without data preparation.
+	std::vector<MatrixXfPtr> batches, targets;
+	for (size_t ii = 0; ii < training.size()/batch_size; ii++) {
+		MNISTBatch<float> rand_batch = training.getRandomBatch();
+		batches.push_back(mnist_encoder.encodeBatch(rand_batch.data()));
+		targets.push_back(label_encoder.encodeBatch(rand_batch.labels()));
+	}//: for
+
+	// Sequential training.
+	BackpropagationNeuralNetwork<float> sequential("sequential");
+	createNetwork(sequential);
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (size_t ii = 0; ii < batches.size(); ii++)
+		sequential.train(batches[ii], targets[ii], learning_rate);
+	double sequential_s = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	// Asynchronous training.
+	BackpropagationNeuralNetwork<float> hogwild("hogwild");
+	createNetwork(hogwild);
+	start = std::chrono::high_resolution_clock::now();
+	hogwild.trainAsynchronous(batches, targets, learning_rate, 0.0f, workers);
+	double hogwild_s = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	double samples = (double)batches.size() * batch_size;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "Single epoch of MNIST (" << batches.size() << " batches of " << batch_size << "):" << std::endl;
+	std::cout << "  * sequential train()          : " << samples / sequential_s << " samples/s, test accuracy "
+			<< 100.0 * accuracy(sequential, test, mnist_encoder, label_encoder) << " %" << std::endl;
+	std::cout << "  * asynchronous (" << std::setw(2) << workers << " workers)   : " << samples / hogwild_s << " samples/s, test accuracy "
+			<< 100.0 * accuracy(hogwild, test, mnist_encoder, label_encoder) << " %" << std::endl;
+	std::cout << "  * speedup                     : " << sequential_s / hogwild_s << "x" << std::endl;
+
+	return 0;
+}
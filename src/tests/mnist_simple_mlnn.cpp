@@ -29,6 +29,7 @@ using namespace mic::logger;
 #include <encoders/UIntMatrixXfEncoder.hpp>
 
 #include <mlnn/BackpropagationNeuralNetwork.hpp>
+#include <mlnn/BatchPipeline.hpp>
 
 // Using multi layer neural networks
 using namespace mic::mlnn;
@@ -89,14 +90,19 @@ int main() {
 	float learning_rate = 0.001;
 	MatrixXfPtr encoded_batch, encoded_targets;
 
+	// Batches returned by the pipelines remain unchanged till the next ones are requested - so the network can read them directly.
+	nn.setInputBinding();
+
+	// Prepare (sample and encode) the batches on a background thread, up to 8 batches in advance.
+	BatchPipeline<float> training_pipeline(28*28, 10, batch_size, 8, 1, BatchPipeline<float>::randomBatches(training, mnist_encoder, label_encoder));
+	training_pipeline.start(iterations);
+
 	// Perform the training.
 	for (size_t ii = 0; ii < iterations; ii++) {
 		LOG(LINFO) << "Batch " << std::setw(4) << ii << "/" << std::setw(4) << iterations;
 
 		// Get random batch [784 x batch_size].
-		MNISTBatch<float> rand_batch = training.getRandomBatch();
-		encoded_batch  = mnist_encoder.encodeBatch(rand_batch.data());
-		encoded_targets  = label_encoder.encodeBatch(rand_batch.labels());
+		training_pipeline.next(encoded_batch, encoded_targets);
 
 		// Train network with batch.
 		float loss = nn.train (encoded_batch, encoded_targets, learning_rate);
@@ -109,12 +115,10 @@ int main() {
 	size_t correct = 0;
 	float loss = 0.0;
 	test.setNextSampleIndex(0);
-	while(!test.isLastBatch()) {
-
-		// Get next batch [784 x batch_size].
-		MNISTBatch<float> next_batch = test.getNextBatch();
-		encoded_batch  = mnist_encoder.encodeBatch(next_batch.data());
-		encoded_targets  = label_encoder.encodeBatch(next_batch.labels());
+	BatchPipeline<float> test_pipeline(28*28, 10, batch_size, 8, 1, BatchPipeline<float>::nextBatches(test, mnist_encoder, label_encoder));
+	test_pipeline.start((test.size() + batch_size - 1) / batch_size);
+	// Get next batch [784 x batch_size].
+	while(test_pipeline.next(encoded_batch, encoded_targets)) {
 
 		// Test network response.
 		// Skip dropout layers at test time
@@ -134,12 +138,10 @@ int main() {
 	correct = 0;
 	loss = 0;
 	training.setNextSampleIndex(0);
-	while(!training.isLastBatch()) {
-
-		// Get next batch [784 x batch_size].
-		MNISTBatch<float> next_batch = training.getNextBatch();
-		encoded_batch  = mnist_encoder.encodeBatch(next_batch.data());
-		encoded_targets  = label_encoder.encodeBatch(next_batch.labels());
+	BatchPipeline<float> training_test_pipeline(28*28, 10, batch_size, 8, 1, BatchPipeline<float>::nextBatches(training, mnist_encoder, label_encoder));
+	training_test_pipeline.start((training.size() + batch_size - 1) / batch_size);
+	// Get next batch [784 x batch_size].
+	while(training_test_pipeline.next(encoded_batch, encoded_targets)) {
 
 		// Test network response.
 		// Skip dropout layers at test time